@@ -0,0 +1,90 @@
+#
+# Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+#
+# This file is part of Fun from Faces (f3).
+#
+# f3 is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# f3 is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+
+QT += core xml
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+win32 {
+	TEMPLATE = vcapp
+	QMAKE_LFLAGS += /INCREMENTAL:NO
+} else {
+	TEMPLATE = app
+}
+
+SOURCES += main.cpp \
+           commands.cpp
+
+HEADERS += commands.h
+
+win32 {
+	INCLUDEPATH += C:\opencv-2.4.10\build\include
+	LIBS += -LC:\opencv-2.4.10\build\x86\vc11\lib
+} else:unix {
+	INCLUDEPATH += /usr/local/include
+	LIBS += -L/usr/local/lib
+}
+
+DEPENDS += ../core
+INCLUDEPATH += ../core
+
+CONFIG(debug, debug|release) {
+
+	TARGET = f3clid
+	DESTDIR = ../debug
+	OBJECTS_DIR = ../debug/tmp/cli
+	MOC_DIR = ../debug/tmp/cli
+	RCC_DIR = ../debug/tmp/cli
+	UI_DIR = ../debug/tmp/cli
+
+	LIBS += -L../debug
+	LIBS += -lf3cored
+
+	win32 {
+		LIBS += -lopencv_core2410d
+	} else:unix {
+		LIBS += -lopencv_core
+	}
+
+} else {
+
+	TARGET = f3cli
+	DESTDIR = ../release
+	OBJECTS_DIR = ../release/tmp/cli
+	MOC_DIR = ../release/tmp/cli
+	RCC_DIR = ../release/tmp/cli
+	UI_DIR = ../release/tmp/cli
+
+	LIBS += -L../release
+	LIBS += -lf3core
+
+	win32 {
+		LIBS += -lopencv_core2410
+	} else:unix {
+		LIBS += -lopencv_core
+	}
+}
+
+unix {
+    target.path = /usr/local/bin
+    INSTALLS += target
+}
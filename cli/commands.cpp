@@ -0,0 +1,593 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "commands.h"
+#include "parallel.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QSet>
+#include <QVector>
+#include <QRegExp>
+
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+// +-----------------------------------------------------------
+f3::Commands::Commands()
+{
+}
+
+// +-----------------------------------------------------------
+int f3::Commands::run(QStringList lsArgs)
+{
+	// Optional number of worker threads (by default, one per processor core)
+	int iPos = lsArgs.indexOf("--threads");
+	if(iPos != -1)
+	{
+		bool bOK = false;
+		int iThreads = iPos + 1 < lsArgs.size() ? lsArgs[iPos + 1].toInt(&bOK) : 0;
+		if(!bOK || iThreads < 1)
+		{
+			printError(QCoreApplication::translate("Commands", "número de threads inválido"));
+			return 1;
+		}
+
+		QThreadPool::globalInstance()->setMaxThreadCount(iThreads);
+		lsArgs.removeAt(iPos + 1);
+		lsArgs.removeAt(iPos);
+	}
+
+	if(lsArgs.isEmpty())
+	{
+		printUsage();
+		return 1;
+	}
+
+	QString sCommand = lsArgs.takeFirst();
+	if(sCommand == "convert")
+		return convert(lsArgs);
+	else if(sCommand == "validate")
+		return validate(lsArgs);
+	else if(sCommand == "merge")
+		return merge(lsArgs);
+	else if(sCommand == "filter")
+		return filter(lsArgs);
+	else if(sCommand == "split")
+		return split(lsArgs);
+	else if(sCommand == "shard")
+		return shard(lsArgs);
+	else if(sCommand == "summarize")
+		return summarize(lsArgs);
+	else if(sCommand == "query")
+		return query(lsArgs);
+	else if(sCommand == "export")
+		return exportCSV(lsArgs);
+	else if(sCommand == "help")
+	{
+		printUsage();
+		return 0;
+	}
+
+	printError(QCoreApplication::translate("Commands", "comando desconhecido [%1]").arg(sCommand));
+	printUsage();
+	return 1;
+}
+
+// +-----------------------------------------------------------
+int f3::Commands::convert(const QStringList &lsArgs)
+{
+	if(lsArgs.size() != 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	FaceDataset oDataset;
+	if(!load(lsArgs[0], oDataset) || !save(oDataset, lsArgs[1]))
+		return 2;
+
+	printMessage(QCoreApplication::translate("Commands", "%1 imagens gravadas em [%2]").arg(oDataset.size()).arg(lsArgs[1]));
+	return 0;
+}
+
+// +-----------------------------------------------------------
+int f3::Commands::validate(const QStringList &lsArgs)
+{
+	if(lsArgs.size() != 1)
+	{
+		printUsage();
+		return 1;
+	}
+
+	FaceDataset oDataset;
+	if(!load(lsArgs[0], oDataset))
+		return 2;
+
+	// Check the images in parallel, since reading the image files is the most expensive part
+	QVector<QStringList> vProblems(oDataset.size());
+	int iNumFeatures = oDataset.numFeatures();
+	oDataset.parallelForEach([&vProblems, iNumFeatures](int iIndex, const FaceImage *pImage) {
+		vProblems[iIndex] = checkImage(pImage, iNumFeatures);
+	});
+
+	// Check the duplicated images and report all problems in the order of the images
+	QSet<QString> setFiles;
+	int iProblems = 0;
+	for(int i = 0; i < oDataset.size(); i++)
+	{
+		QString sFile = oDataset.getImage(i)->fileName();
+		if(setFiles.contains(sFile))
+			vProblems[i].append(QCoreApplication::translate("Commands", "a imagem [%1] está duplicada").arg(sFile));
+		else
+			setFiles.insert(sFile);
+
+		foreach(QString sProblem, vProblems[i])
+			printError(sProblem);
+		iProblems += vProblems[i].size();
+	}
+
+	if(iProblems > 0)
+	{
+		printMessage(QCoreApplication::translate("Commands", "%1 problemas encontrados em [%2]").arg(iProblems).arg(lsArgs[0]));
+		return 3;
+	}
+
+	printMessage(QCoreApplication::translate("Commands", "nenhum problema encontrado em [%1]").arg(lsArgs[0]));
+	return 0;
+}
+
+// +-----------------------------------------------------------
+QStringList f3::Commands::checkImage(const FaceImage *pImage, const int iNumFeatures)
+{
+	QStringList lsRet;
+	QString sFile = pImage->fileName();
+
+	if(!QFileInfo(sFile).exists())
+	{
+		lsRet.append(QCoreApplication::translate("Commands", "a imagem [%1] não existe").arg(sFile));
+		return lsRet;
+	}
+
+	Mat oImage = pImage->mat();
+	if(oImage.empty())
+	{
+		lsRet.append(QCoreApplication::translate("Commands", "a imagem [%1] não pôde ser lida").arg(sFile));
+		return lsRet;
+	}
+
+	vector<FaceFeature*> vFeatures = pImage->getFeatures();
+	if((int) vFeatures.size() != iNumFeatures)
+		lsRet.append(QCoreApplication::translate("Commands", "a imagem [%1] tem %2 marcas faciais, mas o banco define %3").arg(sFile).arg(vFeatures.size()).arg(iNumFeatures));
+
+	foreach(FaceFeature *pFeat, vFeatures)
+	{
+		if(pFeat->x < 0 || pFeat->y < 0 || pFeat->x >= oImage.cols || pFeat->y >= oImage.rows)
+			lsRet.append(QCoreApplication::translate("Commands", "a marca facial %1 da imagem [%2] está fora dos limites da imagem").arg(pFeat->getID()).arg(sFile));
+	}
+
+	return lsRet;
+}
+
+// +-----------------------------------------------------------
+int f3::Commands::merge(const QStringList &lsArgs)
+{
+	if(lsArgs.size() < 3)
+	{
+		printUsage();
+		return 1;
+	}
+
+	// Load all input datasets in parallel (one dataset per chunk)
+	vector<FaceDataset*> vInputs(lsArgs.size() - 1);
+	QVector<bool> vLoaded(vInputs.size());
+	for(int i = 0; i < (int) vInputs.size(); i++)
+		vInputs[i] = new FaceDataset();
+
+	Parallel::forRange(vInputs.size(), [&lsArgs, &vInputs, &vLoaded](int iBegin, int iEnd) {
+		for(int i = iBegin; i < iEnd; i++)
+			vLoaded[i] = load(lsArgs[i + 1], *vInputs[i]);
+	}, 1);
+
+	// Merge them in the order given, ignoring the images already added
+	int iRet = 0;
+	int iIgnored = 0;
+	FaceDataset oOutput;
+	QSet<QString> setFiles;
+	for(int i = 0; i < (int) vInputs.size() && iRet == 0; i++)
+	{
+		FaceDataset *pInput = vInputs[i];
+		if(!vLoaded[i])
+			iRet = 2;
+		else if(i == 0)
+		{
+			oOutput.setNumFeatures(pInput->numFeatures());
+			oOutput.setConnections(pInput->connections());
+		}
+		else if(pInput->numFeatures() != oOutput.numFeatures())
+		{
+			printError(QCoreApplication::translate("Commands", "o banco [%1] tem %2 marcas faciais, mas o banco [%3] tem %4").arg(lsArgs[i + 1]).arg(pInput->numFeatures()).arg(lsArgs[1]).arg(oOutput.numFeatures()));
+			iRet = 2;
+		}
+
+		for(int j = 0; j < pInput->size() && iRet == 0; j++)
+		{
+			const FaceImage *pImage = pInput->getImage(j);
+			if(setFiles.contains(pImage->fileName()))
+				iIgnored++;
+			else
+			{
+				setFiles.insert(pImage->fileName());
+				oOutput.appendImage(pImage);
+			}
+		}
+	}
+
+	foreach(FaceDataset *pInput, vInputs)
+		delete pInput;
+
+	if(iRet != 0)
+		return iRet;
+
+	if(!save(oOutput, lsArgs[0]))
+		return 2;
+
+	printMessage(QCoreApplication::translate("Commands", "%1 imagens gravadas em [%2] (%3 imagens duplicadas ignoradas)").arg(oOutput.size()).arg(lsArgs[0]).arg(iIgnored));
+	return 0;
+}
+
+// +-----------------------------------------------------------
+int f3::Commands::filter(const QStringList &lsArgs)
+{
+	if(lsArgs.size() != 3)
+	{
+		printUsage();
+		return 1;
+	}
+
+	// The emotion label can be given by its name or by its value
+	QStringList lsLabels = EmotionLabel::getLabels();
+	bool bOK = false;
+	int iLabel = lsArgs[2].toInt(&bOK);
+	if(!bOK)
+		iLabel = lsLabels.indexOf(QRegExp(QRegExp::escape(lsArgs[2]), Qt::CaseInsensitive));
+	if(iLabel < 0 || iLabel >= lsLabels.size())
+	{
+		printError(QCoreApplication::translate("Commands", "rótulo de emoção desconhecido [%1]").arg(lsArgs[2]));
+		return 1;
+	}
+
+	FaceDataset oDataset;
+	if(!load(lsArgs[0], oDataset))
+		return 2;
+
+	// The images selected are saved from a view, so they are not copied
+	FaceDatasetView oView(&oDataset, [iLabel](int, const FaceImage *pImage) -> bool {
+		return pImage->emotionLabel().getValue() == iLabel;
+	});
+	if(!save(oView, lsArgs[1]))
+		return 2;
+
+	printMessage(QCoreApplication::translate("Commands", "%1 imagens gravadas em [%2]").arg(oView.size()).arg(lsArgs[1]));
+	return 0;
+}
+
+// +-----------------------------------------------------------
+int f3::Commands::split(const QStringList &lsArgs)
+{
+	bool bOK = false;
+	int iParts = lsArgs.size() == 3 ? lsArgs[1].toInt(&bOK) : 0;
+	if(!bOK || iParts < 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	FaceDataset oDataset;
+	if(!load(lsArgs[0], oDataset))
+		return 2;
+
+	if(iParts > oDataset.size())
+	{
+		printError(QCoreApplication::translate("Commands", "o banco [%1] tem apenas %2 imagens").arg(lsArgs[0]).arg(oDataset.size()));
+		return 2;
+	}
+
+	// Distribute the images in contiguous blocks of similar sizes (as views, so no image is copied)
+	vector<FaceDatasetView> vOutputs;
+	QStringList lsFiles;
+	int iBegin = 0;
+	for(int i = 0; i < iParts; i++)
+	{
+		lsFiles.append(QString("%1-%2.afd").arg(lsArgs[2]).arg(i + 1));
+
+		int iEnd = (int) (((qint64) oDataset.size() * (i + 1)) / iParts);
+		vOutputs.push_back(FaceDatasetView::range(&oDataset, iBegin, iEnd));
+		iBegin = iEnd;
+	}
+
+	// Save the parts in parallel (one part per chunk)
+	QVector<bool> vSaved(iParts);
+	Parallel::forRange(iParts, [&lsFiles, &vOutputs, &vSaved](int iBegin, int iEnd) {
+		for(int i = iBegin; i < iEnd; i++)
+			vSaved[i] = save(vOutputs[i], lsFiles[i]);
+	}, 1);
+
+	int iRet = 0;
+	for(int i = 0; i < iParts; i++)
+	{
+		if(vSaved[i])
+			printMessage(QCoreApplication::translate("Commands", "%1 imagens gravadas em [%2]").arg(vOutputs[i].size()).arg(lsFiles[i]));
+		else
+			iRet = 2;
+	}
+
+	return iRet;
+}
+
+// +-----------------------------------------------------------
+int f3::Commands::shard(const QStringList &lsArgs)
+{
+	bool bOK = false;
+	int iShards = lsArgs.size() == 3 ? lsArgs[1].toInt(&bOK) : 0;
+	if(!bOK || iShards < 1 || !FaceDatasetManifest::isManifest(lsArgs[2]))
+	{
+		printUsage();
+		return 1;
+	}
+
+	FaceDataset oDataset;
+	if(!load(lsArgs[0], oDataset))
+		return 2;
+
+	if(iShards > oDataset.size())
+	{
+		printError(QCoreApplication::translate("Commands", "o banco [%1] tem apenas %2 imagens").arg(lsArgs[0]).arg(oDataset.size()));
+		return 2;
+	}
+
+	// The shards are contiguous blocks of similar sizes, as in split
+	FaceDatasetManifest oManifest(lsArgs[2]);
+	QString sBaseName = QFileInfo(lsArgs[2]).completeBaseName();
+	int iBegin = 0;
+	for(int i = 0; i < iShards; i++)
+	{
+		int iEnd = (int) (((qint64) oDataset.size() * (i + 1)) / iShards);
+		oManifest.addShard(QString("%1-%2.afd").arg(sBaseName).arg(i + 1), iEnd - iBegin);
+		iBegin = iEnd;
+	}
+	oDataset.setShards(oManifest);
+
+	QString sMsgError;
+	if(!oDataset.prepareShardedSave(lsArgs[2]).saveToFile(sMsgError))
+	{
+		printError(QCoreApplication::translate("Commands", "não foi possível salvar o banco de faces anotadas: %1").arg(sMsgError));
+		return 2;
+	}
+
+	printMessage(QCoreApplication::translate("Commands", "%1 imagens gravadas em %2 partições de [%3]").arg(oDataset.size()).arg(iShards).arg(lsArgs[2]));
+	return 0;
+}
+
+// +-----------------------------------------------------------
+int f3::Commands::query(const QStringList &lsArgs)
+{
+	bool bOK = lsArgs.size() == 2 && lsArgs[1] == "unlabelled";
+	int iFeature = -1;
+	if(lsArgs.size() == 3 && lsArgs[1] == "outside")
+		iFeature = lsArgs[2].toInt(&bOK);
+	if(!bOK)
+	{
+		printUsage();
+		return 1;
+	}
+
+	if(!FaceDatasetStore::isStore(lsArgs[0]))
+	{
+		printError(QCoreApplication::translate("Commands", "o banco [%1] não é um banco de dados SQLite (.afdb)").arg(lsArgs[0]));
+		return 2;
+	}
+
+	FaceDatasetStore oStore;
+	QString sMsgError;
+	vector<int> vIndexes;
+	bool bRun = oStore.open(lsArgs[0], sMsgError);
+	if(bRun)
+		bRun = iFeature < 0 ? oStore.unlabelledSamples(vIndexes, sMsgError) : oStore.samplesWithFeatureOutside(iFeature, vIndexes, sMsgError);
+	if(!bRun)
+	{
+		printError(QCoreApplication::translate("Commands", "não foi possível consultar o banco de faces anotadas: %1").arg(sMsgError));
+		return 2;
+	}
+
+	// Only the images found are read from the database
+	FaceImageBatch vImage;
+	for(unsigned int i = 0; i < vIndexes.size(); i++)
+	{
+		if(!oStore.read(vIndexes[i], 1, vImage, sMsgError) || vImage.empty())
+		{
+			printError(QCoreApplication::translate("Commands", "não foi possível consultar o banco de faces anotadas: %1").arg(sMsgError));
+			return 2;
+		}
+		printMessage(QString("%1\t%2").arg(vIndexes[i]).arg(vImage[0]->fileName()));
+	}
+
+	printMessage(QCoreApplication::translate("Commands", "%1 imagens encontradas em [%2]").arg((int) vIndexes.size()).arg(lsArgs[0]));
+	return 0;
+}
+
+// +-----------------------------------------------------------
+int f3::Commands::summarize(const QStringList &lsArgs)
+{
+	if(lsArgs.size() != 1)
+	{
+		printUsage();
+		return 1;
+	}
+
+	FaceDataset oDataset;
+	if(!load(lsArgs[0], oDataset))
+		return 2;
+
+	// Count the emotion labels and the images with the face features already positioned
+	QStringList lsLabels = EmotionLabel::getLabels();
+	QVector<int> vCount = oDataset.parallelMapReduce<QVector<int> >(
+		[&lsLabels](int, const FaceImage *pImage) -> QVector<int> {
+			QVector<int> vRet(lsLabels.size(), 0);
+			int iLabel = pImage->emotionLabel().getValue();
+			if(iLabel >= 0 && iLabel < vRet.size())
+				vRet[iLabel] = 1;
+			return vRet;
+		},
+		[](const QVector<int> &vFirst, const QVector<int> &vSecond) -> QVector<int> {
+			QVector<int> vRet = vFirst;
+			for(int i = 0; i < vRet.size(); i++)
+				vRet[i] += vSecond[i];
+			return vRet;
+		}, QVector<int>(lsLabels.size(), 0));
+
+	int iAnnotated = oDataset.parallelMapReduce<int>(
+		[](int, const FaceImage *pImage) -> int {
+			foreach(FaceFeature *pFeat, pImage->getFeatures())
+				if(pFeat->x != 0 || pFeat->y != 0)
+					return 1;
+			return 0;
+		},
+		[](const int &iFirst, const int &iSecond) -> int { return iFirst + iSecond; }, 0);
+
+	printMessage(QCoreApplication::translate("Commands", "Arquivo: %1").arg(lsArgs[0]));
+	printMessage(QCoreApplication::translate("Commands", "Imagens: %1").arg(oDataset.size()));
+	printMessage(QCoreApplication::translate("Commands", "Marcas faciais: %1").arg(oDataset.numFeatures()));
+	printMessage(QCoreApplication::translate("Commands", "Imagens com marcas faciais posicionadas: %1").arg(iAnnotated));
+	printMessage(QCoreApplication::translate("Commands", "Rótulos de emoção:"));
+	for(int i = 0; i < lsLabels.size(); i++)
+	{
+		double dPercent = oDataset.size() > 0 ? 100.0 * vCount[i] / oDataset.size() : 0.0;
+		printMessage(QString("    %1: %2 (%3%)").arg(lsLabels[i]).arg(vCount[i]).arg(dPercent, 0, 'f', 1));
+	}
+
+	return 0;
+}
+
+// +-----------------------------------------------------------
+int f3::Commands::exportCSV(const QStringList &lsArgs)
+{
+	if(lsArgs.size() != 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	FaceDataset oDataset;
+	if(!load(lsArgs[0], oDataset))
+		return 2;
+
+	// Format the lines in parallel
+	QVector<QString> vLines(oDataset.size());
+	oDataset.parallelForEach([&vLines](int iIndex, const FaceImage *pImage) {
+		QString sFile = pImage->fileName();
+		sFile.replace("\"", "\"\"");
+
+		QString sLine = QString("\"%1\",%2").arg(sFile).arg(pImage->emotionLabel().getValue());
+		foreach(FaceFeature *pFeat, pImage->getFeatures())
+			sLine += QString(",%1,%2").arg(pFeat->x).arg(pFeat->y);
+		vLines[iIndex] = sLine;
+	});
+
+	QFile oFile(lsArgs[1]);
+	if(!oFile.open(QFile::WriteOnly | QFile::Truncate))
+	{
+		printError(QCoreApplication::translate("Commands", "não foi possível escrever no arquivo [%1]").arg(lsArgs[1]));
+		return 2;
+	}
+
+	QTextStream oData(&oFile);
+	oData.setCodec("UTF-8");
+	oData << "fileName,emotionLabel";
+	for(int i = 0; i < oDataset.numFeatures(); i++)
+		oData << ",x" << i << ",y" << i;
+	oData << "\n";
+
+	foreach(QString sLine, vLines)
+		oData << sLine << "\n";
+	oFile.close();
+
+	printMessage(QCoreApplication::translate("Commands", "%1 imagens exportadas para [%2]").arg(oDataset.size()).arg(lsArgs[1]));
+	return 0;
+}
+
+// +-----------------------------------------------------------
+void f3::Commands::printUsage()
+{
+	printError(QCoreApplication::translate("Commands",
+		"Uso: f3cli [--threads N] <comando> <argumentos>\n"
+		"Comandos:\n"
+		"    convert <entrada.afd> <saida.afd>\n"
+		"    validate <entrada.afd>\n"
+		"    merge <saida.afd> <entrada1.afd> <entrada2.afd> [... <entradaN.afd>]\n"
+		"    filter <entrada.afd> <saida.afd> <emocao>\n"
+		"    split <entrada.afd> <partes> <prefixo de saida>\n"
+		"    shard <entrada.afd> <partes> <saida.afm>\n"
+		"    summarize <entrada.afd>\n"
+		"    query <entrada.afdb> unlabelled | outside <marca>\n"
+		"    export <entrada.afd> <saida.csv>"));
+}
+
+// +-----------------------------------------------------------
+void f3::Commands::printMessage(const QString &sMsg)
+{
+	QTextStream oOut(stdout);
+	oOut << sMsg << endl;
+}
+
+// +-----------------------------------------------------------
+void f3::Commands::printError(const QString &sMsg)
+{
+	QTextStream oErr(stderr);
+	oErr << sMsg << endl;
+}
+
+// +-----------------------------------------------------------
+bool f3::Commands::load(const QString &sFileName, FaceDataset &oDataset)
+{
+	QString sMsg;
+	if(!oDataset.loadFromFile(sFileName, sMsg))
+	{
+		printError(QCoreApplication::translate("Commands", "não foi possível abrir o banco de faces anotadas: %1").arg(sMsg));
+		return false;
+	}
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::Commands::save(const AbstractFaceDataset &oDataset, const QString &sFileName)
+{
+	QString sMsg;
+	if(!oDataset.saveToFile(sFileName, sMsg))
+	{
+		printError(QCoreApplication::translate("Commands", "não foi possível salvar o banco de faces anotadas: %1").arg(sMsg));
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include "facedataset.h"
+#include "facedatasetview.h"
+
+#include <QString>
+#include <QStringList>
+
+namespace f3
+{
+	/**
+	 * Static class with the commands of the command line interface. Each command receives the
+	 * list of its arguments (already without the command name) and returns the exit code of the
+	 * program: 0 for success, 1 for invalid arguments, 2 for processing errors and 3 for datasets
+	 * that failed the validation.
+	 */
+	class Commands
+	{
+	protected:
+		/**
+		 * Protected class constructor to prevent this class from being instantiated.
+		 */
+		Commands();
+
+	public:
+		/**
+		 * Parses the command line arguments and executes the requested command.
+		 * @param lsArgs QStringList with the arguments received from the command line (without
+		 * the program name).
+		 * @return Integer with the exit code of the program.
+		 */
+		static int run(QStringList lsArgs);
+
+		/**
+		 * Converts (reads and rewrites in the current format) a face annotation dataset.
+		 * Arguments: <input file> <output file>.
+		 * @param lsArgs QStringList with the arguments of the command.
+		 * @return Integer with the exit code of the program.
+		 */
+		static int convert(const QStringList &lsArgs);
+
+		/**
+		 * Validates a face annotation dataset, checking if all image files can be read, if they are
+		 * not duplicated and if the face features are located inside the images.
+		 * Arguments: <input file>.
+		 * @param lsArgs QStringList with the arguments of the command.
+		 * @return Integer with the exit code of the program.
+		 */
+		static int validate(const QStringList &lsArgs);
+
+		/**
+		 * Merges two or more face annotation datasets into a new one. Images already included from a
+		 * previous dataset are ignored.
+		 * Arguments: <output file> <input file 1> <input file 2> [... <input file N>].
+		 * @param lsArgs QStringList with the arguments of the command.
+		 * @return Integer with the exit code of the program.
+		 */
+		static int merge(const QStringList &lsArgs);
+
+		/**
+		 * Writes a new face annotation dataset with only the images of the given emotion label.
+		 * Arguments: <input file> <output file> <emotion label (name or value)>.
+		 * @param lsArgs QStringList with the arguments of the command.
+		 * @return Integer with the exit code of the program.
+		 */
+		static int filter(const QStringList &lsArgs);
+
+		/**
+		 * Splits a face annotation dataset into a number of new datasets of similar sizes.
+		 * Arguments: <input file> <number of parts> <output prefix>.
+		 * @param lsArgs QStringList with the arguments of the command.
+		 * @return Integer with the exit code of the program.
+		 */
+		static int split(const QStringList &lsArgs);
+
+		/**
+		 * Converts a face annotation dataset into a sharded dataset (see FaceDatasetManifest), with a
+		 * number of shards of similar sizes. The shards are written next to the manifest.
+		 * Arguments: <input file> <number of shards> <output manifest file>.
+		 * @param lsArgs QStringList with the arguments of the command.
+		 * @return Integer with the exit code of the program.
+		 */
+		static int shard(const QStringList &lsArgs);
+
+		/**
+		 * Prints a summary of a face annotation dataset (number of images, number of face features
+		 * and distribution of the emotion labels).
+		 * Arguments: <input file>.
+		 * @param lsArgs QStringList with the arguments of the command.
+		 * @return Integer with the exit code of the program.
+		 */
+		static int summarize(const QStringList &lsArgs);
+
+		/**
+		 * Lists the images of a face annotation dataset stored in a SQLite database (see FaceDatasetStore)
+		 * that match a query, which is run in the database without loading the dataset. The queries are
+		 * "unlabelled" (images without an emotion label) and "outside <feature index>" (images where
+		 * the face feature lies outside the image area).
+		 * Arguments: <input file> <query> [<query argument>].
+		 * @param lsArgs QStringList with the arguments of the command.
+		 * @return Integer with the exit code of the program.
+		 */
+		static int query(const QStringList &lsArgs);
+
+		/**
+		 * Exports a face annotation dataset to a CSV (Comma Separated Values) file, with one line
+		 * per image containing its file name, emotion label and face feature coordinates.
+		 * Arguments: <input file> <output file>.
+		 * @param lsArgs QStringList with the arguments of the command.
+		 * @return Integer with the exit code of the program.
+		 */
+		static int exportCSV(const QStringList &lsArgs);
+
+	protected:
+		/**
+		 * Prints the usage help to the standard error output.
+		 */
+		static void printUsage();
+
+		/**
+		 * Prints a message to the standard output.
+		 * @param sMsg QString with the message to print.
+		 */
+		static void printMessage(const QString &sMsg);
+
+		/**
+		 * Prints an error message to the standard error output.
+		 * @param sMsg QString with the message to print.
+		 */
+		static void printError(const QString &sMsg);
+
+		/**
+		 * Helper method to load a face annotation dataset, printing an error message in case of failure.
+		 * @param sFileName QString with the name of the file to load.
+		 * @param oDataset Reference to the FaceDataset to receive the data.
+		 * @return Boolean indicating if the loading was successful (true) or failed (false).
+		 */
+		static bool load(const QString &sFileName, FaceDataset &oDataset);
+
+		/**
+		 * Helper method to save a face annotation dataset (or a view of it), printing an error message
+		 * in case of failure.
+		 * @param oDataset Reference to the AbstractFaceDataset with the data to save.
+		 * @param sFileName QString with the name of the file to write.
+		 * @return Boolean indicating if the saving was successful (true) or failed (false).
+		 */
+		static bool save(const AbstractFaceDataset &oDataset, const QString &sFileName);
+
+		/**
+		 * Helper method to check the consistency of a face image (used in the validation). This method
+		 * only reads the given face image, so it can be called concurrently for different images.
+		 * @param pImage Pointer to the FaceImage to check.
+		 * @param iNumFeatures Integer with the number of face features expected in the image.
+		 * @return QStringList with the description of the problems found (empty if there were none).
+		 */
+		static QStringList checkImage(const FaceImage *pImage, const int iNumFeatures);
+	};
+}
+
+#endif // COMMANDS_H
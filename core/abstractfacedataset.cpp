@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "abstractfacedataset.h"
+#include "facedatasetjournal.h"
+
+#include <QUuid>
+
+// +-----------------------------------------------------------
+f3::AbstractFaceDataset::~AbstractFaceDataset()
+{
+}
+
+// +-----------------------------------------------------------
+bool f3::AbstractFaceDataset::saveToFile(const QString &sFileName, QString &sMsgError) const
+{
+	// The file is bound to a new identifier, so no existing journal applies to it
+	FaceDatasetSnapshot oSnapshot = snapshot();
+	oSnapshot.m_sJournalId = QUuid::createUuid().toString();
+	if(!oSnapshot.saveToFile(sFileName, sMsgError))
+		return false;
+
+	FaceDatasetJournal::remove(sFileName);
+	return true;
+}
+
+// +-----------------------------------------------------------
+void f3::AbstractFaceDataset::parallelForEach(const std::function<void (int iIndex, const FaceImage *pImage)> &fFunc) const
+{
+	Parallel::forRange(size(), [&](int iBegin, int iEnd) {
+		for(int i = iBegin; i < iEnd; i++)
+			if(const FaceImage *pImage = getImage(i))
+				fFunc(i, pImage);
+	});
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ABSTRACTFACEDATASET_H
+#define ABSTRACTFACEDATASET_H
+
+#include "core_global.h"
+#include "faceimage.h"
+#include "facefeatureconnections.h"
+#include "facedatasetsnapshot.h"
+#include "parallel.h"
+
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+namespace f3
+{
+	/**
+	 * Abstract interface of a collection of annotated face images, implemented by the datasets
+	 * themselves (see FaceDataset) and by the views over subsets of them (see FaceDatasetView).
+	 * The code that only reads the face images (i.e. to save, export or analyse them) or that
+	 * only changes their contents can therefore work with both, without copying the samples.
+	 */
+	class CORE_EXPORT AbstractFaceDataset
+	{
+	public:
+		/**
+		 * Class destructor.
+		 */
+		virtual ~AbstractFaceDataset();
+
+		/**
+		 * Returns the number of face samples in the collection.
+		 * @return Integer with the number of face samples.
+		 */
+		virtual int size() const = 0;
+
+		/**
+		 * Queries the number of facial features in the collection (applicable to all images).
+		 * @return Integer with the number of face features.
+		 */
+		virtual int numFeatures() const = 0;
+
+		/**
+		 * Gets the connections between the face features (the same for all face images).
+		 * @return Const reference to the FaceFeatureConnections with the connections.
+		 */
+		virtual const FaceFeatureConnections& connections() const = 0;
+
+		/**
+		 * Gets the face image for the given index, for read-only access.
+		 * @param iIndex Integer with the index of the image, in range [0, size() - 1].
+		 * @return Pointer to a const FaceImage with the face image data, or NULL if the index is invalid.
+		 */
+		virtual const FaceImage* getImage(const int iIndex) const = 0;
+
+		/**
+		 * Gets the face image for the given index, in order to change it (see FaceDataset::editImage()).
+		 * @param iIndex Integer with the index of the image, in range [0, size() - 1].
+		 * @return Pointer to a FaceImage with the face image data, or NULL if the index is invalid.
+		 */
+		virtual FaceImage* editImage(const int iIndex) = 0;
+
+		/**
+		 * Takes a snapshot of the current contents of the collection (see FaceDataset::snapshot()).
+		 * @return FaceDatasetSnapshot with the current contents of the collection.
+		 */
+		virtual FaceDatasetSnapshot snapshot() const = 0;
+
+        /**
+         * Saves (serializes) the collection to the given file, as a complete face annotation dataset.
+		 * Any journal of the file is removed, since the file then contains all data. The tracking of
+		 * changes of the dataset is not changed (see FaceDataset::prepareFullSave()).
+         * @param sFileName QString with the name of the file to write the data to.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the saving was successful (true) of failed (false).
+         */
+        bool saveToFile(const QString &sFileName, QString &sMsgError) const;
+
+		/**
+		 * Calls the given function for all face images in the collection, in parallel (see the class
+		 * Parallel). The function only gets read access to the images, and the collection must not be
+		 * changed while this method is running. The images that can not be obtained (i.e. the ones
+		 * that failed to be read in the paging mode of FaceDataset) are skipped.
+		 * @param fFunc Function receiving the index of the image and a pointer to the FaceImage.
+		 * It is called from different threads at the same time, hence it must be thread safe.
+		 */
+		void parallelForEach(const std::function<void (int iIndex, const FaceImage *pImage)> &fFunc) const;
+
+		/**
+		 * Maps all face images in the collection to values of type T and reduces them to a single value,
+		 * in parallel. The values of each chunk of images are reduced in the worker threads, and the
+		 * partial results are then reduced in the order of the images (so the result is deterministic
+		 * even if the reduction is not commutative). Since the type can not be deduced from the
+		 * function objects, it must be explicitly given (i.e. parallelMapReduce<int>(...)).
+		 * @param fMap Function that maps the image with the given index to a value.
+		 * @param fReduce Function that combines two values into one.
+		 * @param oInitial Initial value of the reduction (it must be the identity of fReduce, since
+		 * it is used as the initial value of each chunk).
+		 * @return Value of type T with the result of the reduction.
+		 */
+		template<typename T>
+		T parallelMapReduce(const std::function<T (int iIndex, const FaceImage *pImage)> &fMap, const std::function<T (const T &oFirst, const T &oSecond)> &fReduce, const T &oInitial) const;
+	};
+}
+
+// +-----------------------------------------------------------
+template<typename T>
+T f3::AbstractFaceDataset::parallelMapReduce(const std::function<T (int iIndex, const FaceImage *pImage)> &fMap, const std::function<T (const T &oFirst, const T &oSecond)> &fReduce, const T &oInitial) const
+{
+	int iCount = size();
+	int iGrain = Parallel::grainSize(iCount);
+	QVector<T> vPartials(iCount > 0 ? (iCount - 1) / iGrain + 1 : 0, oInitial);
+
+	Parallel::forRange(iCount, [&](int iBegin, int iEnd) {
+		T &oPartial = vPartials[iBegin / iGrain];
+		for(int i = iBegin; i < iEnd; i++)
+			oPartial = fReduce(oPartial, fMap(i, getImage(i)));
+	}, iGrain);
+
+	T oRet = oInitial;
+	for(int i = 0; i < vPartials.size(); i++)
+		oRet = fReduce(oRet, vPartials[i]);
+	return oRet;
+}
+
+#endif // ABSTRACTFACEDATASET_H
@@ -17,9 +17,7 @@
 # along with this program. If not, see <http://www.gnu.org/licenses/>.
 #
 
-QT += core gui xml
-
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+QT += core gui xml sql
 
 DEFINES += CORE_LIBRARY
 
@@ -32,21 +30,41 @@ win32 {
 
 CONFIG += lib
 
-SOURCES += application.cpp \
-           faceimage.cpp \
+SOURCES += faceimage.cpp \
            facefeature.cpp \
+           abstractfacedataset.cpp \
            facedataset.cpp \
+           facedatasetview.cpp \
+           facedatasetsnapshot.cpp \
+           facedatasetreader.cpp \
+           facedatasetjournal.cpp \
+           facedatasetmanifest.cpp \
+           facedatasetstore.cpp \
+           facedatasetpager.cpp \
+           facefeatureconnections.cpp \
            emotionlabel.cpp \
            logcontrol.cpp \
+           parallel.cpp \
+           taskscheduler.cpp \
            utils.cpp
 
 HEADERS += core_global.h \
-           application.h \
            faceimage.h \
            facefeature.h \
+           abstractfacedataset.h \
            facedataset.h \
+           facedatasetview.h \
+           facedatasetsnapshot.h \
+           facedatasetreader.h \
+           facedatasetjournal.h \
+           facedatasetmanifest.h \
+           facedatasetstore.h \
+           facedatasetpager.h \
+           facefeatureconnections.h \
            emotionlabel.h \
            logcontrol.h \
+           parallel.h \
+           taskscheduler.h \
            utils.h
 
 win32 {
@@ -67,29 +85,9 @@ CONFIG(debug, debug|release) {
 	UI_DIR = ../debug/tmp/core
 
     win32 {
-        LIBS += -lopencv_core2410d \
-                -lopencv_imgproc2410d \
-				-lopencv_highgui2410d \
-				-lopencv_ml2410d \
-				-lopencv_video2410d \
-				-lopencv_features2d2410d \
-				-lopencv_calib3d2410d \
-				-lopencv_objdetect2410d \
-				-lopencv_contrib2410d \
-				-lopencv_legacy2410d \
-				-lopencv_flann2410d
+        LIBS += -lopencv_core2410d
     } else:unix {
-        LIBS += -lopencv_core \
-				-lopencv_imgproc \
-				-lopencv_highgui \
-				-lopencv_ml \
-				-lopencv_video \
-				-lopencv_features2d \
-				-lopencv_calib3d \
-				-lopencv_objdetect \
-				-lopencv_contrib \
-				-lopencv_legacy \
-				-lopencv_flann
+        LIBS += -lopencv_core
     }
 
 } else {
@@ -102,29 +100,9 @@ CONFIG(debug, debug|release) {
 	UI_DIR = ../release/tmp/core
     
     win32 {
-        LIBS += -lopencv_core2410 \
-				-lopencv_imgproc2410 \
-				-lopencv_highgui2410 \
-				-lopencv_ml2410 \
-				-lopencv_video2410 \
-				-lopencv_features2d2410 \
-				-lopencv_calib3d2410 \
-				-lopencv_objdetect2410 \
-				-lopencv_contrib2410 \
-				-lopencv_legacy2410 \
-				-lopencv_flann2410
+        LIBS += -lopencv_core2410
     } else:unix {
-        LIBS += -lopencv_core \
-				-lopencv_imgproc \
-				-lopencv_highgui \
-				-lopencv_ml \
-				-lopencv_video \
-				-lopencv_features2d \
-				-lopencv_calib3d \
-				-lopencv_objdetect \
-				-lopencv_contrib \
-				-lopencv_legacy \
-				-lopencv_flann    
+        LIBS += -lopencv_core
     }
 }
 
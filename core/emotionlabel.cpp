@@ -1,6 +1,6 @@
 #include "emotionlabel.h"
 
-#include <QApplication>
+#include <QCoreApplication>
 #include <QDebug>
 
 /*
@@ -81,21 +81,21 @@ bool f3::EmotionLabel::operator>=(const EmotionLabel &oOther) const
 QString f3::EmotionLabel::getName() const
 {
     if(*this == ANGER)
-        return qApp->translate("EmotionLabel", "Raiva");
+        return QCoreApplication::translate("EmotionLabel", "Raiva");
     else if(*this == CONTEMPT)
-        return qApp->translate("EmotionLabel", "Desprezo");
+        return QCoreApplication::translate("EmotionLabel", "Desprezo");
     else if(*this == DISGUST)
-        return qApp->translate("EmotionLabel", "Nojo");
+        return QCoreApplication::translate("EmotionLabel", "Nojo");
     else if(*this == FEAR)
-        return qApp->translate("EmotionLabel", "Medo");
+        return QCoreApplication::translate("EmotionLabel", "Medo");
     else if(*this == HAPPINESS)
-        return qApp->translate("EmotionLabel", "Felicidade");
+        return QCoreApplication::translate("EmotionLabel", "Felicidade");
     else if(*this == SADNESS)
-        return qApp->translate("EmotionLabel", "Tristeza");
+        return QCoreApplication::translate("EmotionLabel", "Tristeza");
     else if(*this == SURPRISE)
-        return qApp->translate("EmotionLabel", "Surpresa");
+        return QCoreApplication::translate("EmotionLabel", "Surpresa");
     else
-        return qApp->translate("EmotionLabel", "Indefinido");
+        return QCoreApplication::translate("EmotionLabel", "Indefinido");
 }
 
 // +-----------------------------------------------------------
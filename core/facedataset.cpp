@@ -20,14 +20,29 @@
 
 #include <QDebug>
 #include <QFileInfo>
-#include <QApplication>
+#include <QCoreApplication>
+#include <QUuid>
+#include <QMutexLocker>
+
+#include <algorithm>
 
 using namespace std;
 
+// Number of consecutive samples read at once in the paging mode
+const int f3::FaceDataset::PAGE_SIZE = 256;
+
+// Minimum number of pages kept in memory in the paging mode
+const int f3::FaceDataset::MIN_RESIDENT_PAGES = 4;
+
 // +-----------------------------------------------------------
 f3::FaceDataset::FaceDataset()
 {
 	m_iNumFeatures = 0;
+	m_iVersion = 0;
+	m_iSavedCount = 0;
+	m_bNeedsFullSave = true;
+	m_iPagingBudget = 0;
+	m_iPageClock = 0;
 }
 
 // +-----------------------------------------------------------
@@ -45,165 +60,1006 @@ int f3::FaceDataset::size() const
 // +-----------------------------------------------------------
 bool f3::FaceDataset::loadFromFile(const QString &sFileName, QString &sMsgError)
 {
-	/******************************************************
-	 * Open and read the file
-	 ******************************************************/
-	QFile oFile(sFileName);
-	if (!oFile.open(QFile::ReadOnly))
-    {
-		sMsgError = QString(QApplication::translate("FaceDataset", "não foi possível ler o arquivo [%1]")).arg(sFileName);
-        return false;
-    }
-
-	QTextStream oData(&oFile);
-	QString sData = oData.readAll();
-	oFile.close();
-
-	/******************************************************
-	 * Parse the xml document
-	 ******************************************************/
-	QDomDocument oDoc;
-	QString sError;
-	int iLine, iColumn;
-	if(!oDoc.setContent(sData, true, &sError, &iLine, &iColumn))
-	{
-		sMsgError = QString(QApplication::translate("FaceDataset", "erro no conteúdo do arquivo [%1]: problema [%2], linha [%3], coluna [%4]")).arg(sFileName, sError, QString::number(iLine), QString::number(iColumn));
-		return false;
-	}
-
-	// Root node
-	QDomElement oRoot = oDoc.firstChildElement("FaceDataset");
+	if(FaceDatasetManifest::isManifest(sFileName))
+		return loadFromManifest(sFileName, sMsgError);
 
-	if(oRoot.isNull())
+	// Datasets in a SQLite database are read in pages, and have no journal (changes are applied to the database)
+	if(FaceDatasetStore::isStore(sFileName))
 	{
-		sMsgError = QString(QApplication::translate("FaceDataset", "erro no conteúdo do arquivo [%1]: o nó '%2' não existe")).arg(sFileName, "FaceDataset");
-		return false;
+		// In the paging mode only the index of the samples is read now
+		if(m_iPagingBudget > 0)
+		{
+			shared_ptr<FaceDatasetPager> pPager(new FaceDatasetPager());
+			if(!pPager->open(sFileName, sMsgError))
+				return false;
+
+			loadFromPager(pPager);
+			markSaved();
+			return true;
+		}
+
+		FaceDatasetStore oStore;
+		if(!oStore.open(sFileName, sMsgError))
+			return false;
+
+		FaceImageBatch vSamples, vBatch;
+		while(!oStore.atEnd())
+		{
+			if(!oStore.readBatch(1000, vBatch, sMsgError))
+				return false;
+			vSamples.insert(vSamples.end(), vBatch.begin(), vBatch.end());
+		}
+
+		clear();
+		m_iNumFeatures = oStore.numFeatures();
+		m_oConnections = oStore.connections();
+		m_vSamples.swap(vSamples);
+		setJournalId(oStore.journalId());
+		markSaved();
+		return true;
 	}
 
-	int iNumFeats = oRoot.attribute("numberOfFeatures", "-1").toInt();
-	if(iNumFeats < 0)
+	// In the paging mode only the index of the samples is read now (the files that can not be
+	// paged are loaded completely, which also reports any error in them)
+	if(m_iPagingBudget > 0)
 	{
-		sMsgError = QString(QApplication::translate("FaceDataset", "erro no conteúdo do arquivo [%1]: o atributo '%2' não existe ou contém um valor inválido")).arg(sFileName, "numberOfFeatures");
-		return false;
+		shared_ptr<FaceDatasetPager> pPager(new FaceDatasetPager());
+		QString sError;
+		if(pPager->open(sFileName, sError))
+		{
+			loadFromPager(pPager);
+			if(!FaceDatasetJournal::replay(sFileName, *this, sMsgError))
+				return false;
+			sMsgError = pagingError();
+			if(!sMsgError.isEmpty())
+				return false;
+
+			markSaved();
+			return true;
+		}
 	}
 
-	// Sample images
-	QDomElement oSamples = oRoot.firstChildElement("Samples");
-	if(oSamples.isNull())
-	{
-		sMsgError = QString(QApplication::translate("FaceDataset", "erro no conteúdo do arquivo [%1]: o nó '%2' não existe")).arg(sFileName, "Samples");
+	// The file is read as a stream, so the whole xml document is never kept in memory
+	FaceDatasetReader oReader;
+	if(!oReader.open(sFileName, sMsgError))
 		return false;
+
+	FaceImageBatch vSamples, vBatch;
+	while(!oReader.atEnd())
+	{
+		if(!oReader.readBatch(1000, vBatch, sMsgError))
+			return false;
+		vSamples.insert(vSamples.end(), vBatch.begin(), vBatch.end());
 	}
 
-	vector<FaceImage*> vSamples;
-	for(QDomElement oElement = oSamples.firstChildElement(); !oElement.isNull(); oElement = oElement.nextSiblingElement())
+	clear();
+	m_iNumFeatures = oReader.numFeatures();
+	m_oConnections = oReader.connections();
+	m_vSamples.swap(vSamples);
+	setJournalId(oReader.journalId());
+
+	// Changes saved incrementally after the file was written
+	if(!FaceDatasetJournal::replay(sFileName, *this, sMsgError))
+		return false;
+
+	markSaved();
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::loadFromManifest(const QString &sFileName, QString &sMsgError)
+{
+	FaceDatasetManifest oManifest;
+	if(!oManifest.loadFromFile(sFileName, sMsgError))
+		return false;
+
+	// Each shard is a complete dataset file, so they are loaded independently (one per thread)
+	int iShards = oManifest.numShards();
+	vector<shared_ptr<FaceDataset> > vShards(iShards);
+	QVector<bool> vLoaded(iShards, false);
+	QVector<QString> vErrors(iShards);
+	for(int i = 0; i < iShards; i++)
+		vShards[i] = shared_ptr<FaceDataset>(new FaceDataset());
+
+	Parallel::forRange(iShards, [&](int iBegin, int iEnd) {
+		for(int i = iBegin; i < iEnd; i++)
+		{
+			if(FaceDatasetManifest::isManifest(oManifest.shardFileName(i)))
+				vErrors[i] = QCoreApplication::translate("FaceDataset", "a partição [%1] não pode ser outro manifesto").arg(oManifest.shardFileName(i));
+			else
+				vLoaded[i] = vShards[i]->loadFromFile(oManifest.shardFileName(i), vErrors[i]);
+		}
+	}, 1);
+
+	for(int i = 0; i < iShards; i++)
 	{
-		FaceImage *pSample = new FaceImage();
-		if(!pSample->loadFromXML(oElement, sError, iNumFeats))
+		if(!vLoaded[i])
+		{
+			sMsgError = QCoreApplication::translate("FaceDataset", "erro ao ler a partição [%1]: %2").arg(oManifest.shardFileName(i)).arg(vErrors[i]);
+			return false;
+		}
+
+		if(vShards[i]->numFeatures() != vShards[0]->numFeatures())
 		{
-			foreach(FaceImage *pSamp, vSamples)
-				delete(pSamp);
-			delete pSample;
+			sMsgError = QCoreApplication::translate("FaceDataset", "a partição [%1] tem %2 marcas faciais, mas a partição [%3] tem %4").arg(oManifest.shardFileName(i)).arg(vShards[i]->numFeatures()).arg(oManifest.shardFileName(0)).arg(vShards[0]->numFeatures());
+			return false;
+		}
 
-			sMsgError = QString(QApplication::translate("FaceDataset", "erro no conteúdo do arquivo [%1]: %2")).arg(sFileName, sError);
+		// The connections are kept once for the whole dataset, so the ones of a shard are never dropped
+		if(vShards[i]->connections().edges() != vShards[0]->connections().edges())
+		{
+			sMsgError = QCoreApplication::translate("FaceDataset", "a partição [%1] tem conexões entre as marcas faciais diferentes das da partição [%2]").arg(oManifest.shardFileName(i)).arg(oManifest.shardFileName(0));
 			return false;
 		}
-		vSamples.push_back(pSample);
 	}
 
+	// The samples are shared with the shards (released right after), so they are not copied
 	clear();
-	m_iNumFeatures = iNumFeats;
-	m_vSamples = vSamples;
+	if(iShards > 0)
+	{
+		m_iNumFeatures = vShards[0]->numFeatures();
+		m_oConnections = vShards[0]->connections();
+	}
+	for(int i = 0; i < iShards; i++)
+	{
+		m_vSamples.insert(m_vSamples.end(), vShards[i]->m_vSamples.begin(), vShards[i]->m_vSamples.end());
+		oManifest.setShardSize(i, vShards[i]->size());
+	}
+	vShards.clear();
 
+	setShards(oManifest);
+	markSaved();
 	return true;
 }
 
 // +-----------------------------------------------------------
-bool f3::FaceDataset::saveToFile(const QString &sFileName, QString &sMsgError) const
+void f3::FaceDataset::clear()
 {
-	/******************************************************
-	 * Create the xml document
-	 ******************************************************/
-	QDomDocument oDoc;
+	m_vSamples.clear();
+	m_iNumFeatures = 0;
+	m_oConnections.clear();
+	m_iVersion++;
 
-	// Processing instruction
-	QDomProcessingInstruction oInstr = oDoc.createProcessingInstruction("xml", "version='1.0' encoding='UTF-8'");
-	oDoc.appendChild(oInstr);
+	resetChanges();
+	m_sJournalId.clear();
+	m_bNeedsFullSave = true;
 
-	// Root node
-	QDomElement oRoot = oDoc.createElementNS("http://www.luiz.vieira.nom.br/f3/", "FaceDataset");
-	oDoc.appendChild(oRoot);
+	m_oManifest = FaceDatasetManifest();
+	m_setChangedShards.clear();
 
-	oRoot.setAttribute("numberOfFeatures", m_iNumFeatures);
+	m_pPager.reset();
+	m_vEntries.clear();
+	m_vPageAccess.clear();
+	m_sPagingError.clear();
+	m_vPageChanges.clear();
+	m_pPageOffsets.reset();
+}
 
-	// Sample images
-	QDomElement oSamples = oDoc.createElement("Samples");
-	oRoot.appendChild(oSamples);
+// +-----------------------------------------------------------
+const f3::FaceImage* f3::FaceDataset::getImage(const int iIndex) const
+{
+    if(iIndex < 0 || iIndex >= size())
+		return NULL;
 
-	foreach(FaceImage *pImage, m_vSamples)
-		pImage->saveToXML(oSamples);
+	return loadImage(iIndex);
+}
 
-	/******************************************************
-	 * Save the file
-	 ******************************************************/
-	QFile oFile(sFileName);
-	if (!oFile.open(QFile::WriteOnly | QFile::Truncate))
-    {
-		sMsgError = QString(QApplication::translate("FaceDataset", "não foi possível escrever no arquivo [%1]")).arg(sFileName);
-        return false;
-    }
+// +-----------------------------------------------------------
+QString f3::FaceDataset::imageFileName(const int iIndex) const
+{
+	if(iIndex < 0 || iIndex >= size())
+		return QString();
 
-	QTextStream oData(&oFile);
-	oDoc.save(oData, 4);
-	oFile.close();
+	if(!m_pPager)
+		return m_vSamples[iIndex]->fileName();
 
-	return true;
+	// The samples in memory may have been changed, so the index is only used for the others
+	QMutexLocker oLocker(m_pPager->mutex());
+	return m_vSamples[iIndex] ? m_vSamples[iIndex]->fileName() : m_vEntries[iIndex].sFileName;
 }
 
 // +-----------------------------------------------------------
-void f3::FaceDataset::clear()
+f3::EmotionLabel f3::FaceDataset::imageEmotionLabel(const int iIndex) const
 {
-	foreach(FaceImage *pImage, m_vSamples)
-		delete pImage;
-	m_vSamples.clear();
+	if(iIndex < 0 || iIndex >= size())
+		return EmotionLabel::UNDEFINED;
 
-	m_iNumFeatures = 0;
+	if(!m_pPager)
+		return m_vSamples[iIndex]->emotionLabel();
+
+	QMutexLocker oLocker(m_pPager->mutex());
+	return m_vSamples[iIndex] ? m_vSamples[iIndex]->emotionLabel() : EmotionLabel::fromValue(m_vEntries[iIndex].iEmotionLabel);
 }
 
 // +-----------------------------------------------------------
-f3::FaceImage* f3::FaceDataset::getImage(const int iIndex) const
+f3::FaceImage* f3::FaceDataset::editImage(const int iIndex)
 {
     if(iIndex < 0 || iIndex >= size())
 		return NULL;
 
-	return m_vSamples[iIndex];
+	if(iIndex < m_iSavedCount)
+		m_setDirtySamples.insert(iIndex);
+	return detach(iIndex);
+}
+
+// +-----------------------------------------------------------
+f3::FaceImage* f3::FaceDataset::detach(const int iIndex)
+{
+	// A changed sample no longer matches the file, so in the paging mode it is never released
+	if(m_pPager)
+	{
+		if(!loadImage(iIndex))
+			return NULL;
+		m_vEntries[iIndex].iBegin = -1;
+	}
+
+	// The use count can only increase in the thread that takes the snapshots (i.e. this one),
+	// so at worst an image just released by a snapshot in another thread is needlessly copied
+	shared_ptr<FaceImage> &pImage = m_vSamples[iIndex];
+	if(pImage.use_count() > 1)
+		pImage = shared_ptr<FaceImage>(new FaceImage(*pImage));
+
+	m_iVersion++;
+	return pImage.get();
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetSnapshot f3::FaceDataset::snapshot() const
+{
+	loadAllPages();
+
+	FaceDatasetSnapshot oRet;
+	oRet.m_vSamples = m_vSamples;
+	oRet.m_iNumFeatures = m_iNumFeatures;
+	oRet.m_oConnections = m_oConnections;
+	oRet.m_iVersion = m_iVersion;
+	return oRet;
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetSnapshot f3::FaceDataset::snapshot(const vector<int> &vIndexes) const
+{
+	FaceDatasetSnapshot oRet;
+	oRet.m_vSamples.reserve(vIndexes.size());
+	for(unsigned int i = 0; i < vIndexes.size(); i++)
+		if(vIndexes[i] >= 0 && vIndexes[i] < size())
+		{
+			loadImage(vIndexes[i]);
+			oRet.m_vSamples.push_back(m_vSamples[vIndexes[i]]);
+		}
+	oRet.m_iNumFeatures = m_iNumFeatures;
+	oRet.m_oConnections = m_oConnections;
+	oRet.m_iVersion = m_iVersion;
+	return oRet;
+}
+
+// +-----------------------------------------------------------
+quint64 f3::FaceDataset::version() const
+{
+	return m_iVersion;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::canSaveIncrementally() const
+{
+	return !m_bNeedsFullSave && !m_sJournalId.isEmpty();
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDataset::journalId() const
+{
+	return m_sJournalId;
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetSnapshot f3::FaceDataset::prepareFullSave()
+{
+	FaceDatasetSnapshot oRet = snapshot();
+
+	// An incomplete snapshot fails to be saved, and nothing changes in the dataset
+	if(!pagingError().isEmpty())
+		return oRet;
+
+	// The new file will not match the existing journal (if any)
+	m_sJournalId = QUuid::createUuid().toString();
+	oRet.m_sJournalId = m_sJournalId;
+
+	// Neither the index of the paging mode (all the samples were read for the snapshot)
+	m_pPager.reset();
+	m_vEntries.clear();
+	m_vPageAccess.clear();
+	m_vPageChanges.clear();
+	m_pPageOffsets.reset();
+
+	resetChanges();
+	m_bNeedsFullSave = true;
+
+	// The changes are no longer tracked by shard, so the shards must all be saved the next time
+	setAllShardsChanged();
+	return oRet;
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetChanges f3::FaceDataset::prepareIncrementalSave()
+{
+	FaceDatasetChanges oRet = pendingChanges();
+	resetChanges();
+	setAllShardsChanged();
+	return oRet;
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetChanges f3::FaceDataset::pendingChanges() const
+{
+	FaceDatasetChanges oRet;
+	oRet.sJournalId = m_sJournalId;
+	oRet.lOperations = m_lPendingOperations;
+	oRet.iSize = size();
+	oRet.iNumFeatures = m_iNumFeatures;
+
+	// The samples are shared with the changes, so they remain stable while written in background
+	QList<int> lDirty = m_setDirtySamples.toList();
+	qSort(lDirty);
+	foreach(int iIndex, lDirty)
+		oRet.vSamples.push_back(make_pair(iIndex, m_vSamples[iIndex]));
+	for(int i = m_iSavedCount; i < size(); i++)
+		oRet.vSamples.push_back(make_pair(i, m_vSamples[i]));
+	return oRet;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::restoreChanges(const FaceDatasetChanges &oChanges)
+{
+	if(isSharded())
+		return false;
+
+	// Only saved samples are removed, and the samples changed after the ones kept are new
+	int iSavedCount = m_iSavedCount;
+	foreach(FaceDatasetChanges::Operation oOperation, oChanges.lOperations)
+		if(oOperation.eType == FaceDatasetChanges::RemoveSample)
+			iSavedCount--;
+
+	if(!applyChanges(oChanges))
+		return false;
+
+	m_lPendingOperations.append(oChanges.lOperations);
+	m_iSavedCount = qMax(iSavedCount, 0);
+	for(unsigned int i = 0; i < oChanges.vSamples.size(); i++)
+		if(oChanges.vSamples[i].first < m_iSavedCount)
+			m_setDirtySamples.insert(oChanges.vSamples[i].first);
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::isSharded() const
+{
+	return m_oManifest.numShards() > 0;
+}
+
+// +-----------------------------------------------------------
+const f3::FaceDatasetManifest& f3::FaceDataset::manifest() const
+{
+	return m_oManifest;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::setShards(const FaceDatasetManifest &oManifest)
+{
+	int iTotal = 0;
+	for(int i = 0; i < oManifest.numShards(); i++)
+		iTotal += oManifest.shardSize(i);
+	if(iTotal != size())
+		return false;
+
+	m_oManifest = oManifest;
+	m_oManifest.m_mChangedShards.clear();
+	setAllShardsChanged();
+	return true;
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetManifest f3::FaceDataset::prepareShardedSave(const QString &sFileName)
+{
+	// Saving to another manifest creates new shards (with the same sizes, if already sharded)
+	if(!isSharded() || QFileInfo(sFileName).absoluteFilePath() != QFileInfo(m_oManifest.fileName()).absoluteFilePath())
+	{
+		FaceDatasetManifest oManifest(sFileName);
+		QString sBaseName = QFileInfo(sFileName).completeBaseName();
+		if(!isSharded())
+			oManifest.addShard(QString("%1-1.afd").arg(sBaseName), size());
+		else
+			for(int i = 0; i < m_oManifest.numShards(); i++)
+				oManifest.addShard(QString("%1-%2.afd").arg(sBaseName).arg(i + 1), m_oManifest.shardSize(i));
+		m_oManifest = oManifest;
+		setAllShardsChanged();
+	}
+
+	// Every shard file has all the face features and connections, so changing them changes all shards
+	foreach(FaceDatasetChanges::Operation oOperation, m_lPendingOperations)
+		if(oOperation.eType != FaceDatasetChanges::RemoveSample)
+		{
+			setAllShardsChanged();
+			break;
+		}
+	foreach(int iIndex, m_setDirtySamples)
+		m_setChangedShards.insert(shardOf(iIndex));
+
+	// The shards are saved complete, with new journal identifiers (their existing journals are removed)
+	FaceDatasetManifest oRet = m_oManifest;
+	int iBegin = 0;
+	for(int i = 0; i < m_oManifest.numShards(); i++)
+	{
+		int iEnd = iBegin + m_oManifest.shardSize(i);
+		if(m_setChangedShards.contains(i))
+		{
+			vector<int> vIndexes;
+			vIndexes.reserve(iEnd - iBegin);
+			for(int j = iBegin; j < iEnd; j++)
+				vIndexes.push_back(j);
+
+			FaceDatasetSnapshot oShard = snapshot(vIndexes);
+			oShard.m_sJournalId = QUuid::createUuid().toString();
+			oRet.m_mChangedShards.insert(i, oShard);
+		}
+		iBegin = iEnd;
+	}
+
+	resetChanges();
+	m_setChangedShards.clear();
+	return oRet;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDataset::shardOf(const int iIndex) const
+{
+	int iEnd = 0;
+	for(int i = 0; i < m_oManifest.numShards(); i++)
+	{
+		iEnd += m_oManifest.shardSize(i);
+		if(iIndex < iEnd)
+			return i;
+	}
+	return m_oManifest.numShards() - 1;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::setAllShardsChanged()
+{
+	for(int i = 0; i < m_oManifest.numShards(); i++)
+		m_setChangedShards.insert(i);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::growLastShard(const int iCount)
+{
+	if(!isSharded())
+		return;
+
+	int iLast = m_oManifest.numShards() - 1;
+	m_oManifest.setShardSize(iLast, m_oManifest.shardSize(iLast) + iCount);
+	m_setChangedShards.insert(iLast);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::finishSave(const bool bSuccess, const shared_ptr<FaceDatasetPager> &pPager)
+{
+	m_bNeedsFullSave = !bSuccess;
+	if(!bSuccess)
+		setAllShardsChanged();
+
+	// The paging mode is resumed over the file saved only if the samples saved are still the first
+	// ones of the dataset, in the same order and with the same features
+	if(!bSuccess || !pPager || m_pPager || m_iPagingBudget <= 0 || pPager->journalId() != m_sJournalId || pPager->numFeatures() != m_iNumFeatures)
+		return;
+	foreach(FaceDatasetChanges::Operation oOperation, m_lPendingOperations)
+		if(oOperation.eType != FaceDatasetChanges::ConnectFeatures && oOperation.eType != FaceDatasetChanges::DisconnectFeatures)
+			return;
+
+	vector<FaceDatasetPager::Entry> vEntries;
+	pPager->takeEntries(vEntries);
+	if((int) vEntries.size() != m_iSavedCount)
+		return;
+
+	// The samples changed since the saving was prepared no longer match the file (as the ones added)
+	foreach(int iIndex, m_setDirtySamples)
+		vEntries[iIndex].iBegin = -1;
+	m_vEntries.swap(vEntries);
+	m_pPager = pPager;
+	indexAppendedImages();
+
+	// All the samples are in memory (they were read for the snapshot), and are released as usual from now on
+	m_vPageAccess.assign(m_vPageAccess.size(), ++m_iPageClock);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::setJournalId(const QString &sJournalId)
+{
+	m_sJournalId = sJournalId;
+	m_bNeedsFullSave = sJournalId.isEmpty();
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::markSaved()
+{
+	resetChanges();
+	m_setChangedShards.clear();
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::resetChanges()
+{
+	m_setDirtySamples.clear();
+	m_lPendingOperations.clear();
+	m_iSavedCount = size();
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::applyChanges(const FaceDatasetChanges &oChanges)
+{
+	bool bMatches = true;
+	for(int iOperation = 0; iOperation < oChanges.lOperations.size(); iOperation++)
+	{
+		const FaceDatasetChanges::Operation &oOperation = oChanges.lOperations[iOperation];
+		switch(oOperation.eType)
+		{
+			case FaceDatasetChanges::RemoveSample:
+			{
+				// The consecutive removals are done at once, so the remaining samples are moved only once.
+				// The index of each removal refers to the samples left by the previous ones, so it is
+				// converted to the index the sample has before all of them
+				vector<int> vRemoved;
+				for(; iOperation < oChanges.lOperations.size() && oChanges.lOperations[iOperation].eType == FaceDatasetChanges::RemoveSample; iOperation++)
+				{
+					int iIndex = oChanges.lOperations[iOperation].iIndex;
+					if(iIndex < 0 || iIndex >= size() - (int) vRemoved.size())
+						continue;
+
+					int iSkipped = 0;
+					while(true)
+					{
+						int iCount = (int) (upper_bound(vRemoved.begin(), vRemoved.end(), iIndex + iSkipped) - vRemoved.begin());
+						if(iCount == iSkipped)
+							break;
+						iSkipped = iCount;
+					}
+					vRemoved.insert(upper_bound(vRemoved.begin(), vRemoved.end(), iIndex + iSkipped), iIndex + iSkipped);
+				}
+				iOperation--;
+
+				if(!vRemoved.empty())
+					removeSamples(vRemoved);
+				break;
+			}
+
+			case FaceDatasetChanges::AddFeature:
+			{
+				if(oOperation.pPositions && (int) oOperation.pPositions->size() != size())
+					bMatches = false;
+				FaceDatasetChanges::Operation oAdd = oOperation;
+				changeAllImages([oAdd](FaceImage *pImage, int iIndex) {
+					if(oAdd.pPositions && iIndex < (int) oAdd.pPositions->size())
+						pImage->insertFeature(oAdd.iIndex, oAdd.iID, (*oAdd.pPositions)[iIndex].x, (*oAdd.pPositions)[iIndex].y);
+					else
+						pImage->insertFeature(oAdd.iIndex, oAdd.iID, oAdd.x, oAdd.y);
+				});
+				m_oConnections.insertFeature(oOperation.iIndex);
+				m_iNumFeatures++;
+				break;
+			}
+
+			case FaceDatasetChanges::RemoveFeature:
+			{
+				int iFeature = oOperation.iIndex;
+				changeAllImages([iFeature](FaceImage *pImage, int) {
+					pImage->removeFeature(iFeature);
+				});
+				m_oConnections.removeFeatures(vector<int>(1, oOperation.iIndex));
+				m_iNumFeatures--;
+				break;
+			}
+
+			case FaceDatasetChanges::ConnectFeatures:
+				m_oConnections.connect(oOperation.iIndex, oOperation.iID);
+				break;
+
+			case FaceDatasetChanges::DisconnectFeatures:
+				m_oConnections.disconnect(oOperation.iIndex, oOperation.iID);
+				break;
+		}
+	}
+
+	// The changed samples replace the existing ones, and the new ones are appended in order
+	for(unsigned int i = 0; i < oChanges.vSamples.size(); i++)
+	{
+		int iIndex = oChanges.vSamples[i].first;
+		if(iIndex >= 0 && iIndex < size())
+		{
+			m_vSamples[iIndex] = oChanges.vSamples[i].second;
+			if(m_pPager)
+				m_vEntries[iIndex].iBegin = -1;
+		}
+		else if(iIndex == size())
+			m_vSamples.push_back(oChanges.vSamples[i].second);
+	}
+	indexAppendedImages();
+
+	m_iVersion++;
+	return bMatches && size() == oChanges.iSize && m_iNumFeatures == oChanges.iNumFeatures;
 }
 
 // +-----------------------------------------------------------
 f3::FaceImage* f3::FaceDataset::addImage(const QString &sFileName)
 {
-	foreach(FaceImage *pImage, m_vSamples)
-		if(pImage->fileName() == sFileName)
-			return pImage;
+	for(int i = 0; i < size(); i++)
+		if(imageFileName(i) == sFileName)
+			return editImage(i);
 
 	FaceImage *pRet = new FaceImage(sFileName);
-	m_vSamples.push_back(pRet);
+	m_vSamples.push_back(shared_ptr<FaceImage>(pRet));
+	m_iVersion++;
+	growLastShard(1);
+	indexAppendedImages();
+	return pRet;
+}
+
+// +-----------------------------------------------------------
+f3::FaceImage* f3::FaceDataset::appendImage(const FaceImage *pSample)
+{
+	FaceImage *pRet = new FaceImage(*pSample);
+
+	m_vSamples.push_back(shared_ptr<FaceImage>(pRet));
+	m_iVersion++;
+	growLastShard(1);
+	indexAppendedImages();
 	return pRet;
 }
 
+// +-----------------------------------------------------------
+void f3::FaceDataset::appendImages(const FaceImageBatch &vBatch)
+{
+	m_vSamples.insert(m_vSamples.end(), vBatch.begin(), vBatch.end());
+	m_iVersion++;
+	growLastShard((int) vBatch.size());
+	indexAppendedImages();
+}
+
+// +-----------------------------------------------------------
+f3::FaceImageBatch f3::FaceDataset::images() const
+{
+	loadAllPages();
+	return m_vSamples;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::setPagingBudget(const qint64 iBytes)
+{
+	m_iPagingBudget = qMax(iBytes, (qint64) 0);
+}
+
+// +-----------------------------------------------------------
+qint64 f3::FaceDataset::pagingBudget() const
+{
+	return m_iPagingBudget;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::isPaged() const
+{
+	return m_pPager != NULL;
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDataset::pagingError() const
+{
+	if(!m_pPager)
+		return m_sPagingError;
+
+	QMutexLocker oLocker(m_pPager->mutex());
+	return m_sPagingError;
+}
+
+// +-----------------------------------------------------------
+shared_ptr<f3::FaceDatasetPager> f3::FaceDataset::pager() const
+{
+	return m_pPager;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDataset::numPagedChanges() const
+{
+	return (int) m_vPageChanges.size();
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::loadFromPager(const shared_ptr<FaceDatasetPager> &pPager)
+{
+	clear();
+	m_iNumFeatures = pPager->numFeatures();
+	m_oConnections = pPager->connections();
+	setJournalId(pPager->journalId());
+
+	pPager->takeEntries(m_vEntries);
+	m_vSamples.resize(m_vEntries.size());
+	m_vPageAccess.assign((m_vEntries.size() + PAGE_SIZE - 1) / PAGE_SIZE, 0);
+	m_pPager = pPager;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::evictColdPages()
+{
+	if(!m_pPager)
+		return;
+
+	QMutexLocker oLocker(m_pPager->mutex());
+
+	// The budget is converted to pages with an estimate of the memory used by each sample
+	qint64 iSampleSize = sizeof(FaceImage) + m_iNumFeatures * (sizeof(FaceFeature) + sizeof(FaceFeature*));
+	qint64 iMaxPages = qMax((qint64) MIN_RESIDENT_PAGES, m_iPagingBudget / (iSampleSize * PAGE_SIZE));
+
+	vector<pair<quint64, int> > vResident;
+	for(unsigned int i = 0; i < m_vPageAccess.size(); i++)
+		if(m_vPageAccess[i] > 0)
+			vResident.push_back(make_pair(m_vPageAccess[i], (int) i));
+	if((qint64) vResident.size() <= iMaxPages)
+		return;
+
+	// The least recently used pages are released first. Only the samples that can be read again are
+	// released, and not while shared with a snapshot (which might be being saved in background)
+	sort(vResident.begin(), vResident.end());
+	for(int i = 0; i < (int) (vResident.size() - iMaxPages); i++)
+	{
+		int iPage = vResident[i].second;
+		int iEnd = qMin(size(), (iPage + 1) * PAGE_SIZE);
+		bool bReleased = true;
+		for(int j = iPage * PAGE_SIZE; j < iEnd; j++)
+		{
+			if(m_vEntries[j].iBegin < 0 || !m_vSamples[j])
+				continue;
+			if(m_vSamples[j].use_count() == 1)
+				m_vSamples[j].reset();
+			else
+				bReleased = false;
+		}
+
+		if(bReleased)
+			m_vPageAccess[iPage] = 0;
+	}
+}
+
+// +-----------------------------------------------------------
+f3::FaceImage* f3::FaceDataset::loadImage(const int iIndex) const
+{
+	if(!m_pPager)
+		return m_vSamples[iIndex].get();
+
+	QMutexLocker oLocker(m_pPager->mutex());
+	int iPage = iIndex / PAGE_SIZE;
+	m_vPageAccess[iPage] = ++m_iPageClock;
+	if(!m_vSamples[iIndex] && !loadPage(iPage))
+		return NULL;
+	return m_vSamples[iIndex].get();
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::loadPage(const int iPage) const
+{
+	int iEnd = qMin(size(), (iPage + 1) * PAGE_SIZE);
+	vector<int> vMissing;
+	vector<pair<qint64, qint64> > vRanges;
+	for(int i = iPage * PAGE_SIZE; i < iEnd; i++)
+	{
+		if(!m_vSamples[i])
+		{
+			vMissing.push_back(i);
+			vRanges.push_back(make_pair(m_vEntries[i].iBegin, m_vEntries[i].iEnd));
+		}
+	}
+
+	// If the file can not be read anymore (i.e. it was changed by another program), the samples
+	// are left unavailable: nothing else is known about them, and the dataset can not be saved
+	FaceImageBatch vBatch;
+	QString sMsgError;
+	if(!m_pPager->read(vRanges, vBatch, sMsgError))
+	{
+		if(m_sPagingError.isEmpty())
+			m_sPagingError = sMsgError;
+		return false;
+	}
+
+	// The samples are read as in the file, so the changes on the features done since are applied again
+	// (except the ones a database already has)
+	for(unsigned int i = 0; i < vMissing.size(); i++)
+	{
+		pair<qint64, int> oKey(m_vEntries[vMissing[i]].iBegin, -1);
+		for(unsigned int j = m_pPager->savedChanges(); j < m_vPageChanges.size(); j++)
+		{
+			const vector<pair<qint64, int> > &vOffsets = *m_vPageChanges[j].pOffsets;
+			vector<pair<qint64, int> >::const_iterator it = lower_bound(vOffsets.begin(), vOffsets.end(), oKey);
+			if(it != vOffsets.end() && it->first == oKey.first)
+				m_vPageChanges[j].fChange(vBatch[i].get(), it->second);
+		}
+		m_vSamples[vMissing[i]] = vBatch[i];
+	}
+	return true;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::loadAllPages() const
+{
+	if(!m_pPager)
+		return;
+
+	QMutexLocker oLocker(m_pPager->mutex());
+	for(int i = 0; i < size(); i += PAGE_SIZE)
+	{
+		int iEnd = qMin(size(), i + PAGE_SIZE);
+		for(int j = i; j < iEnd; j++)
+		{
+			if(!m_vSamples[j])
+			{
+				// The pages that fail are skipped, so the snapshot is incomplete (and can not be saved)
+				m_vPageAccess[i / PAGE_SIZE] = ++m_iPageClock;
+				loadPage(i / PAGE_SIZE);
+				break;
+			}
+		}
+	}
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::indexAppendedImages()
+{
+	if(!m_pPager)
+		return;
+
+	FaceDatasetPager::Entry oEntry;
+	oEntry.iEmotionLabel = EmotionLabel::UNDEFINED.getValue();
+	oEntry.iBegin = -1;
+	oEntry.iEnd = -1;
+	m_vEntries.resize(m_vSamples.size(), oEntry);
+	m_vPageAccess.resize((m_vSamples.size() + PAGE_SIZE - 1) / PAGE_SIZE, 0);
+}
+
 // +-----------------------------------------------------------
 bool f3::FaceDataset::removeImage(const int iIndex)
 {
-	if(iIndex < 0 || iIndex >= size())
+	return removeImages(vector<int>(1, iIndex));
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::removeImages(vector<int> vIndexes)
+{
+	sort(vIndexes.begin(), vIndexes.end());
+	vIndexes.erase(unique(vIndexes.begin(), vIndexes.end()), vIndexes.end());
+	if(vIndexes.empty() || vIndexes.front() < 0 || vIndexes.back() >= size())
 		return false;
 
-	FaceImage *pImage = m_vSamples[iIndex];
-	m_vSamples.erase(m_vSamples.begin() + iIndex);
-	delete pImage;
+	// The shards lose the samples removed from them (counted before the indexes change)
+	if(isSharded())
+	{
+		QVector<int> vRemoved(m_oManifest.numShards(), 0);
+		for(unsigned int i = 0; i < vIndexes.size(); i++)
+			vRemoved[shardOf(vIndexes[i])]++;
+		for(int i = 0; i < vRemoved.size(); i++)
+			if(vRemoved[i] > 0)
+			{
+				m_oManifest.setShardSize(i, m_oManifest.shardSize(i) - vRemoved[i]);
+				m_setChangedShards.insert(i);
+			}
+	}
+
+	removeSamples(vIndexes);
+	m_iVersion++;
+
+	// Only the removal of saved samples needs to be saved. They are journaled from the last to the
+	// first, so each operation refers to the index the sample has when the journal is replayed
+	int iSavedRemoved = lower_bound(vIndexes.begin(), vIndexes.end(), m_iSavedCount) - vIndexes.begin();
+	if(iSavedRemoved > 0)
+	{
+		for(int i = iSavedRemoved - 1; i >= 0; i--)
+		{
+			FaceDatasetChanges::Operation oOperation = { FaceDatasetChanges::RemoveSample, vIndexes[i], 0, 0.0f, 0.0f };
+			m_lPendingOperations.append(oOperation);
+		}
+		m_iSavedCount -= iSavedRemoved;
+
+		// The indexes of the dirty samples are shifted by the number of samples removed before them
+		QSet<int> setDirty;
+		foreach(int iDirty, m_setDirtySamples)
+		{
+			vector<int>::iterator it = lower_bound(vIndexes.begin(), vIndexes.end(), iDirty);
+			if(it == vIndexes.end() || *it != iDirty)
+				setDirty.insert(iDirty - (int) (it - vIndexes.begin()));
+		}
+		m_setDirtySamples.swap(setDirty);
+	}
 
 	return true;
 }
 
+// +-----------------------------------------------------------
+void f3::FaceDataset::removeSamples(const vector<int> &vIndexes)
+{
+	// In the paging mode the samples change pages, so each page takes the last access of the pages
+	// its samples came from (a page with samples in memory must never look released to evictColdPages())
+	vector<quint64> vPageAccess;
+	if(m_pPager)
+	{
+		int iFirstPage = vIndexes.front() / PAGE_SIZE;
+		vPageAccess.assign(m_vPageAccess.begin(), m_vPageAccess.begin() + iFirstPage + 1);
+	}
+
+	// The samples kept are moved to their final positions in a single pass
+	int iSize = size();
+	int iNext = vIndexes.front();
+	unsigned int iRemoved = 0;
+	for(int i = vIndexes.front(); i < iSize; i++)
+	{
+		if(iRemoved < vIndexes.size() && vIndexes[iRemoved] == i)
+			iRemoved++;
+		else
+		{
+			if(m_pPager)
+			{
+				swap(m_vEntries[iNext], m_vEntries[i]);
+				unsigned int iPage = iNext / PAGE_SIZE;
+				if(iPage >= vPageAccess.size())
+					vPageAccess.push_back(0);
+				vPageAccess[iPage] = qMax(vPageAccess[iPage], m_vPageAccess[i / PAGE_SIZE]);
+			}
+			m_vSamples[iNext++].swap(m_vSamples[i]);
+		}
+	}
+	m_vSamples.resize(iNext);
+	if(m_pPager)
+	{
+		m_vEntries.resize(iNext);
+		vPageAccess.resize((iNext + PAGE_SIZE - 1) / PAGE_SIZE, 0);
+		m_vPageAccess.swap(vPageAccess);
+		m_pPageOffsets.reset();
+	}
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::changeAllImages(const function<void (FaceImage *pImage, int iIndex)> &fChange)
+{
+	if(!m_pPager)
+	{
+		for(int i = 0; i < size(); i++)
+			if(FaceImage *pImage = detach(i))
+				fChange(pImage, i);
+		return;
+	}
+
+	// The images in memory are changed now (but can still be released, since the change is applied
+	// again when they are read), and the others are identified by their offsets in the file
+	QMutexLocker oLocker(m_pPager->mutex());
+	if(!m_pPageOffsets)
+	{
+		shared_ptr<vector<pair<qint64, int> > > pOffsets(new vector<pair<qint64, int> >());
+		for(int i = 0; i < size(); i++)
+			if(m_vEntries[i].iBegin >= 0)
+				pOffsets->push_back(make_pair(m_vEntries[i].iBegin, i));
+		m_pPageOffsets = pOffsets;
+	}
+
+	for(int i = 0; i < size(); i++)
+	{
+		shared_ptr<FaceImage> &pImage = m_vSamples[i];
+		if(!pImage)
+			continue;
+		if(pImage.use_count() > 1)
+			pImage = shared_ptr<FaceImage>(new FaceImage(*pImage));
+		fChange(pImage.get(), i);
+	}
+
+	PageChange oChange;
+	oChange.pOffsets = m_pPageOffsets;
+	oChange.fChange = fChange;
+	m_vPageChanges.push_back(oChange);
+	m_iVersion++;
+}
+
 // +-----------------------------------------------------------
 int f3::FaceDataset::numFeatures() const
 {
@@ -214,35 +1070,267 @@ int f3::FaceDataset::numFeatures() const
 void f3::FaceDataset::setNumFeatures(int iNumFeats)
 {
 	m_iNumFeatures = iNumFeats;
+	m_iVersion++;
 }
 
 // +-----------------------------------------------------------
 void f3::FaceDataset::addFeature(int iID, float x, float y)
 {
-	FaceFeature *pFeat;
-	foreach(FaceImage *pSample, m_vSamples)
-		pFeat = pSample->addFeature(iID, x, y);
+	changeAllImages([iID, x, y](FaceImage *pImage, int) {
+		pImage->addFeature(iID, x, y);
+	});
 	m_iNumFeatures++;
+	m_iVersion++;
+
+	FaceDatasetChanges::Operation oOperation = { FaceDatasetChanges::AddFeature, m_iNumFeatures - 1, iID, x, y };
+	m_lPendingOperations.append(oOperation);
 }
 
 // +-----------------------------------------------------------
 bool f3::FaceDataset::removeFeature(const int iIndex)
 {
+	return removeFeatures(vector<int>(1, iIndex));
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::removeFeatures(vector<int> vIndexes)
+{
+	sort(vIndexes.begin(), vIndexes.end());
+	vIndexes.erase(unique(vIndexes.begin(), vIndexes.end()), vIndexes.end());
+	if(vIndexes.empty() || vIndexes.front() < 0 || vIndexes.back() >= m_iNumFeatures)
+		return false;
+
+	changeAllImages([vIndexes](FaceImage *pImage, int) {
+		pImage->removeFeatures(vIndexes);
+	});
+	m_oConnections.removeFeatures(vIndexes);
+	m_iNumFeatures -= (int) vIndexes.size();
+	m_iVersion++;
+
+	// The removals are journaled from the last to the first index, so the indexes remain valid when replayed
+	for(int i = (int) vIndexes.size() - 1; i >= 0; i--)
+	{
+		FaceDatasetChanges::Operation oOperation = { FaceDatasetChanges::RemoveFeature, vIndexes[i], 0, 0.0f, 0.0f };
+		m_lPendingOperations.append(oOperation);
+	}
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::insertFeature(const int iIndex, int iID, const vector<cv::Point2f> &vPositions)
+{
+	if(iIndex < 0 || iIndex > m_iNumFeatures || (int) vPositions.size() != size())
+		return false;
+
+	changeAllImages([iIndex, iID, vPositions](FaceImage *pImage, int i) {
+		pImage->insertFeature(iIndex, iID, vPositions[i].x, vPositions[i].y);
+	});
+	m_oConnections.insertFeature(iIndex);
+	m_iNumFeatures++;
+	m_iVersion++;
+
+	// The positions differ in each image, so they are journaled with the operation. Only the saved
+	// images exist when the journal is replayed (the ones added since are saved complete)
+	FaceDatasetChanges::Operation oOperation = { FaceDatasetChanges::AddFeature, iIndex, iID, 0.0f, 0.0f };
+	oOperation.pPositions = shared_ptr<vector<cv::Point2f> >(new vector<cv::Point2f>(vPositions.begin(), vPositions.begin() + m_iSavedCount));
+	m_lPendingOperations.append(oOperation);
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+vector<cv::Point2f> f3::FaceDataset::getFeaturePositions(const int iIndex) const
+{
+	vector<cv::Point2f> vRet;
 	if(iIndex < 0 || iIndex >= m_iNumFeatures)
+		return vRet;
+
+	vRet.reserve(size());
+	for(int i = 0; i < size(); i++)
+	{
+		const FaceImage *pImage = loadImage(i);
+		FaceFeature *pFeature = pImage ? pImage->getFeature(iIndex) : NULL;
+		vRet.push_back(pFeature ? cv::Point2f(pFeature->x, pFeature->y) : cv::Point2f());
+	}
+	return vRet;
+}
+
+// +-----------------------------------------------------------
+vector<vector<cv::Point2f> > f3::FaceDataset::getShapes(const vector<int> &vIndexes) const
+{
+	vector<vector<cv::Point2f> > vRet(vIndexes.size());
+	for(unsigned int i = 0; i < vIndexes.size(); i++)
+	{
+		const FaceImage *pImage = vIndexes[i] >= 0 && vIndexes[i] < size() ? loadImage(vIndexes[i]) : NULL;
+		if(!pImage)
+			continue;
+
+		vector<FaceFeature*> vFeats = pImage->getFeatures();
+		vRet[i].reserve(vFeats.size());
+		for(unsigned int j = 0; j < vFeats.size(); j++)
+			vRet[i].push_back(*vFeats[j]);
+	}
+	return vRet;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::setShapes(const vector<int> &vIndexes, const vector<vector<cv::Point2f> > &vShapes)
+{
+	if(vIndexes.size() != vShapes.size())
 		return false;
+	for(unsigned int i = 0; i < vIndexes.size(); i++)
+		if(vIndexes[i] < 0 || vIndexes[i] >= size())
+			return false;
+
+	for(unsigned int i = 0; i < vIndexes.size(); i++)
+	{
+		FaceImage *pImage = editImage(vIndexes[i]);
+		if(!pImage)
+			continue;
+
+		vector<FaceFeature*> vFeats = pImage->getFeatures();
+		for(unsigned int j = 0; j < vFeats.size() && j < vShapes[i].size(); j++)
+		{
+			vFeats[j]->x = vShapes[i][j].x;
+			vFeats[j]->y = vShapes[i][j].y;
+		}
+	}
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::transformFeatures(const vector<int> &vIndexes, const cv::Mat &oTransform)
+{
+	if(oTransform.rows != 2 || oTransform.cols != 3)
+		return false;
+	for(unsigned int i = 0; i < vIndexes.size(); i++)
+		if(vIndexes[i] < 0 || vIndexes[i] >= size())
+			return false;
 
-	foreach(FaceImage *pSample, m_vSamples)
-		pSample->removeFeature(iIndex);
-	m_iNumFeatures--;
+	// The images are detached (and marked as changed) in this thread, since it changes the dataset,
+	// and each one only once, so no image is transformed twice (or by two threads)
+	vector<int> vUnique(vIndexes);
+	sort(vUnique.begin(), vUnique.end());
+	vUnique.erase(unique(vUnique.begin(), vUnique.end()), vUnique.end());
+
+	vector<FaceImage*> vImages;
+	vImages.reserve(vUnique.size());
+	for(unsigned int i = 0; i < vUnique.size(); i++)
+		if(FaceImage *pImage = editImage(vUnique[i]))
+			vImages.push_back(pImage);
+
+	cv::Mat oAffine;
+	oTransform.convertTo(oAffine, CV_32F);
+	cv::Mat oLinear = oAffine.colRange(0, 2);
+
+	Parallel::forRange((int) vImages.size(), [&](int iBegin, int iEnd) {
+		vector<cv::Point2f> vPoints;
+		cv::Mat oImageTransform;
+		for(int i = iBegin; i < iEnd; i++)
+		{
+			vector<FaceFeature*> vFeats = vImages[i]->getFeatures();
+			if(vFeats.empty())
+				continue;
+
+			vPoints.resize(vFeats.size());
+			cv::Point2f oCentroid;
+			for(unsigned int j = 0; j < vFeats.size(); j++)
+			{
+				vPoints[j] = *vFeats[j];
+				oCentroid += vPoints[j];
+			}
+			oCentroid *= 1.0f / vFeats.size();
+
+			// The translation is adjusted so the linear part acts around the centroid: p' = A(p - c) + c + t
+			cv::Mat oCenter = (cv::Mat_<float>(2, 1) << oCentroid.x, oCentroid.y);
+			oAffine.copyTo(oImageTransform);
+			oImageTransform.col(2) += oCenter - oLinear * oCenter;
+
+			cv::transform(vPoints, vPoints, oImageTransform);
+			for(unsigned int j = 0; j < vFeats.size(); j++)
+			{
+				vFeats[j]->x = vPoints[j].x;
+				vFeats[j]->y = vPoints[j].y;
+			}
+		}
+	});
 
 	return true;
 }
 
+// +-----------------------------------------------------------
+bool f3::FaceDataset::copyFeatures(const int iSource, const vector<int> &vIndexes)
+{
+	if(iSource < 0 || iSource >= size())
+		return false;
+
+	vector<int> vTargets;
+	for(unsigned int i = 0; i < vIndexes.size(); i++)
+		if(vIndexes[i] != iSource)
+			vTargets.push_back(vIndexes[i]);
+
+	vector<cv::Point2f> vShape = getShapes(vector<int>(1, iSource)).front();
+	return setShapes(vTargets, vector<vector<cv::Point2f> >(vTargets.size(), vShape));
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::parallelForEachFeature(const std::function<void (int iIndex, int iFeature, const FaceFeature *pFeature)> &fFunc) const
+{
+	Parallel::forRange(size(), [&](int iBegin, int iEnd) {
+		for(int i = iBegin; i < iEnd; i++)
+		{
+			const FaceImage *pImage = loadImage(i);
+			for(int j = 0; pImage && j < m_iNumFeatures; j++)
+			{
+				FaceFeature *pFeature = pImage->getFeature(j);
+				if(pFeature)
+					fFunc(i, j, pFeature);
+			}
+		}
+	});
+}
+
 // +-----------------------------------------------------------
 vector<f3::FaceFeature*> f3::FaceDataset::getImageFeatures(const int iIndex)
 {
-	if(iIndex < 0 || iIndex >= (int) m_vSamples.size())
-		return vector<FaceFeature*>();
+	FaceImage *pImage = editImage(iIndex);
+	return pImage ? pImage->getFeatures() : vector<FaceFeature*>();
+}
+
+// +-----------------------------------------------------------
+const f3::FaceFeatureConnections& f3::FaceDataset::connections() const
+{
+	return m_oConnections;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDataset::setConnections(const FaceFeatureConnections &oConnections)
+{
+	m_oConnections = oConnections;
+	m_iVersion++;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::connectFeatures(const int iFirst, const int iSecond)
+{
+	if(iFirst >= m_iNumFeatures || iSecond >= m_iNumFeatures || !m_oConnections.connect(iFirst, iSecond))
+		return false;
+	m_iVersion++;
+
+	FaceDatasetChanges::Operation oOperation = { FaceDatasetChanges::ConnectFeatures, iFirst, iSecond, 0.0f, 0.0f };
+	m_lPendingOperations.append(oOperation);
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDataset::disconnectFeatures(const int iFirst, const int iSecond)
+{
+	if(!m_oConnections.disconnect(iFirst, iSecond))
+		return false;
+	m_iVersion++;
 
-	return m_vSamples[iIndex]->getFeatures();
+	FaceDatasetChanges::Operation oOperation = { FaceDatasetChanges::DisconnectFeatures, iFirst, iSecond, 0.0f, 0.0f };
+	m_lPendingOperations.append(oOperation);
+	return true;
 }
\ No newline at end of file
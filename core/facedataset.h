@@ -21,23 +21,69 @@
 #define FACEDATASET_H
 
 #include "core_global.h"
+#include "abstractfacedataset.h"
 #include "faceimage.h"
 #include "facefeature.h"
 #include "emotionlabel.h"
+#include "parallel.h"
+#include "facedatasetsnapshot.h"
+#include "facedatasetreader.h"
+#include "facedatasetjournal.h"
+#include "facedatasetmanifest.h"
+#include "facedatasetstore.h"
+#include "facedatasetpager.h"
+#include "facefeatureconnections.h"
 
 #include <QDomDocument>
+#include <QVector>
+#include <QSet>
 
 #include <vector>
+#include <memory>
+#include <functional>
 
 namespace f3
 {
 	/**
 	 * Represents a dataset of facial images that can be annotated with facial landmarks and
 	 * prototypical emotional labels.
+	 *
+	 * The face images are shared with the snapshots taken from the dataset (see snapshot()), and
+	 * copied before being changed while they are shared (copy-on-write). Therefore, all changes to
+	 * the face images must be done through the pointers returned by editImage().
+	 *
+	 * The dataset also keeps track of the changes done since it was last loaded or saved (the
+	 * changed samples and the structural operations, like the removal of features), so they can be
+	 * saved incrementally to the journal of the dataset file (see FaceDatasetJournal) instead of
+	 * rewriting the whole file.
+	 *
+	 * Subsets of the dataset can be handled without copying the samples through the views over
+	 * it (see FaceDatasetView), and the code that works on both uses the AbstractFaceDataset interface.
+	 *
+	 * A dataset can also be split in shards listed by a manifest (see FaceDatasetManifest). It is then
+	 * loaded from all shards and, when saved, only the shards with changes are written back.
+	 *
+	 * Huge datasets can be loaded in the paging mode (see setPagingBudget()), where only an index of
+	 * the samples is kept in memory and the samples are read from the file (or database, see
+	 * FaceDatasetPager) in pages of PAGE_SIZE samples when first accessed. The pages not used recently
+	 * are released by evictColdPages(), except
+	 * for the samples changed (which no longer match the file) and the ones shared with snapshots.
+	 * The changes on the face features of all samples (i.e. the insertion or removal of a feature) do not
+	 * read the samples not in memory: they are recorded and applied to the samples when read (until
+	 * they are saved to a database, see numPagedChanges()).
+	 * If a page can not be read anymore (i.e. the file was changed by another program), its samples
+	 * are unavailable (getImage() and editImage() return NULL for them) and the dataset can no longer
+	 * be saved: it must be loaded again (see pagingError()).
 	 */
-	class CORE_EXPORT FaceDataset
+	class CORE_EXPORT FaceDataset : public AbstractFaceDataset
 	{
 	public:
+		/** Number of consecutive samples read at once in the paging mode. */
+		static const int PAGE_SIZE;
+
+		/** Minimum number of pages kept in memory in the paging mode, regardless of the budget. */
+		static const int MIN_RESIDENT_PAGES;
+
 		/**
 		 * Class constructor.
 		 */
@@ -52,25 +98,29 @@ namespace f3
 		 * Returns the number of face samples in the dataset.
 		 * @return Integer with the number of face samples in this dataset.
 		 */
-		int size() const;
+		virtual int size() const;
 
 		/**
 		 * Loads (unserializes) the instance from the given text file in the YAML format
 		 * (YAML Ain't Markup Language - http://en.wikipedia.org/wiki/YAML).
+		 * If the file is the manifest of a sharded dataset, the shards are loaded (see loadFromManifest()),
+		 * and if it is a SQLite database, it is read by a FaceDatasetStore.
 		 * @param sFileName QString with the name of the file to read the data from.
 		 * @param sMsgError QString to receive the error message in case the method fails.
 		 * @return Boolean indicating if the loading was successful (true) of failed (false).
 		 */
 		bool loadFromFile(const QString &sFileName, QString &sMsgError);
 
-        /**
-         * Saves (serializes) the instance to the given file in the YAML format
-		 * (YAML Ain't Markup Language - http://en.wikipedia.org/wiki/YAML).
-         * @param sFileName QString with the name of the file to write the data to.
+		/**
+		 * Loads the dataset from the shards listed in the given manifest (see FaceDatasetManifest).
+		 * The shards are read in parallel (each one with the changes in its own journal) and their
+		 * samples are concatenated in the order of the manifest. All shards must have the same number
+		 * of face features and the same connections between them.
+		 * @param sFileName QString with the name of the manifest file.
 		 * @param sMsgError QString to receive the error message in case the method fails.
-		 * @return Boolean indicating if the saving was successful (true) of failed (false).
-         */
-        bool saveToFile(const QString &sFileName, QString &sMsgError) const;
+		 * @return Boolean indicating if the loading was successful (true) of failed (false).
+		 */
+		bool loadFromManifest(const QString &sFileName, QString &sMsgError);
 
         /**
          * Clear the face annotation dataset.
@@ -78,12 +128,181 @@ namespace f3
         void clear();
 
 		/**
-		 * Gets the face image for the given index. The index must be in the range [0, count - 1],
-		 * where count is the number of face images in the dataset.
+		 * Gets the face image for the given index, for read-only access. The index must be in the range
+		 * [0, count - 1], where count is the number of face images in the dataset.
+		 * @param iIndex Integer with the index of the image file to load.
+		 * @return Pointer to a const FaceImage with the face image data. If the method fails (also if
+		 * the image could not be read in the paging mode, see pagingError()), NULL is returned.
+		 */
+		virtual const FaceImage* getImage(const int iIndex) const;
+
+		/**
+		 * Gets the file name of the face image at the given index. In the paging mode, the image is
+		 * not read from the file for that.
+		 * @param iIndex Integer with the index of the face image.
+		 * @return QString with the file name, or an empty string if the index is invalid.
+		 */
+		QString imageFileName(const int iIndex) const;
+
+		/**
+		 * Gets the emotion label of the face image at the given index. In the paging mode, the image
+		 * is not read from the file for that.
+		 * @param iIndex Integer with the index of the face image.
+		 * @return EmotionLabel of the face image, or EmotionLabel::UNDEFINED if the index is invalid.
+		 */
+		EmotionLabel imageEmotionLabel(const int iIndex) const;
+
+		/**
+		 * Gets the face image for the given index, in order to change it. If the face image is shared
+		 * with any snapshot of the dataset, it is copied first (so the snapshots are not affected by the
+		 * change). The returned pointer must not be kept after another snapshot is taken.
 		 * @param iIndex Integer with the index of the image file to load.
-		 * @return Pointer to a FaceImage with the face image data. If the method fails, NULL is returned. 
+		 * @return Pointer to a FaceImage with the face image data. If the method fails, NULL is returned.
+		 */
+		virtual FaceImage* editImage(const int iIndex);
+
+		/**
+		 * Takes a snapshot of the current contents of the dataset. The snapshot is cheap (the face
+		 * images are not copied) and remains unchanged regardless of the later changes in the dataset,
+		 * so it can be safely read from other threads. This method must be called from the thread
+		 * that changes the dataset.
+		 * @return FaceDatasetSnapshot with the current contents of the dataset.
+		 */
+		virtual FaceDatasetSnapshot snapshot() const;
+
+		/**
+		 * Takes a snapshot of a subset of the current contents of the dataset (as with snapshot(),
+		 * the face images are shared and not copied).
+		 * @param vIndexes Vector with the indexes of the face images to include, in the order given.
+		 * The invalid indexes are ignored.
+		 * @return FaceDatasetSnapshot with the face images given.
+		 */
+		FaceDatasetSnapshot snapshot(const std::vector<int> &vIndexes) const;
+
+		/**
+		 * Queries the current version of the dataset. The version changes every time the dataset
+		 * is changed (including by the pointers obtained from editImage()).
+		 * @return Unsigned integer with the version of the dataset.
+		 */
+		quint64 version() const;
+
+		/**
+		 * Indicates if the changes done since the dataset was last loaded or saved can be saved
+		 * incrementally, by appending them to the journal of the dataset file. That is not
+		 * possible if the dataset was never saved, if it was loaded from a file without journal
+		 * identifier or if the last saving failed.
+		 * @return Boolean indicating if an incremental save is possible.
+		 */
+		bool canSaveIncrementally() const;
+
+		/**
+		 * Queries the journal identifier of the file from which the dataset was loaded or to which
+		 * it was last saved (see FaceDatasetJournal).
+		 * @return QString with the journal identifier, or an empty string if there is none.
+		 */
+		QString journalId() const;
+
+		/**
+		 * Prepares a complete saving of the dataset: takes a snapshot bound to a new journal identifier,
+		 * to be saved with FaceDatasetSnapshot::saveToFile(), and restarts the tracking of changes from it.
+		 * The conclusion of the saving must be informed with finishSave(). In the paging mode, all the
+		 * samples are read for the snapshot and the paging mode is left (see finishSave() to return to it).
+		 * @return FaceDatasetSnapshot with the contents to save.
+		 */
+		FaceDatasetSnapshot prepareFullSave();
+
+		/**
+		 * Prepares an incremental saving of the dataset: takes the changes done since the dataset was
+		 * last loaded or saved, to be saved with FaceDatasetJournal::append(), and restarts the tracking
+		 * of changes. It must only be called if canSaveIncrementally() returns true, and the conclusion
+		 * of the saving must be informed with finishSave().
+		 * @return FaceDatasetChanges with the changes to save.
 		 */
-		FaceImage* getImage(const int iIndex) const;
+		FaceDatasetChanges prepareIncrementalSave();
+
+		/**
+		 * Takes the changes done since the dataset was last loaded or saved, as prepareIncrementalSave(),
+		 * but without restarting the tracking of changes (i.e. to autosave them). The samples are shared
+		 * with the changes, so none is read from the file in the paging mode.
+		 * @return FaceDatasetChanges with the changes not yet saved.
+		 */
+		FaceDatasetChanges pendingChanges() const;
+
+		/**
+		 * Applies the given changes taken with pendingChanges() (i.e. autosaved) as changes not yet saved,
+		 * so they are saved the next time as if they were done again. The dataset must be as it was when
+		 * the changes were taken (i.e. just loaded from the same file) and must not be sharded.
+		 * @param oChanges FaceDatasetChanges with the changes to restore.
+		 * @return Boolean indicating if the dataset matches the changes (see applyChanges()).
+		 */
+		bool restoreChanges(const FaceDatasetChanges &oChanges);
+
+		/**
+		 * Indicates if the dataset is split in shards (i.e. it was loaded from or saved to a manifest).
+		 * @return Boolean indicating if the dataset is sharded (true) or not (false).
+		 */
+		bool isSharded() const;
+
+		/**
+		 * Gets the manifest with the shards of the dataset (empty if the dataset is not sharded).
+		 * @return Const reference to the FaceDatasetManifest with the shards.
+		 */
+		const FaceDatasetManifest& manifest() const;
+
+		/**
+		 * Defines the shards of the dataset (i.e. after its samples were loaded by other means than
+		 * loadFromManifest()). All shards are considered changed, so they are all saved the next time.
+		 * @param oManifest FaceDatasetManifest with the shards.
+		 * @return Boolean indicating if the shards were defined (true) or not (false, in case the
+		 * shard sizes do not add up to the size of the dataset).
+		 */
+		bool setShards(const FaceDatasetManifest &oManifest);
+
+		/**
+		 * Prepares a sharded saving of the dataset: takes a snapshot of each shard changed since the
+		 * dataset was last loaded or saved, to be saved with FaceDatasetManifest::saveToFile(), and
+		 * restarts the tracking of changes. If the dataset is not sharded yet or the manifest file
+		 * differs from the current one, new shards are created (named after the manifest) and all of
+		 * them are saved. The conclusion of the saving must be informed with finishSave().
+		 * @param sFileName QString with the path and name of the manifest file.
+		 * @return FaceDatasetManifest with the shards and the contents of the ones to save.
+		 */
+		FaceDatasetManifest prepareShardedSave(const QString &sFileName);
+
+		/**
+		 * Informs the conclusion of a saving prepared with prepareFullSave() or prepareIncrementalSave().
+		 * If the saving failed, the changes taken are lost for the tracking, so the next saving
+		 * must be complete. After a complete saving of a dataset that was in the paging mode, a pager
+		 * opened on the file saved (i.e. in the thread that saved it) makes the dataset return to the
+		 * paging mode over the new file. The pager is ignored if samples or features were added or
+		 * removed while the dataset was being saved.
+		 * @param bSuccess Boolean indicating if the saving succeeded (true) or failed (false).
+		 * @param pPager Shared pointer to the FaceDatasetPager opened on the file saved, or NULL (the
+		 * default) to remain completely loaded.
+		 */
+		void finishSave(const bool bSuccess, const std::shared_ptr<FaceDatasetPager> &pPager = std::shared_ptr<FaceDatasetPager>());
+
+		/**
+		 * Defines the journal identifier of the dataset file from which the dataset is being loaded.
+		 * It is used by the loading methods, together with markSaved().
+		 * @param sJournalId QString with the journal identifier read from the file.
+		 */
+		void setJournalId(const QString &sJournalId);
+
+		/**
+		 * Marks the current contents of the dataset as saved (i.e. restarts the tracking of changes).
+		 * It is used by the loading methods, after all samples and the journal are loaded.
+		 */
+		void markSaved();
+
+		/**
+		 * Applies the given set of changes (read from the journal of the dataset file) to the dataset.
+		 * The changed samples are shared with the set of changes.
+		 * @param oChanges FaceDatasetChanges with the changes to apply.
+		 * @return Boolean indicating if the dataset matches the changes (i.e. if it ends with the
+		 * number of samples and features expected by the changes) or not.
+		 */
+		bool applyChanges(const FaceDatasetChanges &oChanges);
 
 		/**
 		 * Adds a new image to the face annotation dataset. All other data (landmarks, connections, etc)
@@ -93,6 +312,91 @@ namespace f3
 		 */
 		FaceImage* addImage(const QString &sFileName);
 
+		/**
+		 * Appends a copy of the given face image (including its emotion label and face features) to the
+		 * face annotation dataset. Differently from addImage, this method does not check for duplicated
+		 * file names (the caller is responsible for that) and hence it is suitable for bulk operations
+		 * like merging datasets.
+		 * @param pSample Pointer to the FaceImage with the data to be copied into the dataset.
+		 * @return Pointer to a FaceImage with the new image added to the dataset.
+		 */
+		FaceImage* appendImage(const FaceImage *pSample);
+
+		/**
+		 * Appends the given batch of face images (as read by a FaceDatasetReader) to the face annotation
+		 * dataset. As in appendImage, no check for duplicated file names is done. The images are shared
+		 * (not copied), so they must not be changed by the caller afterwards.
+		 * @param vBatch FaceImageBatch with the face images to append.
+		 */
+		void appendImages(const FaceImageBatch &vBatch);
+
+		/**
+		 * Gets all face images of the dataset, shared (not copied) as in a FaceDatasetReader batch.
+		 * They must not be changed by the caller.
+		 * @return FaceImageBatch with the face images, in order.
+		 */
+		FaceImageBatch images() const;
+
+		/**
+		 * Defines the memory budget for the samples kept in memory in the paging mode. A budget
+		 * greater than 0 makes the next calls to loadFromFile() use the paging mode for the xml files
+		 * and databases (the xml files that can not be paged, i.e. not encoded in UTF-8, are still
+		 * loaded completely).
+		 * @param iBytes Integer with the budget in bytes, or 0 (the default) to disable the paging mode.
+		 */
+		void setPagingBudget(const qint64 iBytes);
+
+		/**
+		 * Gets the memory budget for the samples kept in memory in the paging mode.
+		 * @return Integer with the budget in bytes (0 if the paging mode is disabled).
+		 */
+		qint64 pagingBudget() const;
+
+		/**
+		 * Indicates if the dataset is in the paging mode (i.e. there may be samples not read yet).
+		 * @return Boolean indicating if the dataset is paged (true) or completely loaded (false).
+		 */
+		bool isPaged() const;
+
+		/**
+		 * Gets the error of the first read of samples that failed in the paging mode. The samples
+		 * of that read are unavailable, so the dataset must not be saved anymore (the snapshots
+		 * taken from it are incomplete and fail to be saved) and must be loaded again.
+		 * @return QString with the error message, or an empty string if no read failed.
+		 */
+		QString pagingError() const;
+
+		/**
+		 * Gets the pager that reads the samples in the paging mode. The incremental savings of a
+		 * dataset stored in a database must be done by it (see FaceDatasetPager::apply()).
+		 * @return Shared pointer to the FaceDatasetPager, or NULL if the dataset is not paged.
+		 */
+		std::shared_ptr<FaceDatasetPager> pager() const;
+
+		/**
+		 * Gets the number of changes on the face features of all samples done in the paging mode, that
+		 * are applied to the samples when read (except the ones already saved to a database, see
+		 * FaceDatasetPager::savedChanges()).
+		 * @return Integer with the number of changes.
+		 */
+		int numPagedChanges() const;
+
+		/**
+		 * Replaces the dataset contents with the samples indexed by the given pager, in the paging mode
+		 * (i.e. to load a dataset in background, with the pager opened in another thread). As with the
+		 * other loading methods, the conclusion must be informed with markSaved().
+		 * @param pPager Shared pointer to the FaceDatasetPager already opened (its index is taken).
+		 */
+		void loadFromPager(const std::shared_ptr<FaceDatasetPager> &pPager);
+
+		/**
+		 * Releases the least recently used pages of samples while their estimated memory exceeds the
+		 * paging budget. The pointers obtained with getImage() for the samples released become invalid,
+		 * hence this method must only be called when no such pointer is kept (i.e. not during a parallel
+		 * processing of the dataset). It does nothing if the dataset is not in the paging mode.
+		 */
+		void evictColdPages();
+
 		/**
 		 * Removes an image from the face annotation dataset. All other data (landmarks, connections, etc)
 		 * are also removed.
@@ -102,11 +406,20 @@ namespace f3
 		 */
 		bool removeImage(const int iIndex);
 
+		/**
+		 * Removes a set of images from the face annotation dataset at once. The remaining samples
+		 * are compacted in a single pass, instead of erasing each image from the middle of the vector.
+		 * @param vIndexes Vector with the indexes of the images to remove (in any order).
+		 * @return Boolean indicating if the images were removed (true) or not (false, in case
+		 * any index is out of range, when nothing is removed).
+		 */
+		bool removeImages(std::vector<int> vIndexes);
+
 		/**
 		 * Queries the number of facial features in the dataset (applicable to all images).
 		 * @return Integer with the number of face features in the dataset.
 		 */
-		int numFeatures() const;
+		virtual int numFeatures() const;
 
 		/**
 		 * Updates the number of facial features in the dataset (applicable to all images).
@@ -132,20 +445,283 @@ namespace f3
 		bool removeFeature(const int iIndex);
 
 		/**
-		 * Gets the list of face features in the given image index.
+		 * Removes a set of existing features from the face dataset at once. The features of each
+		 * face image are compacted in a single pass (see FaceImage::removeFeatures()), instead of
+		 * erasing each feature from the middle of the vector.
+		 * @param vIndexes Vector with the indexes of the features to remove (in any order).
+		 * @return Boolean indicating if the features were successfully removed (true) or not (false,
+		 * in case any index is invalid, when nothing is removed).
+		 */
+		bool removeFeatures(std::vector<int> vIndexes);
+
+		/**
+		 * Inserts a feature in the face dataset, at the given index, with a different position
+		 * in each face image (i.e. to restore a feature removed, as with the undo of the removal).
+		 * @param iIndex Integer with the index where to insert the feature.
+		 * @param iID Integer with the identifier of the face feature.
+		 * @param vPositions Vector with the positions of the feature in each face image (in the
+		 * order of the images). It must have one position for each image in the dataset.
+		 * @return Boolean indicating if the feature was successfully inserted (true) or not (false).
+		 */
+		bool insertFeature(const int iIndex, int iID, const std::vector<cv::Point2f> &vPositions);
+
+		/**
+		 * Gets the positions of the feature at the given index in all face images.
+		 * @param iIndex Integer with the index of the feature.
+		 * @return Vector with the positions of the feature in each face image (in the order of
+		 * the images), or an empty vector if the index is invalid.
+		 */
+		std::vector<cv::Point2f> getFeaturePositions(const int iIndex) const;
+
+		/**
+		 * Gets the positions of all features (i.e. the shapes) of the given face images.
+		 * @param vIndexes Vector with the indexes of the face images.
+		 * @return Vector with the shape of each face image, in the order of the indexes given (the
+		 * shapes of invalid indexes are empty).
+		 */
+		std::vector<std::vector<cv::Point2f> > getShapes(const std::vector<int> &vIndexes) const;
+
+		/**
+		 * Updates the positions of all features (i.e. the shapes) of the given face images.
+		 * @param vIndexes Vector with the indexes of the face images.
+		 * @param vShapes Vector with the new shape of each face image, in the order of the indexes.
+		 * @return Boolean indicating if the shapes were updated (true) or not (false, in case any index
+		 * is invalid or the number of shapes differs from the number of indexes, when nothing is changed).
+		 */
+		bool setShapes(const std::vector<int> &vIndexes, const std::vector<std::vector<cv::Point2f> > &vShapes);
+
+		/**
+		 * Applies an affine transform to the features of the given face images. The transform is
+		 * applied relative to the centroid of the features of each image, so a scale or a rotation
+		 * keeps each shape in place. The face images are processed in parallel.
+		 * @param vIndexes Vector with the indexes of the face images.
+		 * @param oTransform 2x3 cv::Mat (of type CV_32F or CV_64F) with the affine transform.
+		 * @return Boolean indicating if the features were transformed (true) or not (false, in case
+		 * any index is invalid or the transform is not a 2x3 matrix, when nothing is changed).
+		 */
+		bool transformFeatures(const std::vector<int> &vIndexes, const cv::Mat &oTransform);
+
+		/**
+		 * Copies the positions of all features (i.e. the shape) of a face image to other face images.
+		 * @param iSource Integer with the index of the face image with the shape to copy.
+		 * @param vIndexes Vector with the indexes of the face images to receive the shape (the
+		 * source is ignored if included).
+		 * @return Boolean indicating if the shape was copied (true) or not (false, in case any index
+		 * is invalid, when nothing is changed).
+		 */
+		bool copyFeatures(const int iSource, const std::vector<int> &vIndexes);
+
+		/**
+		 * Gets the list of face features in the given image index, in order to change them (the
+		 * image is copied first if it is shared with any snapshot, as in editImage()).
 		 * @param iIndex Integer with the index of the image to query the face features.
 		 * @param A vector of FaceFeature instances with the face features in the image. It returns
 		 * an empty vector if the given index is invalid.
 		 */
 		std::vector<FaceFeature*> getImageFeatures(const int iIndex);
 
+		/**
+		 * Gets the connections between the face features (the same for all face images).
+		 * @return Const reference to the FaceFeatureConnections with the connections.
+		 */
+		virtual const FaceFeatureConnections& connections() const;
+
+		/**
+		 * Replaces all the connections between the face features (i.e. with the ones read from a file).
+		 * @param oConnections FaceFeatureConnections with the new connections.
+		 */
+		void setConnections(const FaceFeatureConnections &oConnections);
+
+		/**
+		 * Connects two face features.
+		 * @param iFirst Integer with the index of one of the features.
+		 * @param iSecond Integer with the index of the other feature.
+		 * @return Boolean indicating if the features were connected (true) or not (false, if they
+		 * were already connected or any index is invalid).
+		 */
+		bool connectFeatures(const int iFirst, const int iSecond);
+
+		/**
+		 * Disconnects two face features.
+		 * @param iFirst Integer with the index of one of the features.
+		 * @param iSecond Integer with the index of the other feature.
+		 * @return Boolean indicating if the features were disconnected (true) or not (false, if
+		 * they were not connected).
+		 */
+		bool disconnectFeatures(const int iFirst, const int iSecond);
+
+		/**
+		 * Calls the given function for all face features of all face images in the dataset, in parallel.
+		 * The work is split among the images, and the features of each image are visited sequentially.
+		 * @param fFunc Function receiving the index of the image, the index of the feature and a pointer
+		 * to the FaceFeature. It is called from different threads at the same time, hence it must be thread safe.
+		 */
+		void parallelForEachFeature(const std::function<void (int iIndex, int iFeature, const FaceFeature *pFeature)> &fFunc) const;
+
+	protected:
+
+		/**
+		 * Makes sure the face image at the given index is not shared with any snapshot, copying it
+		 * if needed, and counts a new version of the dataset.
+		 * @param iIndex Integer with the index of the image (it must be valid).
+		 * @return Pointer to the FaceImage that can be changed.
+		 */
+		FaceImage* detach(const int iIndex);
+
+		/**
+		 * Clears the tracking of changes, making the current contents the saved ones.
+		 */
+		void resetChanges();
+
+		/**
+		 * Gets the shard that contains the sample at the given index.
+		 * @param iIndex Integer with the index of the sample (it must be valid).
+		 * @return Integer with the index of the shard.
+		 */
+		int shardOf(const int iIndex) const;
+
+		/**
+		 * Marks all the shards as changed, so they are all saved the next time.
+		 */
+		void setAllShardsChanged();
+
+		/**
+		 * Counts the given number of samples appended to the dataset in its last shard.
+		 * @param iCount Integer with the number of samples appended.
+		 */
+		void growLastShard(const int iCount);
+
+		/**
+		 * Applies a change on the face features to all face images (i.e. the insertion or removal of a
+		 * feature), copying the images shared with snapshots first. In the paging mode, the images not
+		 * in memory are not read for that: the change is recorded and applied when they are read (see
+		 * loadPage()), so it must be thread safe.
+		 * @param fChange Function that changes a face image, receiving it and its index.
+		 */
+		void changeAllImages(const std::function<void (FaceImage *pImage, int iIndex)> &fChange);
+
+		/**
+		 * Removes the samples at the given indexes, moving the remaining ones (and their index, in the
+		 * paging mode) to their final positions in a single pass. Nothing else is updated (i.e. the
+		 * tracking of changes or the shards).
+		 * @param vIndexes Vector with the indexes of the samples to remove (sorted, unique and valid).
+		 */
+		void removeSamples(const std::vector<int> &vIndexes);
+
+		/**
+		 * Gets the face image at the given index, reading its page from the file first if needed
+		 * (in the paging mode). It is thread safe, as getImage().
+		 * @param iIndex Integer with the index of the image (it must be valid).
+		 * @return Pointer to the FaceImage, or NULL if its page could not be read (see pagingError()).
+		 */
+		FaceImage* loadImage(const int iIndex) const;
+
+		/**
+		 * Reads from the file the samples not yet in memory of the given page, and applies to them the
+		 * changes recorded by changeAllImages(). It must be called with the mutex of the pager locked.
+		 * If the reading fails, the samples are left unavailable and the error is kept (see pagingError()).
+		 * @param iPage Integer with the index of the page.
+		 * @return Boolean indicating if the page was read (true) or not (false).
+		 */
+		bool loadPage(const int iPage) const;
+
+		/**
+		 * Reads from the file all the samples not yet in memory (i.e. before taking a snapshot).
+		 */
+		void loadAllPages() const;
+
+		/**
+		 * Updates the index of the paging mode after samples were appended to the dataset (the new
+		 * samples are never released, since they are not in the file).
+		 */
+		void indexAppendedImages();
+
 	private:
 
-		/** Vector of sample face images. */
-		std::vector<FaceImage*> m_vSamples;
+		/**
+		 * Change on the face features of all face images recorded in the paging mode, to be applied to
+		 * the images read from the file afterwards (see changeAllImages()).
+		 */
+		struct PageChange
+		{
+			/**
+			 * Offsets in the file of the images that existed when the change was done, with their indexes
+			 * at that moment (in the order of the file).
+			 */
+			std::shared_ptr<const std::vector<std::pair<qint64, int> > > pOffsets;
+
+			/** Function that applies the change to an image, given its index when the change was done. */
+			std::function<void (FaceImage *pImage, int iIndex)> fChange;
+		};
+
+		/**
+		 * Vector of sample face images (shared with the snapshots of the dataset). In the paging mode,
+		 * the samples not read yet are NULL, and they are read even by the const methods.
+		 */
+		mutable std::vector<std::shared_ptr<FaceImage> > m_vSamples;
 
 		/** Number of face features in the dataset (i.e. applicable to all images). */
 		int m_iNumFeatures;
+
+		/** Connections between the face features. */
+		FaceFeatureConnections m_oConnections;
+
+		/** Version of the dataset, incremented every time it is changed. */
+		quint64 m_iVersion;
+
+		/**
+		 * Indexes of the saved samples changed since the last saving. The samples added since then
+		 * (i.e. from m_iSavedCount on) are not included, since they are always saved.
+		 */
+		QSet<int> m_setDirtySamples;
+
+		/** Structural operations done since the last saving, in the order they were done. */
+		QList<FaceDatasetChanges::Operation> m_lPendingOperations;
+
+		/**
+		 * Number of samples (at the beginning of the vector) that exist in the saved file, possibly
+		 * with changes. The samples after them were added since the last saving.
+		 */
+		int m_iSavedCount;
+
+		/** Journal identifier of the saved file (empty if the dataset was never saved). */
+		QString m_sJournalId;
+
+		/** Indication that the changes tracked are incomplete, so the next saving must be complete. */
+		bool m_bNeedsFullSave;
+
+		/** Manifest with the shards of the dataset (empty if it is not sharded). */
+		FaceDatasetManifest m_oManifest;
+
+		/** Indexes of the shards with samples added or removed since the last saving. */
+		QSet<int> m_setChangedShards;
+
+		/** Memory budget for the samples in the paging mode, in bytes (0 if the paging mode is disabled). */
+		qint64 m_iPagingBudget;
+
+		/** Reader of the samples in the paging mode (NULL if the dataset is completely loaded). */
+		std::shared_ptr<FaceDatasetPager> m_pPager;
+
+		/** Index of the samples in the paging mode, with the location of each one in the file. */
+		std::vector<FaceDatasetPager::Entry> m_vEntries;
+
+		/** Moment of the last access to each page in the paging mode (0 for the pages released). */
+		mutable std::vector<quint64> m_vPageAccess;
+
+		/** Counter of the accesses to the pages, used as the clock of m_vPageAccess. */
+		mutable quint64 m_iPageClock;
+
+		/** Error of the first read of samples that failed in the paging mode (empty if none). */
+		mutable QString m_sPagingError;
+
+		/** Changes on the face features done in the paging mode, in order (see changeAllImages()). */
+		std::vector<PageChange> m_vPageChanges;
+
+		/**
+		 * Offsets in the file of the images, with their indexes, shared by the changes recorded while
+		 * no image is removed (NULL if they must be taken again).
+		 */
+		std::shared_ptr<const std::vector<std::pair<qint64, int> > > m_pPageOffsets;
 	};
 }
 
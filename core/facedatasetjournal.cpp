@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "facedatasetjournal.h"
+#include "facedataset.h"
+
+#include <QDataStream>
+#include <QFileInfo>
+#include <QCoreApplication>
+#include <QMutexLocker>
+
+using namespace std;
+
+/** Magic number identifying the journal files ("F3JN"). */
+static const quint32 JOURNAL_MAGIC = 0x46334A4E;
+
+/** Version of the format of the journal files. */
+static const quint32 JOURNAL_VERSION = 1;
+
+// States of the journal files read or written by this process
+QHash<QString, f3::FaceDatasetJournal::JournalState> f3::FaceDatasetJournal::m_soStates;
+
+// Mutex of the states of the journal files
+QMutex f3::FaceDatasetJournal::m_soStatesMutex;
+
+// +-----------------------------------------------------------
+f3::FaceDatasetChanges::FaceDatasetChanges()
+{
+	iSize = 0;
+	iNumFeatures = 0;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetChanges::isEmpty() const
+{
+	return lOperations.isEmpty() && vSamples.empty();
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetJournal::FaceDatasetJournal()
+{
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetJournal::fileName(const QString &sDatasetFile)
+{
+	return sDatasetFile + ".journal";
+}
+
+// +-----------------------------------------------------------
+qint64 f3::FaceDatasetJournal::size(const QString &sDatasetFile)
+{
+	QFileInfo oInfo(fileName(sDatasetFile));
+	return oInfo.exists() ? oInfo.size() : 0;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetJournal::remove(const QString &sDatasetFile)
+{
+	QFile::remove(fileName(sDatasetFile));
+	forgetState(fileName(sDatasetFile));
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetJournal::append(const QString &sDatasetFile, const FaceDatasetChanges &oChanges, QString &sMsgError)
+{
+	QString sFileName = fileName(sDatasetFile);
+	QFile oFile(sFileName);
+
+	// Check if the existing journal matches the changes, and discard any uncommitted data at its end.
+	// The whole journal is only scanned if it was not last read or written by this process as it is now
+	qint64 iValidSize = -1;
+	qint64 iLastBlock = -1;
+	if(oFile.exists() && oFile.open(QFile::ReadOnly))
+	{
+		if(!checkRecordedState(oFile, oChanges.sJournalId, iValidSize, iLastBlock))
+		{
+			QString sJournalId;
+			iValidSize = scan(oFile, sJournalId, NULL, iLastBlock);
+			if(sJournalId != oChanges.sJournalId)
+				iValidSize = -1;
+		}
+		oFile.close();
+	}
+
+	// If the writing fails, the journal must be scanned again the next time
+	forgetState(sFileName);
+
+	if(!oFile.open(iValidSize < 0 ? QFile::WriteOnly | QFile::Truncate : QFile::ReadWrite))
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível escrever no arquivo [%1]")).arg(sFileName);
+		return false;
+	}
+
+	QDataStream oStream(&oFile);
+	oStream.setVersion(QDataStream::Qt_5_0);
+	if(iValidSize < 0)
+		oStream << JOURNAL_MAGIC << JOURNAL_VERSION << oChanges.sJournalId;
+	else if(!oFile.resize(iValidSize) || !oFile.seek(iValidSize))
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível escrever no arquivo [%1]")).arg(sFileName);
+		return false;
+	}
+
+	// The block is only considered committed if it is completely written with a matching checksum
+	qint64 iBlock = oFile.pos();
+	QByteArray oData = encode(oChanges);
+	oStream << (quint32) oData.size();
+	oStream.writeRawData(oData.constData(), oData.size());
+	oStream << qChecksum(oData.constData(), oData.size());
+
+	if(oStream.status() != QDataStream::Ok || !oFile.flush())
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível escrever no arquivo [%1]")).arg(sFileName);
+		return false;
+	}
+
+	qint64 iSize = oFile.pos();
+	oFile.close();
+	recordState(sFileName, oChanges.sJournalId, iSize, iBlock);
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetJournal::read(const QString &sDatasetFile, const QString &sJournalId, QList<FaceDatasetChanges> &lChanges, QString &sMsgError)
+{
+	lChanges.clear();
+
+	// A dataset file without identifier has no journal
+	QFile oFile(fileName(sDatasetFile));
+	if(sJournalId.isEmpty() || !oFile.exists())
+		return true;
+
+	if(!oFile.open(QFile::ReadOnly))
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível ler o arquivo [%1]")).arg(oFile.fileName());
+		return false;
+	}
+
+	// A journal of other contents of the dataset file (i.e. left by a crash) is ignored
+	QString sFileId;
+	QList<QByteArray> lBlocks;
+	qint64 iLastBlock;
+	qint64 iValidSize = scan(oFile, sFileId, &lBlocks, iLastBlock);
+	if(iValidSize < 0 || sFileId != sJournalId)
+		return true;
+	recordState(oFile.fileName(), sFileId, iValidSize, iLastBlock);
+
+	foreach(QByteArray oData, lBlocks)
+	{
+		FaceDatasetChanges oChanges;
+		if(!decode(oData, oChanges))
+		{
+			sMsgError = QString(QCoreApplication::translate("FaceDataset", "o arquivo [%1] contém dados inválidos")).arg(oFile.fileName());
+			return false;
+		}
+		oChanges.sJournalId = sJournalId;
+		lChanges.append(oChanges);
+	}
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetJournal::replay(const QString &sDatasetFile, FaceDataset &oDataset, QString &sMsgError)
+{
+	QList<FaceDatasetChanges> lChanges;
+	if(!read(sDatasetFile, oDataset.journalId(), lChanges, sMsgError))
+		return false;
+
+	foreach(FaceDatasetChanges oChanges, lChanges)
+	{
+		if(!oDataset.applyChanges(oChanges))
+		{
+			sMsgError = QString(QCoreApplication::translate("FaceDataset", "o arquivo [%1] não corresponde ao conjunto de dados")).arg(fileName(sDatasetFile));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+QByteArray f3::FaceDatasetJournal::encode(const FaceDatasetChanges &oChanges)
+{
+	QByteArray oRet;
+	QDataStream oStream(&oRet, QIODevice::WriteOnly);
+	oStream.setVersion(QDataStream::Qt_5_0);
+	oStream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+	oStream << (qint32) oChanges.iSize << (qint32) oChanges.iNumFeatures;
+
+	oStream << (qint32) oChanges.lOperations.size();
+	foreach(FaceDatasetChanges::Operation oOperation, oChanges.lOperations)
+		oStream << (quint8) oOperation.eType << (qint32) oOperation.iIndex << (qint32) oOperation.iID << oOperation.x << oOperation.y;
+
+	oStream << (qint32) oChanges.vSamples.size();
+	for(unsigned int i = 0; i < oChanges.vSamples.size(); i++)
+	{
+		const FaceImage *pImage = oChanges.vSamples[i].second.get();
+		vector<FaceFeature*> vFeatures = pImage->getFeatures();
+
+		oStream << (qint32) oChanges.vSamples[i].first << pImage->fileName() << (qint32) pImage->emotionLabel().getValue();
+		oStream << (qint32) vFeatures.size();
+		for(unsigned int j = 0; j < vFeatures.size(); j++)
+			oStream << (qint32) vFeatures[j]->getID() << vFeatures[j]->x << vFeatures[j]->y;
+	}
+
+	// The positions of the features added with a different position in each sample come last,
+	// so the blocks written without them are still valid
+	QList<int> lPositioned;
+	for(int i = 0; i < oChanges.lOperations.size(); i++)
+		if(oChanges.lOperations[i].pPositions)
+			lPositioned.append(i);
+
+	oStream << (qint32) lPositioned.size();
+	foreach(int iOperation, lPositioned)
+	{
+		const vector<cv::Point2f> &vPositions = *oChanges.lOperations[iOperation].pPositions;
+		oStream << (qint32) iOperation << (qint32) vPositions.size();
+		for(unsigned int i = 0; i < vPositions.size(); i++)
+			oStream << vPositions[i].x << vPositions[i].y;
+	}
+
+	return oRet;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetJournal::decode(const QByteArray &oData, FaceDatasetChanges &oChanges)
+{
+	QDataStream oStream(oData);
+	oStream.setVersion(QDataStream::Qt_5_0);
+	oStream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+	qint32 iSize, iNumFeatures, iCount;
+	oStream >> iSize >> iNumFeatures;
+	oChanges.iSize = iSize;
+	oChanges.iNumFeatures = iNumFeatures;
+
+	oStream >> iCount;
+	for(int i = 0; i < iCount && oStream.status() == QDataStream::Ok; i++)
+	{
+		quint8 iType;
+		qint32 iIndex, iID;
+		float x, y;
+		oStream >> iType >> iIndex >> iID >> x >> y;
+		if(iType < FaceDatasetChanges::RemoveSample || iType > FaceDatasetChanges::DisconnectFeatures)
+			return false;
+
+		FaceDatasetChanges::Operation oOperation = { (FaceDatasetChanges::OperationType) iType, iIndex, iID, x, y };
+		oChanges.lOperations.append(oOperation);
+	}
+
+	oStream >> iCount;
+	for(int i = 0; i < iCount && oStream.status() == QDataStream::Ok; i++)
+	{
+		qint32 iIndex, iEmotion, iFeatures;
+		QString sFileName;
+		oStream >> iIndex >> sFileName >> iEmotion >> iFeatures;
+
+		shared_ptr<FaceImage> pImage(new FaceImage(sFileName, EmotionLabel::fromValue(iEmotion)));
+		for(int j = 0; j < iFeatures && oStream.status() == QDataStream::Ok; j++)
+		{
+			qint32 iID;
+			float x, y;
+			oStream >> iID >> x >> y;
+			pImage->addFeature(iID, x, y);
+		}
+		oChanges.vSamples.push_back(make_pair((int) iIndex, pImage));
+	}
+
+	if(oStream.atEnd())
+		return oStream.status() == QDataStream::Ok;
+
+	oStream >> iCount;
+	for(int i = 0; i < iCount && oStream.status() == QDataStream::Ok; i++)
+	{
+		qint32 iOperation, iPositions;
+		oStream >> iOperation >> iPositions;
+		if(iOperation < 0 || iOperation >= oChanges.lOperations.size() || oChanges.lOperations[iOperation].eType != FaceDatasetChanges::AddFeature || iPositions < 0)
+			return false;
+
+		shared_ptr<vector<cv::Point2f> > pPositions(new vector<cv::Point2f>());
+		pPositions->reserve(iPositions);
+		for(int j = 0; j < iPositions && oStream.status() == QDataStream::Ok; j++)
+		{
+			float x, y;
+			oStream >> x >> y;
+			pPositions->push_back(cv::Point2f(x, y));
+		}
+		oChanges.lOperations[iOperation].pPositions = pPositions;
+	}
+
+	return oStream.status() == QDataStream::Ok;
+}
+
+// +-----------------------------------------------------------
+qint64 f3::FaceDatasetJournal::scan(QFile &oFile, QString &sJournalId, QList<QByteArray> *lBlocks, qint64 &iLastBlock)
+{
+	iLastBlock = -1;
+
+	QDataStream oStream(&oFile);
+	oStream.setVersion(QDataStream::Qt_5_0);
+
+	quint32 iMagic, iVersion;
+	oStream >> iMagic >> iVersion >> sJournalId;
+	if(oStream.status() != QDataStream::Ok || iMagic != JOURNAL_MAGIC || iVersion != JOURNAL_VERSION)
+		return -1;
+
+	// Each block is the length of the data, the data and its checksum
+	qint64 iValidSize = oFile.pos();
+	while(!oFile.atEnd())
+	{
+		quint32 iLength;
+		oStream >> iLength;
+		if(oStream.status() != QDataStream::Ok || iValidSize + 4 + iLength + 2 > oFile.size())
+			break;
+
+		QByteArray oData = oFile.read(iLength);
+		quint16 iChecksum;
+		oStream >> iChecksum;
+		if(oStream.status() != QDataStream::Ok || (quint32) oData.size() != iLength || iChecksum != qChecksum(oData.constData(), oData.size()))
+			break;
+
+		if(lBlocks)
+			lBlocks->append(oData);
+		iLastBlock = iValidSize;
+		iValidSize = oFile.pos();
+	}
+
+	return iValidSize;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetJournal::recordState(const QString &sFileName, const QString &sJournalId, const qint64 iValidSize, const qint64 iLastBlock)
+{
+	QFileInfo oInfo(sFileName);
+	JournalState oState;
+	oState.sJournalId = sJournalId;
+	oState.iValidSize = iValidSize;
+	oState.iLastBlock = iLastBlock;
+	oState.iFileSize = oInfo.size();
+	oState.oModified = oInfo.lastModified();
+
+	QMutexLocker oLocker(&m_soStatesMutex);
+	m_soStates.insert(oInfo.absoluteFilePath(), oState);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetJournal::forgetState(const QString &sFileName)
+{
+	QMutexLocker oLocker(&m_soStatesMutex);
+	m_soStates.remove(QFileInfo(sFileName).absoluteFilePath());
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetJournal::checkRecordedState(QFile &oFile, const QString &sJournalId, qint64 &iValidSize, qint64 &iLastBlock)
+{
+	QFileInfo oInfo(oFile.fileName());
+	JournalState oState;
+	{
+		QMutexLocker oLocker(&m_soStatesMutex);
+		QHash<QString, JournalState>::const_iterator it = m_soStates.constFind(oInfo.absoluteFilePath());
+		if(it == m_soStates.constEnd())
+			return false;
+		oState = it.value();
+	}
+
+	// Any change in the file by another process (or a copy of the dataset) requires a new scan
+	if(oState.sJournalId != sJournalId || oState.iFileSize != oInfo.size() || oState.oModified != oInfo.lastModified())
+		return false;
+
+	// Only the last committed block is checked, so the cost does not depend on the size of the journal
+	if(oState.iLastBlock >= 0)
+	{
+		if(!oFile.seek(oState.iLastBlock))
+			return false;
+
+		QDataStream oStream(&oFile);
+		oStream.setVersion(QDataStream::Qt_5_0);
+		quint32 iLength;
+		oStream >> iLength;
+		if(oStream.status() != QDataStream::Ok || oState.iLastBlock + 4 + iLength + 2 != oState.iValidSize)
+			return false;
+
+		QByteArray oData = oFile.read(iLength);
+		quint16 iChecksum;
+		oStream >> iChecksum;
+		if(oStream.status() != QDataStream::Ok || (quint32) oData.size() != iLength || iChecksum != qChecksum(oData.constData(), oData.size()))
+			return false;
+	}
+
+	iValidSize = oState.iValidSize;
+	iLastBlock = oState.iLastBlock;
+	return true;
+}
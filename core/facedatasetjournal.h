@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FACEDATASETJOURNAL_H
+#define FACEDATASETJOURNAL_H
+
+#include "core_global.h"
+#include "faceimage.h"
+
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include <QMetaType>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QDateTime>
+
+#include <vector>
+#include <memory>
+#include <utility>
+
+namespace f3
+{
+	class FaceDataset;
+
+	/**
+	 * Set of changes done in a face dataset since it was last saved (see FaceDataset::prepareIncrementalSave()).
+	 * The structural operations (that affect all the samples) are kept in the order they were done,
+	 * and the changed samples are kept with their complete contents and their final indexes (i.e.
+	 * the indexes after all the operations are applied). Samples with indexes beyond the size of the
+	 * dataset are appended to it.
+	 */
+	class CORE_EXPORT FaceDatasetChanges
+	{
+	public:
+		/**
+		 * Types of the structural operations.
+		 */
+		enum OperationType {
+			RemoveSample = 1,	/**< Removal of the sample at iIndex. */
+			AddFeature = 2,		/**< Insertion of the feature iID, at (x, y) or at pPositions, in all samples at iIndex. */
+			RemoveFeature = 3,	/**< Removal of the feature at iIndex from all samples. */
+			ConnectFeatures = 4,	/**< Connection of the features at iIndex and iID. */
+			DisconnectFeatures = 5	/**< Disconnection of the features at iIndex and iID. */
+		};
+
+		/**
+		 * Structural operation done in the dataset.
+		 */
+		struct Operation
+		{
+			/** Type of the operation. */
+			OperationType eType;
+
+			/** Index of the sample or feature affected. */
+			int iIndex;
+
+			/** Identifier of the feature added (or index of the second feature connected or disconnected). */
+			int iID;
+
+			/** Coordinate x of the feature added. */
+			float x;
+
+			/** Coordinate y of the feature added. */
+			float y;
+
+			/**
+			 * Positions of the feature added in each sample, in the order of the samples (i.e. when a
+			 * removed feature is restored). If NULL, the feature is added at (x, y) in all samples.
+			 */
+			std::shared_ptr<const std::vector<cv::Point2f> > pPositions;
+		};
+
+		/**
+		 * Class constructor. Creates an empty set of changes.
+		 */
+		FaceDatasetChanges();
+
+		/**
+		 * Indicates if there are no changes in the set.
+		 * @return Boolean indicating if the set is empty.
+		 */
+		bool isEmpty() const;
+
+		/** Identifier of the saved contents of the dataset to which the changes apply. */
+		QString sJournalId;
+
+		/** Structural operations, in the order they were done. */
+		QList<Operation> lOperations;
+
+		/** Changed samples, with their final indexes (in increasing order). */
+		std::vector<std::pair<int, std::shared_ptr<FaceImage> > > vSamples;
+
+		/** Number of samples in the dataset after the changes. */
+		int iSize;
+
+		/** Number of features in the dataset after the changes. */
+		int iNumFeatures;
+	};
+
+	/**
+	 * Static class that handles the journal of a face dataset file: an append-only file stored
+	 * alongside the dataset file (with the extension .journal added to its name), where the changes
+	 * done in the dataset are saved without rewriting the whole dataset file.
+	 *
+	 * The journal is bound to the contents of the dataset file by an identifier that is also stored in
+	 * the dataset file (see FaceDatasetSnapshot::saveToFile()), so a journal that does not match the
+	 * dataset file is ignored. Each set of changes is written as a block with its length and checksum,
+	 * which works as a commit marker: an incomplete or corrupted block (i.e. due to a crash in the middle
+	 * of the writing) is discarded together with anything after it.
+	 *
+	 * The valid size of each journal read or written is recorded in memory, so appending to a journal
+	 * only checks its last block instead of scanning all of them (unless the file was changed since).
+	 */
+	class CORE_EXPORT FaceDatasetJournal
+	{
+	protected:
+		/**
+		 * Protected class constructor to prevent this class from being instantiated.
+		 */
+		FaceDatasetJournal();
+
+	public:
+		/**
+		 * Gets the name of the journal file of the given dataset file.
+		 * @param sDatasetFile QString with the path and name of the dataset file.
+		 * @return QString with the path and name of the journal file.
+		 */
+		static QString fileName(const QString &sDatasetFile);
+
+		/**
+		 * Queries the size of the journal of the given dataset file.
+		 * @param sDatasetFile QString with the path and name of the dataset file.
+		 * @return Integer with the size in bytes of the journal file (0 if it does not exist).
+		 */
+		static qint64 size(const QString &sDatasetFile);
+
+		/**
+		 * Removes the journal of the given dataset file (if it exists).
+		 * @param sDatasetFile QString with the path and name of the dataset file.
+		 */
+		static void remove(const QString &sDatasetFile);
+
+		/**
+		 * Appends the given changes to the journal of the given dataset file. If the journal does not
+		 * exist or does not match the identifier in the changes, it is recreated.
+		 * @param sDatasetFile QString with the path and name of the dataset file.
+		 * @param oChanges FaceDatasetChanges with the changes to append.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the changes were written (true) or not (false).
+		 */
+		static bool append(const QString &sDatasetFile, const FaceDatasetChanges &oChanges, QString &sMsgError);
+
+		/**
+		 * Reads the changes committed in the journal of the given dataset file.
+		 * @param sDatasetFile QString with the path and name of the dataset file.
+		 * @param sJournalId QString with the identifier of the contents of the dataset file. If it
+		 * does not match the identifier of the journal, no changes are read.
+		 * @param lChanges QList to receive the sets of changes read, in the order they were written.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the reading was successful (true) or failed (false). A missing
+		 * journal is not an error.
+		 */
+		static bool read(const QString &sDatasetFile, const QString &sJournalId, QList<FaceDatasetChanges> &lChanges, QString &sMsgError);
+
+		/**
+		 * Reads the changes committed in the journal of the given dataset file and applies them to the
+		 * given dataset (that must have been loaded from the dataset file).
+		 * @param sDatasetFile QString with the path and name of the dataset file.
+		 * @param oDataset FaceDataset to receive the changes.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the replay was successful (true) or failed (false).
+		 */
+		static bool replay(const QString &sDatasetFile, FaceDataset &oDataset, QString &sMsgError);
+
+	protected:
+
+		/**
+		 * Serializes the given changes into a block of data.
+		 * @param oChanges FaceDatasetChanges with the changes to serialize.
+		 * @return QByteArray with the serialized changes.
+		 */
+		static QByteArray encode(const FaceDatasetChanges &oChanges);
+
+		/**
+		 * Unserializes the changes from the given block of data.
+		 * @param oData QByteArray with the serialized changes.
+		 * @param oChanges FaceDatasetChanges to receive the changes.
+		 * @return Boolean indicating if the block was valid (true) or not (false).
+		 */
+		static bool decode(const QByteArray &oData, FaceDatasetChanges &oChanges);
+
+		/**
+		 * Scans the committed blocks of the given journal file (that must be open for reading).
+		 * @param oFile QFile with the journal file.
+		 * @param sJournalId QString to receive the identifier read from the journal header.
+		 * @param lBlocks Pointer to a QList to receive the data of the committed blocks, or NULL if they
+		 * are not needed.
+		 * @param iLastBlock Integer to receive the position of the last committed block in the file
+		 * (or -1 if there are no committed blocks).
+		 * @return Integer with the size of the valid part of the file (i.e. up to the end of the last
+		 * committed block), or -1 if the header is invalid.
+		 */
+		static qint64 scan(QFile &oFile, QString &sJournalId, QList<QByteArray> *lBlocks, qint64 &iLastBlock);
+
+		/**
+		 * Records the state of the given journal file, just read or written.
+		 * @param sFileName QString with the path and name of the journal file.
+		 * @param sJournalId QString with the identifier in the journal header.
+		 * @param iValidSize Integer with the size of the valid part of the file.
+		 * @param iLastBlock Integer with the position of the last committed block (or -1 if none).
+		 */
+		static void recordState(const QString &sFileName, const QString &sJournalId, const qint64 iValidSize, const qint64 iLastBlock);
+
+		/**
+		 * Forgets the state recorded for the given journal file, so it is scanned again when used.
+		 * @param sFileName QString with the path and name of the journal file.
+		 */
+		static void forgetState(const QString &sFileName);
+
+		/**
+		 * Checks if the state recorded for the given journal file (that must be open for reading)
+		 * still matches it, by comparing its size and modification time and checking its last block.
+		 * @param oFile QFile with the journal file.
+		 * @param sJournalId QString with the expected identifier of the journal.
+		 * @param iValidSize Integer to receive the size of the valid part of the file.
+		 * @param iLastBlock Integer to receive the position of the last committed block (or -1 if none).
+		 * @return Boolean indicating if the recorded state can be used (true) or if the file must
+		 * be scanned (false).
+		 */
+		static bool checkRecordedState(QFile &oFile, const QString &sJournalId, qint64 &iValidSize, qint64 &iLastBlock);
+
+	private:
+
+		/**
+		 * State of a journal file when it was last read or written by this process.
+		 */
+		struct JournalState
+		{
+			/** Identifier in the journal header. */
+			QString sJournalId;
+
+			/** Size of the valid part of the file. */
+			qint64 iValidSize;
+
+			/** Position of the last committed block (or -1 if none). */
+			qint64 iLastBlock;
+
+			/** Size of the file. */
+			qint64 iFileSize;
+
+			/** Modification time of the file. */
+			QDateTime oModified;
+		};
+
+		/** States of the journal files, by their absolute path. */
+		static QHash<QString, JournalState> m_soStates;
+
+		/** Mutex to protect the access to the states (the journals are written in background). */
+		static QMutex m_soStatesMutex;
+	};
+}
+
+Q_DECLARE_METATYPE(f3::FaceDatasetChanges)
+
+#endif // FACEDATASETJOURNAL_H
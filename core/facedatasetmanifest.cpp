@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "facedatasetmanifest.h"
+#include "facedatasetjournal.h"
+#include "parallel.h"
+
+#include <QCoreApplication>
+#include <QDomDocument>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QFileInfo>
+#include <QDir>
+#include <QMutex>
+
+// +-----------------------------------------------------------
+f3::FaceDatasetManifest::FaceDatasetManifest(const QString &sFileName)
+{
+	m_sFileName = sFileName;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetManifest::isManifest(const QString &sFileName)
+{
+	return QFileInfo(sFileName).suffix().compare("afm", Qt::CaseInsensitive) == 0;
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetManifest::fileName() const
+{
+	return m_sFileName;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetManifest::setFileName(const QString &sFileName)
+{
+	m_sFileName = sFileName;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetManifest::numShards() const
+{
+	return m_lShardFiles.size();
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetManifest::shardFileName(const int iShard) const
+{
+	if(iShard < 0 || iShard >= numShards())
+		return QString();
+
+	return QFileInfo(m_sFileName).absoluteDir().absoluteFilePath(m_lShardFiles[iShard]);
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetManifest::shardSize(const int iShard) const
+{
+	if(iShard < 0 || iShard >= numShards())
+		return 0;
+
+	return m_vShardSizes[iShard];
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetManifest::setShardSize(const int iShard, const int iSize)
+{
+	if(iShard >= 0 && iShard < numShards())
+		m_vShardSizes[iShard] = iSize;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetManifest::addShard(const QString &sFileName, const int iSize)
+{
+	m_lShardFiles.append(sFileName);
+	m_vShardSizes.append(iSize);
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetManifest::loadFromFile(const QString &sFileName, QString &sMsgError)
+{
+	QFile oFile(sFileName);
+	if(!oFile.open(QFile::ReadOnly))
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível ler o arquivo [%1]")).arg(sFileName);
+		return false;
+	}
+
+	// The manifest is small, so it is read as a whole
+	QDomDocument oDoc;
+	QString sError;
+	if(!oDoc.setContent(&oFile, true, &sError))
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "o arquivo [%1] não é um manifesto válido: %2")).arg(sFileName).arg(sError);
+		return false;
+	}
+
+	QDomElement oRoot = oDoc.documentElement();
+	if(oRoot.localName() != "FaceDatasetManifest")
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "o arquivo [%1] não é um manifesto válido")).arg(sFileName);
+		return false;
+	}
+
+	m_sFileName = sFileName;
+	m_lShardFiles.clear();
+	m_vShardSizes.clear();
+	m_mChangedShards.clear();
+	for(QDomElement oShard = oRoot.firstChildElement("Shard"); !oShard.isNull(); oShard = oShard.nextSiblingElement("Shard"))
+	{
+		QString sShardFile = oShard.attribute("fileName");
+		if(sShardFile.isEmpty())
+		{
+			sMsgError = QString(QCoreApplication::translate("FaceDataset", "o manifesto [%1] tem uma partição sem nome de arquivo")).arg(sFileName);
+			return false;
+		}
+		addShard(sShardFile, oShard.attribute("numberOfSamples", "0").toInt());
+	}
+
+	if(numShards() == 0)
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "o manifesto [%1] não tem partições")).arg(sFileName);
+		return false;
+	}
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetManifest::saveToFile(QString &sMsgError, const std::function<void (int iPercent)> &fProgress) const
+{
+	/******************************************************
+	 * Save the shards changed, in parallel
+	 ******************************************************/
+	QList<int> lShards = m_mChangedShards.keys();
+	QList<FaceDatasetSnapshot> lSnapshots = m_mChangedShards.values();
+	QVector<QString> vErrors(lShards.size());
+	QMutex oMutex;
+	int iSaved = 0;
+
+	Parallel::forRange(lShards.size(), [&](int iBegin, int iEnd) {
+		for(int i = iBegin; i < iEnd; i++)
+		{
+			QString sShardFile = shardFileName(lShards[i]);
+			if(lSnapshots[i].saveToFile(sShardFile, vErrors[i]))
+				FaceDatasetJournal::remove(sShardFile);
+
+			QMutexLocker oLocker(&oMutex);
+			iSaved++;
+			if(fProgress)
+				fProgress(iSaved * 90 / lShards.size());
+		}
+	}, 1);
+
+	foreach(QString sError, vErrors)
+	{
+		if(!sError.isEmpty())
+		{
+			sMsgError = sError;
+			return false;
+		}
+	}
+
+	/******************************************************
+	 * Save the manifest
+	 ******************************************************/
+	if(!saveListToFile(m_sFileName, sMsgError))
+		return false;
+
+	if(fProgress)
+		fProgress(100);
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetManifest::saveListToFile(const QString &sFileName, QString &sMsgError) const
+{
+	QDomDocument oDoc;
+	QDomProcessingInstruction oInstr = oDoc.createProcessingInstruction("xml", "version='1.0' encoding='UTF-8'");
+	oDoc.appendChild(oInstr);
+
+	QDomElement oRoot = oDoc.createElementNS("http://www.luiz.vieira.nom.br/f3/", "FaceDatasetManifest");
+	oDoc.appendChild(oRoot);
+
+	for(int i = 0; i < numShards(); i++)
+	{
+		QDomElement oShard = oDoc.createElement("Shard");
+		oShard.setAttribute("fileName", m_lShardFiles[i]);
+		oShard.setAttribute("numberOfSamples", m_vShardSizes[i]);
+		oRoot.appendChild(oShard);
+	}
+
+	QSaveFile oFile(sFileName);
+	if(!oFile.open(QFile::WriteOnly | QFile::Truncate))
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível escrever no arquivo [%1]")).arg(sFileName);
+		return false;
+	}
+
+	QTextStream oData(&oFile);
+	oDoc.save(oData, 4);
+	oData.flush();
+	if(!oFile.commit())
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível escrever no arquivo [%1]")).arg(sFileName);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FACEDATASETMANIFEST_H
+#define FACEDATASETMANIFEST_H
+
+#include "core_global.h"
+#include "facedatasetsnapshot.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <QMetaType>
+
+#include <functional>
+
+namespace f3
+{
+	/**
+	 * Manifest of a sharded face annotation dataset: a small xml file (with the extension .afm) that
+	 * lists the shard files, each one a normal face annotation dataset file (.afd). The shards are
+	 * presented as a single dataset (see FaceDataset::loadFromManifest()), and only the shards changed
+	 * are written back when it is saved (see FaceDataset::prepareShardedSave()). Hence, each shard can
+	 * also be opened and edited alone (i.e. by different annotators) and the manifest still opens all of them.
+	 *
+	 * The names of the shard files are kept relative to the folder of the manifest.
+	 */
+	class CORE_EXPORT FaceDatasetManifest
+	{
+		friend class FaceDataset;
+	public:
+		/**
+		 * Class constructor. Creates an empty manifest.
+		 * @param sFileName QString with the path and name of the manifest file. The default is none.
+		 */
+		FaceDatasetManifest(const QString &sFileName = QString());
+
+		/**
+		 * Indicates if the given file is a manifest of a sharded dataset (based on its extension).
+		 * @param sFileName QString with the path and name of the file.
+		 * @return Boolean indicating if the file is a manifest (true) or not (false).
+		 */
+		static bool isManifest(const QString &sFileName);
+
+		/**
+		 * Gets the path and name of the manifest file.
+		 * @return QString with the path and name of the manifest file.
+		 */
+		QString fileName() const;
+
+		/**
+		 * Updates the path and name of the manifest file. The names of the shard files are kept as
+		 * they are, so they are then relative to the folder of the new file.
+		 * @param sFileName QString with the path and name of the manifest file.
+		 */
+		void setFileName(const QString &sFileName);
+
+		/**
+		 * Gets the number of shards in the manifest.
+		 * @return Integer with the number of shards.
+		 */
+		int numShards() const;
+
+		/**
+		 * Gets the path and name of the file of the given shard.
+		 * @param iShard Integer with the index of the shard.
+		 * @return QString with the complete path and name of the shard file.
+		 */
+		QString shardFileName(const int iShard) const;
+
+		/**
+		 * Gets the number of face samples in the given shard.
+		 * @param iShard Integer with the index of the shard.
+		 * @return Integer with the number of face samples.
+		 */
+		int shardSize(const int iShard) const;
+
+		/**
+		 * Updates the number of face samples in the given shard.
+		 * @param iShard Integer with the index of the shard.
+		 * @param iSize Integer with the number of face samples.
+		 */
+		void setShardSize(const int iShard, const int iSize);
+
+		/**
+		 * Appends a shard to the manifest.
+		 * @param sFileName QString with the name of the shard file (relative to the folder of the
+		 * manifest, or absolute).
+		 * @param iSize Integer with the number of face samples in the shard.
+		 */
+		void addShard(const QString &sFileName, const int iSize);
+
+		/**
+		 * Loads the list of shards from the manifest file.
+		 * @param sFileName QString with the path and name of the manifest file.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the loading was successful (true) or failed (false).
+		 */
+		bool loadFromFile(const QString &sFileName, QString &sMsgError);
+
+		/**
+		 * Saves the shards changed (as prepared by FaceDataset::prepareShardedSave()) to their files,
+		 * in parallel, and then the manifest itself. Since the shards are saved complete, any journal
+		 * of their files is removed.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @param fProgress Function called with the percentage of the saving concluded (in range [0, 100]).
+		 * It is called from the threads that save the shards, one call at a time. The default is no function.
+		 * @return Boolean indicating if the saving was successful (true) of failed (false).
+		 */
+		bool saveToFile(QString &sMsgError, const std::function<void (int iPercent)> &fProgress = std::function<void (int)>()) const;
+
+		/**
+		 * Saves only the list of shards (and not their contents) to the given file, as a manifest.
+		 * Used to keep the shards of a dataset whose samples are saved elsewhere (i.e. autosaved).
+		 * @param sFileName QString with the path and name of the file.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the saving was successful (true) of failed (false).
+		 */
+		bool saveListToFile(const QString &sFileName, QString &sMsgError) const;
+
+	private:
+
+		/** Path and name of the manifest file. */
+		QString m_sFileName;
+
+		/** Names of the shard files, as written in the manifest. */
+		QStringList m_lShardFiles;
+
+		/** Number of face samples in each shard. */
+		QVector<int> m_vShardSizes;
+
+		/** Contents of the shards to be written by saveToFile(), indexed by the shard. */
+		QMap<int, FaceDatasetSnapshot> m_mChangedShards;
+	};
+}
+
+Q_DECLARE_METATYPE(f3::FaceDatasetManifest)
+
+#endif // FACEDATASETMANIFEST_H
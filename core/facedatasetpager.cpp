@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "facedatasetpager.h"
+
+#include <QCoreApplication>
+#include <QXmlStreamReader>
+#include <QByteArray>
+
+using namespace std;
+
+// +-----------------------------------------------------------
+f3::FaceDatasetPager::FaceDatasetPager()
+{
+	m_iNumFeatures = 0;
+	m_bStore = false;
+	m_iSavedChanges = 0;
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetPager::~FaceDatasetPager()
+{
+	if(m_oFile.isOpen())
+		m_oFile.close();
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetPager::open(const QString &sFileName, QString &sMsgError, const std::function<bool (int iPercent)> &fProgress)
+{
+	m_vEntries.clear();
+	if(m_oFile.isOpen())
+		m_oFile.close();
+	m_oFile.setFileName(sFileName);
+	m_mStores.clear();
+	m_iSavedChanges = 0;
+
+	m_bStore = FaceDatasetStore::isStore(sFileName);
+	if(m_bStore)
+		return openStore(sFileName, sMsgError, fProgress);
+
+	// The header (number of features, journal identifier and connections) is read as usual
+	FaceDatasetReader oHeader;
+	if(!oHeader.open(sFileName, sMsgError))
+		return false;
+	m_iNumFeatures = oHeader.numFeatures();
+	m_sJournalId = oHeader.journalId();
+	m_oConnections = oHeader.connections();
+
+	QFile oFile(sFileName);
+	QFile oBytes(sFileName);
+	if(!oFile.open(QFile::ReadOnly) || !oBytes.open(QFile::ReadOnly))
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível ler o arquivo [%1]")).arg(sFileName);
+		return false;
+	}
+	qint64 iFileSize = oFile.size();
+
+	/******************************************************
+	 * Conversion of the offsets of the xml reader (in characters) to offsets in the file (in bytes)
+	 ******************************************************/
+	// The file is scanned forward only once, in parallel with the reader, counting the UTF-16
+	// characters of the UTF-8 sequences (the byte order mark, if any, is not a character)
+	QByteArray oChunk = oBytes.read(65536);
+	int iPos = oChunk.startsWith("\xEF\xBB\xBF") ? 3 : 0;
+	qint64 iByte = iPos, iChar = 0;
+	auto fByteOffset = [&](qint64 iTargetChar) -> qint64
+	{
+		while(true)
+		{
+			if(iPos >= oChunk.size())
+			{
+				oChunk = oBytes.read(65536);
+				iPos = 0;
+				if(oChunk.isEmpty())
+					break;
+			}
+
+			// The continuation bytes of the last character counted belong to it
+			uchar cByte = (uchar) oChunk.at(iPos);
+			bool bContinuation = (cByte & 0xC0) == 0x80;
+			if(iChar >= iTargetChar && !bContinuation)
+				break;
+			if(!bContinuation)
+				iChar += cByte >= 0xF0 ? 2 : 1;
+			iPos++;
+			iByte++;
+		}
+		return iByte;
+	};
+
+	/******************************************************
+	 * Build the index of the samples
+	 ******************************************************/
+	QXmlStreamReader oReader(&oFile);
+	if(!oReader.readNextStartElement())
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "o nó '%1' não existe")).arg("FaceDataset");
+		return false;
+	}
+
+	QString sEncoding = oReader.documentEncoding().toString();
+	if(!sEncoding.isEmpty() && sEncoding.compare("UTF-8", Qt::CaseInsensitive) != 0)
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "o arquivo [%1] não está codificado em UTF-8, o que é necessário para lê-lo sob demanda")).arg(sFileName);
+		return false;
+	}
+
+	bool bSamplesFound = false;
+	while(!bSamplesFound && oReader.readNextStartElement())
+	{
+		if(oReader.name() == "Samples")
+			bSamplesFound = true;
+		else
+			oReader.skipCurrentElement();
+	}
+	if(!bSamplesFound)
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "o nó '%1' não existe")).arg("Samples");
+		return false;
+	}
+
+	// Each sample goes from the end of the previous one (so the whitespace before it is included)
+	qint64 iBegin = fByteOffset(oReader.characterOffset());
+	int iLastPercent = -1;
+	while(oReader.readNextStartElement())
+	{
+		Entry oEntry;
+		oEntry.sFileName = oReader.attributes().value("fileName").toString();
+		oEntry.iEmotionLabel = EmotionLabel::fromValue(oReader.attributes().value("emotionLabel").toString().toInt()).getValue();
+		oReader.skipCurrentElement();
+
+		oEntry.iBegin = iBegin;
+		oEntry.iEnd = fByteOffset(oReader.characterOffset());
+		iBegin = oEntry.iEnd;
+		m_vEntries.push_back(oEntry);
+
+		int iPercent = iFileSize > 0 ? (int) (iBegin * 100 / iFileSize) : 100;
+		if(fProgress && iPercent != iLastPercent)
+		{
+			iLastPercent = iPercent;
+			if(!fProgress(iPercent))
+			{
+				sMsgError = QString(QCoreApplication::translate("FaceDataset", "a leitura do arquivo [%1] foi cancelada")).arg(sFileName);
+				return false;
+			}
+		}
+	}
+
+	if(oReader.hasError())
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "erro no conteúdo do arquivo [%1]: problema [%2], linha [%3], coluna [%4]")).arg(sFileName, oReader.errorString(), QString::number(oReader.lineNumber()), QString::number(oReader.columnNumber()));
+		return false;
+	}
+
+	// The locations are checked with the first and the last samples, which are read completely
+	if(!m_vEntries.empty())
+	{
+		vector<pair<qint64, qint64> > vCheck;
+		vCheck.push_back(make_pair(m_vEntries.front().iBegin, m_vEntries.front().iEnd));
+		FaceImageBatch vSamples;
+		if(!read(vCheck, vSamples, sMsgError))
+			return false;
+
+		vCheck[0] = make_pair(m_vEntries.back().iBegin, m_vEntries.back().iEnd);
+		if(!read(vCheck, vSamples, sMsgError))
+			return false;
+	}
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetPager::fileName() const
+{
+	return m_oFile.fileName();
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetPager::numFeatures() const
+{
+	return m_iNumFeatures;
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetPager::journalId() const
+{
+	return m_sJournalId;
+}
+
+// +-----------------------------------------------------------
+f3::FaceFeatureConnections f3::FaceDatasetPager::connections() const
+{
+	return m_oConnections;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetPager::takeEntries(vector<Entry> &vEntries)
+{
+	vEntries.clear();
+	vEntries.swap(m_vEntries);
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetPager::read(const vector<pair<qint64, qint64> > &vRanges, FaceImageBatch &vSamples, QString &sMsgError)
+{
+	vSamples.clear();
+	if(vRanges.empty())
+		return true;
+
+	if(m_bStore)
+		return readStore(vRanges, vSamples, sMsgError);
+
+	if(!m_oFile.isOpen() && !m_oFile.open(QFile::ReadOnly))
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível ler o arquivo [%1]")).arg(m_oFile.fileName());
+		return false;
+	}
+
+	qint64 iStart = vRanges.front().first;
+	qint64 iStop = vRanges.back().second;
+	QByteArray oData;
+	if(m_oFile.seek(iStart))
+		oData = m_oFile.read(iStop - iStart);
+	if(oData.size() != iStop - iStart)
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível ler o arquivo [%1]")).arg(m_oFile.fileName());
+		return false;
+	}
+
+	// Each sample is parsed as an xml document of its own
+	vSamples.reserve(vRanges.size());
+	for(unsigned int i = 0; i < vRanges.size(); i++)
+	{
+		QXmlStreamReader oReader(oData.mid(vRanges[i].first - iStart, vRanges[i].second - vRanges[i].first));
+		shared_ptr<FaceImage> pSample(new FaceImage());
+		QString sError = QString(QCoreApplication::translate("FaceDataset", "o nó '%1' não existe")).arg("Sample");
+		if(!oReader.readNextStartElement() || !pSample->loadFromStream(oReader, sError, m_iNumFeatures))
+		{
+			sMsgError = QString(QCoreApplication::translate("FaceDataset", "erro no conteúdo do arquivo [%1]: problema [%2], posição [%3]")).arg(m_oFile.fileName(), oReader.hasError() ? oReader.errorString() : sError, QString::number(vRanges[i].first));
+			return false;
+		}
+		vSamples.push_back(pSample);
+	}
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetPager::apply(const FaceDatasetChanges &oChanges, const int iSavedChanges, QString &sMsgError)
+{
+	if(!m_bStore)
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "o arquivo [%1] não é um banco de dados")).arg(fileName());
+		return false;
+	}
+
+	// A connection of its own is used, so the size and the features of the database are current
+	QMutexLocker oLocker(&m_oMutex);
+	FaceDatasetStore oStore;
+	if(!oStore.open(fileName(), sMsgError) || !oStore.apply(oChanges, sMsgError))
+		return false;
+
+	m_iNumFeatures = oStore.numFeatures();
+	m_iSavedChanges = iSavedChanges;
+	return true;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetPager::savedChanges() const
+{
+	return m_iSavedChanges;
+}
+
+// +-----------------------------------------------------------
+QMutex* f3::FaceDatasetPager::mutex()
+{
+	return &m_oMutex;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetPager::openStore(const QString &sFileName, QString &sMsgError, const std::function<bool (int iPercent)> &fProgress)
+{
+	FaceDatasetStore oStore;
+	if(!oStore.open(sFileName, sMsgError))
+		return false;
+	m_iNumFeatures = oStore.numFeatures();
+	m_sJournalId = oStore.journalId();
+	m_oConnections = oStore.connections();
+
+	int iSize = oStore.size();
+	int iLastPercent = -1;
+	m_vEntries.reserve(iSize);
+	return oStore.readIndex([&](qint64 iId, const QString &sSampleFile, int iEmotionLabel) -> bool
+	{
+		Entry oEntry;
+		oEntry.sFileName = sSampleFile;
+		oEntry.iEmotionLabel = EmotionLabel::fromValue(iEmotionLabel).getValue();
+		oEntry.iBegin = iId;
+		oEntry.iEnd = iId;
+		m_vEntries.push_back(oEntry);
+
+		int iPercent = iSize > 0 ? (int) (m_vEntries.size() * 100 / iSize) : 100;
+		if(fProgress && iPercent != iLastPercent)
+		{
+			iLastPercent = iPercent;
+			return fProgress(iPercent);
+		}
+		return true;
+	}, sMsgError);
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetPager::readStore(const vector<pair<qint64, qint64> > &vRanges, FaceImageBatch &vSamples, QString &sMsgError)
+{
+	// A connection can only be used in the thread that opened it
+	shared_ptr<FaceDatasetStore> &pStore = m_mStores[QThread::currentThread()];
+	if(!pStore)
+	{
+		pStore = shared_ptr<FaceDatasetStore>(new FaceDatasetStore());
+		if(!pStore->open(fileName(), sMsgError))
+		{
+			m_mStores.remove(QThread::currentThread());
+			return false;
+		}
+	}
+
+	vector<qint64> vIds;
+	vIds.reserve(vRanges.size());
+	for(unsigned int i = 0; i < vRanges.size(); i++)
+		vIds.push_back(vRanges[i].first);
+	if(!pStore->read(vIds, vSamples, sMsgError))
+		return false;
+
+	// The samples have the features last applied to the database (and not the ones of when the
+	// connection was opened, which might be older)
+	for(unsigned int i = 0; i < vSamples.size(); i++)
+	{
+		if((int) vSamples[i]->getFeatures().size() != m_iNumFeatures)
+		{
+			sMsgError = QString(QCoreApplication::translate("FaceDataset", "erro no conteúdo do arquivo [%1]: a amostra de identificador [%2] tem %3 marcas faciais, mas o banco tem %4")).arg(fileName()).arg(vIds[i]).arg(vSamples[i]->getFeatures().size()).arg(m_iNumFeatures);
+			vSamples.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FACEDATASETPAGER_H
+#define FACEDATASETPAGER_H
+
+#include "core_global.h"
+#include "faceimage.h"
+#include "facefeatureconnections.h"
+#include "facedatasetreader.h"
+#include "facedatasetstore.h"
+
+#include <QString>
+#include <QFile>
+#include <QMutex>
+#include <QMap>
+#include <QThread>
+#include <QMetaType>
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <functional>
+
+namespace f3
+{
+	/**
+	 * Reader of the samples of a face annotation dataset file on demand, used by FaceDataset in the
+	 * paging mode (see FaceDataset::setPagingBudget()). When the file is opened, only a compact index of
+	 * the samples is built (their file names, emotion labels and the location of their contents in the
+	 * file), and the complete samples (with their face features) are read afterwards, in pages.
+	 *
+	 * The location of the samples is kept in bytes, so the file must be encoded in UTF-8 (the encoding
+	 * used by FaceDatasetSnapshot::saveToFile()). A dataset stored in a SQLite database (see
+	 * FaceDatasetStore) is also paged: its samples are located by their identifiers in the database,
+	 * and read with a connection for each thread that reads them. Since the database is changed in
+	 * place by the incremental savings, these are done by the pager (see apply()).
+	 */
+	class CORE_EXPORT FaceDatasetPager
+	{
+		Q_DISABLE_COPY(FaceDatasetPager)
+	public:
+		/**
+		 * Compact description of a sample in the index.
+		 */
+		struct Entry
+		{
+			/** Name of the image file of the sample. */
+			QString sFileName;
+
+			/** Value of the emotion label of the sample. */
+			int iEmotionLabel;
+
+			/** Offset (in bytes) where the sample begins in the file (or its identifier in a database),
+			 * or -1 if the sample is not read from the file. */
+			qint64 iBegin;
+
+			/** Offset (in bytes) where the sample ends in the file (or its identifier in a database). */
+			qint64 iEnd;
+		};
+
+		/**
+		 * Class constructor.
+		 */
+		FaceDatasetPager();
+
+		/**
+		 * Class destructor.
+		 */
+		virtual ~FaceDatasetPager();
+
+		/**
+		 * Opens the given dataset file and builds the index of its samples. The samples are parsed
+		 * but their face features are skipped, so the index is built without allocating them (in a
+		 * database, only the table of the samples is queried, see FaceDatasetStore::readIndex()).
+		 * @param sFileName QString with the path and name of the dataset file (or database file).
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @param fProgress Function called with the percentage of the file indexed (in range [0, 100]),
+		 * returning false to cancel the indexing. The default is no function.
+		 * @return Boolean indicating if the opening was successful (true) of failed (false, also in
+		 * case the file is not encoded in UTF-8).
+		 */
+		bool open(const QString &sFileName, QString &sMsgError, const std::function<bool (int iPercent)> &fProgress = std::function<bool (int)>());
+
+		/**
+		 * Gets the path and name of the dataset file.
+		 * @return QString with the path and name of the file.
+		 */
+		QString fileName() const;
+
+		/**
+		 * Gets the number of face features in the dataset (as stored in the file, i.e. after the last
+		 * changes applied to a database).
+		 * @return Integer with the number of face features.
+		 */
+		int numFeatures() const;
+
+		/**
+		 * Gets the journal identifier of the dataset file (see FaceDatasetJournal).
+		 * @return QString with the journal identifier, or an empty string if there is none.
+		 */
+		QString journalId() const;
+
+		/**
+		 * Gets the connections between the face features of the dataset.
+		 * @return FaceFeatureConnections with the connections.
+		 */
+		FaceFeatureConnections connections() const;
+
+		/**
+		 * Moves the index built by open() to the given vector (so it is not kept twice in memory).
+		 * @param vEntries Vector to receive the entries of the index, in the order of the samples.
+		 */
+		void takeEntries(std::vector<Entry> &vEntries);
+
+		/**
+		 * Reads the samples at the given locations of the file. The locations are expected to be
+		 * close to each other (i.e. the samples of a page), since the whole range that contains them
+		 * is read at once. This method is not thread safe (see mutex()).
+		 * @param vRanges Vector with the begin and end offsets of the samples to read (see Entry),
+		 * in ascending order.
+		 * @param vSamples FaceImageBatch to receive the samples read, in the order of the ranges.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the reading was successful (true) of failed (false).
+		 */
+		bool read(const std::vector<std::pair<qint64, qint64> > &vRanges, FaceImageBatch &vSamples, QString &sMsgError);
+
+		/**
+		 * Applies the changes done in a dataset to its database (see FaceDatasetStore::apply()), while
+		 * no sample is read. The changes on the features of all samples are also applied to the samples
+		 * read afterwards, so FaceDataset must not apply them again (see savedChanges()).
+		 * @param oChanges FaceDatasetChanges with the changes to apply.
+		 * @param iSavedChanges Integer with the number of changes on the features of all samples done
+		 * in the paging mode (see FaceDataset::numPagedChanges()) when the changes were prepared.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the changes were applied (true) or not (false, also in case
+		 * the file is not a database).
+		 */
+		bool apply(const FaceDatasetChanges &oChanges, const int iSavedChanges, QString &sMsgError);
+
+		/**
+		 * Gets the number of the first changes on the features of all samples done in the paging mode
+		 * that are already in the samples read (i.e. that were applied to the database). This method
+		 * is not thread safe (see mutex()).
+		 * @return Integer with the number of changes already saved.
+		 */
+		int savedChanges() const;
+
+		/**
+		 * Gets the mutex that serializes the loading of the samples (by FaceDataset), since the
+		 * samples can be requested from different threads at the same time.
+		 * @return Pointer to the QMutex.
+		 */
+		QMutex* mutex();
+
+	protected:
+
+		/**
+		 * Opens the given database and builds the index of its samples. See open().
+		 * @param sFileName QString with the path and name of the database file.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @param fProgress Function called with the percentage of the samples indexed.
+		 * @return Boolean indicating if the opening was successful (true) of failed (false).
+		 */
+		bool openStore(const QString &sFileName, QString &sMsgError, const std::function<bool (int iPercent)> &fProgress);
+
+		/**
+		 * Reads the samples with the given identifiers from the database, with the connection of
+		 * the current thread (opened when the thread reads its first page). See read().
+		 * @param vRanges Vector with the identifiers of the samples to read (see Entry).
+		 * @param vSamples FaceImageBatch to receive the samples read, in the order of the ranges.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the reading was successful (true) of failed (false).
+		 */
+		bool readStore(const std::vector<std::pair<qint64, qint64> > &vRanges, FaceImageBatch &vSamples, QString &sMsgError);
+
+	private:
+
+		/** File from where the samples are read (opened when the first page is read). */
+		QFile m_oFile;
+
+		/** Indication that the file is a database (see FaceDatasetStore). */
+		bool m_bStore;
+
+		/** Connections to the database used to read the samples, by the thread that uses each one. */
+		QMap<QThread*, std::shared_ptr<FaceDatasetStore> > m_mStores;
+
+		/** Number of changes on the features of all samples already applied to the database. */
+		int m_iSavedChanges;
+
+		/** Mutex that serializes the loading of the samples. */
+		QMutex m_oMutex;
+
+		/** Number of face features in the dataset. */
+		int m_iNumFeatures;
+
+		/** Journal identifier of the dataset file. */
+		QString m_sJournalId;
+
+		/** Connections between the face features. */
+		FaceFeatureConnections m_oConnections;
+
+		/** Index of the samples, until taken by takeEntries(). */
+		std::vector<Entry> m_vEntries;
+	};
+}
+
+Q_DECLARE_METATYPE(std::shared_ptr<f3::FaceDatasetPager>)
+
+#endif // FACEDATASETPAGER_H
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "facedatasetreader.h"
+
+#include <QCoreApplication>
+
+using namespace std;
+
+// +-----------------------------------------------------------
+f3::FaceDatasetReader::FaceDatasetReader()
+{
+	m_iNumFeatures = 0;
+	m_bAtEnd = true;
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetReader::~FaceDatasetReader()
+{
+	if(m_oFile.isOpen())
+		m_oFile.close();
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetReader::open(const QString &sFileName, QString &sMsgError)
+{
+	m_oFile.setFileName(sFileName);
+	if(!m_oFile.open(QFile::ReadOnly))
+    {
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível ler o arquivo [%1]")).arg(sFileName);
+        return false;
+    }
+	m_oReader.setDevice(&m_oFile);
+
+	// Root node
+	if(!m_oReader.readNextStartElement() || m_oReader.name() != "FaceDataset")
+	{
+		sMsgError = contentError(QString(QCoreApplication::translate("FaceDataset", "o nó '%1' não existe")).arg("FaceDataset"));
+		return false;
+	}
+
+	bool bOk;
+	m_iNumFeatures = m_oReader.attributes().value("numberOfFeatures").toString().toInt(&bOk);
+	if(!bOk || m_iNumFeatures < 0)
+	{
+		sMsgError = contentError(QString(QCoreApplication::translate("FaceDataset", "o atributo '%1' não existe ou contém um valor inválido")).arg("numberOfFeatures"));
+		return false;
+	}
+	m_sJournalId = m_oReader.attributes().value("journalId").toString();
+	m_oConnections.clear();
+
+	// Connections (optional, written before the samples) and sample images
+	while(m_oReader.readNextStartElement())
+	{
+		if(m_oReader.name() == "Samples")
+		{
+			m_bAtEnd = false;
+			return true;
+		}
+		else if(m_oReader.name() == "Connections")
+		{
+			QString sError;
+			if(!m_oConnections.loadFromStream(m_oReader, sError, m_iNumFeatures))
+			{
+				sMsgError = contentError(m_oReader.hasError() ? m_oReader.errorString() : sError);
+				return false;
+			}
+		}
+		else
+			m_oReader.skipCurrentElement();
+	}
+
+	sMsgError = contentError(QString(QCoreApplication::translate("FaceDataset", "o nó '%1' não existe")).arg("Samples"));
+	return false;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetReader::numFeatures() const
+{
+	return m_iNumFeatures;
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetReader::journalId() const
+{
+	return m_sJournalId;
+}
+
+// +-----------------------------------------------------------
+f3::FaceFeatureConnections f3::FaceDatasetReader::connections() const
+{
+	return m_oConnections;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetReader::readBatch(const int iMaxSamples, FaceImageBatch &vBatch, QString &sMsgError)
+{
+	vBatch.clear();
+	while(!m_bAtEnd && (int) vBatch.size() < iMaxSamples)
+	{
+		if(!m_oReader.readNextStartElement())
+		{
+			// Either the end of the samples node or an error in the document
+			if(m_oReader.hasError())
+			{
+				sMsgError = contentError(m_oReader.errorString());
+				return false;
+			}
+			m_bAtEnd = true;
+			break;
+		}
+
+		shared_ptr<FaceImage> pSample(new FaceImage());
+		QString sError;
+		if(!pSample->loadFromStream(m_oReader, sError, m_iNumFeatures))
+		{
+			sMsgError = contentError(m_oReader.hasError() ? m_oReader.errorString() : sError);
+			return false;
+		}
+		vBatch.push_back(pSample);
+	}
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetReader::atEnd() const
+{
+	return m_bAtEnd;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetReader::progress() const
+{
+	if(m_bAtEnd)
+		return 100;
+	qint64 iSize = m_oFile.size();
+	return iSize > 0 ? (int) qMin(m_oReader.characterOffset() * 100 / iSize, (qint64) 99) : 0;
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetReader::contentError(const QString &sProblem) const
+{
+	return QString(QCoreApplication::translate("FaceDataset", "erro no conteúdo do arquivo [%1]: problema [%2], linha [%3], coluna [%4]")).arg(m_oFile.fileName(), sProblem, QString::number(m_oReader.lineNumber()), QString::number(m_oReader.columnNumber()));
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FACEDATASETREADER_H
+#define FACEDATASETREADER_H
+
+#include "core_global.h"
+#include "faceimage.h"
+#include "facefeatureconnections.h"
+
+#include <QFile>
+#include <QXmlStreamReader>
+#include <QMetaType>
+
+#include <vector>
+#include <memory>
+
+namespace f3
+{
+	/** Batch of face images read from a face dataset file. */
+	typedef std::vector<std::shared_ptr<FaceImage> > FaceImageBatch;
+
+	/**
+	 * Streaming reader of face dataset files. Differently from FaceDataset::loadFromFile (which
+	 * produces the dataset only when the whole file is read), this class reads the samples in
+	 * batches, so they can be used (for instance, displayed) while the rest of the file is still
+	 * being read. Only the samples of the current batch are kept in memory by the reader.
+	 */
+	class CORE_EXPORT FaceDatasetReader
+	{
+	public:
+		/**
+		 * Class constructor.
+		 */
+		FaceDatasetReader();
+
+		/**
+		 * Class destructor.
+		 */
+		virtual ~FaceDatasetReader();
+
+		/**
+		 * Opens the given face dataset file and reads its header (i.e. everything up to the first sample).
+		 * @param sFileName QString with the name of the file to read the data from.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the opening was successful (true) of failed (false).
+		 */
+		bool open(const QString &sFileName, QString &sMsgError);
+
+		/**
+		 * Queries the number of facial features in the dataset being read.
+		 * @return Integer with the number of face features in the dataset.
+		 */
+		int numFeatures() const;
+
+		/**
+		 * Queries the identifier that binds the file being read to its journal (see FaceDatasetJournal).
+		 * @return QString with the identifier, or an empty string if the file has none.
+		 */
+		QString journalId() const;
+
+		/**
+		 * Queries the connections between the face features in the dataset being read.
+		 * @return FaceFeatureConnections with the connections read from the file header.
+		 */
+		FaceFeatureConnections connections() const;
+
+		/**
+		 * Reads the next batch of samples from the file.
+		 * @param iMaxSamples Integer with the maximum number of samples to read.
+		 * @param vBatch FaceImageBatch to receive the samples read. It is cleared before reading.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the reading was successful (true) of failed (false).
+		 */
+		bool readBatch(const int iMaxSamples, FaceImageBatch &vBatch, QString &sMsgError);
+
+		/**
+		 * Indicates if all samples in the file were read.
+		 * @return Boolean indicating if the end of the samples was reached.
+		 */
+		bool atEnd() const;
+
+		/**
+		 * Queries the percentage of the file already read.
+		 * @return Integer with the percentage of the file read (in range [0, 100]).
+		 */
+		int progress() const;
+
+	protected:
+
+		/**
+		 * Builds the error message for a problem in the file contents, including its location.
+		 * @param sProblem QString with the description of the problem.
+		 * @return QString with the error message.
+		 */
+		QString contentError(const QString &sProblem) const;
+
+	private:
+
+		/** File being read. */
+		QFile m_oFile;
+
+		/** Xml stream reader used to parse the file. */
+		QXmlStreamReader m_oReader;
+
+		/** Number of face features in the dataset being read. */
+		int m_iNumFeatures;
+
+		/** Identifier that binds the file being read to its journal. */
+		QString m_sJournalId;
+
+		/** Connections between the face features in the dataset being read. */
+		FaceFeatureConnections m_oConnections;
+
+		/** Indication that all samples were read. */
+		bool m_bAtEnd;
+	};
+}
+
+Q_DECLARE_METATYPE(f3::FaceImageBatch)
+
+#endif // FACEDATASETREADER_H
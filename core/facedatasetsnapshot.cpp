@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "facedatasetsnapshot.h"
+#include "facedatasetstore.h"
+
+#include <QSaveFile>
+#include <QTextStream>
+#include <QDomDocument>
+#include <QCoreApplication>
+
+using namespace std;
+
+// +-----------------------------------------------------------
+f3::FaceDatasetSnapshot::FaceDatasetSnapshot()
+{
+	m_iNumFeatures = 0;
+	m_iVersion = 0;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetSnapshot::size() const
+{
+	return (int) m_vSamples.size();
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetSnapshot::numFeatures() const
+{
+	return m_iNumFeatures;
+}
+
+// +-----------------------------------------------------------
+quint64 f3::FaceDatasetSnapshot::version() const
+{
+	return m_iVersion;
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetSnapshot::journalId() const
+{
+	return m_sJournalId;
+}
+
+// +-----------------------------------------------------------
+const f3::FaceFeatureConnections& f3::FaceDatasetSnapshot::connections() const
+{
+	return m_oConnections;
+}
+
+// +-----------------------------------------------------------
+const f3::FaceImage* f3::FaceDatasetSnapshot::getImage(const int iIndex) const
+{
+	if(iIndex < 0 || iIndex >= size())
+		return NULL;
+
+	return m_vSamples[iIndex].get();
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetSnapshot::saveToFile(const QString &sFileName, QString &sMsgError, const std::function<bool (int iPercent)> &fProgress) const
+{
+	// The samples that could not be read from the original file are not known, so they can not be written
+	for(unsigned int i = 0; i < m_vSamples.size(); i++)
+		if(!m_vSamples[i])
+		{
+			sMsgError = QString(QCoreApplication::translate("FaceDataset", "o conjunto de dados não pode ser gravado porque a amostra %1 não pôde ser lida do arquivo original")).arg(i + 1);
+			return false;
+		}
+
+	// Datasets in a SQLite database are replaced in a single transaction instead
+	if(FaceDatasetStore::isStore(sFileName))
+	{
+		FaceDatasetStore oStore;
+		return oStore.open(sFileName, sMsgError, true) && oStore.write(*this, sMsgError, fProgress);
+	}
+
+	// The building of the xml document is reported as the first 90% of the work
+	int iLastPercent = -1;
+	auto fReport = [&](int iPercent) -> bool
+	{
+		if(!fProgress || iPercent == iLastPercent)
+			return true;
+		iLastPercent = iPercent;
+		if(fProgress(iPercent))
+			return true;
+
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "a gravação do arquivo [%1] foi cancelada")).arg(sFileName);
+		return false;
+	};
+
+	/******************************************************
+	 * Create the xml document
+	 ******************************************************/
+	QDomDocument oDoc;
+
+	// Processing instruction
+	QDomProcessingInstruction oInstr = oDoc.createProcessingInstruction("xml", "version='1.0' encoding='UTF-8'");
+	oDoc.appendChild(oInstr);
+
+	// Root node
+	QDomElement oRoot = oDoc.createElementNS("http://www.luiz.vieira.nom.br/f3/", "FaceDataset");
+	oDoc.appendChild(oRoot);
+
+	oRoot.setAttribute("numberOfFeatures", m_iNumFeatures);
+	if(!m_sJournalId.isEmpty())
+		oRoot.setAttribute("journalId", m_sJournalId);
+
+	// Connections between the features (before the samples, so they are read with the file header)
+	if(!m_oConnections.isEmpty())
+		m_oConnections.saveToXML(oRoot);
+
+	// Sample images
+	QDomElement oSamples = oDoc.createElement("Samples");
+	oRoot.appendChild(oSamples);
+
+	for(int i = 0; i < size(); i++)
+	{
+		if(!fReport(i * 90 / size()))
+			return false;
+		m_vSamples[i]->saveToXML(oSamples);
+	}
+
+	/******************************************************
+	 * Save the file
+	 ******************************************************/
+	QSaveFile oFile(sFileName);
+	if (!oFile.open(QFile::WriteOnly | QFile::Truncate))
+    {
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível escrever no arquivo [%1]")).arg(sFileName);
+        return false;
+    }
+
+	QTextStream oData(&oFile);
+	oDoc.save(oData, 4);
+	oData.flush();
+
+	if(!fReport(90))
+	{
+		oFile.cancelWriting();
+		return false;
+	}
+
+	// Replace the existing file only now that the new one is complete
+	if(!oFile.commit())
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível escrever no arquivo [%1]")).arg(sFileName);
+        return false;
+	}
+
+	fReport(100);
+	return true;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FACEDATASETSNAPSHOT_H
+#define FACEDATASETSNAPSHOT_H
+
+#include "core_global.h"
+#include "faceimage.h"
+#include "facefeatureconnections.h"
+
+#include <QString>
+
+#include <vector>
+#include <memory>
+#include <functional>
+
+namespace f3
+{
+	/**
+	 * Read-only view of the contents of a FaceDataset at the moment it was taken (see
+	 * FaceDataset::snapshot()). The snapshot shares the face images with the dataset, so taking it is
+	 * cheap, and the dataset copies a face image before changing it if the image is shared with any
+	 * snapshot (copy-on-write). Hence the snapshot remains stable, and can be used in other threads
+	 * (for instance, to save or analyse the dataset in background) while the dataset is edited.
+	 */
+	class CORE_EXPORT FaceDatasetSnapshot
+	{
+		friend class FaceDataset;
+		friend class AbstractFaceDataset;
+	public:
+		/**
+		 * Class constructor. Creates an empty snapshot.
+		 */
+		FaceDatasetSnapshot();
+
+		/**
+		 * Returns the number of face samples in the snapshot.
+		 * @return Integer with the number of face samples.
+		 */
+		int size() const;
+
+		/**
+		 * Queries the number of facial features in the snapshot (applicable to all images).
+		 * @return Integer with the number of face features.
+		 */
+		int numFeatures() const;
+
+		/**
+		 * Queries the version of the dataset when the snapshot was taken. The version of a dataset
+		 * changes every time it is edited, so it can be used to check if the snapshot is outdated.
+		 * @return Unsigned integer with the version of the dataset.
+		 */
+		quint64 version() const;
+
+		/**
+		 * Queries the identifier of the saved contents written with the snapshot (see FaceDatasetJournal).
+		 * It is only defined in the snapshots taken to save the dataset (see FaceDataset::prepareFullSave()).
+		 * @return QString with the identifier, or an empty string if it is not defined.
+		 */
+		QString journalId() const;
+
+		/**
+		 * Queries the connections between the face features in the snapshot.
+		 * @return Const reference to the FaceFeatureConnections with the connections.
+		 */
+		const FaceFeatureConnections& connections() const;
+
+		/**
+		 * Gets the face image for the given index. The index must be in the range [0, count - 1],
+		 * where count is the number of face images in the snapshot.
+		 * @param iIndex Integer with the index of the image.
+		 * @return Pointer to a const FaceImage with the face image data. If the index is invalid,
+		 * NULL is returned.
+		 */
+		const FaceImage* getImage(const int iIndex) const;
+
+        /**
+         * Saves (serializes) the snapshot to the given file, in the same format used by FaceDataset.
+		 * The data is first written to a temporary file that only replaces the given file after it
+		 * is completely written, so a failure in the middle of the saving never corrupts an existing file.
+		 * If the file is a SQLite database (see FaceDatasetStore), its contents are replaced in a transaction.
+		 * A snapshot missing samples that could not be read (see FaceDataset::pagingError()) is never saved.
+         * @param sFileName QString with the name of the file to write the data to.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @param fProgress Function called with the percentage of the saving concluded (in range [0, 100]).
+		 * If it returns false, the saving is cancelled (and the method fails). The default is no function.
+		 * @return Boolean indicating if the saving was successful (true) of failed (false).
+         */
+        bool saveToFile(const QString &sFileName, QString &sMsgError, const std::function<bool (int iPercent)> &fProgress = std::function<bool (int)>()) const;
+
+	private:
+
+		/** Vector of sample face images, shared with the dataset. */
+		std::vector<std::shared_ptr<FaceImage> > m_vSamples;
+
+		/** Number of face features in the dataset when the snapshot was taken. */
+		int m_iNumFeatures;
+
+		/** Connections between the face features when the snapshot was taken. */
+		FaceFeatureConnections m_oConnections;
+
+		/** Version of the dataset when the snapshot was taken. */
+		quint64 m_iVersion;
+
+		/** Identifier written in the file to bind it to its journal (empty if not applicable). */
+		QString m_sJournalId;
+	};
+}
+
+#endif // FACEDATASETSNAPSHOT_H
@@ -0,0 +1,746 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "facedatasetstore.h"
+#include "parallel.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QUuid>
+#include <QImageReader>
+#include <QStringList>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+
+#include <algorithm>
+#include <map>
+
+using namespace std;
+
+// +-----------------------------------------------------------
+f3::FaceDatasetStore::FaceDatasetStore()
+{
+	m_iSize = 0;
+	m_iNumFeatures = 0;
+	m_iNext = 0;
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetStore::~FaceDatasetStore()
+{
+	close();
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::isStore(const QString &sFileName)
+{
+	return QFileInfo(sFileName).suffix().compare("afdb", Qt::CaseInsensitive) == 0;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::open(const QString &sFileName, QString &sMsgError, const bool bCreate)
+{
+	close();
+	if(!bCreate && !QFile::exists(sFileName))
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "não foi possível ler o arquivo [%1]")).arg(sFileName);
+		return false;
+	}
+
+	m_sFileName = sFileName;
+	m_sConnection = QUuid::createUuid().toString();
+	QSqlDatabase oDB = QSqlDatabase::addDatabase("QSQLITE", m_sConnection);
+	oDB.setDatabaseName(sFileName);
+	if(!oDB.open())
+	{
+		sMsgError = databaseError(oDB.lastError().text());
+		return false;
+	}
+
+	/******************************************************
+	 * Create the tables, if needed
+	 ******************************************************/
+	// The positions are not unique keys, so a range of them can be shifted with a single update
+	QStringList lSchema;
+	lSchema << "CREATE TABLE IF NOT EXISTS properties (name TEXT PRIMARY KEY, value TEXT)"
+		<< "CREATE TABLE IF NOT EXISTS samples (id INTEGER PRIMARY KEY, position INTEGER NOT NULL, fileName TEXT NOT NULL, emotion INTEGER NOT NULL, width INTEGER, height INTEGER)"
+		<< "CREATE INDEX IF NOT EXISTS samples_position ON samples (position)"
+		<< "CREATE INDEX IF NOT EXISTS samples_emotion ON samples (emotion)"
+		<< "CREATE TABLE IF NOT EXISTS landmarks (sample INTEGER NOT NULL REFERENCES samples (id), position INTEGER NOT NULL, id INTEGER NOT NULL, x REAL NOT NULL, y REAL NOT NULL)"
+		<< "CREATE INDEX IF NOT EXISTS landmarks_sample ON landmarks (sample, position)"
+		<< "CREATE INDEX IF NOT EXISTS landmarks_feature ON landmarks (position)"
+		<< "CREATE TABLE IF NOT EXISTS connections (first INTEGER NOT NULL, second INTEGER NOT NULL, PRIMARY KEY (first, second))";
+
+	QSqlQuery oQuery(oDB);
+	foreach(QString sStatement, lSchema)
+	{
+		if(!oQuery.exec(sStatement))
+		{
+			sMsgError = databaseError(oQuery.lastError().text());
+			return false;
+		}
+	}
+
+	/******************************************************
+	 * Read the dataset properties
+	 ******************************************************/
+	m_iNumFeatures = 0;
+	m_sJournalId.clear();
+	m_oConnections.clear();
+
+	if(!oQuery.exec("SELECT name, value FROM properties"))
+	{
+		sMsgError = databaseError(oQuery.lastError().text());
+		return false;
+	}
+	while(oQuery.next())
+	{
+		if(oQuery.value(0).toString() == "numberOfFeatures")
+			m_iNumFeatures = oQuery.value(1).toInt();
+		else if(oQuery.value(0).toString() == "journalId")
+			m_sJournalId = oQuery.value(1).toString();
+	}
+
+	if(!oQuery.exec("SELECT first, second FROM connections"))
+	{
+		sMsgError = databaseError(oQuery.lastError().text());
+		return false;
+	}
+	while(oQuery.next())
+		m_oConnections.connect(oQuery.value(0).toInt(), oQuery.value(1).toInt());
+
+	if(!oQuery.exec("SELECT COUNT(*) FROM samples") || !oQuery.next())
+	{
+		sMsgError = databaseError(oQuery.lastError().text());
+		return false;
+	}
+	m_iSize = oQuery.value(0).toInt();
+	m_iNext = 0;
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetStore::close()
+{
+	if(m_sConnection.isEmpty())
+		return;
+
+	// The connection can only be removed when no instance of it is in use
+	QSqlDatabase::database(m_sConnection, false).close();
+	QSqlDatabase::removeDatabase(m_sConnection);
+	m_sConnection.clear();
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetStore::fileName() const
+{
+	return m_sFileName;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetStore::size() const
+{
+	return m_iSize;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetStore::numFeatures() const
+{
+	return m_iNumFeatures;
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetStore::journalId() const
+{
+	return m_sJournalId;
+}
+
+// +-----------------------------------------------------------
+f3::FaceFeatureConnections f3::FaceDatasetStore::connections() const
+{
+	return m_oConnections;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::read(const int iFirst, const int iCount, FaceImageBatch &vBatch, QString &sMsgError)
+{
+	vBatch.clear();
+
+	// The samples and their landmarks are read with a single query (one row per landmark)
+	QSqlQuery oQuery(QSqlDatabase::database(m_sConnection, false));
+	oQuery.setForwardOnly(true);
+	oQuery.prepare("SELECT s.position, s.fileName, s.emotion, l.id, l.x, l.y FROM samples s LEFT JOIN landmarks l ON l.sample = s.id "
+		"WHERE s.position >= ? AND s.position < ? ORDER BY s.position, l.position");
+	oQuery.bindValue(0, iFirst);
+	oQuery.bindValue(1, iFirst + iCount);
+	if(!oQuery.exec())
+	{
+		sMsgError = databaseError(oQuery.lastError().text());
+		return false;
+	}
+
+	int iLast = -1;
+	while(oQuery.next())
+	{
+		int iPosition = oQuery.value(0).toInt();
+		if(iPosition != iLast)
+		{
+			vBatch.push_back(shared_ptr<FaceImage>(new FaceImage(oQuery.value(1).toString(), EmotionLabel::fromValue(oQuery.value(2).toInt()))));
+			iLast = iPosition;
+		}
+		if(!oQuery.isNull(3))
+			vBatch.back()->addFeature(oQuery.value(3).toInt(), oQuery.value(4).toFloat(), oQuery.value(5).toFloat());
+	}
+
+	for(unsigned int i = 0; i < vBatch.size(); i++)
+	{
+		if((int) vBatch[i]->getFeatures().size() != m_iNumFeatures)
+		{
+			sMsgError = databaseError(QString(QCoreApplication::translate("FaceDataset", "a amostra [%1] tem %2 marcas faciais, mas o banco tem %3")).arg(iFirst + i).arg(vBatch[i]->getFeatures().size()).arg(m_iNumFeatures));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::readIndex(const std::function<bool (qint64 iId, const QString &sFileName, int iEmotionLabel)> &fSample, QString &sMsgError)
+{
+	QSqlQuery oQuery(QSqlDatabase::database(m_sConnection, false));
+	oQuery.setForwardOnly(true);
+	if(!oQuery.exec("SELECT id, fileName, emotion FROM samples ORDER BY position"))
+	{
+		sMsgError = databaseError(oQuery.lastError().text());
+		return false;
+	}
+
+	while(oQuery.next())
+	{
+		if(!fSample(oQuery.value(0).toLongLong(), oQuery.value(1).toString(), oQuery.value(2).toInt()))
+		{
+			sMsgError = QString(QCoreApplication::translate("FaceDataset", "a leitura do arquivo [%1] foi cancelada")).arg(m_sFileName);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::read(const vector<qint64> &vIds, FaceImageBatch &vBatch, QString &sMsgError)
+{
+	vBatch.clear();
+	if(vIds.empty())
+		return true;
+
+	// The samples are read with a single query on the range of the identifiers, and the ones in the
+	// range that were not requested (i.e. of other pages) are skipped
+	vector<qint64> vSorted(vIds);
+	sort(vSorted.begin(), vSorted.end());
+
+	QSqlQuery oQuery(QSqlDatabase::database(m_sConnection, false));
+	oQuery.setForwardOnly(true);
+	oQuery.prepare("SELECT s.id, s.fileName, s.emotion, l.id, l.x, l.y FROM samples s LEFT JOIN landmarks l ON l.sample = s.id "
+		"WHERE s.id >= ? AND s.id <= ? ORDER BY s.id, l.position");
+	oQuery.bindValue(0, vSorted.front());
+	oQuery.bindValue(1, vSorted.back());
+	if(!oQuery.exec())
+	{
+		sMsgError = databaseError(oQuery.lastError().text());
+		return false;
+	}
+
+	map<qint64, shared_ptr<FaceImage> > mSamples;
+	qint64 iLast = -1;
+	shared_ptr<FaceImage> pSample;
+	while(oQuery.next())
+	{
+		qint64 iId = oQuery.value(0).toLongLong();
+		if(iId != iLast)
+		{
+			pSample.reset();
+			if(binary_search(vSorted.begin(), vSorted.end(), iId))
+			{
+				pSample = shared_ptr<FaceImage>(new FaceImage(oQuery.value(1).toString(), EmotionLabel::fromValue(oQuery.value(2).toInt())));
+				mSamples[iId] = pSample;
+			}
+			iLast = iId;
+		}
+		if(pSample && !oQuery.isNull(3))
+			pSample->addFeature(oQuery.value(3).toInt(), oQuery.value(4).toFloat(), oQuery.value(5).toFloat());
+	}
+
+	vBatch.reserve(vIds.size());
+	for(unsigned int i = 0; i < vIds.size(); i++)
+	{
+		map<qint64, shared_ptr<FaceImage> >::const_iterator it = mSamples.find(vIds[i]);
+		if(it == mSamples.end())
+		{
+			vBatch.clear();
+			sMsgError = databaseError(QString(QCoreApplication::translate("FaceDataset", "a amostra de identificador [%1] não existe")).arg(vIds[i]));
+			return false;
+		}
+		vBatch.push_back(it->second);
+	}
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::readBatch(const int iMaxSamples, FaceImageBatch &vBatch, QString &sMsgError)
+{
+	if(!read(m_iNext, iMaxSamples, vBatch, sMsgError))
+		return false;
+
+	m_iNext += (int) vBatch.size();
+	if((int) vBatch.size() < iMaxSamples)
+		m_iNext = m_iSize;
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::atEnd() const
+{
+	return m_iNext >= m_iSize;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetStore::progress() const
+{
+	return m_iSize > 0 ? qMin(m_iNext * 100 / m_iSize, 100) : 100;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::write(const FaceDatasetSnapshot &oSnapshot, QString &sMsgError, const std::function<bool (int iPercent)> &fProgress)
+{
+	int iLastPercent = -1;
+	auto fReport = [&](int iPercent) -> bool
+	{
+		if(!fProgress || iPercent == iLastPercent)
+			return true;
+		iLastPercent = iPercent;
+		if(fProgress(iPercent))
+			return true;
+
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "a gravação do arquivo [%1] foi cancelada")).arg(m_sFileName);
+		return false;
+	};
+
+	QSqlDatabase oDB = QSqlDatabase::database(m_sConnection, false);
+	if(!oDB.transaction())
+	{
+		sMsgError = databaseError(oDB.lastError().text());
+		return false;
+	}
+
+	int iOldNumFeatures = m_iNumFeatures;
+	QString sOldJournalId = m_sJournalId;
+	FaceFeatureConnections oOldConnections = m_oConnections;
+	m_iNumFeatures = oSnapshot.numFeatures();
+	m_sJournalId = oSnapshot.journalId();
+	m_oConnections = oSnapshot.connections();
+
+	QSqlQuery oQuery(oDB);
+	bool bOk = oQuery.exec("DELETE FROM landmarks") && oQuery.exec("DELETE FROM samples");
+	if(!bOk)
+		sMsgError = databaseError(oQuery.lastError().text());
+	else
+		bOk = writeProperties(sMsgError);
+
+	for(int i = 0; bOk && i < oSnapshot.size(); i++)
+		bOk = fReport(i * 100 / oSnapshot.size()) && insertSample(i, oSnapshot.getImage(i), sMsgError);
+
+	if(bOk && !oDB.commit())
+	{
+		sMsgError = databaseError(oDB.lastError().text());
+		bOk = false;
+	}
+
+	// The previous contents remain in the database if the writing failed
+	if(!bOk)
+	{
+		oDB.rollback();
+		m_iNumFeatures = iOldNumFeatures;
+		m_sJournalId = sOldJournalId;
+		m_oConnections = oOldConnections;
+		return false;
+	}
+
+	m_iSize = oSnapshot.size();
+	fReport(100);
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::apply(const FaceDatasetChanges &oChanges, QString &sMsgError)
+{
+	if(oChanges.sJournalId != m_sJournalId)
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "o conteúdo do banco de dados [%1] não corresponde às alterações a gravar")).arg(m_sFileName);
+		return false;
+	}
+
+	QSqlDatabase oDB = QSqlDatabase::database(m_sConnection, false);
+	if(!oDB.transaction())
+	{
+		sMsgError = databaseError(oDB.lastError().text());
+		return false;
+	}
+
+	int iOldSize = m_iSize;
+	int iOldNumFeatures = m_iNumFeatures;
+	FaceFeatureConnections oOldConnections = m_oConnections;
+
+	QSqlQuery oQuery(oDB);
+	auto fExec = [&](const QString &sStatement, const QVariantList &lValues) -> bool
+	{
+		oQuery.prepare(sStatement);
+		for(int i = 0; i < lValues.size(); i++)
+			oQuery.bindValue(i, lValues[i]);
+		if(oQuery.exec())
+			return true;
+
+		sMsgError = databaseError(oQuery.lastError().text());
+		return false;
+	};
+
+	/******************************************************
+	 * Structural operations, in the order they were done
+	 ******************************************************/
+	bool bOk = true;
+	for(int iOperation = 0; iOperation < oChanges.lOperations.size(); iOperation++)
+	{
+		const FaceDatasetChanges::Operation &oOperation = oChanges.lOperations[iOperation];
+		switch(oOperation.eType)
+		{
+			case FaceDatasetChanges::RemoveSample:
+			{
+				// The consecutive removals are done at once, so the positions of the remaining samples
+				// are updated only once. The index of each removal refers to the samples left by the
+				// previous ones, so it is converted to the position in the table (that is not yet updated)
+				vector<int> vRemoved;
+				for(; iOperation < oChanges.lOperations.size() && oChanges.lOperations[iOperation].eType == FaceDatasetChanges::RemoveSample; iOperation++)
+				{
+					int iIndex = oChanges.lOperations[iOperation].iIndex;
+					if(iIndex < 0 || iIndex >= m_iSize - (int) vRemoved.size())
+					{
+						sMsgError = QString(QCoreApplication::translate("FaceDataset", "o conteúdo do banco de dados [%1] não corresponde às alterações a gravar")).arg(m_sFileName);
+						bOk = false;
+						break;
+					}
+
+					int iSkipped = 0;
+					while(true)
+					{
+						int iCount = (int) (upper_bound(vRemoved.begin(), vRemoved.end(), iIndex + iSkipped) - vRemoved.begin());
+						if(iCount == iSkipped)
+							break;
+						iSkipped = iCount;
+					}
+					vRemoved.insert(upper_bound(vRemoved.begin(), vRemoved.end(), iIndex + iSkipped), iIndex + iSkipped);
+				}
+				iOperation--;
+
+				for(unsigned int i = 0; bOk && i < vRemoved.size(); i++)
+					bOk = fExec("DELETE FROM landmarks WHERE sample IN (SELECT id FROM samples WHERE position = ?)", QVariantList() << vRemoved[i]) &&
+						fExec("DELETE FROM samples WHERE position = ?", QVariantList() << vRemoved[i]);
+
+				// The samples between two removed ones are moved back by the number of samples removed
+				// before them (in increasing order, so no sample is moved twice)
+				for(unsigned int i = 0; bOk && i < vRemoved.size(); i++)
+				{
+					int iEnd = i + 1 < vRemoved.size() ? vRemoved[i + 1] : m_iSize;
+					if(iEnd > vRemoved[i] + 1)
+						bOk = fExec("UPDATE samples SET position = position - ? WHERE position > ? AND position < ?", QVariantList() << (int) (i + 1) << vRemoved[i] << iEnd);
+				}
+
+				m_iSize -= (int) vRemoved.size();
+				break;
+			}
+
+			case FaceDatasetChanges::AddFeature:
+				bOk = fExec("UPDATE landmarks SET position = position + 1 WHERE position >= ?", QVariantList() << oOperation.iIndex);
+				if(bOk && !oOperation.pPositions)
+					bOk = fExec("INSERT INTO landmarks (sample, position, id, x, y) SELECT id, ?, ?, ?, ? FROM samples", QVariantList() << oOperation.iIndex << oOperation.iID << oOperation.x << oOperation.y);
+				else if(bOk)
+				{
+					// The feature has a different position in each sample (i.e. a removed feature restored)
+					const vector<cv::Point2f> &vPositions = *oOperation.pPositions;
+					if((int) vPositions.size() != m_iSize)
+					{
+						sMsgError = QString(QCoreApplication::translate("FaceDataset", "o conteúdo do banco de dados [%1] não corresponde às alterações a gravar")).arg(m_sFileName);
+						bOk = false;
+					}
+					else
+						oQuery.prepare("INSERT INTO landmarks (sample, position, id, x, y) SELECT id, ?, ?, ?, ? FROM samples WHERE position = ?");
+					for(int i = 0; bOk && i < m_iSize; i++)
+					{
+						oQuery.bindValue(0, oOperation.iIndex);
+						oQuery.bindValue(1, oOperation.iID);
+						oQuery.bindValue(2, vPositions[i].x);
+						oQuery.bindValue(3, vPositions[i].y);
+						oQuery.bindValue(4, i);
+						bOk = oQuery.exec();
+						if(!bOk)
+							sMsgError = databaseError(oQuery.lastError().text());
+					}
+				}
+				m_oConnections.insertFeature(oOperation.iIndex);
+				m_iNumFeatures++;
+				break;
+
+			case FaceDatasetChanges::RemoveFeature:
+				bOk = fExec("DELETE FROM landmarks WHERE position = ?", QVariantList() << oOperation.iIndex) &&
+					fExec("UPDATE landmarks SET position = position - 1 WHERE position > ?", QVariantList() << oOperation.iIndex);
+				m_oConnections.removeFeatures(vector<int>(1, oOperation.iIndex));
+				m_iNumFeatures--;
+				break;
+
+			case FaceDatasetChanges::ConnectFeatures:
+				m_oConnections.connect(oOperation.iIndex, oOperation.iID);
+				break;
+
+			case FaceDatasetChanges::DisconnectFeatures:
+				m_oConnections.disconnect(oOperation.iIndex, oOperation.iID);
+				break;
+		}
+
+		if(!bOk)
+			break;
+	}
+
+	/******************************************************
+	 * Changed samples (replaced) and new ones (appended)
+	 ******************************************************/
+	for(unsigned int i = 0; bOk && i < oChanges.vSamples.size(); i++)
+	{
+		int iIndex = oChanges.vSamples[i].first;
+		if(iIndex >= 0 && iIndex < m_iSize)
+			bOk = fExec("DELETE FROM landmarks WHERE sample IN (SELECT id FROM samples WHERE position = ?)", QVariantList() << iIndex) &&
+				fExec("DELETE FROM samples WHERE position = ?", QVariantList() << iIndex) &&
+				insertSample(iIndex, oChanges.vSamples[i].second.get(), sMsgError);
+		else if(iIndex == m_iSize)
+		{
+			bOk = insertSample(iIndex, oChanges.vSamples[i].second.get(), sMsgError);
+			m_iSize++;
+		}
+	}
+
+	if(bOk)
+		bOk = writeProperties(sMsgError);
+
+	if(bOk && (m_iSize != oChanges.iSize || m_iNumFeatures != oChanges.iNumFeatures))
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "o conteúdo do banco de dados [%1] não corresponde às alterações a gravar")).arg(m_sFileName);
+		bOk = false;
+	}
+
+	if(bOk && !oDB.commit())
+	{
+		sMsgError = databaseError(oDB.lastError().text());
+		bOk = false;
+	}
+
+	// Nothing is changed in the database if any of the changes failed
+	if(!bOk)
+	{
+		oDB.rollback();
+		m_iSize = iOldSize;
+		m_iNumFeatures = iOldNumFeatures;
+		m_oConnections = oOldConnections;
+		return false;
+	}
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::unlabelledSamples(vector<int> &vIndexes, QString &sMsgError)
+{
+	vIndexes.clear();
+
+	QSqlQuery oQuery(QSqlDatabase::database(m_sConnection, false));
+	oQuery.setForwardOnly(true);
+	oQuery.prepare("SELECT position FROM samples WHERE emotion = ? ORDER BY position");
+	oQuery.bindValue(0, EmotionLabel::UNDEFINED.getValue());
+	if(!oQuery.exec())
+	{
+		sMsgError = databaseError(oQuery.lastError().text());
+		return false;
+	}
+
+	while(oQuery.next())
+		vIndexes.push_back(oQuery.value(0).toInt());
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::samplesWithFeatureOutside(const int iFeature, vector<int> &vIndexes, QString &sMsgError)
+{
+	vIndexes.clear();
+	if(iFeature < 0 || iFeature >= m_iNumFeatures)
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceDataset", "a marca facial [%1] não existe no banco de dados [%2]")).arg(iFeature).arg(m_sFileName);
+		return false;
+	}
+
+	QSqlDatabase oDB = QSqlDatabase::database(m_sConnection, false);
+	QSqlQuery oQuery(oDB);
+
+	/******************************************************
+	 * Read the sizes of the images not yet known
+	 ******************************************************/
+	if(!oQuery.exec("SELECT id, fileName FROM samples WHERE width IS NULL"))
+	{
+		sMsgError = databaseError(oQuery.lastError().text());
+		return false;
+	}
+
+	vector<qlonglong> vIds;
+	QStringList lFiles;
+	while(oQuery.next())
+	{
+		vIds.push_back(oQuery.value(0).toLongLong());
+		lFiles.append(oQuery.value(1).toString());
+	}
+
+	if(!vIds.empty())
+	{
+		// Only the image headers are read (in parallel), and unreadable images get an invalid size
+		vector<QSize> vSizes(vIds.size());
+		Parallel::forRange((int) vIds.size(), [&](int iBegin, int iEnd) {
+			for(int i = iBegin; i < iEnd; i++)
+				vSizes[i] = QImageReader(lFiles.at(i)).size();
+		});
+
+		bool bOk = oDB.transaction();
+		oQuery.prepare("UPDATE samples SET width = ?, height = ? WHERE id = ?");
+		for(unsigned int i = 0; bOk && i < vIds.size(); i++)
+		{
+			oQuery.bindValue(0, vSizes[i].isValid() ? vSizes[i].width() : -1);
+			oQuery.bindValue(1, vSizes[i].isValid() ? vSizes[i].height() : -1);
+			oQuery.bindValue(2, vIds[i]);
+			bOk = oQuery.exec();
+		}
+		if(!bOk || !oDB.commit())
+		{
+			sMsgError = databaseError(bOk ? oDB.lastError().text() : oQuery.lastError().text());
+			oDB.rollback();
+			return false;
+		}
+	}
+
+	/******************************************************
+	 * Query the landmarks (by the index of the feature)
+	 ******************************************************/
+	oQuery.setForwardOnly(true);
+	oQuery.prepare("SELECT s.position FROM landmarks l JOIN samples s ON s.id = l.sample WHERE l.position = ? AND "
+		"(l.x < 0 OR l.y < 0 OR (s.width >= 0 AND (l.x >= s.width OR l.y >= s.height))) ORDER BY s.position");
+	oQuery.bindValue(0, iFeature);
+	if(!oQuery.exec())
+	{
+		sMsgError = databaseError(oQuery.lastError().text());
+		return false;
+	}
+
+	while(oQuery.next())
+		vIndexes.push_back(oQuery.value(0).toInt());
+	return true;
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetStore::databaseError(const QString &sProblem) const
+{
+	return QString(QCoreApplication::translate("FaceDataset", "erro no banco de dados [%1]: %2")).arg(m_sFileName, sProblem);
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::insertSample(const int iIndex, const FaceImage *pImage, QString &sMsgError)
+{
+	QSqlQuery oQuery(QSqlDatabase::database(m_sConnection, false));
+	oQuery.prepare("INSERT INTO samples (position, fileName, emotion) VALUES (?, ?, ?)");
+	oQuery.bindValue(0, iIndex);
+	oQuery.bindValue(1, pImage->fileName());
+	oQuery.bindValue(2, pImage->emotionLabel().getValue());
+	if(!oQuery.exec())
+	{
+		sMsgError = databaseError(oQuery.lastError().text());
+		return false;
+	}
+	qlonglong iSample = oQuery.lastInsertId().toLongLong();
+
+	vector<FaceFeature*> vFeatures = pImage->getFeatures();
+	oQuery.prepare("INSERT INTO landmarks (sample, position, id, x, y) VALUES (?, ?, ?, ?, ?)");
+	for(unsigned int i = 0; i < vFeatures.size(); i++)
+	{
+		oQuery.bindValue(0, iSample);
+		oQuery.bindValue(1, i);
+		oQuery.bindValue(2, vFeatures[i]->getID());
+		oQuery.bindValue(3, vFeatures[i]->x);
+		oQuery.bindValue(4, vFeatures[i]->y);
+		if(!oQuery.exec())
+		{
+			sMsgError = databaseError(oQuery.lastError().text());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetStore::writeProperties(QString &sMsgError)
+{
+	QSqlQuery oQuery(QSqlDatabase::database(m_sConnection, false));
+	if(!oQuery.exec("DELETE FROM properties") || !oQuery.exec("DELETE FROM connections"))
+	{
+		sMsgError = databaseError(oQuery.lastError().text());
+		return false;
+	}
+
+	oQuery.prepare("INSERT INTO properties (name, value) VALUES (?, ?)");
+	oQuery.bindValue(0, "numberOfFeatures");
+	oQuery.bindValue(1, m_iNumFeatures);
+	bool bOk = oQuery.exec();
+	if(bOk)
+	{
+		oQuery.bindValue(0, "journalId");
+		oQuery.bindValue(1, m_sJournalId);
+		bOk = oQuery.exec();
+	}
+
+	vector<pair<int, int> > vEdges = m_oConnections.edges();
+	if(bOk)
+		oQuery.prepare("INSERT INTO connections (first, second) VALUES (?, ?)");
+	for(unsigned int i = 0; bOk && i < vEdges.size(); i++)
+	{
+		oQuery.bindValue(0, vEdges[i].first);
+		oQuery.bindValue(1, vEdges[i].second);
+		bOk = oQuery.exec();
+	}
+
+	if(!bOk)
+		sMsgError = databaseError(oQuery.lastError().text());
+	return bOk;
+}
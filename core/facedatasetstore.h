@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FACEDATASETSTORE_H
+#define FACEDATASETSTORE_H
+
+#include "core_global.h"
+#include "faceimage.h"
+#include "facefeatureconnections.h"
+#include "facedatasetsnapshot.h"
+#include "facedatasetreader.h"
+#include "facedatasetjournal.h"
+
+#include <QString>
+
+#include <vector>
+#include <functional>
+
+namespace f3
+{
+	/**
+	 * Face annotation dataset stored in a SQLite database (a file with the extension .afdb), as an
+	 * alternative to the xml file. The database has a normalized schema: a table with the samples
+	 * (file name and emotion label), a table with their landmarks (one row per face feature), a table
+	 * with the connections between the features and a table with the dataset properties.
+	 *
+	 * The complete dataset is written in a single transaction (see write()), and the changes tracked
+	 * by FaceDataset are applied as small transactions (see apply()) instead of a journal. The samples
+	 * are read in pages (see read() and readBatch()), also by their identifiers in the paging mode of
+	 * FaceDataset (see readIndex() and FaceDatasetPager), and some queries are done directly in the
+	 * database (see unlabelledSamples() and samplesWithFeatureOutside()), without loading the dataset.
+	 *
+	 * Each instance uses its own database connection, which can only be used in the thread that
+	 * opened it (a limitation of the Qt SQL module).
+	 */
+	class CORE_EXPORT FaceDatasetStore
+	{
+	public:
+		/**
+		 * Class constructor.
+		 */
+		FaceDatasetStore();
+
+		/**
+		 * Class destructor. Closes the database, if opened.
+		 */
+		virtual ~FaceDatasetStore();
+
+		/**
+		 * Indicates if the given file is a dataset stored in a SQLite database (based on its extension).
+		 * @param sFileName QString with the path and name of the file.
+		 * @return Boolean indicating if the file is a dataset store (true) or not (false).
+		 */
+		static bool isStore(const QString &sFileName);
+
+		/**
+		 * Opens the database in the given file and reads the dataset properties (number of features,
+		 * journal identifier and connections). The tables are created if they do not exist.
+		 * @param sFileName QString with the path and name of the database file.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @param bCreate Boolean indicating if the file is created if it does not exist (true) or if
+		 * it must exist (false, the default, used for reading).
+		 * @return Boolean indicating if the opening was successful (true) of failed (false).
+		 */
+		bool open(const QString &sFileName, QString &sMsgError, const bool bCreate = false);
+
+		/**
+		 * Closes the database.
+		 */
+		void close();
+
+		/**
+		 * Gets the path and name of the database file.
+		 * @return QString with the path and name of the database file.
+		 */
+		QString fileName() const;
+
+		/**
+		 * Gets the number of samples in the dataset stored.
+		 * @return Integer with the number of samples.
+		 */
+		int size() const;
+
+		/**
+		 * Gets the number of face features in the dataset stored.
+		 * @return Integer with the number of face features.
+		 */
+		int numFeatures() const;
+
+		/**
+		 * Gets the identifier of the contents stored (the same used to bind a journal to a dataset
+		 * file, see FaceDatasetJournal), checked before the changes are applied.
+		 * @return QString with the identifier of the contents.
+		 */
+		QString journalId() const;
+
+		/**
+		 * Gets the connections between the face features of the dataset stored.
+		 * @return FaceFeatureConnections with the connections.
+		 */
+		FaceFeatureConnections connections() const;
+
+		/**
+		 * Reads a page of samples from the database.
+		 * @param iFirst Integer with the index of the first sample to read.
+		 * @param iCount Integer with the maximum number of samples to read.
+		 * @param vBatch FaceImageBatch to receive the samples read, in order (it is cleared first).
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the reading was successful (true) of failed (false).
+		 */
+		bool read(const int iFirst, const int iCount, FaceImageBatch &vBatch, QString &sMsgError);
+
+		/**
+		 * Reads the index of the samples (their identifiers in the database, file names and emotion
+		 * labels, without the landmarks), in the order of the samples. The identifiers do not change
+		 * when the positions of the samples do (see apply()), so the samples can be read by them afterwards.
+		 * @param fSample Function called with the identifier, the file name and the value of the emotion
+		 * label of each sample, returning false to cancel the reading.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the reading was successful (true) of failed (false).
+		 */
+		bool readIndex(const std::function<bool (qint64 iId, const QString &sFileName, int iEmotionLabel)> &fSample, QString &sMsgError);
+
+		/**
+		 * Reads the samples with the given identifiers (see readIndex()). The identifiers are expected
+		 * to be close to each other (i.e. the samples of a page), since the whole range that contains
+		 * them is queried at once.
+		 * @param vIds Vector with the identifiers of the samples to read.
+		 * @param vBatch FaceImageBatch to receive the samples read, in the order of the identifiers.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the reading was successful (true) of failed (false, also in
+		 * case a sample does not exist anymore).
+		 */
+		bool read(const std::vector<qint64> &vIds, FaceImageBatch &vBatch, QString &sMsgError);
+
+		/**
+		 * Reads the next batch of samples, in the same way as FaceDatasetReader::readBatch().
+		 * @param iMaxSamples Integer with the maximum number of samples to read.
+		 * @param vBatch FaceImageBatch to receive the samples read (it is cleared first).
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the reading was successful (true) of failed (false).
+		 */
+		bool readBatch(const int iMaxSamples, FaceImageBatch &vBatch, QString &sMsgError);
+
+		/**
+		 * Indicates if all samples were read with readBatch().
+		 * @return Boolean indicating if there are no more samples to read.
+		 */
+		bool atEnd() const;
+
+		/**
+		 * Gets the percentage of the samples already read with readBatch().
+		 * @return Integer with the percentage read (in range [0, 100]).
+		 */
+		int progress() const;
+
+		/**
+		 * Replaces all contents of the database with the given snapshot, in a single transaction
+		 * (so the previous contents remain if the writing fails or is cancelled).
+		 * @param oSnapshot FaceDatasetSnapshot with the contents to write.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @param fProgress Function called with the percentage of the writing concluded (in range [0, 100]),
+		 * returning false to cancel the writing. The default is no function.
+		 * @return Boolean indicating if the writing was successful (true) of failed (false).
+		 */
+		bool write(const FaceDatasetSnapshot &oSnapshot, QString &sMsgError, const std::function<bool (int iPercent)> &fProgress = std::function<bool (int)>());
+
+		/**
+		 * Applies the changes done in a dataset (see FaceDataset::prepareIncrementalSave()) to the
+		 * database, in a single transaction. Only the samples changed are rewritten.
+		 * @param oChanges FaceDatasetChanges with the changes to apply. Their journal identifier must
+		 * match the one of the contents stored.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the changes were applied (true) or not (false).
+		 */
+		bool apply(const FaceDatasetChanges &oChanges, QString &sMsgError);
+
+		/**
+		 * Queries the samples without an emotion label (see EmotionLabel::UNDEFINED).
+		 * @param vIndexes Vector to receive the indexes of the samples, in ascending order.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the query was successful (true) of failed (false).
+		 */
+		bool unlabelledSamples(std::vector<int> &vIndexes, QString &sMsgError);
+
+		/**
+		 * Queries the samples where the given face feature lies outside the image area. The sizes of
+		 * the images are read from their files (only the headers) the first time they are needed, and
+		 * then kept in the database. Images that can not be read are only checked for negative coordinates.
+		 * @param iFeature Integer with the index of the face feature.
+		 * @param vIndexes Vector to receive the indexes of the samples, in ascending order.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the query was successful (true) of failed (false).
+		 */
+		bool samplesWithFeatureOutside(const int iFeature, std::vector<int> &vIndexes, QString &sMsgError);
+
+	protected:
+
+		/**
+		 * Formats an error message for a failure in the database.
+		 * @param sProblem QString with the description of the problem (i.e. the error of the query).
+		 * @return QString with the error message.
+		 */
+		QString databaseError(const QString &sProblem) const;
+
+		/**
+		 * Writes a sample and its landmarks at the given position, with the database already in a transaction.
+		 * @param iIndex Integer with the position of the sample.
+		 * @param pImage Pointer to the FaceImage with the sample contents.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the writing was successful (true) of failed (false).
+		 */
+		bool insertSample(const int iIndex, const FaceImage *pImage, QString &sMsgError);
+
+		/**
+		 * Writes the dataset properties and the connections, with the database already in a transaction.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the writing was successful (true) of failed (false).
+		 */
+		bool writeProperties(QString &sMsgError);
+
+	private:
+
+		/** Path and name of the database file. */
+		QString m_sFileName;
+
+		/** Name of the database connection used by the instance (empty if it is not opened). */
+		QString m_sConnection;
+
+		/** Number of samples in the dataset stored. */
+		int m_iSize;
+
+		/** Number of face features in the dataset stored. */
+		int m_iNumFeatures;
+
+		/** Identifier of the contents stored. */
+		QString m_sJournalId;
+
+		/** Connections between the face features. */
+		FaceFeatureConnections m_oConnections;
+
+		/** Index of the next sample to be read by readBatch(). */
+		int m_iNext;
+	};
+}
+
+#endif // FACEDATASETSTORE_H
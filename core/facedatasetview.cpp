@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "facedatasetview.h"
+#include "parallel.h"
+
+#include <QVector>
+
+using namespace std;
+
+// +-----------------------------------------------------------
+f3::FaceDatasetView::FaceDatasetView(FaceDataset *pParent, const vector<int> &vIndexes)
+{
+	m_pParent = pParent;
+	m_vIndexes.reserve(vIndexes.size());
+	for(unsigned int i = 0; i < vIndexes.size(); i++)
+		if(vIndexes[i] >= 0 && vIndexes[i] < pParent->size())
+			m_vIndexes.push_back(vIndexes[i]);
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetView::FaceDatasetView(FaceDataset *pParent, const Predicate &fPredicate)
+{
+	m_pParent = pParent;
+
+	// The predicate is evaluated in parallel, and the images accepted are then collected in order
+	QVector<bool> vAccepted(pParent->size());
+	pParent->parallelForEach([&vAccepted, &fPredicate](int iIndex, const FaceImage *pImage) {
+		vAccepted[iIndex] = fPredicate(iIndex, pImage);
+	});
+
+	for(int i = 0; i < vAccepted.size(); i++)
+		if(vAccepted[i])
+			m_vIndexes.push_back(i);
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetView f3::FaceDatasetView::range(FaceDataset *pParent, const int iBegin, const int iEnd)
+{
+	vector<int> vIndexes;
+	for(int i = qMax(iBegin, 0); i < iEnd && i < pParent->size(); i++)
+		vIndexes.push_back(i);
+	return FaceDatasetView(pParent, vIndexes);
+}
+
+// +-----------------------------------------------------------
+f3::FaceDataset* f3::FaceDatasetView::parent() const
+{
+	return m_pParent;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetView::parentIndex(const int iIndex) const
+{
+	if(iIndex < 0 || iIndex >= size())
+		return -1;
+
+	return m_vIndexes[iIndex];
+}
+
+// +-----------------------------------------------------------
+const vector<int>& f3::FaceDatasetView::indexes() const
+{
+	return m_vIndexes;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetView::size() const
+{
+	return m_vIndexes.size();
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetView::numFeatures() const
+{
+	return m_pParent->numFeatures();
+}
+
+// +-----------------------------------------------------------
+const f3::FaceFeatureConnections& f3::FaceDatasetView::connections() const
+{
+	return m_pParent->connections();
+}
+
+// +-----------------------------------------------------------
+const f3::FaceImage* f3::FaceDatasetView::getImage(const int iIndex) const
+{
+	return m_pParent->getImage(parentIndex(iIndex));
+}
+
+// +-----------------------------------------------------------
+f3::FaceImage* f3::FaceDatasetView::editImage(const int iIndex)
+{
+	return m_pParent->editImage(parentIndex(iIndex));
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetSnapshot f3::FaceDatasetView::snapshot() const
+{
+	return m_pParent->snapshot(m_vIndexes);
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FACEDATASETVIEW_H
+#define FACEDATASETVIEW_H
+
+#include "core_global.h"
+#include "abstractfacedataset.h"
+#include "facedataset.h"
+
+#include <vector>
+#include <functional>
+
+namespace f3
+{
+	/**
+	 * Lightweight view over a subset of the face images of a FaceDataset (i.e. only the images
+	 * with a given emotion label, or a validation split), defined by a list of indexes in the
+	 * parent dataset. The view does not copy the face images: reading them reads the parent, and
+	 * editing them through the view edits the parent (so the changes are tracked and saved with it).
+	 * Saving the view writes a new dataset file with only its face images.
+	 *
+	 * The view refers to the indexes of the images in the parent, so it must be rebuilt if images
+	 * are inserted in or removed from the parent.
+	 */
+	class CORE_EXPORT FaceDatasetView : public AbstractFaceDataset
+	{
+	public:
+		/**
+		 * Type of the function used to select the face images of a view. It receives the index of the
+		 * image in the parent dataset and a pointer to the FaceImage, and returns true to include it.
+		 */
+		typedef std::function<bool (int iIndex, const FaceImage *pImage)> Predicate;
+
+		/**
+		 * Class constructor. Creates a view with the given face images of the parent dataset.
+		 * @param pParent Instance of the FaceDataset the view refers to. It must outlive the view.
+		 * @param vIndexes Vector with the indexes of the face images in the parent dataset, in the
+		 * order they appear in the view. The invalid indexes are ignored.
+		 */
+		FaceDatasetView(FaceDataset *pParent, const std::vector<int> &vIndexes);
+
+		/**
+		 * Class constructor. Creates a view with the face images of the parent dataset accepted by the
+		 * given function, in the order of the parent. The function is evaluated in parallel (see the
+		 * class Parallel), so it must be thread safe.
+		 * @param pParent Instance of the FaceDataset the view refers to. It must outlive the view.
+		 * @param fPredicate Predicate function that selects the face images to include.
+		 */
+		FaceDatasetView(FaceDataset *pParent, const Predicate &fPredicate);
+
+		/**
+		 * Creates a view with a contiguous range of face images of the parent dataset (i.e. to split it).
+		 * @param pParent Instance of the FaceDataset the view refers to. It must outlive the view.
+		 * @param iBegin Integer with the index of the first face image in the parent dataset.
+		 * @param iEnd Integer with the index right after the last face image in the parent dataset.
+		 * @return FaceDatasetView with the face images in the range [iBegin, iEnd).
+		 */
+		static FaceDatasetView range(FaceDataset *pParent, const int iBegin, const int iEnd);
+
+		/**
+		 * Gets the parent dataset of the view.
+		 * @return Instance of the FaceDataset the view refers to.
+		 */
+		FaceDataset* parent() const;
+
+		/**
+		 * Gets the index in the parent dataset of a face image of the view.
+		 * @param iIndex Integer with the index of the image in the view.
+		 * @return Integer with the index of the image in the parent dataset, or -1 if the index is invalid.
+		 */
+		int parentIndex(const int iIndex) const;
+
+		/**
+		 * Gets the indexes in the parent dataset of all face images of the view.
+		 * @return Const reference to the vector with the indexes, in the order of the view.
+		 */
+		const std::vector<int>& indexes() const;
+
+		/**
+		 * Returns the number of face samples in the view.
+		 * @return Integer with the number of face samples.
+		 */
+		virtual int size() const;
+
+		/**
+		 * Queries the number of facial features in the parent dataset.
+		 * @return Integer with the number of face features.
+		 */
+		virtual int numFeatures() const;
+
+		/**
+		 * Gets the connections between the face features of the parent dataset.
+		 * @return Const reference to the FaceFeatureConnections with the connections.
+		 */
+		virtual const FaceFeatureConnections& connections() const;
+
+		/**
+		 * Gets the face image for the given index of the view, for read-only access.
+		 * @param iIndex Integer with the index of the image in the view.
+		 * @return Pointer to a const FaceImage with the face image data, or NULL if the index is invalid.
+		 */
+		virtual const FaceImage* getImage(const int iIndex) const;
+
+		/**
+		 * Gets the face image for the given index of the view, in order to change it. The image is
+		 * edited in the parent dataset (see FaceDataset::editImage()).
+		 * @param iIndex Integer with the index of the image in the view.
+		 * @return Pointer to a FaceImage with the face image data, or NULL if the index is invalid.
+		 */
+		virtual FaceImage* editImage(const int iIndex);
+
+		/**
+		 * Takes a snapshot of the face images of the view (see FaceDataset::snapshot()).
+		 * @return FaceDatasetSnapshot with the face images of the view.
+		 */
+		virtual FaceDatasetSnapshot snapshot() const;
+
+	private:
+
+		/** Parent dataset of the view. */
+		FaceDataset *m_pParent;
+
+		/** Indexes of the face images of the view in the parent dataset. */
+		std::vector<int> m_vIndexes;
+	};
+}
+
+#endif // FACEDATASETVIEW_H
@@ -19,7 +19,7 @@
 
 #include "facefeature.h"
 
-#include <QApplication>
+#include <QCoreApplication>
 
 // +-----------------------------------------------------------
 f3::FaceFeature::FaceFeature():
@@ -53,28 +53,28 @@ bool f3::FaceFeature::loadFromXML(const QDomElement &oElement, QString &sMsgErro
 // Check the element name
 	if(oElement.tagName() != "Feature")
 	{
-		sMsgError = QString(QApplication::translate("FaceFeature", "nome de n invlido [%1] - era esperado o nome de n '%2'").arg(oElement.tagName(), "Feature"));
+		sMsgError = QString(QCoreApplication::translate("FaceFeature", "nome de n invlido [%1] - era esperado o nome de n '%2'").arg(oElement.tagName(), "Feature"));
 		return false;
 	}
 
 	QString sID = oElement.attribute("id");
 	if(sID == "")
 	{
-		sMsgError = QString(QApplication::translate("FaceFeature", "o atributo '%1' no existe ou tem valor invlido").arg("id"));
+		sMsgError = QString(QCoreApplication::translate("FaceFeature", "o atributo '%1' no existe ou tem valor invlido").arg("id"));
 		return false;
 	}
 
 	QString sValueX = oElement.attribute("x");
 	if(sValueX == "")
 	{
-		sMsgError = QString(QApplication::translate("FaceFeature", "o atributo '%1' no existe ou tem valor invlido").arg("x"));
+		sMsgError = QString(QCoreApplication::translate("FaceFeature", "o atributo '%1' no existe ou tem valor invlido").arg("x"));
 		return false;
 	}
 
 	QString sValueY = oElement.attribute("y");
 	if(sValueY == "")
 	{
-		sMsgError = QString(QApplication::translate("FaceFeature", "o atributo '%1' no existe ou tem valor invlido").arg("y"));
+		sMsgError = QString(QCoreApplication::translate("FaceFeature", "o atributo '%1' no existe ou tem valor invlido").arg("y"));
 		return false;
 	}
 
@@ -85,6 +85,36 @@ bool f3::FaceFeature::loadFromXML(const QDomElement &oElement, QString &sMsgErro
 	return true;
 }
 
+// +-----------------------------------------------------------
+bool f3::FaceFeature::loadFromStream(QXmlStreamReader &oReader, QString &sMsgError)
+{
+	// Check the element name
+	if(oReader.name() != "Feature")
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceFeature", "nome de n invlido [%1] - era esperado o nome de n '%2'").arg(oReader.name().toString(), "Feature"));
+		return false;
+	}
+
+	QXmlStreamAttributes oAttrs = oReader.attributes();
+	const char *aNames[] = { "id", "x", "y" };
+	for(int i = 0; i < 3; i++)
+	{
+		if(oAttrs.value(aNames[i]).isEmpty())
+		{
+			sMsgError = QString(QCoreApplication::translate("FaceFeature", "o atributo '%1' no existe ou tem valor invlido").arg(aNames[i]));
+			return false;
+		}
+	}
+
+	m_iID = oAttrs.value("id").toString().toInt();
+	x = oAttrs.value("x").toString().toFloat();
+	y = oAttrs.value("y").toString().toFloat();
+
+	// Move to the end of the element
+	oReader.skipCurrentElement();
+	return true;
+}
+
 // +-----------------------------------------------------------
 void f3::FaceFeature::saveToXML(QDomElement &oParent) const
 {
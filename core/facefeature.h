@@ -23,6 +23,7 @@
 #include "core_global.h"
 
 #include <QDomDocument>
+#include <QXmlStreamReader>
 
 #include <opencv2/core/core.hpp>
 
@@ -68,6 +69,15 @@ namespace f3
 		 */
 		bool loadFromXML(const QDomElement &oElement, QString &sMsgError);
 
+		/**
+		 * Loads (unserializes) the face feature data from the given xml stream. The stream must be
+		 * positioned at the start element of the feature node, and it is left at its end element.
+		 * @param oReader QXmlStreamReader from where to read the feature data.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the loading was successful (true) or if it failed (false).
+		 */
+		bool loadFromStream(QXmlStreamReader &oReader, QString &sMsgError);
+
         /**
          * Saves the face feature data into the given xml element.
 		 * @param oParent QDomElement to receive the node of the face feature data.
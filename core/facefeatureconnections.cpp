@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "facefeatureconnections.h"
+
+#include <QCoreApplication>
+
+#include <algorithm>
+
+using namespace std;
+
+// +-----------------------------------------------------------
+f3::FaceFeatureConnections::FaceFeatureConnections()
+{
+	m_bIndexValid = false;
+}
+
+// +-----------------------------------------------------------
+quint64 f3::FaceFeatureConnections::key(const int iFirst, const int iSecond)
+{
+	return ((quint64) (quint32) qMin(iFirst, iSecond) << 32) | (quint32) qMax(iFirst, iSecond);
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceFeatureConnections::connect(const int iFirst, const int iSecond)
+{
+	if(iFirst < 0 || iSecond < 0 || iFirst == iSecond)
+		return false;
+
+	quint64 iKey = key(iFirst, iSecond);
+	if(m_setEdges.contains(iKey))
+		return false;
+
+	m_setEdges.insert(iKey);
+	m_bIndexValid = false;
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceFeatureConnections::disconnect(const int iFirst, const int iSecond)
+{
+	if(!m_setEdges.remove(key(iFirst, iSecond)))
+		return false;
+
+	m_bIndexValid = false;
+	return true;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceFeatureConnections::isConnected(const int iFirst, const int iSecond) const
+{
+	return m_setEdges.contains(key(iFirst, iSecond));
+}
+
+// +-----------------------------------------------------------
+int f3::FaceFeatureConnections::size() const
+{
+	return m_setEdges.size();
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceFeatureConnections::isEmpty() const
+{
+	return m_setEdges.isEmpty();
+}
+
+// +-----------------------------------------------------------
+void f3::FaceFeatureConnections::clear()
+{
+	m_setEdges.clear();
+	m_bIndexValid = false;
+}
+
+// +-----------------------------------------------------------
+vector<pair<int, int> > f3::FaceFeatureConnections::edges() const
+{
+	vector<quint64> vKeys(m_setEdges.begin(), m_setEdges.end());
+	sort(vKeys.begin(), vKeys.end());
+
+	vector<pair<int, int> > vRet;
+	vRet.reserve(vKeys.size());
+	for(unsigned int i = 0; i < vKeys.size(); i++)
+		vRet.push_back(make_pair((int) (vKeys[i] >> 32), (int) (vKeys[i] & 0xFFFFFFFF)));
+	return vRet;
+}
+
+// +-----------------------------------------------------------
+vector<int> f3::FaceFeatureConnections::neighbours(const int iFeature) const
+{
+	if(!m_bIndexValid)
+		buildIndex();
+
+	if(iFeature < 0 || iFeature + 1 >= (int) m_vOffsets.size())
+		return vector<int>();
+	return vector<int>(m_vNeighbours.begin() + m_vOffsets[iFeature], m_vNeighbours.begin() + m_vOffsets[iFeature + 1]);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceFeatureConnections::buildIndex() const
+{
+	vector<pair<int, int> > vEdges = edges();
+	int iNumFeatures = 0;
+	for(unsigned int i = 0; i < vEdges.size(); i++)
+		iNumFeatures = qMax(iNumFeatures, vEdges[i].second + 1);
+
+	// Count the neighbours of each feature, and then place them in their slots
+	m_vOffsets.assign(iNumFeatures + 1, 0);
+	for(unsigned int i = 0; i < vEdges.size(); i++)
+	{
+		m_vOffsets[vEdges[i].first + 1]++;
+		m_vOffsets[vEdges[i].second + 1]++;
+	}
+	for(int i = 0; i < iNumFeatures; i++)
+		m_vOffsets[i + 1] += m_vOffsets[i];
+
+	m_vNeighbours.resize(vEdges.size() * 2);
+	vector<int> vNext(m_vOffsets.begin(), m_vOffsets.end() - 1);
+	for(unsigned int i = 0; i < vEdges.size(); i++)
+	{
+		m_vNeighbours[vNext[vEdges[i].first]++] = vEdges[i].second;
+		m_vNeighbours[vNext[vEdges[i].second]++] = vEdges[i].first;
+	}
+	for(int i = 0; i < iNumFeatures; i++)
+		sort(m_vNeighbours.begin() + m_vOffsets[i], m_vNeighbours.begin() + m_vOffsets[i + 1]);
+
+	m_bIndexValid = true;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceFeatureConnections::insertFeature(const int iIndex)
+{
+	if(m_setEdges.isEmpty())
+		return;
+
+	QSet<quint64> setEdges;
+	setEdges.reserve(m_setEdges.size());
+	foreach(quint64 iKey, m_setEdges)
+	{
+		int iFirst = (int) (iKey >> 32);
+		int iSecond = (int) (iKey & 0xFFFFFFFF);
+		setEdges.insert(key(iFirst >= iIndex ? iFirst + 1 : iFirst, iSecond >= iIndex ? iSecond + 1 : iSecond));
+	}
+	m_setEdges.swap(setEdges);
+	m_bIndexValid = false;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceFeatureConnections::removeFeatures(const vector<int> &vIndexes)
+{
+	if(m_setEdges.isEmpty() || vIndexes.empty())
+		return;
+
+	// The new index of a feature is its old index minus the number of features removed before it
+	QSet<quint64> setEdges;
+	setEdges.reserve(m_setEdges.size());
+	foreach(quint64 iKey, m_setEdges)
+	{
+		int iFirst = (int) (iKey >> 32);
+		int iSecond = (int) (iKey & 0xFFFFFFFF);
+		vector<int>::const_iterator itFirst = lower_bound(vIndexes.begin(), vIndexes.end(), iFirst);
+		vector<int>::const_iterator itSecond = lower_bound(vIndexes.begin(), vIndexes.end(), iSecond);
+		if((itFirst != vIndexes.end() && *itFirst == iFirst) || (itSecond != vIndexes.end() && *itSecond == iSecond))
+			continue;
+
+		setEdges.insert(key(iFirst - (int) (itFirst - vIndexes.begin()), iSecond - (int) (itSecond - vIndexes.begin())));
+	}
+	m_setEdges.swap(setEdges);
+	m_bIndexValid = false;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceFeatureConnections::loadFromStream(QXmlStreamReader &oReader, QString &sMsgError, const int iNumFeatures)
+{
+	// Check the element name
+	if(oReader.name() != "Connections")
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceFeatureConnections", "nome de nó inválido [%1] - era esperado o nome de nó '%2'").arg(oReader.name().toString(), "Connections"));
+		return false;
+	}
+
+	QSet<quint64> setEdges;
+	while(oReader.readNextStartElement())
+	{
+		if(oReader.name() != "Connection")
+		{
+			oReader.skipCurrentElement();
+			continue;
+		}
+
+		bool bOkSource, bOkTarget;
+		int iSource = oReader.attributes().value("source").toString().toInt(&bOkSource);
+		int iTarget = oReader.attributes().value("target").toString().toInt(&bOkTarget);
+		if(!bOkSource || !bOkTarget || iSource < 0 || iSource >= iNumFeatures || iTarget < 0 || iTarget >= iNumFeatures || iSource == iTarget)
+		{
+			sMsgError = QString(QCoreApplication::translate("FaceFeatureConnections", "o nó '%1' contém uma conexão inválida entre [%2] e [%3]").arg("Connections", oReader.attributes().value("source").toString(), oReader.attributes().value("target").toString()));
+			return false;
+		}
+		setEdges.insert(key(iSource, iTarget));
+		oReader.skipCurrentElement();
+	}
+
+	m_setEdges.swap(setEdges);
+	m_bIndexValid = false;
+	return true;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceFeatureConnections::saveToXML(QDomElement &oParent) const
+{
+	// Add the "Connections" node
+	QDomElement oConnections = oParent.ownerDocument().createElement("Connections");
+	oParent.appendChild(oConnections);
+
+	// Add the nodes for the connections (sorted, so the file does not change if the connections do not)
+	vector<pair<int, int> > vEdges = edges();
+	for(unsigned int i = 0; i < vEdges.size(); i++)
+	{
+		QDomElement oConnection = oParent.ownerDocument().createElement("Connection");
+		oConnection.setAttribute("source", vEdges[i].first);
+		oConnection.setAttribute("target", vEdges[i].second);
+		oConnections.appendChild(oConnection);
+	}
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FACEFEATURECONNECTIONS_H
+#define FACEFEATURECONNECTIONS_H
+
+#include "core_global.h"
+
+#include <QSet>
+#include <QString>
+#include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QMetaType>
+
+#include <vector>
+#include <utility>
+
+namespace f3
+{
+	/**
+	 * Undirected graph of the connections between the face features of a dataset (the same for
+	 * all face images). The connections are kept in a hashed set of edges, so connecting, disconnecting
+	 * and querying a connection take constant time. The neighbours of each feature are obtained from a
+	 * compact adjacency index (CSR, compressed sparse row), which is built from the edges only when
+	 * first queried after a change.
+	 */
+	class CORE_EXPORT FaceFeatureConnections
+	{
+	public:
+		/**
+		 * Class constructor. Creates a graph without connections.
+		 */
+		FaceFeatureConnections();
+
+		/**
+		 * Builds the key of the edge connecting two features, independent of their order.
+		 * @param iFirst Integer with the index of one of the features.
+		 * @param iSecond Integer with the index of the other feature.
+		 * @return Unsigned 64 bits integer with the key of the edge (the smallest index in the high
+		 * 32 bits and the largest index in the low 32 bits).
+		 */
+		static quint64 key(const int iFirst, const int iSecond);
+
+		/**
+		 * Connects two features.
+		 * @param iFirst Integer with the index of one of the features.
+		 * @param iSecond Integer with the index of the other feature.
+		 * @return Boolean indicating if the connection was added (true) or not (false, if the
+		 * features were already connected or the indexes are invalid).
+		 */
+		bool connect(const int iFirst, const int iSecond);
+
+		/**
+		 * Disconnects two features.
+		 * @param iFirst Integer with the index of one of the features.
+		 * @param iSecond Integer with the index of the other feature.
+		 * @return Boolean indicating if the connection was removed (true) or not (false, if the
+		 * features were not connected).
+		 */
+		bool disconnect(const int iFirst, const int iSecond);
+
+		/**
+		 * Indicates if two features are connected.
+		 * @param iFirst Integer with the index of one of the features.
+		 * @param iSecond Integer with the index of the other feature.
+		 * @return Boolean indicating if the features are connected (true) or not (false).
+		 */
+		bool isConnected(const int iFirst, const int iSecond) const;
+
+		/**
+		 * Queries the number of connections.
+		 * @return Integer with the number of connections.
+		 */
+		int size() const;
+
+		/**
+		 * Indicates if there are no connections.
+		 * @return Boolean indicating if there are no connections (true) or not (false).
+		 */
+		bool isEmpty() const;
+
+		/**
+		 * Removes all connections.
+		 */
+		void clear();
+
+		/**
+		 * Gets all the connections, as pairs of feature indexes (the smallest index first), sorted.
+		 * @return Vector with the pairs of indexes of the connected features.
+		 */
+		std::vector<std::pair<int, int> > edges() const;
+
+		/**
+		 * Gets the features connected to the given feature. The query uses the adjacency index, which
+		 * is rebuilt if the connections changed since it was last used (hence this method must not be
+		 * called concurrently on the same instance).
+		 * @param iFeature Integer with the index of the feature.
+		 * @return Vector with the indexes of the connected features, in ascending order.
+		 */
+		std::vector<int> neighbours(const int iFeature) const;
+
+		/**
+		 * Updates the connections due to the insertion of a feature at the given index (the indexes
+		 * of the features from it onwards are incremented). The new feature has no connections.
+		 * @param iIndex Integer with the index of the feature inserted.
+		 */
+		void insertFeature(const int iIndex);
+
+		/**
+		 * Updates the connections due to the removal of features (the connections of the removed
+		 * features are removed, and the indexes of the remaining features are adjusted).
+		 * @param vIndexes Vector with the indexes of the features removed, sorted in ascending order
+		 * and without repeated values.
+		 */
+		void removeFeatures(const std::vector<int> &vIndexes);
+
+		/**
+		 * Loads (unserializes) the connections from the given xml stream. The stream must be
+		 * positioned at the start element of the connections node, and it is left at its end element.
+		 * @param oReader QXmlStreamReader from where to read the connections.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @param iNumFeatures Integer with the number of features in the dataset.
+		 * @return Boolean indicating if the loading was successful (true) or if it failed (false).
+		 */
+		bool loadFromStream(QXmlStreamReader &oReader, QString &sMsgError, const int iNumFeatures);
+
+		/**
+		 * Saves the connections into the given xml element.
+		 * @param oParent Parent QDomElement to receive the new node of the connections.
+		 */
+		void saveToXML(QDomElement &oParent) const;
+
+	protected:
+
+		/**
+		 * Rebuilds the adjacency index from the set of edges.
+		 */
+		void buildIndex() const;
+
+	private:
+
+		/** Set with the keys of the edges (see key()). */
+		QSet<quint64> m_setEdges;
+
+		/** Offsets of the neighbours of each feature in m_vNeighbours (one more than the number of features). */
+		mutable std::vector<int> m_vOffsets;
+
+		/** Indexes of the neighbours of all features, grouped by feature. */
+		mutable std::vector<int> m_vNeighbours;
+
+		/** Indication that the adjacency index is up to date with the set of edges. */
+		mutable bool m_bIndexValid;
+	};
+}
+
+Q_DECLARE_METATYPE(f3::FaceFeatureConnections)
+
+#endif // FACEFEATURECONNECTIONS_H
@@ -19,8 +19,9 @@
 
 #include "faceimage.h"
 
-#include <QApplication>
-#include <opencv2/highgui/highgui.hpp>
+#include <QCoreApplication>
+#include <QImage>
+#include <QPixmap>
 
 using namespace std;
 using namespace cv;
@@ -32,6 +33,27 @@ f3::FaceImage::FaceImage(const QString &sFileName, const EmotionLabel eEmotionLa
 	m_eEmotionLabel = eEmotionLabel;
 }
 
+// +-----------------------------------------------------------
+f3::FaceImage::FaceImage(const FaceImage &oOther)
+{
+	*this = oOther;
+}
+
+// +-----------------------------------------------------------
+f3::FaceImage& f3::FaceImage::operator=(const FaceImage &oOther)
+{
+	if(this == &oOther)
+		return *this;
+
+	clear();
+	m_sFileName = oOther.m_sFileName;
+	m_eEmotionLabel = oOther.m_eEmotionLabel;
+	m_vFeatures.reserve(oOther.m_vFeatures.size());
+	foreach(FaceFeature *pFeat, oOther.m_vFeatures)
+		m_vFeatures.push_back(new FaceFeature(pFeat->getID(), pFeat->x, pFeat->y));
+	return *this;
+}
+
 // +-----------------------------------------------------------
 f3::FaceImage::~FaceImage()
 {
@@ -70,7 +92,7 @@ bool f3::FaceImage::loadFromXML(const QDomElement &oElement, QString &sMsgError,
 	// Check the element name
 	if(oElement.tagName() != "Sample")
 	{
-		sMsgError = QString(QApplication::translate("FaceImage", "nome de nó inválido [%1] - era esperado o nome de nó '%2'").arg(oElement.tagName(), "Sample"));
+		sMsgError = QString(QCoreApplication::translate("FaceImage", "nome de nó inválido [%1] - era esperado o nome de nó '%2'").arg(oElement.tagName(), "Sample"));
 		return false;
 	}
 
@@ -78,7 +100,7 @@ bool f3::FaceImage::loadFromXML(const QDomElement &oElement, QString &sMsgError,
 	QString sFile = oElement.attribute("fileName");
 	if(sFile == "")
 	{
-		sMsgError = QString(QApplication::translate("FaceImage", "o atributo '%1' não existe ou tem valor inválido").arg("fileName"));
+		sMsgError = QString(QCoreApplication::translate("FaceImage", "o atributo '%1' não existe ou tem valor inválido").arg("fileName"));
 		return false;
 	}
 
@@ -86,7 +108,7 @@ bool f3::FaceImage::loadFromXML(const QDomElement &oElement, QString &sMsgError,
 	int iEmotion = oElement.attribute("emotionLabel", "-1").toInt();
 	if(iEmotion < EmotionLabel::UNDEFINED.getValue() || iEmotion > EmotionLabel::SURPRISE.getValue())
 	{
-		sMsgError = QString(QApplication::translate("FaceImage", "o atributo '%1' não existe ou tem valor inválido").arg("emotionLabel"));
+		sMsgError = QString(QCoreApplication::translate("FaceImage", "o atributo '%1' não existe ou tem valor inválido").arg("emotionLabel"));
 		return false;
 	}
 
@@ -95,7 +117,7 @@ bool f3::FaceImage::loadFromXML(const QDomElement &oElement, QString &sMsgError,
 	QDomElement oFeatures = oElement.firstChildElement("Features");
 	if(oFeatures.isNull() || oFeatures.childNodes().count() != iNumExpectedFeatures)
 	{
-		sMsgError = QString(QApplication::translate("FaceImage", "o nó '%1' não existe ou não tem o número esperado de nós filhos").arg("Features"));
+		sMsgError = QString(QCoreApplication::translate("FaceImage", "o nó '%1' não existe ou não tem o número esperado de nós filhos").arg("Features"));
 		return false;
 	}
 
@@ -121,6 +143,77 @@ bool f3::FaceImage::loadFromXML(const QDomElement &oElement, QString &sMsgError,
 	return true;
 }
 
+// +-----------------------------------------------------------
+bool f3::FaceImage::loadFromStream(QXmlStreamReader &oReader, QString &sMsgError, int iNumExpectedFeatures)
+{
+	// Check the element name
+	if(oReader.name() != "Sample")
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceImage", "nome de nó inválido [%1] - era esperado o nome de nó '%2'").arg(oReader.name().toString(), "Sample"));
+		return false;
+	}
+
+	// Read the file name
+	QString sFile = oReader.attributes().value("fileName").toString();
+	if(sFile == "")
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceImage", "o atributo '%1' não existe ou tem valor inválido").arg("fileName"));
+		return false;
+	}
+
+	// Read the emotion label
+	bool bOk;
+	int iEmotion = oReader.attributes().value("emotionLabel").toString().toInt(&bOk);
+	if(!bOk || iEmotion < EmotionLabel::UNDEFINED.getValue() || iEmotion > EmotionLabel::SURPRISE.getValue())
+	{
+		sMsgError = QString(QCoreApplication::translate("FaceImage", "o atributo '%1' não existe ou tem valor inválido").arg("emotionLabel"));
+		return false;
+	}
+
+	// Read the face features
+	bool bFeaturesFound = false;
+	vector<FaceFeature*> vFeatures;
+	vFeatures.reserve(iNumExpectedFeatures);
+	while(oReader.readNextStartElement())
+	{
+		if(oReader.name() != "Features" || bFeaturesFound)
+		{
+			oReader.skipCurrentElement();
+			continue;
+		}
+
+		bFeaturesFound = true;
+		while(oReader.readNextStartElement())
+		{
+			FaceFeature *pFeature = new FaceFeature();
+			if(!pFeature->loadFromStream(oReader, sMsgError))
+			{
+				foreach(FaceFeature *pFeat, vFeatures)
+					delete(pFeat);
+				delete pFeature;
+
+				return false;
+			}
+			vFeatures.push_back(pFeature);
+		}
+	}
+
+	if(!bFeaturesFound || (int) vFeatures.size() != iNumExpectedFeatures)
+	{
+		foreach(FaceFeature *pFeat, vFeatures)
+			delete(pFeat);
+
+		sMsgError = QString(QCoreApplication::translate("FaceImage", "o nó '%1' não existe ou não tem o número esperado de nós filhos").arg("Features"));
+		return false;
+	}
+
+	clear();
+	m_sFileName = sFile;
+	m_eEmotionLabel = EmotionLabel::fromValue(iEmotion);
+	m_vFeatures = vFeatures;
+	return true;
+}
+
 // +-----------------------------------------------------------
 void f3::FaceImage::saveToXML(QDomElement &oParent) const
 {
@@ -152,8 +245,16 @@ QPixmap f3::FaceImage::pixMap() const
 // +-----------------------------------------------------------
 Mat f3::FaceImage::mat() const
 {
-	Mat oRet = imread(m_sFileName.toStdString());
-	return oRet;
+	// The file is decoded with the Qt image readers instead of OpenCV's imread, so the applications
+	// do not need to load the highgui module (and all of its media dependencies) during startup
+	QImage oImage;
+	if(!oImage.load(m_sFileName))
+		return Mat();
+
+	// Mimic the output of imread: 8-bit, 3 channels in the BGR order
+	oImage = oImage.convertToFormat(QImage::Format_RGB888).rgbSwapped();
+	Mat oRet(oImage.height(), oImage.width(), CV_8UC3, (void*) oImage.constBits(), oImage.bytesPerLine());
+	return oRet.clone();
 }
 
 // +-----------------------------------------------------------
@@ -164,6 +265,19 @@ f3::FaceFeature* f3::FaceImage::addFeature(int iID, float x, float y)
 	return pFeat;
 }
 
+// +-----------------------------------------------------------
+f3::FaceFeature* f3::FaceImage::insertFeature(const int iIndex, int iID, float x, float y)
+{
+	if(iIndex < 0 || iIndex >= (int) m_vFeatures.size())
+		return addFeature(iID, x, y);
+
+	FaceFeature *pFeat = new FaceFeature(iID, x, y);
+	m_vFeatures.insert(m_vFeatures.begin() + iIndex, pFeat);
+	for(unsigned int i = iIndex + 1; i < m_vFeatures.size(); i++)
+		m_vFeatures[i]->setID(m_vFeatures[i]->getID() + 1);
+	return pFeat;
+}
+
 // +-----------------------------------------------------------
 f3::FaceFeature* f3::FaceImage::getFeature(const int iIndex) const
 {
@@ -184,9 +298,37 @@ bool f3::FaceImage::removeFeature(const int iIndex)
 	if(iIndex < 0 || iIndex >= (int) m_vFeatures.size())
 		return false;
 
-	FaceFeature *pFeat = m_vFeatures[iIndex];
-	m_vFeatures.erase(m_vFeatures.begin() + iIndex);
-	delete pFeat;
+	return removeFeatures(vector<int>(1, iIndex)) == 1;
+}
 
-	return true;
+// +-----------------------------------------------------------
+int f3::FaceImage::removeFeatures(const vector<int> &vIndexes)
+{
+	// The features kept are moved to the front of the vector (in their original order) as the
+	// vector is traversed, so each one is moved at most once
+	unsigned int iNext = 0, iKept = 0;
+	int iRemoved = 0;
+	FaceFeature *pFeat;
+	for(unsigned int i = 0; i < m_vFeatures.size(); i++)
+	{
+		pFeat = m_vFeatures[i];
+		while(iNext < vIndexes.size() && vIndexes[iNext] < (int) i)
+			iNext++;
+
+		if(iNext < vIndexes.size() && vIndexes[iNext] == (int) i)
+		{
+			delete pFeat;
+			iRemoved++;
+			iNext++;
+		}
+		else
+		{
+			if(iRemoved)
+				pFeat->setID(pFeat->getID() - iRemoved);
+			m_vFeatures[iKept++] = pFeat;
+		}
+	}
+	m_vFeatures.resize(iKept);
+
+	return iRemoved;
 }
\ No newline at end of file
@@ -26,12 +26,14 @@
 
 #include <opencv2/core/core.hpp>
 #include <QString>
-#include <QPixmap>
 #include <QDomDocument>
+#include <QXmlStreamReader>
 
 #include <vector>
 #include <string>
 
+class QPixmap;
+
 namespace f3
 {
 	/**
@@ -50,6 +52,21 @@ namespace f3
 		 */
 		FaceImage(const QString &sFileName = QString(), const EmotionLabel eEmotionLabel = EmotionLabel::UNDEFINED);
 
+		/**
+		 * Copy constructor. Performs a deep copy of the face image (i.e. the face features are
+		 * also copied).
+		 * @param oOther Instance of the FaceImage to copy from.
+		 */
+		FaceImage(const FaceImage &oOther);
+
+		/**
+		 * Assignment operator. Performs a deep copy of the face image (i.e. the face features are
+		 * also copied).
+		 * @param oOther Instance of the FaceImage to copy from.
+		 * @return Reference to this face image.
+		 */
+		FaceImage& operator=(const FaceImage &oOther);
+
 		/**
 		 * Class destructor.
 		 */
@@ -82,6 +99,18 @@ namespace f3
 		 */
 		FaceFeature *addFeature(int iID, float x = 0.0f, float y = 0.0f);
 
+		/**
+		 * Inserts a new face feature in the face image, at the given index. The IDs of the
+		 * face features after it are incremented.
+		 * @param iIndex Integer with the index where to insert the face feature. If it is out
+		 * of bounds, the face feature is added at the end.
+		 * @param iID Integer with the ID of the face feature.
+		 * @param x Float with the x coordinate of the face feature.
+		 * @param y Float with the y coordinate of the face feature.
+		 * @return Instance of a FaceFeature with the new feature created.
+		 */
+		FaceFeature *insertFeature(const int iIndex, int iID, float x = 0.0f, float y = 0.0f);
+
 		/**
 		 * Gets the face feature at the given index.
 		 * @param iIndex Integer with the index of the feature to be obtained.
@@ -97,13 +126,24 @@ namespace f3
 		std::vector<FaceFeature*> getFeatures() const;
 
 		/**
-		 * Removes the face feature at the given index.
+		 * Removes the face feature at the given index. The IDs of the face features after
+		 * it are decremented.
 		 * @param iIndex Integer with the index of the feature to be removed.
 		 * @return Boolean indicating if the face feature was successfully
 		 * removed (true) or not (false).
 		 */
 		bool removeFeature(const int iIndex);
 
+		/**
+		 * Removes the face features at the given indexes, compacting the remaining ones in a
+		 * single pass. The IDs of the remaining face features are decremented by the number of
+		 * face features removed before them.
+		 * @param vIndexes Vector with the indexes of the features to be removed. It must be sorted
+		 * in ascending order and have no repeated values. Indexes out of bounds are ignored.
+		 * @return Integer with the number of face features removed.
+		 */
+		int removeFeatures(const std::vector<int> &vIndexes);
+
 		/**
 		 * Loads (unserializes) the face image data from the given xml element.
 		 * @param oElement QDomElement from where to read the image data (the image node in the xml).
@@ -113,6 +153,17 @@ namespace f3
 		 */
 		bool loadFromXML(const QDomElement &oElement, QString &sMsgError, int iNumExpectedFeatures);
 
+		/**
+		 * Loads (unserializes) the face image data from the given xml stream. The stream must be
+		 * positioned at the start element of the image node, and it is left at its end element.
+		 * Differently from loadFromXML, this method does not require the whole document to be in memory.
+		 * @param oReader QXmlStreamReader from where to read the image data.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @param iNumExpectedFeatures Integer with the number of expected features.
+		 * @return Boolean indicating if the loading was successful (true) or if it failed (false).
+		 */
+		bool loadFromStream(QXmlStreamReader &oReader, QString &sMsgError, int iNumExpectedFeatures);
+
         /**
          * Saves the face image data into the given xml element.
 		 * @param oParent Parent QDomElement to receive the new node of the face image data.
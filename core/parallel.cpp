@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "parallel.h"
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QSemaphore>
+
+using namespace std;
+
+namespace f3
+{
+	/**
+	 * Shared state of a call to Parallel::forRange.
+	 */
+	class ParallelJob
+	{
+	public:
+		/**
+		 * Class constructor.
+		 * @param iCount Integer with the number of indexes to process.
+		 * @param iGrainSize Integer with the number of indexes in each chunk.
+		 * @param fFunc RangeFunction to be called for each chunk.
+		 */
+		ParallelJob(const int iCount, const int iGrainSize, const Parallel::RangeFunction &fFunc):
+			m_oNext(0), m_iCount(iCount), m_iGrainSize(iGrainSize), m_fFunc(fFunc)
+		{
+		}
+
+		/**
+		 * Claims and processes chunks until the whole range has been claimed.
+		 */
+		void work()
+		{
+			int iBegin;
+			while((iBegin = m_oNext.fetchAndAddRelaxed(m_iGrainSize)) < m_iCount)
+				m_fFunc(iBegin, qMin(iBegin + m_iGrainSize, m_iCount));
+		}
+
+		/** Semaphore released by each helper thread when it finishes. */
+		QSemaphore m_oDone;
+
+	private:
+		/** First index of the next chunk to be claimed. */
+		QAtomicInt m_oNext;
+
+		/** Number of indexes to process. */
+		int m_iCount;
+
+		/** Number of indexes in each chunk. */
+		int m_iGrainSize;
+
+		/** Function called for each chunk. */
+		const Parallel::RangeFunction &m_fFunc;
+	};
+
+	/**
+	 * Runnable executed by the helper threads of the pool.
+	 */
+	class ParallelWorker: public QRunnable
+	{
+	public:
+		/**
+		 * Class constructor.
+		 * @param pJob Pointer to the ParallelJob to work on.
+		 */
+		ParallelWorker(ParallelJob *pJob): m_pJob(pJob)
+		{
+		}
+
+		/**
+		 * Works on the job and signals its conclusion.
+		 */
+		void run()
+		{
+			m_pJob->work();
+			m_pJob->m_oDone.release();
+		}
+
+	private:
+		/** Job to work on. */
+		ParallelJob *m_pJob;
+	};
+}
+
+// +-----------------------------------------------------------
+f3::Parallel::Parallel()
+{
+}
+
+// +-----------------------------------------------------------
+void f3::Parallel::forRange(const int iCount, const RangeFunction &fFunc, const int iGrainSize)
+{
+	if(iCount <= 0)
+		return;
+
+	int iGrain = iGrainSize > 0 ? iGrainSize : grainSize(iCount);
+	int iChunks = (iCount - 1) / iGrain + 1;
+	ParallelJob oJob(iCount, iGrain, fFunc);
+
+	// Start only the helpers that can run right now (the calling thread is also a worker)
+	QThreadPool *pPool = QThreadPool::globalInstance();
+	int iHelpers = 0;
+	while(iHelpers < iChunks - 1 && iHelpers < pPool->maxThreadCount() - 1)
+	{
+		ParallelWorker *pWorker = new ParallelWorker(&oJob);
+		if(!pPool->tryStart(pWorker))
+		{
+			delete pWorker;
+			break;
+		}
+		iHelpers++;
+	}
+
+	oJob.work();
+	oJob.m_oDone.acquire(iHelpers);
+}
+
+// +-----------------------------------------------------------
+int f3::Parallel::grainSize(const int iCount)
+{
+	int iThreads = qMax(QThreadPool::globalInstance()->maxThreadCount(), 1);
+	return qMax(iCount / (iThreads * 8), 1);
+}
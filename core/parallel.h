@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "core_global.h"
+
+#include <functional>
+
+namespace f3
+{
+	/**
+	 * Static class with a simple data-parallel loop used to process the samples of the datasets
+	 * (and any other index range) in the threads of the global Qt thread pool.
+	 *
+	 * The range is split in chunks of contiguous indexes that are claimed by the threads from a
+	 * shared atomic counter: the threads that finish earlier simply claim more chunks, so the load
+	 * is balanced without the overhead of a scheduler. The calling thread also processes chunks,
+	 * and only the pool threads that are idle at the time of the call are used as helpers (so
+	 * nested calls never block waiting for threads that are not available).
+	 */
+	class CORE_EXPORT Parallel
+	{
+	protected:
+		/**
+		 * Protected class constructor to prevent this class from being instantiated.
+		 */
+		Parallel();
+
+	public:
+		/**
+		 * Type of the function called to process a chunk of the range. It receives the first index
+		 * of the chunk and the index right after its last one (i.e. the chunk is [iBegin, iEnd)).
+		 */
+		typedef std::function<void (int iBegin, int iEnd)> RangeFunction;
+
+		/**
+		 * Processes the index range [0, iCount) in parallel. The method returns only after all
+		 * indexes have been processed.
+		 * @param iCount Integer with the number of indexes to process.
+		 * @param fFunc RangeFunction to be called for each chunk of the range. It is called from
+		 * different threads at the same time, hence it must be thread safe.
+		 * @param iGrainSize Integer with the number of indexes in each chunk. The default (0) uses
+		 * the value returned by grainSize().
+		 */
+		static void forRange(const int iCount, const RangeFunction &fFunc, const int iGrainSize = 0);
+
+		/**
+		 * Queries the default chunk size used for the given number of indexes. It produces about
+		 * eight chunks per thread, so the load can still be balanced when the items have different
+		 * processing costs, while keeping chunks large when the work per item is small.
+		 * @param iCount Integer with the number of indexes to process.
+		 * @return Integer with the number of indexes in each chunk (at least 1).
+		 */
+		static int grainSize(const int iCount);
+	};
+}
+
+#endif // PARALLEL_H
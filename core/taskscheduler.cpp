@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "taskscheduler.h"
+
+#include <QCoreApplication>
+#include <QRunnable>
+#include <QThread>
+#include <QDebug>
+
+#include <exception>
+
+using namespace std;
+
+namespace f3
+{
+	/**
+	 * Event used to deliver the notifications of the tasks to the GUI thread.
+	 */
+	class TaskEvent: public QEvent
+	{
+	public:
+		/**
+		 * Class constructor.
+		 * @param eType QEvent::Type with the type registered for the task events.
+		 * @param fHandler Function to be called in the GUI thread to handle the notification.
+		 */
+		TaskEvent(QEvent::Type eType, const std::function<void ()> &fHandler): QEvent(eType)
+		{
+			m_fHandler = fHandler;
+		}
+
+		/** Function to be called in the GUI thread to handle the notification. */
+		std::function<void ()> m_fHandler;
+	};
+
+	/**
+	 * Runnable used to execute a task in the thread pool of the scheduler.
+	 */
+	class TaskRunnable: public QRunnable
+	{
+	public:
+		/**
+		 * Class constructor.
+		 * @param pScheduler Instance of the scheduler that executes the task.
+		 * @param oToken CancellationToken of the task.
+		 * @param fTask Function with the task to be executed.
+		 * @param fFinish Function to be called in the GUI thread with the task result.
+		 * @param fProgress Function to be called in the GUI thread with the progress reports.
+		 */
+		TaskRunnable(TaskScheduler *pScheduler, const CancellationToken &oToken, const TaskScheduler::Task &fTask,
+			const std::function<void (const QVariant&)> &fFinish, const TaskScheduler::ProgressHandler &fProgress)
+		{
+			m_pScheduler = pScheduler;
+			m_oToken = oToken;
+			m_fTask = fTask;
+			m_fFinish = fFinish;
+			m_fProgress = fProgress;
+		}
+
+		/**
+		 * Executes the task (unless it was cancelled before starting) and posts its completion.
+		 */
+		void run()
+		{
+			QVariant oResult;
+			if(!m_oToken.isCancelled())
+			{
+				TaskContext oContext(m_pScheduler, m_oToken, m_fProgress);
+				try
+				{
+					oResult = m_fTask(oContext);
+				}
+				catch(std::exception &e)
+				{
+					qCritical() << "Exception executing a background task:" << e.what();
+				}
+				catch(...)
+				{
+					qCritical() << "Unknown exception executing a background task";
+				}
+			}
+
+			std::function<void (const QVariant&)> fFinish = m_fFinish;
+			m_pScheduler->post([fFinish, oResult]() { fFinish(oResult); });
+		}
+
+	private:
+		/** Instance of the scheduler that executes the task. */
+		TaskScheduler *m_pScheduler;
+
+		/** Cancellation token of the task. */
+		CancellationToken m_oToken;
+
+		/** Function with the task to be executed. */
+		TaskScheduler::Task m_fTask;
+
+		/** Function called in the GUI thread with the task result. */
+		std::function<void (const QVariant&)> m_fFinish;
+
+		/** Function called in the GUI thread with the progress reports. */
+		TaskScheduler::ProgressHandler m_fProgress;
+	};
+}
+
+// Type of the events used to deliver the task notifications
+const QEvent::Type f3::TaskScheduler::m_seEventType = (QEvent::Type) QEvent::registerEventType();
+
+// +-----------------------------------------------------------
+f3::CancellationToken::CancellationToken()
+{
+	m_pFlag = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+}
+
+// +-----------------------------------------------------------
+bool f3::CancellationToken::isCancelled() const
+{
+	if(m_pFlag->load())
+		return true;
+
+	foreach(const QSharedPointer<QAtomicInt> &pFlag, m_lAncestors)
+		if(pFlag->load())
+			return true;
+
+	return false;
+}
+
+// +-----------------------------------------------------------
+void f3::CancellationToken::cancel()
+{
+	m_pFlag->store(1);
+}
+
+// +-----------------------------------------------------------
+f3::CancellationToken f3::CancellationToken::createChild() const
+{
+	CancellationToken oChild;
+	oChild.m_lAncestors = m_lAncestors;
+	oChild.m_lAncestors.append(m_pFlag);
+	return oChild;
+}
+
+// +-----------------------------------------------------------
+quintptr f3::CancellationToken::id() const
+{
+	return (quintptr) m_pFlag.data();
+}
+
+// +-----------------------------------------------------------
+f3::TaskContext::TaskContext(TaskScheduler *pScheduler, const CancellationToken &oToken, const std::function<void (int, const QVariant&)> &fProgress)
+{
+	m_pScheduler = pScheduler;
+	m_oToken = oToken;
+	m_fProgress = fProgress;
+}
+
+// +-----------------------------------------------------------
+bool f3::TaskContext::isCancelled() const
+{
+	return m_oToken.isCancelled();
+}
+
+// +-----------------------------------------------------------
+void f3::TaskContext::reportProgress(int iPercent, const QVariant &oPartial)
+{
+	if(!m_fProgress || m_oToken.isCancelled())
+		return;
+
+	CancellationToken oToken = m_oToken;
+	std::function<void (int, const QVariant&)> fProgress = m_fProgress;
+	m_pScheduler->post([oToken, fProgress, iPercent, oPartial]()
+	{
+		if(!oToken.isCancelled())
+			fProgress(iPercent, oPartial);
+	});
+}
+
+// +-----------------------------------------------------------
+const f3::CancellationToken& f3::TaskContext::token() const
+{
+	return m_oToken;
+}
+
+// +-----------------------------------------------------------
+f3::TaskScheduler::TaskScheduler(QObject *pParent): QObject(pParent)
+{
+	// Leave one core free for the GUI thread
+	m_oPool.setMaxThreadCount(qMax(QThread::idealThreadCount() - 1, 1));
+}
+
+// +-----------------------------------------------------------
+f3::TaskScheduler::~TaskScheduler()
+{
+	cancelAll();
+	waitForDone();
+}
+
+// +-----------------------------------------------------------
+f3::CancellationToken f3::TaskScheduler::schedule(const Priority ePriority, const Task &fTask, const CompletionHandler &fDone,
+	const CancellationToken &oOwner, const QString &sKey, const ProgressHandler &fProgress)
+{
+	// The task is cancelled either individually, by its owner or by the scheduler
+	CancellationToken oToken = oOwner.createChild();
+	oToken.m_lAncestors.append(m_oRootToken.m_pFlag);
+
+	// A new task with the same identity replaces the previous one
+	QPair<quintptr, QString> oKey = qMakePair(oOwner.id(), sKey);
+	if(!sKey.isEmpty())
+	{
+		QHash<QPair<quintptr, QString>, CancellationToken>::iterator it = m_hKeyedTasks.find(oKey);
+		if(it != m_hKeyedTasks.end())
+			it.value().cancel();
+		m_hKeyedTasks.insert(oKey, oToken);
+	}
+
+	std::function<void (const QVariant&)> fFinish = [this, oToken, oKey, fDone](const QVariant &oResult)
+	{
+		QHash<QPair<quintptr, QString>, CancellationToken>::iterator it = m_hKeyedTasks.find(oKey);
+		if(it != m_hKeyedTasks.end() && it.value().id() == oToken.id())
+			m_hKeyedTasks.erase(it);
+
+		if(fDone && !oToken.isCancelled())
+			fDone(oResult);
+	};
+
+	m_oPool.start(new TaskRunnable(this, oToken, fTask, fFinish, fProgress), ePriority);
+	return oToken;
+}
+
+// +-----------------------------------------------------------
+void f3::TaskScheduler::cancelAll()
+{
+	// Tasks scheduled from now on are bound to a new root token
+	m_oRootToken.cancel();
+	m_oRootToken = CancellationToken();
+}
+
+// +-----------------------------------------------------------
+bool f3::TaskScheduler::waitForDone(const int iTimeout)
+{
+	return m_oPool.waitForDone(iTimeout);
+}
+
+// +-----------------------------------------------------------
+int f3::TaskScheduler::maxThreadCount() const
+{
+	return m_oPool.maxThreadCount();
+}
+
+// +-----------------------------------------------------------
+void f3::TaskScheduler::post(const std::function<void ()> &fHandler)
+{
+	QCoreApplication::postEvent(this, new TaskEvent(m_seEventType, fHandler));
+}
+
+// +-----------------------------------------------------------
+void f3::TaskScheduler::customEvent(QEvent *pEvent)
+{
+	if(pEvent->type() == m_seEventType)
+		((TaskEvent*) pEvent)->m_fHandler();
+	else
+		QObject::customEvent(pEvent);
+}
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include "core_global.h"
+
+#include <QObject>
+#include <QEvent>
+#include <QThreadPool>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QVariant>
+#include <QHash>
+#include <QPair>
+#include <QList>
+#include <QString>
+
+#include <functional>
+
+namespace f3
+{
+	class TaskScheduler;
+
+	/**
+	 * Token used to cancel background tasks. Copies of a token share the same cancellation flag,
+	 * and a child token (created with createChild()) is also cancelled when any of its ancestors is.
+	 * This allows, for instance, a window to own a token that cancels all the tasks it scheduled
+	 * when it is closed, while each task still can be cancelled individually.
+	 */
+	class CORE_EXPORT CancellationToken
+	{
+		friend class TaskScheduler;
+	public:
+		/**
+		 * Class constructor. Creates a new token, not yet cancelled and with no ancestors.
+		 */
+		CancellationToken();
+
+		/**
+		 * Indicates if the token (or any of its ancestors) was cancelled.
+		 * @return Boolean indicating if the token was cancelled or not.
+		 */
+		bool isCancelled() const;
+
+		/**
+		 * Cancels the token. All its copies and children are also cancelled.
+		 */
+		void cancel();
+
+		/**
+		 * Creates a new token that is cancelled whenever this token is cancelled (but that can also
+		 * be cancelled individually, without affecting this token).
+		 * @return CancellationToken with the child token.
+		 */
+		CancellationToken createChild() const;
+
+		/**
+		 * Queries a value that uniquely identifies the token (and all its copies).
+		 * @return Unsigned integer with the token identifier.
+		 */
+		quintptr id() const;
+
+	private:
+		/** Cancellation flag shared among the copies of the token. */
+		QSharedPointer<QAtomicInt> m_pFlag;
+
+		/** Cancellation flags of the ancestors of the token. */
+		QList<QSharedPointer<QAtomicInt> > m_lAncestors;
+	};
+
+	/**
+	 * Context received by the background tasks while they execute, used to check for their
+	 * cancellation and to report their progress back to the GUI thread.
+	 */
+	class CORE_EXPORT TaskContext
+	{
+		friend class TaskRunnable;
+	public:
+		/**
+		 * Indicates if the task was cancelled. Long running tasks shall call this method regularly
+		 * and return as soon as possible when it returns true.
+		 * @return Boolean indicating if the task was cancelled or not.
+		 */
+		bool isCancelled() const;
+
+		/**
+		 * Reports the progress of the task. The progress handler given when the task was scheduled
+		 * (if any) is called in the GUI thread with the reported values.
+		 * @param iPercent Integer with the percentage of the task concluded (in range [0, 100]).
+		 * @param oPartial QVariant with an optional partial result produced by the task.
+		 */
+		void reportProgress(int iPercent, const QVariant &oPartial = QVariant());
+
+		/**
+		 * Gets the cancellation token of the task.
+		 * @return Const reference to the CancellationToken of the task.
+		 */
+		const CancellationToken& token() const;
+
+	protected:
+		/**
+		 * Class constructor.
+		 * @param pScheduler Instance of the TaskScheduler that executes the task.
+		 * @param oToken CancellationToken of the task.
+		 * @param fProgress Function to be called in the GUI thread with the progress reports.
+		 */
+		TaskContext(TaskScheduler *pScheduler, const CancellationToken &oToken, const std::function<void (int, const QVariant&)> &fProgress);
+
+	private:
+		/** Instance of the scheduler that executes the task. */
+		TaskScheduler *m_pScheduler;
+
+		/** Cancellation token of the task. */
+		CancellationToken m_oToken;
+
+		/** Function called in the GUI thread with the progress reports. */
+		std::function<void (int, const QVariant&)> m_fProgress;
+	};
+
+	/**
+	 * Central scheduler of the background tasks of the applications (image decoding, thumbnailing,
+	 * prefetching, saving, etc). The tasks are executed by a thread pool owned by the scheduler, whose
+	 * size leaves one core free for the GUI thread, and are started according to their priority
+	 * classes. The completion and the progress of the tasks are always handled in the GUI thread
+	 * (or, more precisely, in the thread where the scheduler was created).
+	 */
+	class CORE_EXPORT TaskScheduler: public QObject
+	{
+		Q_OBJECT
+		friend class TaskContext;
+		friend class TaskRunnable;
+	public:
+		/**
+		 * Priority classes of the tasks. Tasks with higher priorities are started first.
+		 */
+		enum Priority {
+			Idle = 0,		/**< Work that can wait until nothing else is to be done (e.g. autosaving). */
+			Prefetch = 1,	/**< Work that will probably be needed soon (e.g. decoding the next image). */
+			VisibleNow = 2	/**< Work whose result the user is waiting for (e.g. decoding the current image). */
+		};
+
+		/** Function executed in background by a task. Its return is passed to the completion handler. */
+		typedef std::function<QVariant (TaskContext &oContext)> Task;
+
+		/** Function called in the GUI thread with the result of a task that was not cancelled. */
+		typedef std::function<void (const QVariant &oResult)> CompletionHandler;
+
+		/** Function called in the GUI thread with the progress reports of a task that was not cancelled. */
+		typedef std::function<void (int iPercent, const QVariant &oPartial)> ProgressHandler;
+
+		/**
+		 * Class constructor.
+		 * @param pParent Instance of the QObject parent of the scheduler. The default is NULL.
+		 */
+		TaskScheduler(QObject *pParent = NULL);
+
+		/**
+		 * Class destructor. Cancels all pending tasks and waits for the running ones to finish.
+		 */
+		virtual ~TaskScheduler();
+
+		/**
+		 * Schedules a task for execution in background.
+		 * @param ePriority Priority value with the priority class of the task.
+		 * @param fTask Task function to be executed in background.
+		 * @param fDone CompletionHandler to be called in the GUI thread with the task result. It is not called
+		 * if the task is cancelled. The default is no handler.
+		 * @param oOwner CancellationToken of the owner of the task (e.g. a window). The task is cancelled
+		 * when this token is cancelled. The default is a new token (i.e. a task not owned by anyone).
+		 * @param sKey QString with an identity for the task among the tasks of the same owner (e.g. the
+		 * row of the image it processes, or its purpose). When a task is scheduled with the same owner
+		 * and key of a previous task, the previous task is cancelled. The default is no key.
+		 * @param fProgress ProgressHandler to be called in the GUI thread with the progress reported by
+		 * the task. The default is no handler.
+		 * @return CancellationToken that can be used to cancel the task individually.
+		 */
+		CancellationToken schedule(const Priority ePriority, const Task &fTask, const CompletionHandler &fDone = CompletionHandler(),
+			const CancellationToken &oOwner = CancellationToken(), const QString &sKey = QString(), const ProgressHandler &fProgress = ProgressHandler());
+
+		/**
+		 * Cancels all the tasks scheduled so far.
+		 */
+		void cancelAll();
+
+		/**
+		 * Waits for all the tasks in execution to finish.
+		 * @param iTimeout Maximum time (in miliseconds) to wait. The default (-1) waits indefinitely.
+		 * @return Boolean indicating if all tasks finished (true) or if the timeout was reached (false).
+		 */
+		bool waitForDone(const int iTimeout = -1);
+
+		/**
+		 * Queries the maximum number of tasks executed at the same time.
+		 * @return Integer with the number of threads used by the scheduler.
+		 */
+		int maxThreadCount() const;
+
+	protected:
+		/**
+		 * Handles the events posted by the tasks in execution (with their completion or progress),
+		 * calling the proper handlers in the GUI thread.
+		 * @param pEvent Instance of the QEvent with the event data.
+		 */
+		void customEvent(QEvent *pEvent);
+
+		/**
+		 * Posts a notification of a task (its completion or progress) to be handled in the GUI thread.
+		 * This method is thread safe.
+		 * @param fHandler Function to be called in the GUI thread to handle the notification.
+		 */
+		void post(const std::function<void ()> &fHandler);
+
+	private:
+		/** Thread pool used to execute the tasks. */
+		QThreadPool m_oPool;
+
+		/** Token used as the ancestor of all tasks, in order to cancel them all at once. */
+		CancellationToken m_oRootToken;
+
+		/** Tokens of the tasks in execution that were scheduled with a key, indexed by their owner and key. */
+		QHash<QPair<quintptr, QString>, CancellationToken> m_hKeyedTasks;
+
+		/** Type of the events used to notify the task completion and progress. */
+		static const QEvent::Type m_seEventType;
+	};
+}
+
+#endif // TASKSCHEDULER_H
@@ -25,6 +25,10 @@
 #include <opencv2/core/core.hpp>
 
 #include <QMessageBox>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QFile>
+#include <QDateTime>
 #include <QGridLayout>
 #include <QApplication>
 #include <QtMath>
@@ -35,6 +39,22 @@
 using namespace std;
 using namespace cv;
 
+// Interval between the checks for autosaving (two minutes)
+const int f3::ChildWindow::AUTOSAVE_INTERVAL = 2 * 60 * 1000;
+
+// Proportion of the dataset file size above which its journal is compacted (a quarter)
+const int f3::ChildWindow::JOURNAL_COMPACTION_RATIO = 4;
+
+// Size up to which the journal is never compacted (1 MB)
+const int f3::ChildWindow::JOURNAL_COMPACTION_MIN_SIZE = 1024 * 1024;
+
+// Maximum number of undoable commands
+const int f3::ChildWindow::UNDO_LIMIT = 100;
+
+// Maximum memory used by the undoable commands (in KB): 256 MB. The removal of features and the
+// changes in batch keep positions of all images selected, so a few commands may use all of it
+const int f3::ChildWindow::UNDO_MEMORY_LIMIT = 256 * 1024;
+
 // +-----------------------------------------------------------
 f3::ChildWindow::ChildWindow(QWidget *pParent) :
     QWidget(pParent)
@@ -61,15 +81,42 @@ f3::ChildWindow::ChildWindow(QWidget *pParent) :
 	connect(m_pFaceWidget, SIGNAL(onFaceFeaturesChanged()), this, SLOT(onDataChanged()));
 	connect(m_pFaceDatasetModel, SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)), this, SLOT(onDataChanged()));
 	connect(m_pFaceSelectionModel, SIGNAL(currentChanged(const QModelIndex &, const QModelIndex &)), this, SLOT(onCurrentChanged(const QModelIndex &, const QModelIndex &)));
+	connect(m_pFaceDatasetModel, SIGNAL(rowsRemoved(const QModelIndex &, int, int)), this, SLOT(onRowsRemoved(const QModelIndex &, int, int)));
+	connect(m_pFaceDatasetModel, SIGNAL(loadProgress(const int)), this, SLOT(onDatasetLoadProgress(const int)));
+	connect(m_pFaceDatasetModel, SIGNAL(loadFinished(const bool, const QString)), this, SLOT(onDatasetLoadFinished(const bool, const QString)));
+	connect(m_pFaceDatasetModel, SIGNAL(emotionLabelEdited(const int, const EmotionLabel, const EmotionLabel)), this, SLOT(onEmotionLabelEdited(const int, const EmotionLabel, const EmotionLabel)));
+
+	// The undoable commands refer to the rows of the model, so they are discarded when rows are
+	// inserted (i.e. images without the features edited) or removed
+	m_pUndoStack = new QUndoStack(this);
+	m_pUndoStack->setUndoLimit(UNDO_LIMIT);
+	connect(m_pFaceDatasetModel, SIGNAL(rowsInserted(const QModelIndex &, int, int)), m_pUndoStack, SLOT(clear()));
+	connect(m_pFaceDatasetModel, SIGNAL(rowsRemoved(const QModelIndex &, int, int)), m_pUndoStack, SLOT(clear()));
+	connect(m_pFaceDatasetModel, SIGNAL(modelReset()), m_pUndoStack, SLOT(clear()));
+
+	// The connections between the features are kept in the dataset and mirrored in the editor
+	connect(m_pFaceDatasetModel, SIGNAL(modelReset()), this, SLOT(refreshConnectionsInWidget()));
 
 	// Indicate that it is a brand new dataset (i.e. not yet saved to a file)
 	setProperty("new", true);
 	m_iCurrentImage = -1;
+
+	// The cost of the cached images is measured in KB
+	m_oImageCache.setMaxCost(64 * 1024);
+
+	// Periodic autosave to a sidecar file
+	m_bSaving = false;
+	m_bLastSaveOk = true;
+	m_bAutosaving = false;
+	m_iSavedVersion = m_pFaceDatasetModel->version();
+	connect(&m_oAutosaveTimer, SIGNAL(timeout()), this, SLOT(onAutosaveTimeout()));
+	m_oAutosaveTimer.start(AUTOSAVE_INTERVAL);
 }
 
 // +-----------------------------------------------------------
 f3::ChildWindow::~ChildWindow()
 {
+	m_oToken.cancel();
 	delete m_pFaceSelectionModel;
 	delete m_pFaceDatasetModel;
 }
@@ -87,38 +134,379 @@ QItemSelectionModel* f3::ChildWindow::selectionModel() const
 }
 
 // +-----------------------------------------------------------
-bool f3::ChildWindow::save(QString &sMsgError)
+void f3::ChildWindow::save()
+{
+	saveToFile(windowFilePath());
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::saveToFile(const QString &sFileName)
 {
-	if(!m_pFaceDatasetModel->saveToFile(windowFilePath(), sMsgError))
-		return false;
+	if(m_bSaving)
+		return;
 
-	onDataChanged(false);
-	setProperty("new", QVariant()); // No longer a new dataset
+	// A dataset with samples that could not be read from its file must be loaded again instead
+	QString sPagingError = m_pFaceDatasetModel->pagingError();
+	if(!sPagingError.isEmpty())
+	{
+		m_bLastSaveOk = false;
+		m_sLastSaveError = tr("o banco de faces não pode ser salvo e deve ser aberto novamente: %1").arg(sPagingError);
+		emit onSaveFinished(m_bLastSaveOk, m_sLastSaveError);
+		return;
+	}
+
+	m_bSaving = true;
+	quint64 iVersion = m_pFaceDatasetModel->version();
+
+	// The changes are appended to the journal of the same file, unless it is too big in proportion
+	// to the file (then the file is rewritten, and the journal compacted into it)
+	QFileInfo oFile(sFileName);
+	qint64 iJournalSize = FaceDatasetJournal::size(sFileName);
+	bool bIncremental = sFileName == windowFilePath() && oFile.exists() && !property("new").toBool() &&
+		m_pFaceDatasetModel->canSaveIncrementally() &&
+		iJournalSize <= qMax(oFile.size() / JOURNAL_COMPACTION_RATIO, (qint64) JOURNAL_COMPACTION_MIN_SIZE);
+
+	TaskScheduler::Task fTask;
+	if(FaceDatasetManifest::isManifest(sFileName))
+	{
+		// Only the shards changed are written (in parallel), and then the manifest
+		FaceDatasetManifest oManifest = m_pFaceDatasetModel->prepareShardedSave(sFileName);
+		fTask = [oManifest](TaskContext &oContext) -> QVariant
+		{
+			QString sMsgError;
+			bool bOk = oManifest.saveToFile(sMsgError, [&oContext](int iPercent) {
+				oContext.reportProgress(iPercent);
+			});
+			return bOk ? QVariant(true) : QVariant(sMsgError);
+		};
+	}
+	else if(bIncremental)
+	{
+		// A SQLite database read in the paging mode is updated by its pager, so no sample is read from
+		// it while it changes (and the changes on the features saved are not applied again when read)
+		shared_ptr<FaceDatasetPager> pPager = m_pFaceDatasetModel->pager();
+		int iPagedChanges = m_pFaceDatasetModel->numPagedChanges();
+		FaceDatasetChanges oChanges = m_pFaceDatasetModel->prepareIncrementalSave();
+		fTask = [oChanges, sFileName, pPager, iPagedChanges](TaskContext &oContext) -> QVariant
+		{
+			QString sMsgError;
+			if(!oChanges.isEmpty())
+			{
+				// A SQLite database is updated in place (in a transaction), instead of by the journal
+				if(FaceDatasetStore::isStore(sFileName) && pPager)
+				{
+					if(!pPager->apply(oChanges, iPagedChanges, sMsgError))
+						return QVariant(sMsgError);
+				}
+				else if(FaceDatasetStore::isStore(sFileName))
+				{
+					FaceDatasetStore oStore;
+					if(!oStore.open(sFileName, sMsgError) || !oStore.apply(oChanges, sMsgError))
+						return QVariant(sMsgError);
+				}
+				else if(!FaceDatasetJournal::append(sFileName, oChanges, sMsgError))
+					return QVariant(sMsgError);
+			}
+			oContext.reportProgress(100);
+			return QVariant(true);
+		};
+	}
+	else
+	{
+		// A dataset in the paging mode is read completely to be saved, so the new file is indexed
+		// afterwards (in background) for the dataset to return to that mode
+		bool bIndex = m_pFaceDatasetModel->isPaged();
+		FaceDatasetSnapshot oSnapshot = m_pFaceDatasetModel->prepareFullSave();
+		fTask = [oSnapshot, sFileName, bIndex](TaskContext &oContext) -> QVariant
+		{
+			QString sMsgError;
+			bool bOk = oSnapshot.saveToFile(sFileName, sMsgError, [&oContext](int iPercent) -> bool {
+				oContext.reportProgress(iPercent);
+				return true; // A requested saving is never cancelled midway
+			});
+			if(!bOk)
+				return QVariant(sMsgError);
+
+			// The new file does not match the existing journal anymore
+			FaceDatasetJournal::remove(sFileName);
+
+			// If the new file can not be indexed, the dataset merely remains completely loaded
+			if(bIndex)
+			{
+				shared_ptr<FaceDatasetPager> pPager(new FaceDatasetPager());
+				if(pPager->open(sFileName, sMsgError))
+					return QVariant::fromValue(pPager);
+				qWarning() << "Indexing of" << sFileName << "failed:" << sMsgError;
+			}
+			return QVariant(true);
+		};
+	}
+
+	TaskScheduler::CompletionHandler fDone = [this, sFileName, iVersion](const QVariant &oResult)
+	{
+		m_bSaving = false;
+		// The result is invalid if the task failed unexpectedly (i.e. with an exception). The complete
+		// saving of a dataset in the paging mode results in the pager of the new file
+		shared_ptr<FaceDatasetPager> pPager = oResult.value<shared_ptr<FaceDatasetPager> >();
+		m_bLastSaveOk = oResult.type() == QVariant::Bool || pPager != NULL;
+		m_pFaceDatasetModel->finishSave(m_bLastSaveOk, pPager);
+		m_sLastSaveError = m_bLastSaveOk ? QString() : oResult.toString();
+		if(!m_bLastSaveOk && m_sLastSaveError.isEmpty())
+			m_sLastSaveError = tr("não foi possível escrever no arquivo [%1]").arg(sFileName);
+
+		if(m_bLastSaveOk)
+		{
+			// The autosaved copies of both the previous and the new file names are now outdated
+			discardAutosave();
+			setWindowFilePath(sFileName);
+			discardAutosave();
+			setProperty("new", QVariant()); // No longer a new dataset
+			m_iSavedVersion = iVersion;
+
+			// The dataset might have been changed while it was being saved
+			if(m_pFaceDatasetModel->version() == iVersion)
+				onDataChanged(false);
+			else
+				emit onDataModified();
+		}
+
+		emit onSaveFinished(m_bLastSaveOk, m_sLastSaveError);
+	};
+
+	TaskScheduler::ProgressHandler fProgress = [this](int iPercent, const QVariant &oPartial)
+	{
+		Q_UNUSED(oPartial);
+		emit onSaveProgress(iPercent);
+	};
+
+	F3Application::scheduler()->schedule(TaskScheduler::VisibleNow, fTask, fDone, m_oToken, "", fProgress);
+	emit onSaveProgress(0);
+}
+
+// +-----------------------------------------------------------
+bool f3::ChildWindow::isSaving() const
+{
+	return m_bSaving;
+}
+
+// +-----------------------------------------------------------
+bool f3::ChildWindow::waitForSave(QString &sMsgError)
+{
+	if(m_bSaving)
+	{
+		QEventLoop oLoop;
+		connect(this, SIGNAL(onSaveFinished(const bool, const QString)), &oLoop, SLOT(quit()));
+		oLoop.exec(QEventLoop::ExcludeUserInputEvents);
+	}
+
+	sMsgError = m_sLastSaveError;
+	return m_bLastSaveOk;
+}
+
+// +-----------------------------------------------------------
+QString f3::ChildWindow::autosaveFileName() const
+{
+	return windowFilePath() + ".autosave";
+}
+
+// +-----------------------------------------------------------
+QString f3::ChildWindow::autosaveShardsFileName() const
+{
+	return autosaveFileName() + ".afm";
+}
+
+// +-----------------------------------------------------------
+bool f3::ChildWindow::hasAutosave() const
+{
+	// The dataset file is also changed by the saving of its journal
+	QFileInfo oAutosave(autosaveFileName());
+	if(!oAutosave.exists())
+		oAutosave = QFileInfo(FaceDatasetJournal::fileName(autosaveFileName()));
+	QFileInfo oJournal(FaceDatasetJournal::fileName(windowFilePath()));
+	QDateTime oSaved = QFileInfo(windowFilePath()).lastModified();
+	if(oJournal.exists())
+		oSaved = qMax(oSaved, oJournal.lastModified());
+	return oAutosave.exists() && oAutosave.lastModified() >= oSaved;
+}
+
+// +-----------------------------------------------------------
+bool f3::ChildWindow::recoverAutosave(QString &sMsgError)
+{
+	// The changes autosaved in the paging mode apply to the dataset as loaded from its file
+	if(!QFile::exists(autosaveFileName()))
+	{
+		QList<FaceDatasetChanges> lChanges;
+		if(!FaceDatasetJournal::read(autosaveFileName(), m_pFaceDatasetModel->journalId(), lChanges, sMsgError))
+			return false;
+		if(lChanges.isEmpty())
+		{
+			sMsgError = tr("a cópia de recuperação não corresponde ao conteúdo do arquivo [%1]").arg(windowFilePath());
+			return false;
+		}
+		if(!m_pFaceDatasetModel->restoreChanges(lChanges.last(), sMsgError))
+			return false;
+	}
+	else
+	{
+		// The copy of a sharded dataset is a single file, so its shards are defined again
+		FaceDatasetManifest oManifest;
+		if(FaceDatasetManifest::isManifest(windowFilePath()))
+		{
+			if(!oManifest.loadFromFile(autosaveShardsFileName(), sMsgError))
+				return false;
+			oManifest.setFileName(windowFilePath());
+		}
+
+		if(!m_pFaceDatasetModel->loadFromFile(autosaveFileName(), sMsgError))
+			return false;
+
+		if(oManifest.numShards() > 0 && !m_pFaceDatasetModel->setShards(oManifest))
+		{
+			sMsgError = tr("a cópia de recuperação não corresponde às partições do arquivo [%1]").arg(windowFilePath());
+			return false;
+		}
+	}
+
+	m_iSavedVersion = m_pFaceDatasetModel->version();
+	setWindowModified(true); // The recovered contents are not yet saved to the dataset file
+	emit onDataModified();
 	return true;
 }
 
 // +-----------------------------------------------------------
-bool f3::ChildWindow::saveToFile(const QString &sFileName, QString &sMsgError)
+void f3::ChildWindow::discardAutosave()
 {
-	if(!m_pFaceDatasetModel->saveToFile(sFileName, sMsgError))
-		return false;
+	QFile::remove(autosaveFileName());
+	QFile::remove(autosaveShardsFileName());
+	FaceDatasetJournal::remove(autosaveFileName());
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::onAutosaveTimeout()
+{
+	// Only datasets that already have a file and were changed since they were last (auto)saved
+	if(m_bSaving || m_bAutosaving || property("new").toBool() || !isWindowModified() || m_pFaceDatasetModel->version() == m_iSavedVersion)
+		return;
+
+	// The copy would miss the samples that could not be read from the dataset file
+	if(!m_pFaceDatasetModel->pagingError().isEmpty())
+		return;
 
+	// In the paging mode the dataset is not read completely for a copy: only the changes done since it
+	// was last saved are autosaved (so nothing is autosaved if they are not all tracked, i.e. after a
+	// saving failed), and they replace any complete copy autosaved before
+	bool bPaged = m_pFaceDatasetModel->isPaged();
+	if(bPaged && !m_pFaceDatasetModel->canSaveIncrementally())
+		return;
+
+	m_bAutosaving = true;
+	QString sFileName = autosaveFileName();
+	QString sShardsFileName = autosaveShardsFileName();
+	quint64 iVersion = m_pFaceDatasetModel->version();
+
+	TaskScheduler::Task fTask;
+	if(bPaged)
+	{
+		FaceDatasetChanges oChanges = m_pFaceDatasetModel->pendingChanges();
+		fTask = [oChanges, sFileName, sShardsFileName](TaskContext &oContext) -> QVariant
+		{
+			Q_UNUSED(oContext);
+			QString sMsgError;
+			QFile::remove(sFileName);
+			QFile::remove(sShardsFileName);
+			FaceDatasetJournal::remove(sFileName);
+			bool bOk = FaceDatasetJournal::append(sFileName, oChanges, sMsgError);
+			if(!bOk)
+				qWarning() << "Autosave to" << FaceDatasetJournal::fileName(sFileName) << "failed:" << sMsgError;
+			return bOk;
+		};
+	}
+	else
+	{
+		// The samples of a sharded dataset are copied to a single file, with the list of its shards
+		FaceDatasetSnapshot oSnapshot = m_pFaceDatasetModel->snapshot();
+		FaceDatasetManifest oManifest = m_pFaceDatasetModel->manifest();
+		fTask = [oSnapshot, oManifest, sFileName, sShardsFileName](TaskContext &oContext) -> QVariant
+		{
+			QString sMsgError;
+			bool bOk = true;
+			if(oManifest.numShards() > 0)
+				bOk = oManifest.saveListToFile(sShardsFileName, sMsgError);
+			else
+				QFile::remove(sShardsFileName);
+
+			if(bOk)
+				bOk = oSnapshot.saveToFile(sFileName, sMsgError, [&oContext](int iPercent) -> bool {
+					Q_UNUSED(iPercent);
+					return !oContext.isCancelled();
+				});
+			if(bOk)
+				FaceDatasetJournal::remove(sFileName);
+			else
+				qWarning() << "Autosave to" << sFileName << "failed:" << sMsgError;
+			return bOk;
+		};
+	}
+
+	TaskScheduler::CompletionHandler fDone = [this, iVersion](const QVariant &oResult)
+	{
+		m_bAutosaving = false;
+		if(oResult.toBool())
+			m_iSavedVersion = iVersion;
+	};
+
+	F3Application::scheduler()->schedule(TaskScheduler::Idle, fTask, fDone, m_oToken, "autosave");
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::loadFromFile(const QString &sFileName)
+{
 	setWindowFilePath(sFileName);
-	onDataChanged(false);
 	setProperty("new", QVariant()); // No longer a new dataset
-	return true;
+
+	// The features can not be edited while the dataset is loaded
+	m_pFaceWidget->setInteractive(false);
+	m_pFaceDatasetModel->startLoading(sFileName, m_oToken);
+	emit onDataModified();
 }
 
 // +-----------------------------------------------------------
-bool f3::ChildWindow::loadFromFile(const QString &sFileName, QString &sMsgError)
+bool f3::ChildWindow::isLoading() const
 {
-	if(!m_pFaceDatasetModel->loadFromFile(qPrintable(sFileName), sMsgError))
-		return false;
+	return m_pFaceDatasetModel->isLoading();
+}
 
-	setWindowFilePath(sFileName);
+// +-----------------------------------------------------------
+void f3::ChildWindow::cancelLoading()
+{
+	m_pFaceDatasetModel->cancelLoading();
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::onDatasetLoadProgress(const int iPercent)
+{
+	// Select the first image as soon as it is available (the connections are read before it)
+	if(!m_pFaceSelectionModel->currentIndex().isValid() && m_pFaceDatasetModel->rowCount() > 0)
+	{
+		m_pFaceSelectionModel->setCurrentIndex(m_pFaceDatasetModel->index(0, 0), QItemSelectionModel::Select);
+		refreshConnectionsInWidget();
+	}
+
+	emit onLoadProgress(iPercent);
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::onDatasetLoadFinished(const bool bSuccess, const QString sMsgError)
+{
+	m_pFaceWidget->setInteractive(true);
+
+	// The model is reset if changes were applied from the journal of the file
+	if(!m_pFaceSelectionModel->currentIndex().isValid() && m_pFaceDatasetModel->rowCount() > 0)
+		m_pFaceSelectionModel->setCurrentIndex(m_pFaceDatasetModel->index(0, 0), QItemSelectionModel::Select);
+
+	m_iSavedVersion = m_pFaceDatasetModel->version();
 	onDataChanged(false);
-	setProperty("new", QVariant()); // No longer a new dataset
-	return true;
+	emit onLoadFinished(bSuccess, sMsgError);
 }
 
 // +-----------------------------------------------------------
@@ -170,8 +558,86 @@ void f3::ChildWindow::onScaleFactorChanged(const double dScaleFactor)
 // +-----------------------------------------------------------
 void f3::ChildWindow::updateEmotionLabel(const EmotionLabel eLabel)
 {
-	QModelIndex oIndex = m_pFaceSelectionModel->currentIndex();
-    m_pFaceDatasetModel->setData(m_pFaceDatasetModel->index(oIndex.row(), 1), QVariant(eLabel.getValue()), Qt::UserRole);
+	QList<int> lSelected = getSelectedImages();
+	if(lSelected.size() <= 1)
+	{
+		QModelIndex oIndex = m_pFaceSelectionModel->currentIndex();
+		m_pFaceDatasetModel->setData(m_pFaceDatasetModel->index(oIndex.row(), 1), QVariant(eLabel.getValue()), Qt::UserRole);
+		return;
+	}
+
+	// Only the images with a different label are changed (and recorded for undo)
+	QList<int> lImages;
+	QList<EmotionLabel> lOldLabels, lNewLabels;
+	foreach(int iImage, lSelected)
+	{
+		const FaceImage *pImage = m_pFaceDatasetModel->getImage(iImage);
+		if(!pImage)
+			continue;
+
+		EmotionLabel eOldLabel = pImage->emotionLabel();
+		if(eOldLabel.getValue() != eLabel.getValue())
+		{
+			lImages.append(iImage);
+			lOldLabels.append(eOldLabel);
+			lNewLabels.append(eLabel);
+		}
+	}
+	if(lImages.isEmpty())
+		return;
+
+	m_pFaceDatasetModel->setEmotionLabels(lImages, lNewLabels);
+	pushUndoCommand(new SetEmotionLabelsCommand(this, lImages, lOldLabels, eLabel));
+}
+
+// +-----------------------------------------------------------
+QList<int> f3::ChildWindow::getSelectedImages() const
+{
+	QList<int> lRet;
+	foreach(QModelIndex oIndex, m_pFaceSelectionModel->selectedRows())
+		lRet.append(oIndex.row());
+	if(lRet.isEmpty() && m_iCurrentImage != -1)
+		lRet.append(m_iCurrentImage);
+	qSort(lRet);
+	return lRet;
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::transformFeatures(const Mat &oTransform)
+{
+	QList<int> lImages = getSelectedImages();
+	if(lImages.isEmpty())
+		return;
+
+	vector<vector<Point2f> > vOldShapes = m_pFaceDatasetModel->getShapes(lImages);
+	if(!m_pFaceDatasetModel->transformFeatures(lImages, oTransform))
+		return;
+	vector<vector<Point2f> > vNewShapes = m_pFaceDatasetModel->getShapes(lImages);
+
+	QString sText = QApplication::translate("UndoCommands", "transformar marcas de %1 imagens").arg(lImages.size());
+	pushUndoCommand(new SetShapesCommand(this, sText, lImages, vOldShapes, vNewShapes));
+
+	if(lImages.contains(m_iCurrentImage))
+		refreshFeaturesInWidget();
+	onDataChanged();
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::copyFeatures()
+{
+	QList<int> lImages = getSelectedImages();
+	lImages.removeAll(m_iCurrentImage);
+	if(m_iCurrentImage == -1 || lImages.isEmpty())
+		return;
+
+	vector<vector<Point2f> > vOldShapes = m_pFaceDatasetModel->getShapes(lImages);
+	if(!m_pFaceDatasetModel->copyFeatures(m_iCurrentImage, lImages))
+		return;
+	vector<vector<Point2f> > vNewShapes(lImages.size(), m_pFaceDatasetModel->getShapes(QList<int>() << m_iCurrentImage).front());
+
+	QString sText = QApplication::translate("UndoCommands", "copiar marcas para %1 imagens").arg(lImages.size());
+	pushUndoCommand(new SetShapesCommand(this, sText, lImages, vOldShapes, vNewShapes));
+	onDataChanged();
 }
 
 // +-----------------------------------------------------------
@@ -197,11 +663,16 @@ void f3::ChildWindow::onCurrentChanged(const QModelIndex &oCurrent, const QModel
 	else
 	{
 		m_iCurrentImage = oCurrent.row();
-		QVariant oData = m_pFaceDatasetModel->data(m_pFaceDatasetModel->index(m_iCurrentImage, 2), Qt::UserRole);
-		if(oData.isValid())
-			m_pFaceWidget->setPixmap(oData.value<QPixmap>());
-		else
-			m_pFaceWidget->setPixmap(QPixmap(":/images/brokenimage"));
+
+		// No face image is held at this point, so it is safe to release the samples not used recently
+		// (if the dataset was loaded in the paging mode)
+		m_pFaceDatasetModel->evictColdPages();
+
+		// Decode the current image in background and prefetch its neighbours, so navigating
+		// through the list does not block the GUI
+		requestImage(m_iCurrentImage, TaskScheduler::VisibleNow, "current-image");
+		requestImage(m_iCurrentImage + 1, TaskScheduler::Prefetch, "next-image");
+		requestImage(m_iCurrentImage - 1, TaskScheduler::Prefetch, "previous-image");
 
 		QString sImageName = oCurrent.data(Qt::UserRole).toString();
 		EmotionLabel eEmotion = EmotionLabel::fromValue(m_pFaceDatasetModel->data(m_pFaceDatasetModel->index(m_iCurrentImage, 1), Qt::UserRole).toInt());
@@ -212,37 +683,177 @@ void f3::ChildWindow::onCurrentChanged(const QModelIndex &oCurrent, const QModel
 }
 
 // +-----------------------------------------------------------
-void f3::ChildWindow::refreshFeaturesInWidget()
+void f3::ChildWindow::onRowsRemoved(const QModelIndex &oParent, int iFirst, int iLast)
+{
+	Q_UNUSED(oParent);
+
+	// If the current image was removed, the selection model already moved the current index
+	// (to a row not removed) before the removal
+	if(m_iCurrentImage > iLast)
+		m_iCurrentImage -= iLast - iFirst + 1;
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::requestImage(const int iRow, const TaskScheduler::Priority ePriority, const QString &sKey)
+{
+	QString sFileName;
+	if(iRow >= 0 && iRow < m_pFaceDatasetModel->rowCount())
+		sFileName = m_pFaceDatasetModel->data(m_pFaceDatasetModel->index(iRow, 0), Qt::UserRole).toString();
+
+	// The decoding of the image previously requested with the same key is no longer needed, unless
+	// that image is still requested with another key (i.e. the prefetched image of the new current row)
+	QString sPrevious = m_hImageRequests.value(sKey);
+	m_hImageRequests.insert(sKey, sFileName);
+	if(!sPrevious.isEmpty() && sPrevious != sFileName && !m_hImageRequests.values().contains(sPrevious))
+	{
+		QHash<QString, ImageTask>::iterator it = m_hImageTasks.find(sPrevious);
+		if(it != m_hImageTasks.end())
+		{
+			it->oToken.cancel();
+			m_hImageTasks.erase(it);
+		}
+	}
+
+	if(sFileName.isEmpty())
+		return;
+
+	QImage *pCached = m_oImageCache.object(sFileName);
+	if(pCached)
+	{
+		if(iRow == m_iCurrentImage)
+			displayImage(*pCached);
+		return;
+	}
+
+	// The image being decoded is not decoded twice: its decoding is only scheduled again (and the
+	// previous one cancelled) to raise its priority, if it is still waiting to start
+	QHash<QString, ImageTask>::iterator it = m_hImageTasks.find(sFileName);
+	if(it != m_hImageTasks.end())
+	{
+		if(it->ePriority >= ePriority || it->pStarted->load())
+			return;
+		it->oToken.cancel();
+		m_hImageTasks.erase(it);
+	}
+
+	QSharedPointer<QAtomicInt> pStarted(new QAtomicInt(0));
+	TaskScheduler::Task fTask = [sFileName, pStarted](TaskContext &oContext) -> QVariant
+	{
+		Q_UNUSED(oContext);
+		pStarted->store(1);
+		return QVariant::fromValue(QImage(sFileName));
+	};
+
+	TaskScheduler::CompletionHandler fDone = [this, sFileName](const QVariant &oResult)
+	{
+		// A decoding that was cancelled (i.e. replaced by another) never gets here
+		m_hImageTasks.remove(sFileName);
+
+		QImage oImage = oResult.value<QImage>();
+		if(!oImage.isNull())
+			m_oImageCache.insert(sFileName, new QImage(oImage), qMax(oImage.byteCount() / 1024, 1));
+
+		// Only display the image if its row is still the current one
+		QString sCurrent = m_pFaceDatasetModel->data(m_pFaceDatasetModel->index(m_iCurrentImage, 0), Qt::UserRole).toString();
+		if(m_iCurrentImage != -1 && sCurrent == sFileName)
+			displayImage(oImage);
+	};
+
+	// The decodings are cancelled by the keys of their requests (above), not by the scheduler
+	ImageTask oTask;
+	oTask.oToken = F3Application::scheduler()->schedule(ePriority, fTask, fDone, m_oToken);
+	oTask.ePriority = ePriority;
+	oTask.pStarted = pStarted;
+	m_hImageTasks.insert(sFileName, oTask);
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::displayImage(const QImage &oImage)
+{
+	if(oImage.isNull())
+		m_pFaceWidget->setPixmap(QPixmap(":/images/brokenimage"));
+	else
+		m_pFaceWidget->setImage(oImage);
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::refreshFeaturesInWidget(const QList<int> &lIndexes)
 {
-	vector<FaceFeature*> vFeats = m_pFaceDatasetModel->getFeatures(m_iCurrentImage);
+	// Read-only access, so merely displaying a sample does not mark it as changed
+	const FaceImage *pImage = m_pFaceDatasetModel->getImage(m_iCurrentImage);
+	vector<FaceFeature*> vFeats = pImage ? pImage->getFeatures() : vector<FaceFeature*>();
 	QList<FaceFeatureNode*> lsNodes = m_pFaceWidget->getFaceFeatures(m_pFaceDatasetModel->numFeatures());
-	for(int i = 0; i < (int) vFeats.size(); i++)
+
+	// The nodes moved to display the data are not changes made by the user
+	m_pFaceWidget->beginBulkUpdate();
+	if(lIndexes.isEmpty())
 	{
-		lsNodes[i]->setData(0, true); // Indication to avoid emitting position change event
-		lsNodes[i]->setPos(vFeats[i]->x, vFeats[i]->y);
-		lsNodes[i]->setData(0, false);
+		for(int i = 0; i < (int) vFeats.size() && i < lsNodes.size(); i++)
+			lsNodes[i]->setPos(vFeats[i]->x, vFeats[i]->y);
 	}
+	else
+	{
+		foreach(int iIndex, lIndexes)
+		{
+			if(iIndex >= 0 && iIndex < (int) vFeats.size() && iIndex < lsNodes.size())
+				lsNodes[iIndex]->setPos(vFeats[iIndex]->x, vFeats[iIndex]->y);
+		}
+	}
+	m_pFaceWidget->endBulkUpdate();
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::refreshConnectionsInWidget()
+{
+	m_pFaceWidget->getFaceFeatures(m_pFaceDatasetModel->numFeatures());
+	m_pFaceWidget->setConnections(m_pFaceDatasetModel->connections().edges());
 }
 
 // +-----------------------------------------------------------
 void f3::ChildWindow::updateFeaturesInDataset()
 {
-	QList<FaceFeatureNode*> lsNodes = m_pFaceWidget->getFaceFeatures();
-	vector<FaceFeature*> vFeats = m_pFaceDatasetModel->getFeatures(m_iCurrentImage);
+	// Only the nodes changed by the user are checked, and only the features actually moved are
+	// updated (and recorded for undo)
+	QList<int> lChanged;
+	foreach(FaceFeatureNode *pNode, m_pFaceWidget->takeChangedFeatures())
+		lChanged.append(pNode->getID());
 
+	const FaceImage *pImage = m_pFaceDatasetModel->getImage(m_iCurrentImage);
+	if(lChanged.isEmpty() || !pImage)
+		return;
+	qSort(lChanged);
+
+	const QList<FaceFeatureNode*> &lsNodes = m_pFaceWidget->getFaceFeatures();
+	vector<FaceFeature*> vFeats = pImage->getFeatures();
+	QList<int> lIndexes;
+	QList<QPointF> lOldPositions, lNewPositions;
 	FaceFeatureNode* pNode;
-	for(int i = 0; i < (int) vFeats.size(); i++)
+	foreach(int i, lChanged)
 	{
-		if(i >= lsNodes.size()) // Sanity check (vFeats and lsNodes are supposed to have the same size, but who knows?)
+		if(i >= (int) vFeats.size() || i >= lsNodes.size()) // Sanity check (vFeats and lsNodes are supposed to have the same size, but who knows?)
 		{
 			qCritical() << tr("An update of face features in dataset was not performed due to inconsistences.");
 			continue;
 		}
 		pNode = lsNodes.at(i);
-		vFeats[i]->setID(pNode->getID());
-		vFeats[i]->x = pNode->x();
-		vFeats[i]->y = pNode->y();
+		if(vFeats[i]->x != (float) pNode->x() || vFeats[i]->y != (float) pNode->y())
+		{
+			lIndexes.append(i);
+			lOldPositions.append(QPointF(vFeats[i]->x, vFeats[i]->y));
+			lNewPositions.append(pNode->pos());
+		}
+	}
+
+	if(lIndexes.isEmpty())
+		return;
+
+	vFeats = m_pFaceDatasetModel->getFeatures(m_iCurrentImage);
+	for(int i = 0; i < lIndexes.size(); i++)
+	{
+		vFeats[lIndexes[i]]->x = lNewPositions[i].x();
+		vFeats[lIndexes[i]]->y = lNewPositions[i].y();
 	}
+	pushUndoCommand(new MoveFeaturesCommand(this, m_iCurrentImage, lIndexes, lOldPositions, lNewPositions));
 }
 
 // +-----------------------------------------------------------
@@ -286,6 +897,18 @@ void f3::ChildWindow::setDisplayFeatureIDs(const bool bValue)
 	m_pFaceWidget->setDisplayFeatureIDs(bValue);
 }
 
+// +-----------------------------------------------------------
+bool f3::ChildWindow::batchedRendering() const
+{
+	return m_pFaceWidget->batchedRendering();
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::setBatchedRendering(const bool bValue)
+{
+	m_pFaceWidget->setBatchedRendering(bValue);
+}
+
 // +-----------------------------------------------------------
 const QList<f3::FaceFeatureNode*>& f3::ChildWindow::getFaceFeatures() const
 {
@@ -313,33 +936,44 @@ void f3::ChildWindow::setContextMenu(QMenu *pMenu)
 // +-----------------------------------------------------------
 void f3::ChildWindow::addFeature(const QPoint &oPos)
 {
-	FaceFeatureNode *pNode = m_pFaceWidget->addFaceFeature(oPos, true);
-	m_pFaceDatasetModel->addFeature(pNode->getID(), pNode->x(), pNode->y());
-	onDataChanged();
+	QPointF oScenePos = m_pFaceWidget->mapToScene(m_pFaceWidget->mapFromGlobal(oPos));
+	pushUndoCommand(new AddFeatureCommand(this, m_pFaceDatasetModel->numFeatures(), oScenePos));
 }
 
 // +-----------------------------------------------------------
 void f3::ChildWindow::removeSelectedFeatures()
 {
-	bool bUpdated = false;
-	QList<FaceFeatureNode*> lsFeats = m_pFaceWidget->getSelectedFeatures();
-	foreach(FaceFeatureNode *pNode, lsFeats)
-	{
-		m_pFaceDatasetModel->removeFeature(pNode->getID());
-		m_pFaceWidget->removeFaceFeature(pNode);
-		bUpdated = true;
-	}
-	if(bUpdated)
+	QList<int> lIndexes;
+	foreach(FaceFeatureNode *pNode, m_pFaceWidget->getSelectedFeatures())
+		lIndexes.append(pNode->getID());
+	if(lIndexes.isEmpty())
+		return;
+	qSort(lIndexes);
+
+	// The positions of the features in all images and their connections are kept for undo
+	QList<vector<Point2f> > lPositions;
+	QList<QPair<int, int> > lConnections;
+	const FaceFeatureConnections &oConnections = m_pFaceDatasetModel->connections();
+	foreach(int iIndex, lIndexes)
 	{
-		updateFeaturesInDataset();
-		onDataChanged();
+		lPositions.append(m_pFaceDatasetModel->getFeaturePositions(iIndex));
+
+		// Connections between two removed features are included only once (from the lowest one)
+		vector<int> vNeighbours = oConnections.neighbours(iIndex);
+		for(unsigned int i = 0; i < vNeighbours.size(); i++)
+		{
+			if(vNeighbours[i] > iIndex || qBinaryFind(lIndexes, vNeighbours[i]) == lIndexes.constEnd())
+				lConnections.append(qMakePair(iIndex, vNeighbours[i]));
+		}
 	}
+
+	pushUndoCommand(new RemoveFeaturesCommand(this, lIndexes, lPositions, lConnections));
 }
 
 // +-----------------------------------------------------------
 void f3::ChildWindow::connectFeatures()
 {
-	bool bUpdated = false;
+	QList<QPair<int, int> > lConnections;
 	QList<FaceFeatureNode*> lsFeats = m_pFaceWidget->getSelectedFeatures();
 	QList<FaceFeatureNode*>::iterator oFirst, oSecond;
 
@@ -347,18 +981,18 @@ void f3::ChildWindow::connectFeatures()
 	{
 		for(oSecond = oFirst + 1; oSecond != lsFeats.end(); oSecond++)
 		{
-			m_pFaceWidget->connectFaceFeatures(*oFirst, *oSecond);
-			bUpdated = true;
+			if(!m_pFaceDatasetModel->connections().isConnected((*oFirst)->getID(), (*oSecond)->getID()))
+				lConnections.append(qMakePair((*oFirst)->getID(), (*oSecond)->getID()));
 		}
 	}
-	if(bUpdated)
-		onDataChanged();
+	if(!lConnections.isEmpty())
+		pushUndoCommand(new ConnectFeaturesCommand(this, lConnections, true));
 }
 
 // +-----------------------------------------------------------
 void f3::ChildWindow::disconnectFeatures()
 {
-	bool bUpdated = false;
+	QList<QPair<int, int> > lConnections;
 	QList<FaceFeatureNode*> lsFeats = m_pFaceWidget->getSelectedFeatures();
 	QList<FaceFeatureNode*>::iterator oFirst, oSecond;
 
@@ -366,10 +1000,190 @@ void f3::ChildWindow::disconnectFeatures()
 	{
 		for(oSecond = oFirst + 1; oSecond != lsFeats.end(); oSecond++)
 		{
-			m_pFaceWidget->disconnectFaceFeatures(*oFirst, *oSecond);
-			bUpdated = true;
+			if(m_pFaceDatasetModel->connections().isConnected((*oFirst)->getID(), (*oSecond)->getID()))
+				lConnections.append(qMakePair((*oFirst)->getID(), (*oSecond)->getID()));
 		}
 	}
-	if(bUpdated)
-		onDataChanged();
+	if(!lConnections.isEmpty())
+		pushUndoCommand(new ConnectFeaturesCommand(this, lConnections, false));
+}
+
+// +-----------------------------------------------------------
+QUndoStack* f3::ChildWindow::undoStack() const
+{
+	return m_pUndoStack;
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::pushUndoCommand(UndoCommand *pCommand)
+{
+	m_pUndoStack->push(new UndoStackEntry(shared_ptr<UndoCommand>(pCommand)));
+
+	// Find the oldest command that fits in the memory limit with the newer ones (the stack has
+	// no commands to redo after a push)
+	qint64 iTotal = 0;
+	int iFirst = m_pUndoStack->count() - 1;
+	for(; iFirst >= 0; iFirst--)
+	{
+		iTotal += static_cast<const UndoStackEntry*>(m_pUndoStack->command(iFirst))->command()->cost();
+		if(iTotal > (qint64) UNDO_MEMORY_LIMIT * 1024)
+			break;
+	}
+	iFirst = qMin(iFirst + 1, m_pUndoStack->count() - 1);
+	if(iFirst <= 0)
+		return;
+
+	// QUndoStack can not discard its oldest commands, so it is rebuilt with the newest ones
+	vector<shared_ptr<UndoCommand> > vKept;
+	for(int i = iFirst; i < m_pUndoStack->count(); i++)
+		vKept.push_back(static_cast<const UndoStackEntry*>(m_pUndoStack->command(i))->command());
+
+	m_pUndoStack->clear();
+	for(unsigned int i = 0; i < vKept.size(); i++)
+	{
+		UndoStackEntry *pEntry = new UndoStackEntry(vKept[i], true);
+		m_pUndoStack->push(pEntry);
+		pEntry->setPushed();
+	}
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::setFeaturePositions(const int iImage, const QList<int> &lIndexes, const QList<QPointF> &lPositions)
+{
+	vector<FaceFeature*> vFeats = m_pFaceDatasetModel->getFeatures(iImage);
+	for(int i = 0; i < lIndexes.size(); i++)
+	{
+		if(lIndexes[i] < (int) vFeats.size())
+		{
+			vFeats[lIndexes[i]]->x = lPositions[i].x();
+			vFeats[lIndexes[i]]->y = lPositions[i].y();
+		}
+	}
+
+	// Display the image changed, so the user sees what was undone or redone
+	if(iImage != m_iCurrentImage)
+		m_pFaceSelectionModel->setCurrentIndex(m_pFaceDatasetModel->index(iImage, 0), QItemSelectionModel::ClearAndSelect);
+	else
+		refreshFeaturesInWidget(lIndexes);
+	onDataChanged();
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::appendFeature(const QPointF &oPos)
+{
+	int iIndex = m_pFaceDatasetModel->numFeatures();
+	m_pFaceDatasetModel->addFeature(iIndex, oPos.x(), oPos.y());
+	if(m_pFaceWidget->getFaceFeatures().size() == iIndex)
+		m_pFaceWidget->insertFaceFeature(iIndex, oPos);
+	refreshFeaturesInWidget();
+	onDataChanged();
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::removeFeatures(const QList<int> &lIndexes)
+{
+	// The nodes are only removed individually (keeping the connections of the others) if the
+	// editor is in sync with the dataset
+	const QList<FaceFeatureNode*> &lsNodes = m_pFaceWidget->getFaceFeatures();
+	bool bInSync = lsNodes.size() == m_pFaceDatasetModel->numFeatures();
+	if(bInSync)
+	{
+		QList<FaceFeatureNode*> lRemoved;
+		foreach(int iIndex, lIndexes)
+			lRemoved.append(lsNodes[iIndex]);
+		m_pFaceWidget->removeFaceFeatures(lRemoved);
+	}
+	m_pFaceDatasetModel->removeFeatures(lIndexes);
+	refreshFeaturesInWidget();
+	if(!bInSync)
+		refreshConnectionsInWidget();
+	onDataChanged();
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::insertFeatures(const QList<int> &lIndexes, const QList<vector<Point2f> > &lPositions, const QList<QPair<int, int> > &lConnections)
+{
+	bool bInSync = m_pFaceWidget->getFaceFeatures().size() == m_pFaceDatasetModel->numFeatures();
+	for(int i = 0; i < lIndexes.size(); i++)
+	{
+		m_pFaceDatasetModel->insertFeature(lIndexes[i], lIndexes[i], lPositions[i]);
+		if(bInSync)
+			m_pFaceWidget->insertFaceFeature(lIndexes[i], QPointF());
+	}
+	refreshFeaturesInWidget();
+	if(!bInSync)
+		refreshConnectionsInWidget();
+	setConnections(lConnections, true);
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::setConnections(const QList<QPair<int, int> > &lConnections, const bool bConnect)
+{
+	const QList<FaceFeatureNode*> &lsNodes = m_pFaceWidget->getFaceFeatures();
+	typedef QPair<int, int> Connection;
+
+	// The editor updates its batched rendering only once, after all the connections are changed
+	m_pFaceWidget->beginBulkUpdate();
+	foreach(Connection oConnection, lConnections)
+	{
+		if(oConnection.first >= lsNodes.size() || oConnection.second >= lsNodes.size())
+			continue;
+
+		// The connections are kept in the dataset, and mirrored in the editor
+		if(bConnect)
+		{
+			m_pFaceDatasetModel->connectFeatures(oConnection.first, oConnection.second);
+			m_pFaceWidget->connectFaceFeatures(lsNodes[oConnection.first], lsNodes[oConnection.second]);
+		}
+		else
+		{
+			m_pFaceDatasetModel->disconnectFeatures(oConnection.first, oConnection.second);
+			m_pFaceWidget->disconnectFaceFeatures(lsNodes[oConnection.first], lsNodes[oConnection.second]);
+		}
+	}
+	m_pFaceWidget->endBulkUpdate();
+	onDataChanged();
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::setEmotionLabel(const int iImage, const EmotionLabel eLabel)
+{
+	m_pFaceDatasetModel->setEmotionLabel(iImage, eLabel);
+
+	// Display the image changed, so the user sees what was undone or redone
+	if(iImage != m_iCurrentImage)
+		m_pFaceSelectionModel->setCurrentIndex(m_pFaceDatasetModel->index(iImage, 0), QItemSelectionModel::ClearAndSelect);
+	else
+	{
+		QString sImageName = m_pFaceDatasetModel->data(m_pFaceDatasetModel->index(iImage, 0), Qt::UserRole).toString();
+		emit onUIUpdated(sImageName, eLabel, getZoomLevel());
+	}
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::setEmotionLabels(const QList<int> &lImages, const QList<EmotionLabel> &lLabels)
+{
+	m_pFaceDatasetModel->setEmotionLabels(lImages, lLabels);
+
+	int iCurrent = lImages.indexOf(m_iCurrentImage);
+	if(iCurrent != -1)
+	{
+		QString sImageName = m_pFaceDatasetModel->data(m_pFaceDatasetModel->index(m_iCurrentImage, 0), Qt::UserRole).toString();
+		emit onUIUpdated(sImageName, lLabels[iCurrent], getZoomLevel());
+	}
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::setShapes(const QList<int> &lImages, const vector<vector<Point2f> > &vShapes)
+{
+	m_pFaceDatasetModel->setShapes(lImages, vShapes);
+	if(lImages.contains(m_iCurrentImage))
+		refreshFeaturesInWidget();
+	onDataChanged();
+}
+
+// +-----------------------------------------------------------
+void f3::ChildWindow::onEmotionLabelEdited(const int iRow, const EmotionLabel eOldLabel, const EmotionLabel eNewLabel)
+{
+	pushUndoCommand(new SetEmotionLabelCommand(this, iRow, eOldLabel, eNewLabel));
 }
\ No newline at end of file
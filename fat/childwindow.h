@@ -22,9 +22,15 @@
 
 #include "facedatasetmodel.h"
 #include "facewidget.h"
+#include "taskscheduler.h"
+#include "undocommands.h"
 
 #include <QtGui>
 #include <QWidget>
+#include <QCache>
+#include <QImage>
+#include <QTimer>
+#include <QUndoStack>
 
 namespace f3
 {
@@ -35,6 +41,25 @@ namespace f3
 	{
 		Q_OBJECT
 	public:
+
+		/** Interval (in miliseconds) between the checks for autosaving the dataset. */
+		static const int AUTOSAVE_INTERVAL;
+
+		/**
+		 * Proportion of the size of the dataset file above which its journal is compacted into it
+		 * (i.e. the journal is compacted when it is bigger than 1/JOURNAL_COMPACTION_RATIO of the file).
+		 */
+		static const int JOURNAL_COMPACTION_RATIO;
+
+		/** Size (in bytes) up to which the journal of a dataset file is never compacted. */
+		static const int JOURNAL_COMPACTION_MIN_SIZE;
+
+		/** Maximum number of commands kept in the undo stack of the window. */
+		static const int UNDO_LIMIT;
+
+		/** Maximum memory (in KB) used by the commands kept in the undo stack of the window. */
+		static const int UNDO_MEMORY_LIMIT;
+
 		/**
 		 * Class constructor.
 		 * @param pParent Instance of the widget that will be the parent of this window.
@@ -63,25 +88,79 @@ namespace f3
 		QItemSelectionModel* selectionModel() const;
 
 		/**
-		 * Saves the contents of the face annotation dataset in this window to the current file
-		 * (stored in the windowFilePath property). The file is saved in the YAML format, as defined
-		 * in the FaceDataset class.
+		 * Starts saving the contents of the face annotation dataset in this window to the current file
+		 * (stored in the windowFilePath property). The saving is done in background, from a snapshot of
+		 * the dataset taken when this method is called, and its progress and conclusion are indicated by
+		 * the signals onSaveProgress and onSaveFinished.
 		 */
-		bool save(QString &sMsgError);
+		void save();
 
 		/**
-		 * Saves the contents of the face annotation dataset in this window to the given file.
-		 * The file is saved in the YAML format, as defined in the FaceDataset class.
+		 * Starts saving the contents of the face annotation dataset in this window to the given file.
+		 * The saving is done in background, as in save(). The windowFilePath property is only updated
+		 * if the saving succeeds.
+		 *
+		 * If the file is the one the dataset was loaded from (or last saved to), only the changes done
+		 * since then are appended to the journal of the file (see FaceDatasetJournal). The whole file
+		 * is only rewritten if that is not possible or if the journal became too big, in which case the
+		 * journal is compacted into the file.
 		 * @param sFileName QString with the path and name of the file to save the dataset to.
 		 */
-		bool saveToFile(const QString &sFileName, QString &sMsgError);
+		void saveToFile(const QString &sFileName);
+
+		/**
+		 * Indicates if a saving started with save() or saveToFile() is still in progress.
+		 * @return Boolean indicating if the dataset is being saved or not.
+		 */
+		bool isSaving() const;
+
+		/**
+		 * Waits until the saving in progress (if any) is concluded. The events of the application
+		 * continue to be processed while waiting, so the GUI remains responsive.
+		 * @param sMsgError QString to receive the error message in case the last saving failed.
+		 * @return Boolean indicating if the last saving succeeded (true) or failed (false).
+		 */
+		bool waitForSave(QString &sMsgError);
+
+		/**
+		 * Indicates if there is an autosaved copy of the dataset newer than the dataset file (i.e.
+		 * if the application was not properly closed after the dataset was changed).
+		 * @return Boolean indicating if there is an autosaved copy that can be recovered.
+		 */
+		bool hasAutosave() const;
 
 		/**
-		 * Loads the contents of the face annotation dataset from the given file into this window.
-		 * The file must be in the YAML format, as defined in the FaceDataset class.
+		 * Loads the autosaved copy of the dataset in place of the contents loaded from the dataset file.
+		 * The window is marked as modified, so the user can save the recovered contents.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the recovery was successful (true) of failed (false).
+		 */
+		bool recoverAutosave(QString &sMsgError);
+
+		/**
+		 * Removes the autosaved copy of the dataset (if it exists).
+		 */
+		void discardAutosave();
+
+		/**
+		 * Starts loading the contents of the face annotation dataset from the given file into this window.
+		 * The loading is done in background, and the samples are displayed as they are read. Its progress
+		 * and conclusion are indicated by the signals onLoadProgress and onLoadFinished.
 		 * @param sFileName QString with the path and name of the file to load the dataset from.
 		 */
-		bool loadFromFile(const QString &sFileName, QString &sMsgError);
+		void loadFromFile(const QString &sFileName);
+
+		/**
+		 * Indicates if a loading started with loadFromFile() is still in progress. The dataset must
+		 * not be edited while it is being loaded.
+		 * @return Boolean indicating if the dataset is being loaded or not.
+		 */
+		bool isLoading() const;
+
+		/**
+		 * Cancels the loading in progress (if any).
+		 */
+		void cancelLoading();
 
 		/**
 		 * Sets the zoom level of the image in display in terms of the steps defined in the zoom
@@ -108,11 +187,33 @@ namespace f3
 		void zoomOut();
 
 		/**
-		 * Updates the emotion label of the face current selected.
-		 * @param eLabel EmotionLabel with the new emotion label for the current face image.
+		 * Updates the emotion label of the face images selected (or of the current one, if only
+		 * it is selected). The labels of several images are changed at once, with a single undoable
+		 * command.
+		 * @param eLabel EmotionLabel with the new emotion label for the face images.
 		 */
 		void updateEmotionLabel(const EmotionLabel eLabel);
 
+		/**
+		 * Gets the indexes of the face images selected in the list of images (or the current
+		 * one, if no image is selected).
+		 * @return QList with the indexes of the face images, in ascending order.
+		 */
+		QList<int> getSelectedImages() const;
+
+		/**
+		 * Applies an affine transform to the features of the face images selected, in a single
+		 * undoable command. See FaceDataset::transformFeatures().
+		 * @param oTransform 2x3 cv::Mat with the affine transform.
+		 */
+		void transformFeatures(const cv::Mat &oTransform);
+
+		/**
+		 * Copies the positions of the features of the current face image to the other face images
+		 * selected, in a single undoable command.
+		 */
+		void copyFeatures();
+
 		/**
 		 * Indicates if the face feature nodes are on display.
 		 * @return Boolean indicating if the face feature nodes are being displayed or not.
@@ -149,6 +250,18 @@ namespace f3
 		 */
 		void setDisplayFeatureIDs(const bool bValue);
 
+		/**
+		 * Indicates if the face feature nodes and edges are drawn in batch.
+		 * @return Boolean indicating if the batched rendering is in use or not.
+		 */
+		bool batchedRendering() const;
+
+		/**
+		 * Updates the indication on if the face feature nodes and edges shall be drawn in batch.
+		 * @param bValue Boolean with the new value (true means to draw in batch, false means to draw individually).
+		 */
+		void setBatchedRendering(const bool bValue);
+
 		/**
 		 * Queries the list of existing face feature nodes.
 		 * @param Const reference to the QList of existing nodes.
@@ -195,20 +308,146 @@ namespace f3
 		 */
 		void disconnectFeatures();
 
+		/**
+		 * Gets the stack of undoable commands of the edits done in this window. The commands refer
+		 * to the rows of the data model, so the stack is cleared when rows are inserted or removed.
+		 * @return Instance of the QUndoStack of this window.
+		 */
+		QUndoStack* undoStack() const;
+
+		/**
+		 * Updates the positions of the given features in the given face image, and displays it.
+		 * Used by the undo commands (see MoveFeaturesCommand).
+		 * @param iImage Integer with the index of the face image.
+		 * @param lIndexes QList with the indexes of the features to update.
+		 * @param lPositions QList with the new positions of the features.
+		 */
+		void setFeaturePositions(const int iImage, const QList<int> &lIndexes, const QList<QPointF> &lPositions);
+
+		/**
+		 * Adds a new feature at the end of the features of all face images, in the given position.
+		 * Used by the undo commands (see AddFeatureCommand).
+		 * @param oPos QPointF with the position of the new feature, in the scene coordinates of the editor.
+		 */
+		void appendFeature(const QPointF &oPos);
+
+		/**
+		 * Removes the given features from all face images. Used by the undo commands (see
+		 * RemoveFeaturesCommand and AddFeatureCommand).
+		 * @param lIndexes QList with the indexes of the features to remove, in ascending order.
+		 */
+		void removeFeatures(const QList<int> &lIndexes);
+
+		/**
+		 * Inserts the given features in all face images, and restores their connections. Used by
+		 * the undo commands (see RemoveFeaturesCommand).
+		 * @param lIndexes QList with the indexes of the features to insert, in ascending order.
+		 * @param lPositions QList with the positions of each feature in all face images.
+		 * @param lConnections QList with the connections of the features (as pairs of feature indexes).
+		 */
+		void insertFeatures(const QList<int> &lIndexes, const QList<std::vector<cv::Point2f> > &lPositions, const QList<QPair<int, int> > &lConnections);
+
+		/**
+		 * Connects or disconnects the given pairs of features. Used by the undo commands (see
+		 * ConnectFeaturesCommand).
+		 * @param lConnections QList with the connections to change (as pairs of feature indexes).
+		 * @param bConnect Boolean indicating if the features are connected (true) or disconnected (false).
+		 */
+		void setConnections(const QList<QPair<int, int> > &lConnections, const bool bConnect);
+
+		/**
+		 * Updates the emotion label of the given face image, and displays it. Used by the undo
+		 * commands (see SetEmotionLabelCommand).
+		 * @param iImage Integer with the index of the face image.
+		 * @param eLabel EmotionLabel with the new emotion label.
+		 */
+		void setEmotionLabel(const int iImage, const EmotionLabel eLabel);
+
+		/**
+		 * Updates the emotion labels of the given face images. Used by the undo commands (see
+		 * SetEmotionLabelsCommand).
+		 * @param lImages QList with the indexes of the face images.
+		 * @param lLabels QList with the new emotion label of each face image.
+		 */
+		void setEmotionLabels(const QList<int> &lImages, const QList<EmotionLabel> &lLabels);
+
+		/**
+		 * Updates the positions of all features of the given face images. Used by the undo
+		 * commands (see SetShapesCommand).
+		 * @param lImages QList with the indexes of the face images.
+		 * @param vShapes Vector with the new shape of each face image.
+		 */
+		void setShapes(const QList<int> &lImages, const std::vector<std::vector<cv::Point2f> > &vShapes);
+
 	protected:
 
 		/**
 		 * Refreshes the positions of face features in the editor based on the values in the dataset.
+		 * The nodes are moved in a bulk update of the editor, so their edges are adjusted only once.
+		 * @param lIndexes QList with the indexes of the features to refresh. If it is empty (the
+		 * default), all features are refreshed (i.e. when the current image changes).
 		 */
-		void refreshFeaturesInWidget();
+		void refreshFeaturesInWidget(const QList<int> &lIndexes = QList<int>());
 
 		/**
 		 * Updates the positions of face features in the dataset based on the values in the editor.
+		 * Only the nodes changed by the user since the last update are considered (see
+		 * FaceWidget::takeChangedFeatures()).
 		 */
 		void updateFeaturesInDataset();
 
+		/**
+		 * Requests the image of the given row to be decoded in background (unless it is already
+		 * cached). The decoded image is stored in the cache and displayed if its row is the current one.
+		 * If the image is already being decoded (i.e. prefetched), that decoding is used instead of a
+		 * new one, and it is only scheduled again if it has not started yet and the new priority is higher.
+		 * @param iRow Integer with the row of the face image in the data model.
+		 * @param ePriority Priority of the background task that decodes the image.
+		 * @param sKey QString with the identity of the request. A new request with the same key
+		 * cancels the previous one if it has not yet finished (unless the same image was requested
+		 * again with another key).
+		 */
+		void requestImage(const int iRow, const TaskScheduler::Priority ePriority, const QString &sKey);
+
+		/**
+		 * Gets the name of the file used to autosave the dataset (a sidecar file stored alongside the
+		 * dataset file). In the paging mode, only the changes not yet saved are autosaved, to the
+		 * journal of that file (see FaceDatasetJournal::fileName()). The shards of a sharded dataset
+		 * are listed in another sidecar file (see autosaveShardsFileName()).
+		 * @return QString with the path and name of the autosave file.
+		 */
+		QString autosaveFileName() const;
+
+		/**
+		 * Gets the name of the file that lists the shards of the autosaved copy of a sharded dataset,
+		 * so the copy is recovered with the same shards (and not as a single dataset file).
+		 * @return QString with the path and name of the file with the list of shards.
+		 */
+		QString autosaveShardsFileName() const;
+
+		/**
+		 * Displays the given decoded image in the face features editor (or the broken image icon
+		 * if the image could not be decoded).
+		 * @param oImage QImage with the decoded image to display.
+		 */
+		void displayImage(const QImage &oImage);
+
+		/**
+		 * Pushes the given command to the undo stack (which executes it). If the commands in the
+		 * stack then use more memory than UNDO_MEMORY_LIMIT, the oldest ones are discarded (the
+		 * newest command is always kept).
+		 * @param pCommand Instance of the UndoCommand to push. The window takes its ownership.
+		 */
+		void pushUndoCommand(UndoCommand *pCommand);
+
 	protected slots:
 
+		/**
+		 * Rebuilds the face feature edges in the editor from the connections in the dataset (i.e.
+		 * when the dataset is loaded).
+		 */
+		void refreshConnectionsInWidget();
+
 		/**
 		 * Captures the indication of changes in the image scale factor (zoom).
 		 * @param dScaleFactor Double with the new scale factor for the image.
@@ -233,6 +472,44 @@ namespace f3
 		 */
 		void onCurrentChanged(const QModelIndex &oCurrent, const QModelIndex &oPrevious);
 
+		/**
+		 * Captures the removal of rows from the data model, to shift the index of the current image
+		 * when rows before it are removed (the selection model does not signal it in that case).
+		 * @param oParent QModelIndex with the parent of the rows removed (unused).
+		 * @param iFirst Integer with the index of the first row removed.
+		 * @param iLast Integer with the index of the last row removed.
+		 */
+		void onRowsRemoved(const QModelIndex &oParent, int iFirst, int iLast);
+
+		/**
+		 * Captures the timeout of the autosave timer, to autosave the dataset in background if it was
+		 * changed since the last autosave.
+		 */
+		void onAutosaveTimeout();
+
+		/**
+		 * Captures the progress of the loading of the dataset, to select the first image as soon
+		 * as it is available.
+		 * @param iPercent Integer with the percentage of the file read (in range [0, 100]).
+		 */
+		void onDatasetLoadProgress(const int iPercent);
+
+		/**
+		 * Captures the conclusion of the loading of the dataset.
+		 * @param bSuccess Boolean indicating if the loading succeeded (true) or failed (false).
+		 * @param sMsgError QString with the error message in case the loading failed.
+		 */
+		void onDatasetLoadFinished(const bool bSuccess, const QString sMsgError);
+
+		/**
+		 * Captures the edition of the emotion label of a face image in the data model, to record
+		 * it in the undo stack.
+		 * @param iRow Integer with the row of the face image.
+		 * @param eOldLabel EmotionLabel with the label before the edition.
+		 * @param eNewLabel EmotionLabel with the label after the edition.
+		 */
+		void onEmotionLabelEdited(const int iRow, const EmotionLabel eOldLabel, const EmotionLabel eNewLabel);
+
 	signals:
 
 		/**
@@ -254,8 +531,49 @@ namespace f3
 		 */
 		void onUIUpdated(const QString sImageName, const EmotionLabel eEmotion, const int iZoomLevel);
 
+		/**
+		 * Signal to indicate the progress of the saving started with save() or saveToFile().
+		 * @param iPercent Integer with the percentage of the saving concluded (in range [0, 100]).
+		 */
+		void onSaveProgress(const int iPercent);
+
+		/**
+		 * Signal to indicate the conclusion of the saving started with save() or saveToFile().
+		 * @param bSuccess Boolean indicating if the saving succeeded (true) or failed (false).
+		 * @param sMsgError QString with the error message in case the saving failed.
+		 */
+		void onSaveFinished(const bool bSuccess, const QString sMsgError);
+
+		/**
+		 * Signal to indicate the progress of the loading started with loadFromFile().
+		 * @param iPercent Integer with the percentage of the file read (in range [0, 100]).
+		 */
+		void onLoadProgress(const int iPercent);
+
+		/**
+		 * Signal to indicate the conclusion of the loading started with loadFromFile().
+		 * @param bSuccess Boolean indicating if the loading succeeded (true) or failed (false).
+		 * @param sMsgError QString with the error message in case the loading failed.
+		 */
+		void onLoadFinished(const bool bSuccess, const QString sMsgError);
+
 	private:
 
+		/**
+		 * Decoding of a face image in background, requested by requestImage().
+		 */
+		struct ImageTask
+		{
+			/** Token used to cancel the decoding. */
+			CancellationToken oToken;
+
+			/** Priority class with which the decoding was scheduled. */
+			TaskScheduler::Priority ePriority;
+
+			/** Indication that the decoding has started (set in the background thread). */
+			QSharedPointer<QAtomicInt> pStarted;
+		};
+
 		/** Index of the current displayed face image. */
 		int m_iCurrentImage;
 
@@ -267,6 +585,39 @@ namespace f3
 
 		/** Selection model used to represent the selection of items in Qt view components such as QListView. */
 		QItemSelectionModel *m_pFaceSelectionModel;
+
+		/** Token that cancels the background tasks of this window when it is closed. */
+		CancellationToken m_oToken;
+
+		/** Cache of the decoded face images (the current and the prefetched ones), indexed by file name. */
+		QCache<QString, QImage> m_oImageCache;
+
+		/** Decodings of face images not yet finished, indexed by file name. */
+		QHash<QString, ImageTask> m_hImageTasks;
+
+		/** File names of the face images last requested with each key (see requestImage()). */
+		QHash<QString, QString> m_hImageRequests;
+
+		/** Indication that a saving is in progress. */
+		bool m_bSaving;
+
+		/** Indication that the last saving succeeded. */
+		bool m_bLastSaveOk;
+
+		/** Error message of the last saving, in case it failed. */
+		QString m_sLastSaveError;
+
+		/** Timer used to periodically autosave the dataset. */
+		QTimer m_oAutosaveTimer;
+
+		/** Indication that an autosave is in progress. */
+		bool m_bAutosaving;
+
+		/** Version of the dataset last saved or autosaved. */
+		quint64 m_iSavedVersion;
+
+		/** Stack of undoable commands of the edits done in the window. */
+		QUndoStack *m_pUndoStack;
 	};
 }
 
@@ -1,20 +1,54 @@
 #include "facedatasetmodel.h"
+#include "application.h"
 #include <assert.h>
 
 #include <QFileInfo>
 #include <QApplication>
+#include <QImageReader>
 #include <QDebug>
+#include <QPair>
+
+#include <algorithm>
+
+// +-----------------------------------------------------------
+// Size of the side of the thumbnails
+const int f3::FaceDatasetModel::THUMBNAIL_SIZE = 50;
+
+// Maximum memory used by the atlas of thumbnails (in KB): 16 MB, about 1600 thumbnails
+const int f3::FaceDatasetModel::THUMBNAIL_CACHE_SIZE = 16 * 1024;
+
+// Maximum number of thumbnails being built at the same time (about the number of thumbnails visible at once)
+const int f3::FaceDatasetModel::MAX_THUMBNAIL_REQUESTS = 64;
+
+// Maximum number of ranges of rows signalled separately when removing images (beyond it, the views
+// are rebuilt faster than they process the signals)
+const int f3::FaceDatasetModel::MAX_REMOVAL_RANGES = 32;
+
+// Minimum size of the dataset files loaded in the paging mode (in KB): 64 MB, about 100 thousand samples
+const int f3::FaceDatasetModel::PAGING_MIN_FILE_SIZE = 64 * 1024;
+
+// Memory used by the samples of the datasets loaded in the paging mode (in KB): 128 MB
+const int f3::FaceDatasetModel::PAGING_BUDGET = 128 * 1024;
 
 // +-----------------------------------------------------------
 f3::FaceDatasetModel::FaceDatasetModel(QObject *pParent):
-	QAbstractListModel(pParent)
+	QAbstractListModel(pParent),
+	m_oThumbnailAtlas(THUMBNAIL_SIZE, THUMBNAIL_CACHE_SIZE)
 {
 	m_pFaceDataset = new FaceDataset();
+	m_bLoading = false;
+
+	m_vThumbnailRequests.resize(MAX_THUMBNAIL_REQUESTS);
+	m_oThumbnailPlaceholder = QPixmap(THUMBNAIL_SIZE, THUMBNAIL_SIZE);
+	m_oThumbnailPlaceholder.fill(Qt::transparent);
+	m_lLabelNames = EmotionLabel::getLabels();
 }
 
 // +-----------------------------------------------------------
 f3::FaceDatasetModel::~FaceDatasetModel()
 {
+	m_oLoadToken.cancel();
+	m_oThumbnailToken.cancel();
 	delete m_pFaceDataset;
 }
 
@@ -68,32 +102,38 @@ QVariant f3::FaceDatasetModel::headerData(int iSection, Qt::Orientation eOrienta
 // +-----------------------------------------------------------
 QVariant f3::FaceDatasetModel::data(const QModelIndex &oIndex, int iRole) const
 {
-	FaceImage *pImage = m_pFaceDataset->getImage(oIndex.row());
-	if(!pImage)
+	if(oIndex.row() < 0 || oIndex.row() >= m_pFaceDataset->size())
 		return QVariant();
 
+	// The face images are only used for the image data, so the views do not cause the samples
+	// of a dataset loaded in the paging mode to be read
+	const FaceImage *pImage;
 	QPixmap oPixmap;
+	int iLabel;
 
 	switch(iRole)
 	{
-		// Data to be displayed on ModelViews
+		// Data to be displayed on ModelViews (the strings are precomputed, since the views query them constantly)
 		case Qt::DisplayRole:
 			switch(oIndex.column())
 			{
 				case 0: // [Image Name]
-					return QFileInfo(pImage->fileName()).baseName();
+					return m_lDisplayNames.at(oIndex.row());
 
 				case 1: // [Emotion Label Name]
-					return pImage->emotionLabel().getName();
+					iLabel = m_pFaceDataset->imageEmotionLabel(oIndex.row()).getValue();
+					if(iLabel >= 0 && iLabel < m_lLabelNames.size())
+						return m_lLabelNames.at(iLabel);
+					return m_pFaceDataset->imageEmotionLabel(oIndex.row()).getName();
 
 				default:
 					return QVariant();
 			}
 
-		// Decoration data (image thumbnails for the first column)
+		// Decoration data (image thumbnails for the first column, painted from the atlas by ThumbnailDelegate)
 		case Qt::DecorationRole:
 			if(oIndex.column() == 0)
-				return m_lCachedThumbnails[oIndex.row()];
+				return m_oThumbnailPlaceholder;
 			else
 				return QVariant();
 
@@ -102,13 +142,15 @@ QVariant f3::FaceDatasetModel::data(const QModelIndex &oIndex, int iRole) const
 			switch(oIndex.column())
 			{
 				case 0: // The complete image file name+path
-					return pImage->fileName();
+					return m_pFaceDataset->imageFileName(oIndex.row());
 
 				case 1: // The emotion label
-					return pImage->emotionLabel().getValue();
+					return m_pFaceDataset->imageEmotionLabel(oIndex.row()).getValue();
 
 				case 2: // The image data
-					oPixmap = pImage->pixMap();
+					pImage = m_pFaceDataset->getImage(oIndex.row());
+					if(pImage)
+						oPixmap = pImage->pixMap();
 					if(oPixmap.isNull())
 						oPixmap = QPixmap(":/images/brokenimage");
 					return oPixmap;
@@ -126,8 +168,7 @@ QVariant f3::FaceDatasetModel::data(const QModelIndex &oIndex, int iRole) const
 // +-----------------------------------------------------------
 bool f3::FaceDatasetModel::setData(const QModelIndex &oIndex, const QVariant &oValue, int iRole)
 {
-	FaceImage *pImage = m_pFaceDataset->getImage(oIndex.row());
-	if(!pImage)
+	if(oIndex.row() < 0 || oIndex.row() >= m_pFaceDataset->size())
 		return false;
 
 	if(iRole == Qt::UserRole)
@@ -140,8 +181,13 @@ bool f3::FaceDatasetModel::setData(const QModelIndex &oIndex, const QVariant &oV
 				return false;
 
 			case 1: // [Emotion Label]
-				pImage->setEmotionLabel(EmotionLabel::fromValue(oValue.toInt()));
-				emit dataChanged(oIndex, oIndex);
+				eLabel = EmotionLabel::fromValue(oValue.toInt());
+				if(eLabel.getValue() != m_pFaceDataset->imageEmotionLabel(oIndex.row()).getValue())
+				{
+					EmotionLabel eOldLabel = m_pFaceDataset->imageEmotionLabel(oIndex.row());
+					setEmotionLabel(oIndex.row(), eLabel);
+					emit emotionLabelEdited(oIndex.row(), eOldLabel, eLabel);
+				}
 				return true;
 
 			default:
@@ -158,12 +204,11 @@ bool f3::FaceDatasetModel::loadFromFile(const QString &sFileName, QString &sMsgE
 	beginResetModel();
 	bool bRet = m_pFaceDataset->loadFromFile(sFileName, sMsgError);
 
-	// Rebuild the thumbnails cache
+	// The thumbnails are built again when first requested
 	if(bRet)
 	{
-		m_lCachedThumbnails.clear();
-		for(int i = 0; i < m_pFaceDataset->size(); i++)
-			m_lCachedThumbnails.append(buildThumbnail(i));
+		resetDisplayNames();
+		resetThumbnails();
 	}
 
 	endResetModel();
@@ -176,6 +221,341 @@ bool f3::FaceDatasetModel::saveToFile(const QString &sFileName, QString &sMsgErr
 	return m_pFaceDataset->saveToFile(sFileName, sMsgError);
 }
 
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::startLoading(const QString &sFileName, const CancellationToken &oOwner)
+{
+	cancelLoading();
+
+	beginResetModel();
+	m_pFaceDataset->clear();
+	m_lDisplayNames.clear();
+	resetThumbnails();
+	endResetModel();
+
+	m_bLoading = true;
+	m_oLoadToken = oOwner.createChild();
+
+	// The samples are read in background and sent to the GUI thread as partial results. The first
+	// batch is small, so the first images can be displayed as soon as possible
+	TaskScheduler::Task fTask = [sFileName](TaskContext &oContext) -> QVariant
+	{
+		QString sMsgError;
+
+		// The shards of a sharded dataset are loaded in parallel (each with its journal) and sent at once
+		if(FaceDatasetManifest::isManifest(sFileName))
+		{
+			FaceDataset oDataset;
+			if(!oDataset.loadFromManifest(sFileName, sMsgError))
+				return sMsgError;
+
+			oContext.reportProgress(0, QVariantList() << oDataset.numFeatures() << QString() << QVariant::fromValue(oDataset.connections()));
+			oContext.reportProgress(100, QVariant::fromValue(oDataset.images()));
+			oContext.reportProgress(100, QVariant::fromValue(oDataset.manifest()));
+			return QVariant::fromValue(QList<FaceDatasetChanges>());
+		}
+
+		// Only the index of the samples of a large file is read, and the samples are read when used
+		bool bPaged = QFileInfo(sFileName).size() >= (qint64) PAGING_MIN_FILE_SIZE * 1024;
+		auto fIndexing = [&oContext](int iPercent) -> bool
+		{
+			oContext.reportProgress(iPercent, QVariant());
+			return !oContext.isCancelled();
+		};
+
+		// A SQLite database is read in pages, as the xml file, but it has no journal to apply
+		if(FaceDatasetStore::isStore(sFileName))
+		{
+			if(bPaged)
+			{
+				std::shared_ptr<FaceDatasetPager> pPager(new FaceDatasetPager());
+				if(!pPager->open(sFileName, sMsgError, fIndexing))
+					return oContext.isCancelled() ? QVariant::fromValue(QList<FaceDatasetChanges>()) : QVariant(sMsgError);
+
+				oContext.reportProgress(100, QVariant::fromValue(pPager));
+				return QVariant::fromValue(QList<FaceDatasetChanges>());
+			}
+
+			FaceDatasetStore oStore;
+			if(!oStore.open(sFileName, sMsgError))
+				return sMsgError;
+
+			oContext.reportProgress(0, QVariantList() << oStore.numFeatures() << oStore.journalId() << QVariant::fromValue(oStore.connections()));
+
+			FaceImageBatch vBatch;
+			int iBatchSize = 16;
+			while(!oStore.atEnd() && !oContext.isCancelled())
+			{
+				if(!oStore.readBatch(iBatchSize, vBatch, sMsgError))
+					return sMsgError;
+				oContext.reportProgress(oStore.progress(), QVariant::fromValue(vBatch));
+				iBatchSize = 500;
+			}
+			return QVariant::fromValue(QList<FaceDatasetChanges>());
+		}
+
+		if(bPaged)
+		{
+			std::shared_ptr<FaceDatasetPager> pPager(new FaceDatasetPager());
+
+			// The file is read as a stream if it can not be paged (i.e. it is not encoded in UTF-8)
+			if(pPager->open(sFileName, sMsgError, fIndexing))
+			{
+				oContext.reportProgress(100, QVariant::fromValue(pPager));
+
+				QList<FaceDatasetChanges> lChanges;
+				if(!FaceDatasetJournal::read(sFileName, pPager->journalId(), lChanges, sMsgError))
+					return sMsgError;
+				return QVariant::fromValue(lChanges);
+			}
+			else if(oContext.isCancelled())
+				return QVariant::fromValue(QList<FaceDatasetChanges>());
+		}
+
+		FaceDatasetReader oReader;
+		if(!oReader.open(sFileName, sMsgError))
+			return sMsgError;
+
+		// The number of features, the journal identifier and the connections are sent before the first batch
+		oContext.reportProgress(0, QVariantList() << oReader.numFeatures() << oReader.journalId() << QVariant::fromValue(oReader.connections()));
+
+		FaceImageBatch vBatch;
+		int iBatchSize = 16;
+		while(!oReader.atEnd() && !oContext.isCancelled())
+		{
+			if(!oReader.readBatch(iBatchSize, vBatch, sMsgError))
+				return sMsgError;
+			oContext.reportProgress(oReader.progress(), QVariant::fromValue(vBatch));
+			iBatchSize = 500;
+		}
+
+		// The changes saved incrementally after the file was written are applied at the end
+		QList<FaceDatasetChanges> lChanges;
+		if(!FaceDatasetJournal::read(sFileName, oReader.journalId(), lChanges, sMsgError))
+			return sMsgError;
+		return QVariant::fromValue(lChanges);
+	};
+
+	TaskScheduler::ProgressHandler fProgress = [this](int iPercent, const QVariant &oPartial)
+	{
+		if(oPartial.type() == QVariant::List)
+		{
+			m_pFaceDataset->setNumFeatures(oPartial.toList().at(0).toInt());
+			m_pFaceDataset->setJournalId(oPartial.toList().at(1).toString());
+			m_pFaceDataset->setConnections(oPartial.toList().at(2).value<FaceFeatureConnections>());
+		}
+		else if(oPartial.userType() == qMetaTypeId<FaceDatasetManifest>())
+			m_pFaceDataset->setShards(oPartial.value<FaceDatasetManifest>());
+		else if(oPartial.userType() == qMetaTypeId<std::shared_ptr<FaceDatasetPager> >())
+		{
+			beginResetModel();
+			m_pFaceDataset->setPagingBudget((qint64) PAGING_BUDGET * 1024);
+			m_pFaceDataset->loadFromPager(oPartial.value<std::shared_ptr<FaceDatasetPager> >());
+			resetDisplayNames();
+			resetThumbnails();
+			endResetModel();
+		}
+		else if(oPartial.isValid())
+			insertBatch(oPartial.value<FaceImageBatch>());
+		emit loadProgress(iPercent);
+	};
+
+	TaskScheduler::CompletionHandler fDone = [this](const QVariant &oResult)
+	{
+		m_bLoading = false;
+
+		// The result is invalid if the task failed unexpectedly (i.e. with an exception)
+		bool bSuccess = oResult.userType() == qMetaTypeId<QList<FaceDatasetChanges> >();
+		QString sMsgError = bSuccess ? QString() : oResult.toString();
+		if(bSuccess)
+			bSuccess = applyJournal(oResult.value<QList<FaceDatasetChanges> >(), sMsgError);
+		else if(sMsgError.isEmpty())
+			sMsgError = tr("erro inesperado durante a leitura do arquivo");
+
+		// Applying the journal reads the samples in the paging mode, which can also fail
+		if(bSuccess && !m_pFaceDataset->pagingError().isEmpty())
+		{
+			bSuccess = false;
+			sMsgError = m_pFaceDataset->pagingError();
+		}
+
+		m_pFaceDataset->markSaved();
+		emit loadFinished(bSuccess, sMsgError);
+	};
+
+	F3Application::scheduler()->schedule(TaskScheduler::VisibleNow, fTask, fDone, m_oLoadToken, "", fProgress);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::cancelLoading()
+{
+	if(!m_bLoading)
+		return;
+
+	m_oLoadToken.cancel();
+	m_bLoading = false;
+	emit loadFinished(false, tr("o carregamento foi cancelado"));
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetModel::isLoading() const
+{
+	return m_bLoading;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::insertBatch(const FaceImageBatch &vBatch)
+{
+	if(vBatch.empty())
+		return;
+
+	int iFirst = m_pFaceDataset->size();
+	beginInsertRows(QModelIndex(), iFirst, iFirst + (int) vBatch.size() - 1);
+	m_pFaceDataset->appendImages(vBatch);
+	m_lDisplayNames.reserve(m_pFaceDataset->size());
+	m_vThumbnailSlots.reserve(m_pFaceDataset->size());
+	for(int i = iFirst; i < m_pFaceDataset->size(); i++)
+	{
+		m_lDisplayNames.append(displayName(m_pFaceDataset->imageFileName(i)));
+		m_vThumbnailSlots.append(-1);
+	}
+	endInsertRows();
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetModel::applyJournal(const QList<FaceDatasetChanges> &lChanges, QString &sMsgError)
+{
+	if(lChanges.isEmpty())
+		return true;
+
+	bool bRet = true;
+	beginResetModel();
+	foreach(FaceDatasetChanges oChanges, lChanges)
+	{
+		if(!m_pFaceDataset->applyChanges(oChanges))
+		{
+			sMsgError = tr("o diário de alterações do arquivo não corresponde ao conjunto de dados");
+			bRet = false;
+			break;
+		}
+	}
+
+	resetDisplayNames();
+	resetThumbnails();
+	endResetModel();
+
+	return bRet;
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetSnapshot f3::FaceDatasetModel::snapshot() const
+{
+	return m_pFaceDataset->snapshot();
+}
+
+// +-----------------------------------------------------------
+quint64 f3::FaceDatasetModel::version() const
+{
+	return m_pFaceDataset->version();
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetModel::canSaveIncrementally() const
+{
+	return m_pFaceDataset->canSaveIncrementally();
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetSnapshot f3::FaceDatasetModel::prepareFullSave()
+{
+	return m_pFaceDataset->prepareFullSave();
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetChanges f3::FaceDatasetModel::prepareIncrementalSave()
+{
+	return m_pFaceDataset->prepareIncrementalSave();
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetChanges f3::FaceDatasetModel::pendingChanges() const
+{
+	return m_pFaceDataset->pendingChanges();
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetModel::restoreChanges(const FaceDatasetChanges &oChanges, QString &sMsgError)
+{
+	beginResetModel();
+	bool bRet = m_pFaceDataset->restoreChanges(oChanges);
+	if(!bRet)
+		sMsgError = tr("as alterações recuperadas não correspondem ao conjunto de dados");
+	resetDisplayNames();
+	resetThumbnails();
+	endResetModel();
+
+	return bRet;
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetModel::journalId() const
+{
+	return m_pFaceDataset->journalId();
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetManifest f3::FaceDatasetModel::prepareShardedSave(const QString &sFileName)
+{
+	return m_pFaceDataset->prepareShardedSave(sFileName);
+}
+
+// +-----------------------------------------------------------
+f3::FaceDatasetManifest f3::FaceDatasetModel::manifest() const
+{
+	return m_pFaceDataset->manifest();
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetModel::setShards(const FaceDatasetManifest &oManifest)
+{
+	return m_pFaceDataset->setShards(oManifest);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::finishSave(const bool bSuccess, const std::shared_ptr<FaceDatasetPager> &pPager)
+{
+	m_pFaceDataset->finishSave(bSuccess, pPager);
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetModel::isPaged() const
+{
+	return m_pFaceDataset->isPaged();
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::evictColdPages()
+{
+	m_pFaceDataset->evictColdPages();
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetModel::pagingError() const
+{
+	return m_pFaceDataset->pagingError();
+}
+
+// +-----------------------------------------------------------
+std::shared_ptr<f3::FaceDatasetPager> f3::FaceDatasetModel::pager() const
+{
+	return m_pFaceDataset->pager();
+}
+
+// +-----------------------------------------------------------
+int f3::FaceDatasetModel::numPagedChanges() const
+{
+	return m_pFaceDataset->numPagedChanges();
+}
+
 // +-----------------------------------------------------------
 bool f3::FaceDatasetModel::addImages(const QStringList &lImageFiles)
 {
@@ -185,7 +565,8 @@ bool f3::FaceDatasetModel::addImages(const QStringList &lImageFiles)
 	for(int i = 0; i < lImageFiles.size(); i++)
 	{
 		m_pFaceDataset->addImage(lImageFiles[i]);
-		m_lCachedThumbnails.append(buildThumbnail(m_pFaceDataset->size() - 1));
+		m_lDisplayNames.append(displayName(m_pFaceDataset->imageFileName(m_pFaceDataset->size() - 1)));
+		m_vThumbnailSlots.append(-1);
 	}
 	endInsertRows();
 	return true;
@@ -194,15 +575,81 @@ bool f3::FaceDatasetModel::addImages(const QStringList &lImageFiles)
 // +-----------------------------------------------------------
 bool f3::FaceDatasetModel::removeImages(const QList<int> &lImageIndexes)
 {
-	int iFirst = lImageIndexes.first();
-	int iLast = lImageIndexes.last();
-	beginRemoveRows(QModelIndex(), iFirst, iLast);
-	for(int i = lImageIndexes.size() - 1; i >= 0; i--)
+	std::vector<int> vIndexes = lImageIndexes.toVector().toStdVector();
+	std::sort(vIndexes.begin(), vIndexes.end());
+	vIndexes.erase(std::unique(vIndexes.begin(), vIndexes.end()), vIndexes.end());
+	if(vIndexes.empty() || vIndexes.front() < 0 || vIndexes.back() >= rowCount())
+		return false;
+
+	// Group the indexes in contiguous ranges of rows
+	QList<QPair<int, int>> lRanges;
+	for(unsigned int i = 0; i < vIndexes.size(); i++)
 	{
-		m_pFaceDataset->removeImage(lImageIndexes[i]);
-		m_lCachedThumbnails.removeAt(lImageIndexes[i]);
+		if(!lRanges.isEmpty() && lRanges.last().second == vIndexes[i] - 1)
+			lRanges.last().second = vIndexes[i];
+		else
+			lRanges.append(qMakePair(vIndexes[i], vIndexes[i]));
 	}
-	endRemoveRows();
+
+	if(lRanges.size() <= MAX_REMOVAL_RANGES)
+	{
+		// Each range is removed with its own signals, from the last to the first so the
+		// ranges not yet removed keep their row indexes
+		for(int i = lRanges.size() - 1; i >= 0; i--)
+		{
+			int iFirst = lRanges[i].first;
+			int iLast = lRanges[i].second;
+			beginRemoveRows(QModelIndex(), iFirst, iLast);
+
+			std::vector<int> vRange;
+			for(int j = iFirst; j <= iLast; j++)
+			{
+				vRange.push_back(j);
+				if(m_vThumbnailSlots[j] != -1)
+					m_oThumbnailAtlas.release(m_vThumbnailSlots[j]);
+			}
+			m_pFaceDataset->removeImages(vRange);
+			m_lDisplayNames.erase(m_lDisplayNames.begin() + iFirst, m_lDisplayNames.begin() + iLast + 1);
+			m_vThumbnailSlots.remove(iFirst, iLast - iFirst + 1);
+
+			endRemoveRows();
+		}
+	}
+	else
+	{
+		// The rows are too scattered, so the storage is compacted in a single pass and the views
+		// are rebuilt once, instead of shifting the rows after each range
+		beginResetModel();
+		m_pFaceDataset->removeImages(vIndexes);
+
+		QStringList lDisplayNames;
+		lDisplayNames.reserve(m_lDisplayNames.size() - (int) vIndexes.size());
+		int iNext = 0;
+		unsigned int iRemoved = 0;
+		for(int i = 0; i < m_vThumbnailSlots.size(); i++)
+		{
+			if(iRemoved < vIndexes.size() && vIndexes[iRemoved] == i)
+			{
+				if(m_vThumbnailSlots[i] != -1)
+					m_oThumbnailAtlas.release(m_vThumbnailSlots[i]);
+				iRemoved++;
+			}
+			else
+			{
+				lDisplayNames.append(m_lDisplayNames[i]);
+				m_vThumbnailSlots[iNext++] = m_vThumbnailSlots[i];
+			}
+		}
+		m_lDisplayNames.swap(lDisplayNames);
+		m_vThumbnailSlots.resize(iNext);
+
+		endResetModel();
+	}
+
+	// The thumbnails of the rows after the first one removed changed owners
+	for(int i = vIndexes.front(); i < m_vThumbnailSlots.size(); i++)
+		if(m_vThumbnailSlots[i] != -1)
+			m_oThumbnailAtlas.setOwner(m_vThumbnailSlots[i], i);
 	return true;
 }
 
@@ -218,6 +665,104 @@ void f3::FaceDatasetModel::removeFeature(const int iIndex)
 	m_pFaceDataset->removeFeature(iIndex);
 }
 
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::removeFeatures(const QList<int> &lIndexes)
+{
+	m_pFaceDataset->removeFeatures(lIndexes.toVector().toStdVector());
+}
+
+// +-----------------------------------------------------------
+const f3::FaceImage* f3::FaceDatasetModel::getImage(const int iIndex) const
+{
+	return m_pFaceDataset->getImage(iIndex);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::insertFeature(const int iIndex, int iID, const std::vector<cv::Point2f> &vPositions)
+{
+	m_pFaceDataset->insertFeature(iIndex, iID, vPositions);
+}
+
+// +-----------------------------------------------------------
+std::vector<cv::Point2f> f3::FaceDatasetModel::getFeaturePositions(const int iIndex) const
+{
+	return m_pFaceDataset->getFeaturePositions(iIndex);
+}
+
+// +-----------------------------------------------------------
+const f3::FaceFeatureConnections& f3::FaceDatasetModel::connections() const
+{
+	return m_pFaceDataset->connections();
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::connectFeatures(const int iFirst, const int iSecond)
+{
+	m_pFaceDataset->connectFeatures(iFirst, iSecond);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::disconnectFeatures(const int iFirst, const int iSecond)
+{
+	m_pFaceDataset->disconnectFeatures(iFirst, iSecond);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::setEmotionLabel(const int iRow, const EmotionLabel eLabel)
+{
+	FaceImage *pImage = m_pFaceDataset->editImage(iRow);
+	if(!pImage)
+		return;
+
+	pImage->setEmotionLabel(eLabel);
+	QModelIndex oIndex = index(iRow, 1);
+	emit dataChanged(oIndex, oIndex);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::setEmotionLabels(const QList<int> &lRows, const QList<EmotionLabel> &lLabels)
+{
+	int iFirst = -1, iLast = -1;
+	for(int i = 0; i < lRows.size() && i < lLabels.size(); i++)
+	{
+		FaceImage *pImage = m_pFaceDataset->editImage(lRows[i]);
+		if(!pImage)
+			continue;
+
+		pImage->setEmotionLabel(lLabels[i]);
+		iFirst = iFirst == -1 ? lRows[i] : qMin(iFirst, lRows[i]);
+		iLast = qMax(iLast, lRows[i]);
+	}
+
+	// A single signal covers all rows changed, instead of one signal for each of them
+	if(iFirst != -1)
+		emit dataChanged(index(iFirst, 1), index(iLast, 1));
+}
+
+// +-----------------------------------------------------------
+std::vector<std::vector<cv::Point2f> > f3::FaceDatasetModel::getShapes(const QList<int> &lRows) const
+{
+	return m_pFaceDataset->getShapes(lRows.toVector().toStdVector());
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetModel::setShapes(const QList<int> &lRows, const std::vector<std::vector<cv::Point2f> > &vShapes)
+{
+	return m_pFaceDataset->setShapes(lRows.toVector().toStdVector(), vShapes);
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetModel::transformFeatures(const QList<int> &lRows, const cv::Mat &oTransform)
+{
+	return m_pFaceDataset->transformFeatures(lRows.toVector().toStdVector(), oTransform);
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceDatasetModel::copyFeatures(const int iSource, const QList<int> &lRows)
+{
+	return m_pFaceDataset->copyFeatures(iSource, lRows.toVector().toStdVector());
+}
+
 // +-----------------------------------------------------------
 std::vector<f3::FaceFeature*> f3::FaceDatasetModel::getFeatures(const int iIndex)
 {
@@ -231,17 +776,95 @@ int f3::FaceDatasetModel::numFeatures() const
 }
 
 // +-----------------------------------------------------------
-QPixmap f3::FaceDatasetModel::buildThumbnail(const int iIndex)
+bool f3::FaceDatasetModel::thumbnailRegion(const int iIndex, QPixmap &oPage, QRect &oRegion) const
 {
-	QPixmap oImage;
-	FaceImage *pImage = m_pFaceDataset->getImage(iIndex);
-	if(!pImage)
-		oImage = QPixmap(":/images/imagemissing");
-	else
-		oImage = pImage->pixMap();
+	if(iIndex < 0 || iIndex >= m_pFaceDataset->size())
+		return false;
+
+	int iSlot = m_vThumbnailSlots[iIndex];
+	if(iSlot == -1)
+	{
+		requestThumbnail(iIndex, m_pFaceDataset->imageFileName(iIndex));
+		return false;
+	}
+
+	m_oThumbnailAtlas.touch(iSlot);
+	oPage = m_oThumbnailAtlas.page(iSlot);
+	oRegion = m_oThumbnailAtlas.region(iSlot);
+	return true;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::requestThumbnail(const int iIndex, const QString &sFileName) const
+{
+	// Each row uses a request slot, so while scrolling fast the requests of the rows that are not visible
+	// anymore are replaced by the new ones (the scheduler cancels a task when another takes its key)
+	int iSlot = iIndex % MAX_THUMBNAIL_REQUESTS;
+	if(m_vThumbnailRequests[iSlot] == sFileName)
+		return;
+	m_vThumbnailRequests[iSlot] = sFileName;
+
+	TaskScheduler::Task fTask = [sFileName](TaskContext &oContext) -> QVariant
+	{
+		if(oContext.isCancelled())
+			return QVariant();
 
-	oImage = oImage.scaled(50, 50, Qt::IgnoreAspectRatio);
-	return oImage;
+		// The readers of some formats (e.g. JPEG) decode directly in a reduced size
+		QImageReader oReader(sFileName);
+		oReader.setScaledSize(QSize(THUMBNAIL_SIZE, THUMBNAIL_SIZE));
+		return QVariant::fromValue(oReader.read());
+	};
+
+	// The model is changed only after data() returned, so it is safe to discard the constness here
+	FaceDatasetModel *pModel = const_cast<FaceDatasetModel*>(this);
+	TaskScheduler::CompletionHandler fDone = [pModel, iIndex, iSlot, sFileName](const QVariant &oResult)
+	{
+		if(pModel->m_vThumbnailRequests[iSlot] == sFileName)
+			pModel->m_vThumbnailRequests[iSlot].clear();
+
+		// The thumbnail is only stored if the row still displays the same image
+		if(pModel->m_pFaceDataset->imageFileName(iIndex) != sFileName || pModel->m_vThumbnailSlots[iIndex] != -1)
+			return;
+
+		QImage oImage = oResult.value<QImage>();
+		if(oImage.isNull())
+			oImage = QImage(":/images/imagemissing");
+
+		// The atlas is changed in the GUI thread, where its pages are painted
+		int iEvicted;
+		int iSlot = pModel->m_oThumbnailAtlas.allocate(iIndex, iEvicted);
+		if(iEvicted != -1 && iEvicted < pModel->m_vThumbnailSlots.size())
+			pModel->m_vThumbnailSlots[iEvicted] = -1;
+		pModel->m_oThumbnailAtlas.store(iSlot, oImage);
+		pModel->m_vThumbnailSlots[iIndex] = iSlot;
+
+		QModelIndex oIndex = pModel->index(iIndex, 0);
+		emit pModel->dataChanged(oIndex, oIndex);
+	};
+
+	F3Application::scheduler()->schedule(TaskScheduler::VisibleNow, fTask, fDone, m_oThumbnailToken, QString("thumbnail-%1").arg(iSlot));
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::resetThumbnails()
+{
+	m_oThumbnailAtlas.clear();
+	m_vThumbnailSlots.fill(-1, m_pFaceDataset->size());
+}
+
+// +-----------------------------------------------------------
+QString f3::FaceDatasetModel::displayName(const QString &sFileName)
+{
+	return QFileInfo(sFileName).baseName();
+}
+
+// +-----------------------------------------------------------
+void f3::FaceDatasetModel::resetDisplayNames()
+{
+	m_lDisplayNames.clear();
+	m_lDisplayNames.reserve(m_pFaceDataset->size());
+	for(int i = 0; i < m_pFaceDataset->size(); i++)
+		m_lDisplayNames.append(displayName(m_pFaceDataset->imageFileName(i)));
 }
 
 // +-----------------------------------------------------------
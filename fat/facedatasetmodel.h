@@ -21,10 +21,14 @@
 #define FACEDATASETMODEL_H
 
 #include "facedataset.h"
+#include "taskscheduler.h"
+#include "thumbnailatlas.h"
 
 #include <QAbstractListModel>
 #include <QList>
 #include <QPixmap>
+#include <QStringList>
+#include <QVector>
 
 namespace f3
 {
@@ -34,6 +38,7 @@ namespace f3
 	 */
 	class FaceDatasetModel : public QAbstractListModel
 	{
+		Q_OBJECT
 	public:
 		/**
 		 * Class constructor.
@@ -105,6 +110,143 @@ namespace f3
          */
         bool saveToFile(const QString &sFileName, QString &sMsgError) const;
 
+		/**
+		 * Starts loading the given file in background. The model is cleared, and the samples are
+		 * inserted in batches of rows as they are read from the file (so they can be displayed and
+		 * selected before the whole file is read). The progress and the conclusion of the loading
+		 * are indicated by the signals loadProgress and loadFinished.
+		 * @param sFileName QString with the name of the file to read the data from.
+		 * @param oOwner CancellationToken of the owner of the model, that cancels the loading when cancelled.
+		 */
+		void startLoading(const QString &sFileName, const CancellationToken &oOwner);
+
+		/**
+		 * Cancels the loading in progress (if any). The samples already inserted are kept in the model,
+		 * and the signal loadFinished is emitted indicating the failure.
+		 */
+		void cancelLoading();
+
+		/**
+		 * Indicates if a loading started with startLoading() is in progress.
+		 * @return Boolean indicating if the model is being loaded or not.
+		 */
+		bool isLoading() const;
+
+		/**
+		 * Takes a snapshot of the current contents of the face dataset, that can be read (or saved)
+		 * in other threads while the dataset is edited. See FaceDataset::snapshot().
+		 * @return FaceDatasetSnapshot with the current contents of the face dataset.
+		 */
+		FaceDatasetSnapshot snapshot() const;
+
+		/**
+		 * Queries the current version of the face dataset (that changes every time it is edited).
+		 * @return Unsigned integer with the version of the face dataset.
+		 */
+		quint64 version() const;
+
+		/**
+		 * Indicates if the changes in the face dataset can be saved incrementally to the journal of
+		 * its file. See FaceDataset::canSaveIncrementally().
+		 * @return Boolean indicating if an incremental save is possible.
+		 */
+		bool canSaveIncrementally() const;
+
+		/**
+		 * Prepares a complete saving of the face dataset. See FaceDataset::prepareFullSave().
+		 * @return FaceDatasetSnapshot with the contents to save.
+		 */
+		FaceDatasetSnapshot prepareFullSave();
+
+		/**
+		 * Prepares an incremental saving of the face dataset. See FaceDataset::prepareIncrementalSave().
+		 * @return FaceDatasetChanges with the changes to save.
+		 */
+		FaceDatasetChanges prepareIncrementalSave();
+
+		/**
+		 * Takes the changes not yet saved in the face dataset. See FaceDataset::pendingChanges().
+		 * @return FaceDatasetChanges with the changes not yet saved.
+		 */
+		FaceDatasetChanges pendingChanges() const;
+
+		/**
+		 * Applies the given changes taken with pendingChanges() as changes not yet saved. See
+		 * FaceDataset::restoreChanges(). The model is reset.
+		 * @param oChanges FaceDatasetChanges with the changes to restore.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the changes were restored (true) or not (false).
+		 */
+		bool restoreChanges(const FaceDatasetChanges &oChanges, QString &sMsgError);
+
+		/**
+		 * Queries the journal identifier of the file of the face dataset. See FaceDataset::journalId().
+		 * @return QString with the journal identifier, or an empty string if there is none.
+		 */
+		QString journalId() const;
+
+		/**
+		 * Prepares a sharded saving of the face dataset. See FaceDataset::prepareShardedSave().
+		 * @param sFileName QString with the path and name of the manifest file.
+		 * @return FaceDatasetManifest with the shards and the contents of the ones to save.
+		 */
+		FaceDatasetManifest prepareShardedSave(const QString &sFileName);
+
+		/**
+		 * Gets the manifest with the shards of the face dataset. See FaceDataset::manifest().
+		 * @return FaceDatasetManifest with the shards (empty if the dataset is not sharded).
+		 */
+		FaceDatasetManifest manifest() const;
+
+		/**
+		 * Defines the shards of the face dataset. See FaceDataset::setShards().
+		 * @param oManifest FaceDatasetManifest with the shards.
+		 * @return Boolean indicating if the shards were defined (true) or not (false).
+		 */
+		bool setShards(const FaceDatasetManifest &oManifest);
+
+		/**
+		 * Informs the conclusion of a saving prepared with prepareFullSave(), prepareIncrementalSave()
+		 * or prepareShardedSave(). See FaceDataset::finishSave().
+		 * @param bSuccess Boolean indicating if the saving succeeded (true) or failed (false).
+		 * @param pPager Shared pointer to the FaceDatasetPager opened on the file saved by a complete
+		 * saving, to return to the paging mode, or NULL (the default).
+		 */
+		void finishSave(const bool bSuccess, const std::shared_ptr<FaceDatasetPager> &pPager = std::shared_ptr<FaceDatasetPager>());
+
+		/**
+		 * Indicates if the dataset is in the paging mode. See FaceDataset::isPaged().
+		 * @return Boolean indicating if the dataset is paged (true) or completely loaded (false).
+		 */
+		bool isPaged() const;
+
+		/**
+		 * Releases from memory the samples least recently used, if the dataset was loaded in the
+		 * paging mode (see FaceDataset::evictColdPages()). It must be called only while no face
+		 * image obtained from the model is in use (i.e. when the current image changes).
+		 */
+		void evictColdPages();
+
+		/**
+		 * Gets the error of the reading of samples that failed in the paging mode, after which
+		 * the dataset can not be saved anymore (see FaceDataset::pagingError()).
+		 * @return QString with the error message, or an empty string if no reading failed.
+		 */
+		QString pagingError() const;
+
+		/**
+		 * Gets the pager that reads the samples in the paging mode. See FaceDataset::pager().
+		 * @return Shared pointer to the FaceDatasetPager, or NULL if the dataset is not paged.
+		 */
+		std::shared_ptr<FaceDatasetPager> pager() const;
+
+		/**
+		 * Gets the number of changes on the face features of all samples done in the paging mode.
+		 * See FaceDataset::numPagedChanges().
+		 * @return Integer with the number of changes.
+		 */
+		int numPagedChanges() const;
+
 		/**
 		 * Adds the given images to the dataset.
 		 * @param lImageFiles QStringList with the list of image file names to add.
@@ -113,8 +255,11 @@ namespace f3
 		bool addImages(const QStringList &lImageFiles);
 
 		/**
-		 * Removes the given images to the dataset.
-		 * @param lImageFiles QList with the list of image indexes to remove.
+		 * Removes the given images from the dataset. The indexes are grouped in contiguous ranges
+		 * of rows, and each range is signalled as removed on its own. If the rows are too scattered
+		 * (more than MAX_REMOVAL_RANGES ranges) the model is reset instead, and all the rows are
+		 * compacted in a single pass.
+		 * @param lImageIndexes QList with the list of image indexes to remove (in any order).
 		 * @return Boolean indicating if the operation was successful or not.
 		 */
 		bool removeImages(const QList<int> &lImageIndexes);
@@ -134,6 +279,105 @@ namespace f3
 		 */
 		void removeFeature(const int iIndex);
 
+		/**
+		 * Removes the features of given indexes in all face images at once. See FaceDataset::removeFeatures().
+		 * @param lIndexes QList with the indexes of the features to remove.
+		 */
+		void removeFeatures(const QList<int> &lIndexes);
+
+		/**
+		 * Inserts a feature at the given index in all face images, with a different position in each
+		 * one. See FaceDataset::insertFeature().
+		 * @param iIndex Integer with the index where to insert the feature.
+		 * @param iID Integer with the identifier of the face feature.
+		 * @param vPositions Vector with the positions of the feature in each face image.
+		 */
+		void insertFeature(const int iIndex, int iID, const std::vector<cv::Point2f> &vPositions);
+
+		/**
+		 * Gets the positions of the feature of given index in all face images.
+		 * @param iIndex Integer with the index of the feature.
+		 * @return Vector with the positions of the feature in each face image.
+		 */
+		std::vector<cv::Point2f> getFeaturePositions(const int iIndex) const;
+
+		/**
+		 * Gets the connections between the face features. See FaceDataset::connections().
+		 * @return Const reference to the FaceFeatureConnections with the connections.
+		 */
+		const FaceFeatureConnections& connections() const;
+
+		/**
+		 * Connects two face features. See FaceDataset::connectFeatures().
+		 * @param iFirst Integer with the index of one of the features.
+		 * @param iSecond Integer with the index of the other feature.
+		 */
+		void connectFeatures(const int iFirst, const int iSecond);
+
+		/**
+		 * Disconnects two face features. See FaceDataset::disconnectFeatures().
+		 * @param iFirst Integer with the index of one of the features.
+		 * @param iSecond Integer with the index of the other feature.
+		 */
+		void disconnectFeatures(const int iFirst, const int iSecond);
+
+		/**
+		 * Updates the emotion label of the face image at the given row. Differently from setData()
+		 * (used by the views), this method does not emit the signal emotionLabelEdited.
+		 * @param iRow Integer with the row of the face image.
+		 * @param eLabel EmotionLabel with the new emotion label.
+		 */
+		void setEmotionLabel(const int iRow, const EmotionLabel eLabel);
+
+		/**
+		 * Updates the emotion labels of the face images at the given rows, emitting a single
+		 * dataChanged for all of them. As setEmotionLabel(), it does not emit the signal emotionLabelEdited.
+		 * @param lRows QList with the rows of the face images.
+		 * @param lLabels QList with the new emotion label of each row (in the same order).
+		 */
+		void setEmotionLabels(const QList<int> &lRows, const QList<EmotionLabel> &lLabels);
+
+		/**
+		 * Gets the positions of all features of the face images at the given rows. See FaceDataset::getShapes().
+		 * @param lRows QList with the rows of the face images.
+		 * @return Vector with the shape of each face image, in the order of the rows given.
+		 */
+		std::vector<std::vector<cv::Point2f> > getShapes(const QList<int> &lRows) const;
+
+		/**
+		 * Updates the positions of all features of the face images at the given rows. See FaceDataset::setShapes().
+		 * @param lRows QList with the rows of the face images.
+		 * @param vShapes Vector with the new shape of each face image, in the order of the rows.
+		 * @return Boolean indicating if the shapes were updated (true) or not (false).
+		 */
+		bool setShapes(const QList<int> &lRows, const std::vector<std::vector<cv::Point2f> > &vShapes);
+
+		/**
+		 * Applies an affine transform to the features of the face images at the given rows. See
+		 * FaceDataset::transformFeatures().
+		 * @param lRows QList with the rows of the face images.
+		 * @param oTransform 2x3 cv::Mat with the affine transform.
+		 * @return Boolean indicating if the features were transformed (true) or not (false).
+		 */
+		bool transformFeatures(const QList<int> &lRows, const cv::Mat &oTransform);
+
+		/**
+		 * Copies the positions of all features of a face image to the face images at the given rows.
+		 * See FaceDataset::copyFeatures().
+		 * @param iSource Integer with the row of the face image with the shape to copy.
+		 * @param lRows QList with the rows of the face images to receive the shape.
+		 * @return Boolean indicating if the shape was copied (true) or not (false).
+		 */
+		bool copyFeatures(const int iSource, const QList<int> &lRows);
+
+		/**
+		 * Gets the face image of the given index for read-only access (so it is not considered
+		 * changed, as when its features are obtained with getFeatures()).
+		 * @param iIndex Integer with the index of the face image to query.
+		 * @return Pointer to a const FaceImage with the face image data, or NULL if the index is invalid.
+		 */
+		const FaceImage* getImage(const int iIndex) const;
+
 		/**
 		 * Gets all features in the given face image index.
 		 * @param iIndex Integer with the index of the face image to query.
@@ -147,15 +391,101 @@ namespace f3
 		 */
 		int numFeatures() const;
 
+		/**
+		 * Gets the region of the thumbnail of the given image index in the atlas of thumbnails. Only the
+		 * thumbnails of the rows requested by the views (i.e. the visible ones) are built, in background,
+		 * and kept in an atlas of bounded size (see ThumbnailAtlas). If the thumbnail is not available,
+		 * it is requested and the row is updated when it is ready.
+		 * @param iIndex Integer with the index of the image.
+		 * @param oPage QPixmap to receive the page of the atlas where the thumbnail is.
+		 * @param oRegion QRect to receive the region of the thumbnail in the page.
+		 * @return Boolean indicating if the thumbnail is available (true) or not (false).
+		 */
+		bool thumbnailRegion(const int iIndex, QPixmap &oPage, QRect &oRegion) const;
+
+		/** Size of the side of the thumbnails of the images, in pixels. */
+		static const int THUMBNAIL_SIZE;
+
+		/** Maximum memory used by the atlas of thumbnails, in KB. */
+		static const int THUMBNAIL_CACHE_SIZE;
+
+		/** Maximum number of thumbnails being built at the same time. */
+		static const int MAX_THUMBNAIL_REQUESTS;
+
+		/** Maximum number of ranges of rows signalled separately when removing images. */
+		static const int MAX_REMOVAL_RANGES;
+
+		/** Minimum size of the dataset files loaded in the paging mode, in KB. */
+		static const int PAGING_MIN_FILE_SIZE;
+
+		/** Memory used by the samples of the datasets loaded in the paging mode, in KB. */
+		static const int PAGING_BUDGET;
+
 	protected:
 
 		/**
-		 * Build a thumbnail for the given image index.
-		 * @param iIndex Integer with the index of the image to build the thumbnail for.
-		 * @return A QPixmap with the thumbmail. If the image could not be read,
-		 * a thumbnail of the 'image missing' is returned instead.
+		 * Requests the thumbnail for the given image index to be built in background. If the image
+		 * could not be read, a thumbnail of the 'image missing' is used instead.
+		 * @param iIndex Integer with the index of the image.
+		 * @param sFileName QString with the file name of the image.
+		 */
+		void requestThumbnail(const int iIndex, const QString &sFileName) const;
+
+		/**
+		 * Releases the thumbnails of all images and resizes the slots to the current number of rows.
+		 */
+		void resetThumbnails();
+
+		/**
+		 * Builds the string displayed for the given face image.
+		 * @param sFileName QString with the file name of the face image.
+		 * @return QString with the name of the image file (without its path and extension).
+		 */
+		static QString displayName(const QString &sFileName);
+
+		/**
+		 * Rebuilds the strings displayed for all face images (see displayName()).
+		 */
+		void resetDisplayNames();
+
+		/**
+		 * Inserts a batch of samples read in background at the end of the model.
+		 * @param vBatch FaceImageBatch with the samples to insert.
+		 */
+		void insertBatch(const FaceImageBatch &vBatch);
+
+		/**
+		 * Applies the changes read from the journal of the file loaded in background. The model is
+		 * reset if there are any changes.
+		 * @param lChanges QList with the sets of changes read from the journal.
+		 * @param sMsgError QString to receive the error message in case the method fails.
+		 * @return Boolean indicating if the changes were applied (true) or not (false).
+		 */
+		bool applyJournal(const QList<FaceDatasetChanges> &lChanges, QString &sMsgError);
+
+	signals:
+
+		/**
+		 * Signal to indicate the progress of the loading started with startLoading().
+		 * @param iPercent Integer with the percentage of the file read (in range [0, 100]).
+		 */
+		void loadProgress(const int iPercent);
+
+		/**
+		 * Signal to indicate the conclusion of the loading started with startLoading().
+		 * @param bSuccess Boolean indicating if the loading succeeded (true) or failed (false).
+		 * @param sMsgError QString with the error message in case the loading failed.
+		 */
+		void loadFinished(const bool bSuccess, const QString sMsgError);
+
+		/**
+		 * Signal to indicate that the emotion label of a face image was edited through setData()
+		 * (i.e. by the user, in a view), so the change can be recorded for undo.
+		 * @param iRow Integer with the row of the face image.
+		 * @param eOldLabel EmotionLabel with the label before the edition.
+		 * @param eNewLabel EmotionLabel with the label after the edition.
 		 */
-		QPixmap buildThumbnail(const int iIndex);
+		void emotionLabelEdited(const int iRow, const EmotionLabel eOldLabel, const EmotionLabel eNewLabel);
 
 		/**
 		 * Queries the display/edit flags for the given index.
@@ -169,11 +499,34 @@ namespace f3
 		FaceDataset *m_pFaceDataset;
 
 		/**
-		 * List of thumbnails for the existing images to improve access performance.
-		 * The thumbnails are related to the images in the facedataset according to their
-		 * indexed position.
+		 * Atlas with the thumbnails already built. The atlas is bounded by the memory used, so its
+		 * size does not depend on the number of images in the dataset.
 		 */
-		QList<QPixmap> m_lCachedThumbnails;
+		mutable ThumbnailAtlas m_oThumbnailAtlas;
+
+		/** Slots of the thumbnails in the atlas (aligned with the rows of the model, -1 if not built). */
+		QVector<int> m_vThumbnailSlots;
+
+		/** File names of the images whose thumbnails are being built, by their request slots. */
+		mutable QVector<QString> m_vThumbnailRequests;
+
+		/** Placeholder returned as decoration, to reserve the space of the thumbnails (see ThumbnailDelegate). */
+		QPixmap m_oThumbnailPlaceholder;
+
+		/** Cancellation token of the thumbnails being built. */
+		CancellationToken m_oThumbnailToken;
+
+		/** Strings displayed for the face images (precomputed, aligned with the rows of the model). */
+		QStringList m_lDisplayNames;
+
+		/** Names of the emotion labels (precomputed, by their values). */
+		QStringList m_lLabelNames;
+
+		/** Cancellation token of the loading in progress. */
+		CancellationToken m_oLoadToken;
+
+		/** Indication that a loading is in progress. */
+		bool m_bLoading;
 	};
 
 }
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "facefeaturegrid.h"
+#include "facefeaturenode.h"
+
+#include <QtMath>
+#include <climits>
+
+// Size of the side of the grid cells (a few times the distance between neighbour landmarks)
+const int f3::FaceFeatureGrid::CELL_SIZE = 32;
+
+// +-----------------------------------------------------------
+f3::FaceFeatureGrid::FaceFeatureGrid()
+{
+}
+
+// +-----------------------------------------------------------
+quint64 f3::FaceFeatureGrid::cellKey(const int iX, const int iY)
+{
+	return ((quint64) (quint32) iX << 32) | (quint64) (quint32) iY;
+}
+
+// +-----------------------------------------------------------
+int f3::FaceFeatureGrid::cellCoord(const double dValue)
+{
+	return qFloor(dValue / CELL_SIZE);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceFeatureGrid::update(FaceFeatureNode *pNode)
+{
+	quint64 iKey = cellKey(cellCoord(pNode->x()), cellCoord(pNode->y()));
+
+	QHash<FaceFeatureNode*, quint64>::iterator it = m_hNodeCells.find(pNode);
+	if(it != m_hNodeCells.end())
+	{
+		if(it.value() == iKey) // Moved inside the same cell
+			return;
+
+		QHash<quint64, QVector<FaceFeatureNode*> >::iterator itCell = m_hCells.find(it.value());
+		itCell->remove(itCell->indexOf(pNode));
+		if(itCell->isEmpty())
+			m_hCells.erase(itCell);
+		it.value() = iKey;
+	}
+	else
+		m_hNodeCells.insert(pNode, iKey);
+
+	m_hCells[iKey].append(pNode);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceFeatureGrid::remove(FaceFeatureNode *pNode)
+{
+	QHash<FaceFeatureNode*, quint64>::iterator it = m_hNodeCells.find(pNode);
+	if(it == m_hNodeCells.end())
+		return;
+
+	QHash<quint64, QVector<FaceFeatureNode*> >::iterator itCell = m_hCells.find(it.value());
+	itCell->remove(itCell->indexOf(pNode));
+	if(itCell->isEmpty())
+		m_hCells.erase(itCell);
+	m_hNodeCells.erase(it);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceFeatureGrid::clear()
+{
+	m_hCells.clear();
+	m_hNodeCells.clear();
+}
+
+// +-----------------------------------------------------------
+QList<f3::FaceFeatureNode*> f3::FaceFeatureGrid::nodesIn(const QRectF &oRect) const
+{
+	QList<FaceFeatureNode*> lNodes;
+	QRectF oArea = oRect.normalized();
+
+	int iLeft = cellCoord(oArea.left());
+	int iRight = cellCoord(oArea.right());
+	int iTop = cellCoord(oArea.top());
+	int iBottom = cellCoord(oArea.bottom());
+
+	// If the rectangle covers more cells than there are occupied, it is cheaper to visit these
+	qint64 iNumCells = (qint64) (iRight - iLeft + 1) * (qint64) (iBottom - iTop + 1);
+	if(iNumCells > m_hCells.size())
+	{
+		QHash<quint64, QVector<FaceFeatureNode*> >::const_iterator itCell;
+		for(itCell = m_hCells.constBegin(); itCell != m_hCells.constEnd(); ++itCell)
+			foreach(FaceFeatureNode *pNode, itCell.value())
+				if(oArea.contains(pNode->pos()))
+					lNodes.append(pNode);
+	}
+	else
+	{
+		QHash<quint64, QVector<FaceFeatureNode*> >::const_iterator itCell;
+		for(int iY = iTop; iY <= iBottom; iY++)
+			for(int iX = iLeft; iX <= iRight; iX++)
+			{
+				itCell = m_hCells.constFind(cellKey(iX, iY));
+				if(itCell != m_hCells.constEnd())
+					foreach(FaceFeatureNode *pNode, itCell.value())
+						if(oArea.contains(pNode->pos()))
+							lNodes.append(pNode);
+			}
+	}
+
+	return lNodes;
+}
+
+// +-----------------------------------------------------------
+f3::FaceFeatureNode* f3::FaceFeatureGrid::nearest(const QPointF &oPos, const double dMaxDistance) const
+{
+	FaceFeatureNode *pNearest = NULL;
+	double dBest = dMaxDistance < 0 ? -1 : dMaxDistance * dMaxDistance;
+	if(m_hCells.isEmpty())
+		return NULL;
+
+	int iCX = cellCoord(oPos.x());
+	int iCY = cellCoord(oPos.y());
+	int iMaxRing = dMaxDistance < 0 ? INT_MAX : qCeil(dMaxDistance / CELL_SIZE);
+	int iVisited = 0;
+
+	QHash<quint64, QVector<FaceFeatureNode*> >::const_iterator itCell;
+	for(int iRing = 0; iRing <= iMaxRing; iRing++)
+	{
+		// All cells from this ring on are farther than the nearest node found
+		double dRingDist = (iRing - 1) * CELL_SIZE;
+		if(pNearest && iRing > 0 && dBest <= dRingDist * dRingDist)
+			break;
+
+		// When the search spreads over more cells than there are occupied, it is cheaper to visit these
+		// (this also ends the unlimited search)
+		iVisited += iRing == 0 ? 1 : 8 * iRing;
+		if(iVisited > m_hCells.size() * 2 && iRing > 1)
+		{
+			for(itCell = m_hCells.constBegin(); itCell != m_hCells.constEnd(); ++itCell)
+				foreach(FaceFeatureNode *pNode, itCell.value())
+				{
+					QPointF oDiff = pNode->pos() - oPos;
+					double dDist = oDiff.x() * oDiff.x() + oDiff.y() * oDiff.y();
+					if(dBest < 0 || dDist < dBest)
+					{
+						dBest = dDist;
+						pNearest = pNode;
+					}
+				}
+			break;
+		}
+
+		// Visit the cells in the border of the ring
+		for(int iY = iCY - iRing; iY <= iCY + iRing; iY++)
+		{
+			bool bBorderRow = iY == iCY - iRing || iY == iCY + iRing;
+			int iStep = bBorderRow ? 1 : 2 * iRing;
+			for(int iX = iCX - iRing; iX <= iCX + iRing; iX += iStep)
+			{
+				itCell = m_hCells.constFind(cellKey(iX, iY));
+				if(itCell == m_hCells.constEnd())
+					continue;
+
+				foreach(FaceFeatureNode *pNode, itCell.value())
+				{
+					QPointF oDiff = pNode->pos() - oPos;
+					double dDist = oDiff.x() * oDiff.x() + oDiff.y() * oDiff.y();
+					if(dBest < 0 || dDist < dBest)
+					{
+						dBest = dDist;
+						pNearest = pNode;
+					}
+				}
+			}
+		}
+	}
+
+	return pNearest;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FACEFEATUREGRID_H
+#define FACEFEATUREGRID_H
+
+#include <QHash>
+#include <QVector>
+#include <QList>
+#include <QPointF>
+#include <QRectF>
+
+namespace f3
+{
+	class FaceFeatureNode;
+
+	/**
+	 * Implements a spatial index of the face feature nodes, as a uniform grid of square cells
+	 * over their positions in the scene. Only the occupied cells are stored, so the index does
+	 * not depend on the size of the image. It is updated incrementally as the nodes move, and
+	 * answers the point, rectangle and nearest node queries of the editor by visiting only the
+	 * cells around the query (instead of all the items in the scene).
+	 */
+	class FaceFeatureGrid
+	{
+	public:
+		/**
+		 * Class constructor.
+		 */
+		FaceFeatureGrid();
+
+		/**
+		 * Updates the cell of the node according to its current position, inserting
+		 * the node in the index if it is not there yet.
+		 * @param pNode Instance of the FaceFeatureNode that was added or moved.
+		 */
+		void update(FaceFeatureNode *pNode);
+
+		/**
+		 * Removes the node from the index.
+		 * @param pNode Instance of the FaceFeatureNode to be removed.
+		 */
+		void remove(FaceFeatureNode *pNode);
+
+		/**
+		 * Removes all nodes from the index.
+		 */
+		void clear();
+
+		/**
+		 * Queries the nodes whose positions lay inside the given rectangle.
+		 * @param oRect QRectF with the rectangle to query, in scene coordinates.
+		 * @return QList with the nodes found (in no specific order).
+		 */
+		QList<FaceFeatureNode*> nodesIn(const QRectF &oRect) const;
+
+		/**
+		 * Queries the node nearest to the given point.
+		 * @param oPos QPointF with the point to query, in scene coordinates.
+		 * @param dMaxDistance Double with the maximum distance of the node to the point. The
+		 * default is -1, indicating that there is no limit.
+		 * @return Instance of the nearest FaceFeatureNode, or NULL if there is no node within
+		 * the maximum distance.
+		 */
+		FaceFeatureNode* nearest(const QPointF &oPos, const double dMaxDistance = -1) const;
+
+	protected:
+
+		/**
+		 * Gets the key of the cell with the given grid coordinates.
+		 * @param iX Integer with the column of the cell.
+		 * @param iY Integer with the row of the cell.
+		 * @return Unsigned 64-bit integer with the key of the cell.
+		 */
+		static quint64 cellKey(const int iX, const int iY);
+
+		/**
+		 * Gets the grid coordinate (column or row) of the given scene coordinate.
+		 * @param dValue Double with the scene coordinate (x or y).
+		 * @return Integer with the grid coordinate.
+		 */
+		static int cellCoord(const double dValue);
+
+	public:
+
+		/** Size of the side of the grid cells, in scene units (pixels of the face image). */
+		static const int CELL_SIZE;
+
+	private:
+
+		/** Nodes in each occupied cell, by the key of the cell. */
+		QHash<quint64, QVector<FaceFeatureNode*> > m_hCells;
+
+		/** Key of the cell of each node indexed. */
+		QHash<FaceFeatureNode*, quint64> m_hNodeCells;
+	};
+};
+
+#endif // FACEFEATUREGRID_H
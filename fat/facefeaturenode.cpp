@@ -37,12 +37,15 @@ f3::FaceFeatureNode::FaceFeatureNode(int iID, FaceWidget *pFaceWidget)
     setFlag(ItemIsMovable);
     setFlag(ItemSendsGeometryChanges);
 	setFlag(ItemIsSelectable);
-    setCacheMode(DeviceCoordinateCache);
+
+	// In the batched rendering the node is drawn by the editor, so it has nothing to cache
+	setCacheMode(pFaceWidget->batchedRendering() ? NoCache : DeviceCoordinateCache);
 
 	setSelected(false);
-	setAcceptHoverEvents(true);
 
 	m_iID = iID;
+	m_oBoundingRect = QRectF(-RADIUS, -RADIUS, 2 * RADIUS, 2 * RADIUS);
+	updateBoundingRect();
 }
 
 // +-----------------------------------------------------------
@@ -67,29 +70,33 @@ QList<f3::FaceFeatureEdge *> f3::FaceFeatureNode::edges() const
 // +-----------------------------------------------------------
 f3::FaceFeatureEdge *f3::FaceFeatureNode::getEdgeTo(const FaceFeatureNode *pNode) const
 {
-	foreach(FaceFeatureEdge *pEdge, m_lEdges)
-	{
-		if((pEdge->sourceNode() == this && pEdge->targetNode() == pNode) ||
-		   (pEdge->sourceNode() == pNode && pEdge->targetNode() == this))
-		{
-			return pEdge;
-		}
-	}
-	return NULL;
+	return m_pFaceWidget->getConnection(this, pNode);
 }
 
 // +-----------------------------------------------------------
 QRectF f3::FaceFeatureNode::boundingRect() const
 {
+	return m_oBoundingRect;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceFeatureNode::updateBoundingRect()
+{
+	QRectF oBounds;
 	if(m_pFaceWidget->displayFeatureIDs())
 	{
-		QString sID = QString::number(m_iID);
-		int iHeight = m_pFaceWidget->fontMetrics().height();
-		int iWidth = m_pFaceWidget->fontMetrics().width(sID);
-		return QRectF(-(iWidth + RADIUS), -(iHeight + RADIUS), 2 * RADIUS + iWidth, 2 * RADIUS + iHeight);
+		QSizeF oSize = m_pFaceWidget->featureLabelSize(m_iID);
+		oBounds = QRectF(-(oSize.width() + RADIUS), -(oSize.height() + RADIUS), 2 * RADIUS + oSize.width(), 2 * RADIUS + oSize.height());
 	}
 	else
-		return QRectF(-RADIUS, -RADIUS, 2 * RADIUS, 2 * RADIUS);
+		oBounds = QRectF(-RADIUS, -RADIUS, 2 * RADIUS, 2 * RADIUS);
+
+	if(oBounds != m_oBoundingRect)
+	{
+		prepareGeometryChange();
+		m_oBoundingRect = oBounds;
+	}
+	update();
 }
 
 // +-----------------------------------------------------------
@@ -98,6 +105,10 @@ void f3::FaceFeatureNode::paint(QPainter *pPainter, const QStyleOptionGraphicsIt
 	Q_UNUSED(pOption);
 	Q_UNUSED(pWidget);
 
+	// In the batched rendering the node is drawn by the editor (see FaceFeaturesItem)
+	if(m_pFaceWidget->batchedRendering())
+		return;
+
 	QBrush oBrush;
 	oBrush.setStyle(Qt::SolidPattern);
 	if(isSelected())
@@ -111,39 +122,32 @@ void f3::FaceFeatureNode::paint(QPainter *pPainter, const QStyleOptionGraphicsIt
 		oBrush.setColor(QColor(Qt::yellow));
 	}
 
-	QRectF oBounds;
+	// The label is drawn from the cache of the editor (at the top left of the bounding rect)
 	if(m_pFaceWidget->displayFeatureIDs())
-	{
-		QString sID = QString::number(m_iID);
-		int iHeight = m_pFaceWidget->fontMetrics().height();
-		int iWidth = m_pFaceWidget->fontMetrics().width(sID);
-		oBounds = QRectF(-(iWidth + RADIUS), -(iHeight + RADIUS), iWidth, iHeight);
-		pPainter->drawText(oBounds, sID);
-
-		oBounds = QRectF(-RADIUS, -RADIUS, 2 * RADIUS, 2 * RADIUS);
-	}
-	else
-		oBounds = boundingRect();
+		pPainter->drawStaticText(m_oBoundingRect.topLeft(), m_pFaceWidget->featureLabel(m_iID));
 
     pPainter->setBrush(oBrush);
-	pPainter->drawEllipse(oBounds);
+	pPainter->drawEllipse(QRectF(-RADIUS, -RADIUS, 2 * RADIUS, 2 * RADIUS));
 }
 
 // +-----------------------------------------------------------
 QVariant f3::FaceFeatureNode::itemChange(GraphicsItemChange eChange, const QVariant &oValue)
 {
-	QString sText;
     switch(eChange)
 	{
 		case ItemPositionHasChanged:
-			foreach(FaceFeatureEdge *pEdge, m_lEdges)
-				pEdge->adjust();
-
-			sText = QApplication::translate("FaceFeatureNode", "Nó: %1 Posição: (%2, %3)").arg(m_iID).arg(QString::number(pos().x(), 'f', 2)).arg(QString::number(pos().y(), 'f', 2));
-			F3Application::instance()->showStatusMessage(sText, 0);
-
-			if(!data(0).toBool()) // This flag is used in ChildWindow::refreshFeaturesInWidget
-				m_pFaceWidget->faceFeatureMoved(this);
+			// In bulk updates, the edges are adjusted only once by the editor when the update ends
+			// (and in the batched rendering they are not drawn by their own items)
+			if(!m_pFaceWidget->isBulkUpdating())
+			{
+				if(!m_pFaceWidget->batchedRendering())
+				{
+					foreach(FaceFeatureEdge *pEdge, m_lEdges)
+						pEdge->adjust();
+				}
+				showPositionInStatus();
+			}
+			m_pFaceWidget->faceFeatureMoved(this);
 			break;
 	
 		default:
@@ -154,28 +158,25 @@ QVariant f3::FaceFeatureNode::itemChange(GraphicsItemChange eChange, const QVari
 }
 
 // +-----------------------------------------------------------
-void f3::FaceFeatureNode::hoverEnterEvent(QGraphicsSceneHoverEvent *pEvent)
+int f3::FaceFeatureNode::getID() const
 {
-	QString sText = QApplication::translate("FaceFeatureNode", "Nó: %1 Posição: (%2, %3)").arg(m_iID).arg(QString::number(pos().x(), 'f', 2)).arg(QString::number(pos().y(), 'f', 2));
-	F3Application::instance()->showStatusMessage(sText, 0);
-	QGraphicsItem::hoverEnterEvent(pEvent);
+	return m_iID;
 }
 
 // +-----------------------------------------------------------
-void f3::FaceFeatureNode::hoverLeaveEvent(QGraphicsSceneHoverEvent *pEvent)
+void f3::FaceFeatureNode::setID(int iID)
 {
-	F3Application::instance()->showStatusMessage("");
-	QGraphicsItem::hoverLeaveEvent(pEvent);
-}
+	if(iID == m_iID)
+		return;
 
-// +-----------------------------------------------------------
-int f3::FaceFeatureNode::getID() const
-{
-	return m_iID;
+	m_iID = iID;
+	if(m_pFaceWidget->displayFeatureIDs())
+		updateBoundingRect();
 }
 
 // +-----------------------------------------------------------
-void f3::FaceFeatureNode::setID(int iID)
+void f3::FaceFeatureNode::showPositionInStatus() const
 {
-	m_iID = iID;
+	QString sText = QApplication::translate("FaceFeatureNode", "Nó: %1 Posição: (%2, %3)").arg(m_iID).arg(QString::number(pos().x(), 'f', 2)).arg(QString::number(pos().y(), 'f', 2));
+	F3Application::instance()->showStatusMessage(sText, 0);
 }
\ No newline at end of file
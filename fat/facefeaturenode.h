@@ -73,6 +73,12 @@ namespace f3
 		 */
 		QRectF boundingRect() const Q_DECL_OVERRIDE;
 
+		/**
+		 * Recomputes the bounding rectangle of the node, which depends on the display of its identifier
+		 * and on the size of its label. It must be called when any of these change.
+		 */
+		void updateBoundingRect();
+
 		/**
 		 * Gets the identifier of the feature node.
 		 */
@@ -84,6 +90,11 @@ namespace f3
 		 */
 		void setID(int iID);
 
+		/**
+		 * Displays the identifier and the position of the node in the status bar of the application.
+		 */
+		void showPositionInStatus() const;
+
 	public:
 
 		/** Constant with the radius of the node drawn, in pixels. */
@@ -106,18 +117,6 @@ namespace f3
 		 */
 		QVariant itemChange(GraphicsItemChange eChange, const QVariant &oValue) Q_DECL_OVERRIDE;
 
-		/**
-		 * Captures the mouse enter event on the feature node.
-		 * @param pEvent Instance of a QGraphicsSceneHoverEvent with the event data.
-		 */
-		void hoverEnterEvent(QGraphicsSceneHoverEvent *pEvent) Q_DECL_OVERRIDE;
-
-		/**
-		 * Captures the mouse exit event on the feature node.
-		 * @param pEvent Instance of a QGraphicsSceneHoverEvent with the event data.
-		 */
-		void hoverLeaveEvent(QGraphicsSceneHoverEvent *pEvent) Q_DECL_OVERRIDE;
-
 	private:
 
 		/** Reference to the parent face widget. */
@@ -128,6 +127,9 @@ namespace f3
 
 		/** Identifier of the face feature node. */
 		int m_iID;
+
+		/** Bounding rectangle of the node (precomputed, see updateBoundingRect()). */
+		QRectF m_oBoundingRect;
 	};
 };
 
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "facefeaturesitem.h"
+#include "facewidget.h"
+#include "facefeaturenode.h"
+#include "facefeatureedge.h"
+
+#include <QPainter>
+
+// +-----------------------------------------------------------
+f3::FaceFeaturesItem::FaceFeaturesItem(FaceWidget *pFaceWidget)
+{
+	m_pFaceWidget = pFaceWidget;
+
+	// The interaction is handled by the individual node items
+	setAcceptedMouseButtons(0);
+	setAcceptHoverEvents(false);
+}
+
+// +-----------------------------------------------------------
+QRectF f3::FaceFeaturesItem::boundingRect() const
+{
+	return m_oBounds;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceFeaturesItem::updateGeometry()
+{
+	const QList<FaceFeatureNode*> &lNodes = m_pFaceWidget->getFaceFeatures();
+	QRectF oBounds;
+	if(!lNodes.isEmpty())
+	{
+		qreal dLeft, dTop, dRight, dBottom;
+		dLeft = dRight = lNodes.first()->x();
+		dTop = dBottom = lNodes.first()->y();
+		foreach(FaceFeatureNode *pNode, lNodes)
+		{
+			dLeft = qMin(dLeft, pNode->x());
+			dRight = qMax(dRight, pNode->x());
+			dTop = qMin(dTop, pNode->y());
+			dBottom = qMax(dBottom, pNode->y());
+		}
+
+		// Margin for the radius of the nodes and for their identifiers (drawn above and to the left)
+		qreal dMargin = FaceFeatureNode::RADIUS;
+		if(m_pFaceWidget->displayFeatureIDs())
+		{
+			QSizeF oSize = m_pFaceWidget->featureLabelSize(lNodes.size() - 1);
+			dMargin += qMax(oSize.width(), oSize.height());
+		}
+		oBounds = QRectF(QPointF(dLeft, dTop), QPointF(dRight, dBottom)).adjusted(-dMargin, -dMargin, dMargin, dMargin);
+	}
+
+	if(oBounds != m_oBounds)
+	{
+		prepareGeometryChange();
+		m_oBounds = oBounds;
+	}
+	update();
+}
+
+// +-----------------------------------------------------------
+void f3::FaceFeaturesItem::paint(QPainter *pPainter, const QStyleOptionGraphicsItem *pOption, QWidget *pWidget)
+{
+	Q_UNUSED(pOption);
+	Q_UNUSED(pWidget);
+
+	const QList<FaceFeatureNode*> &lNodes = m_pFaceWidget->getFaceFeatures();
+	bool bDisplayConnections = m_pFaceWidget->displayConnections();
+
+	// Collect the coordinates in contiguous arrays (each edge is taken from its source node)
+	m_vPoints.resize(0);
+	m_vSelectedPoints.resize(0);
+	m_vLines.resize(0);
+	foreach(FaceFeatureNode *pNode, lNodes)
+	{
+		if(pNode->isSelected())
+			m_vSelectedPoints.append(pNode->pos());
+		else
+			m_vPoints.append(pNode->pos());
+
+		if(bDisplayConnections)
+		{
+			foreach(FaceFeatureEdge *pEdge, pNode->edges())
+			{
+				if(pEdge->sourceNode() == pNode)
+					m_vLines.append(QLineF(pNode->pos(), pEdge->targetNode()->pos()));
+			}
+		}
+	}
+
+	// The edges are drawn first, so the nodes cover their ends
+	if(!m_vLines.isEmpty())
+	{
+		pPainter->setPen(QPen(Qt::yellow, 1, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+		pPainter->drawLines(m_vLines);
+	}
+
+	// The nodes are drawn as points with a round pen of the diameter of the nodes
+	pPainter->setPen(QPen(Qt::yellow, 2 * FaceFeatureNode::RADIUS, Qt::SolidLine, Qt::RoundCap));
+	pPainter->drawPoints(m_vPoints.constData(), m_vPoints.size());
+	pPainter->setPen(QPen(Qt::red, 2 * FaceFeatureNode::RADIUS, Qt::SolidLine, Qt::RoundCap));
+	pPainter->drawPoints(m_vSelectedPoints.constData(), m_vSelectedPoints.size());
+
+	// The identifiers (if displayed) are the only per node calls, drawn from the cache of the editor
+	if(m_pFaceWidget->displayFeatureIDs())
+	{
+		foreach(FaceFeatureNode *pNode, lNodes)
+		{
+			pPainter->setPen(QPen(pNode->isSelected() ? Qt::red : Qt::yellow, 0));
+			pPainter->drawStaticText(pNode->pos() + pNode->boundingRect().topLeft(), m_pFaceWidget->featureLabel(pNode->getID()));
+		}
+	}
+}
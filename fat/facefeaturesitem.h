@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FACEFEATURESITEM_H
+#define FACEFEATURESITEM_H
+
+#include <QGraphicsItem>
+#include <QVector>
+#include <QPointF>
+#include <QLineF>
+
+namespace f3
+{
+	class FaceWidget;
+
+	/**
+	 * Implements the batched rendering of all face feature nodes and edges of a FaceWidget in a single
+	 * graphics item. Instead of painting each node and each edge as an individual item, this item draws
+	 * all the edges with one call to QPainter::drawLines and all the nodes with one call to
+	 * QPainter::drawPoints (per color). The individual items are kept (without painting anything) for
+	 * the interaction, so the API of the editor is the same in both rendering modes.
+	 */
+	class FaceFeaturesItem: public QGraphicsItem
+	{
+	public:
+		/**
+		 * Class constructor.
+		 * @param pFaceWidget Instance of the FaceWidget whose face features are drawn.
+		 */
+		FaceFeaturesItem(FaceWidget *pFaceWidget);
+
+		/**
+		 * Queries the bounding rectangle of the item (i.e. of all face feature nodes and edges).
+		 * @return A QRectF with the coordinates and size of the bounding rect of the item.
+		 */
+		QRectF boundingRect() const Q_DECL_OVERRIDE;
+
+		/**
+		 * Updates the bounding rectangle of the item from the current positions of the face feature
+		 * nodes, and schedules its repainting. It must be called every time the nodes change.
+		 */
+		void updateGeometry();
+
+	protected:
+
+		/**
+		 * Paint method for the face feature nodes and edges.
+		 * @param pPainter Instance of a QPainter to allow drawing the item.
+		 * @param pOption Instance of a QStyleOptionGraphicsItem with information on the style and state of the item.
+		 * @param pWidget Instance of a QWidget with the widget that the item is being painted on. Optional, and might be 0.
+		 */
+		void paint(QPainter *pPainter, const QStyleOptionGraphicsItem *pOption, QWidget *pWidget) Q_DECL_OVERRIDE;
+
+	private:
+
+		/** Reference to the parent face widget. */
+		FaceWidget *m_pFaceWidget;
+
+		/** Bounding rectangle of all nodes and edges. */
+		QRectF m_oBounds;
+
+		/** Positions of the nodes not selected (kept as a member to reuse its memory between paints). */
+		QVector<QPointF> m_vPoints;
+
+		/** Positions of the nodes selected (kept as a member to reuse its memory between paints). */
+		QVector<QPointF> m_vSelectedPoints;
+
+		/** Lines of the edges (kept as a member to reuse its memory between paints). */
+		QVector<QLineF> m_vLines;
+	};
+};
+
+#endif // FACEFEATURESITEM_H
@@ -19,6 +19,7 @@
 
 #include "facewidget.h"
 #include "facewidgetscene.h"
+#include "application.h"
 
 #include <QApplication>
 #include <QPixmap>
@@ -26,18 +27,28 @@
 #include <QScrollBar>
 #include <QtMath>
 #include <QGraphicsSceneMouseEvent>
+#include <QSet>
 
 // Scale values for zoom in and out steps
 const double f3::FaceWidget::ZOOM_IN_STEP = 1.25;
 const double f3::FaceWidget::ZOOM_OUT_STEP = 0.80;
 
+// Interval of the status bar updates while dragging (about the display refresh rate)
+const int f3::FaceWidget::STATUS_UPDATE_INTERVAL = 16;
+
+// Maximum number of feature labels cached (a few zoom steps of a dense scheme)
+const int f3::FaceWidget::LABEL_CACHE_SIZE = 8192;
+
 // Number of face features edited by the widget
 const int f3::FaceWidget::NUM_FACE_FEATURES = 68;
 
 // +-----------------------------------------------------------
 f3::FaceWidget::FaceWidget(QWidget *pParent) : QGraphicsView(pParent)
 {
-	setDragMode(RubberBandDrag);
+	// The selection by rubber band is done by the widget (see updateRubberBand())
+	setDragMode(NoDrag);
+	m_pRubberBand = new QRubberBand(QRubberBand::Rectangle, viewport());
+	m_pHoveredNode = NULL;
 
 	m_pScene = (QGraphicsScene*) new FaceWidgetScene(this);
 	m_pScene->setItemIndexMethod(QGraphicsScene::NoIndex);
@@ -56,20 +67,37 @@ f3::FaceWidget::FaceWidget(QWidget *pParent) : QGraphicsView(pParent)
 
 	// Add the image item
 	QPixmap oPixmap(":/images/noface");
-	m_pPixmapItem = m_pScene->addPixmap(oPixmap);
-	m_pPixmapItem->setShapeMode(QGraphicsPixmapItem::BoundingRectShape);
+	m_pImageItem = new TiledImageItem();
+	m_pImageItem->setImage(oPixmap.toImage());
+	m_pScene->addItem(m_pImageItem);
 	m_pScene->setSceneRect(0, 0, oPixmap.width(), oPixmap.height());
 
 	// Setup the face features editor
 	m_bDisplayFaceFeatures = true;
 	m_bDisplayConnections = true;
 	m_bDisplayFeatureIDs = false;
+	m_oLabelCache.setMaxCost(LABEL_CACHE_SIZE);
+
+	// The item of the batched rendering is added before any node, so the nodes stay above it
+	m_bBatchedRendering = false;
+	m_pFeaturesItem = new FaceFeaturesItem(this);
+	m_pFeaturesItem->setVisible(false);
+	m_pScene->addItem(m_pFeaturesItem);
 
 	m_pContextMenu = NULL;
 
 	//createFaceFeatures();
 	m_bFeaturesMoved = false;
 	m_bSelectionChanged = false;
+	m_iBulkUpdateLevel = 0;
+	m_bBulkUserChange = false;
+	m_bBulkConnectionsChanged = false;
+
+	m_pStatusNode = NULL;
+	m_pStatusTimer = new QTimer(this);
+	m_pStatusTimer->setSingleShot(true);
+	m_pStatusTimer->setInterval(STATUS_UPDATE_INTERVAL);
+	connect(m_pStatusTimer, SIGNAL(timeout()), this, SLOT(onStatusTimeout()));
 }
 
 // +-----------------------------------------------------------
@@ -81,8 +109,14 @@ f3::FaceWidget::~FaceWidget()
 // +-----------------------------------------------------------
 void f3::FaceWidget::setPixmap(const QPixmap &oPixmap)
 {
-	m_pPixmapItem->setPixmap(oPixmap);
-	m_pScene->setSceneRect(0, 0, oPixmap.width(), oPixmap.height());
+	setImage(oPixmap.toImage());
+}
+
+// +-----------------------------------------------------------
+void f3::FaceWidget::setImage(const QImage &oImage)
+{
+	m_pImageItem->setImage(oImage);
+	m_pScene->setSceneRect(0, 0, oImage.width(), oImage.height());
 }
 
 // +-----------------------------------------------------------
@@ -147,12 +181,9 @@ void f3::FaceWidget::wheelEvent(QWheelEvent *pEvent)
 // +-----------------------------------------------------------
 void f3::FaceWidget::mousePressEvent(QMouseEvent* pEvent)
 {
-	QPointF oPos = pEvent->pos();
-	oPos = mapToScene(pEvent->pos());
-	QTransform oTrf;
-	QGraphicsItem* pItem = scene()->itemAt(oPos, oTrf);
-	if (pItem && pItem->isEnabled() && (pItem->flags() & QGraphicsItem::ItemIsSelectable) &&
-		(pEvent->modifiers() & Qt::ShiftModifier))
+	QPointF oPos = mapToScene(pEvent->pos());
+	FaceFeatureNode *pItem = faceFeatureAt(oPos);
+	if (pItem && (pEvent->modifiers() & Qt::ShiftModifier))
 	{
 		int iFirst, iLast;
 		QList<FaceFeatureNode*> lsSelected = getSelectedFeatures();
@@ -166,7 +197,7 @@ void f3::FaceWidget::mousePressEvent(QMouseEvent* pEvent)
 					iFirst = pNode->getID();
 		}
 
-		iLast = ((FaceFeatureNode*) pItem)->getID();
+		iLast = pItem->getID();
 
 		if(iFirst != iLast)
 		{
@@ -180,12 +211,30 @@ void f3::FaceWidget::mousePressEvent(QMouseEvent* pEvent)
 		pEvent->accept();
 	}
 	else
+	{
 		QGraphicsView::mousePressEvent((QMouseEvent*) pEvent);
+
+		// Pressing outside the nodes starts the selection by rubber band (the nodes
+		// still selected, as when the control key is pressed, are kept selected)
+		if(!pItem && pEvent->button() == Qt::LeftButton && m_bDisplayFaceFeatures)
+		{
+			m_oRubberBandOrigin = pEvent->pos();
+			m_setRubberBandBase = getSelectedFeatures().toSet();
+			m_pRubberBand->setGeometry(QRect(m_oRubberBandOrigin, QSize()));
+			m_pRubberBand->show();
+		}
+	}
 }
 
 // +-----------------------------------------------------------
 void f3::FaceWidget::mouseReleaseEvent(QMouseEvent *pEvent)
 {
+	if(m_pRubberBand->isVisible())
+	{
+		m_pRubberBand->hide();
+		m_setRubberBandBase.clear();
+	}
+
 	if(m_bFeaturesMoved)
 	{
 		emit onFaceFeaturesChanged();
@@ -201,6 +250,65 @@ void f3::FaceWidget::mouseReleaseEvent(QMouseEvent *pEvent)
 	QGraphicsView::mouseReleaseEvent(pEvent);
 }
 
+// +-----------------------------------------------------------
+void f3::FaceWidget::mouseMoveEvent(QMouseEvent *pEvent)
+{
+	if(m_pRubberBand->isVisible())
+	{
+		updateRubberBand(pEvent->pos());
+		pEvent->accept();
+		return;
+	}
+
+	// A node grabbing the mouse means the selected nodes are being dragged
+	bool bDragging = (pEvent->buttons() & Qt::LeftButton) && m_pScene->mouseGrabberItem();
+	if(bDragging)
+		beginBulkUpdate(true);
+
+	QGraphicsView::mouseMoveEvent(pEvent);
+
+	if(bDragging)
+		endBulkUpdate();
+	else if(pEvent->buttons() == Qt::NoButton)
+		updateHoveredFeature(mapToScene(pEvent->pos()));
+}
+
+// +-----------------------------------------------------------
+void f3::FaceWidget::updateHoveredFeature(const QPointF &oPos)
+{
+	FaceFeatureNode *pNode = faceFeatureAt(oPos);
+	if(pNode == m_pHoveredNode)
+		return;
+
+	m_pHoveredNode = pNode;
+	if(pNode)
+		pNode->showPositionInStatus();
+	else
+		F3Application::instance()->showStatusMessage("");
+}
+
+// +-----------------------------------------------------------
+void f3::FaceWidget::updateRubberBand(const QPoint &oPos)
+{
+	QRect oRect = QRect(m_oRubberBandOrigin, oPos).normalized();
+	m_pRubberBand->setGeometry(oRect);
+
+	// The nodes intersecting the rubber band are those whose centers are up to a radius away from it
+	int iRadius = FaceFeatureNode::RADIUS;
+	QRectF oArea = mapToScene(oRect).boundingRect().adjusted(-iRadius, -iRadius, iRadius, iRadius);
+	QSet<FaceFeatureNode*> setSelected = m_setRubberBandBase;
+	foreach(FaceFeatureNode *pNode, faceFeaturesIn(oArea))
+		setSelected.insert(pNode);
+
+	// Only the nodes whose selection changed are updated
+	foreach(FaceFeatureNode *pNode, getSelectedFeatures())
+		if(!setSelected.contains(pNode))
+			pNode->setSelected(false);
+	foreach(FaceFeatureNode *pNode, setSelected)
+		if(!pNode->isSelected())
+			pNode->setSelected(true);
+}
+
 // +-----------------------------------------------------------
 void f3::FaceWidget::zoomIn()
 {
@@ -292,6 +400,7 @@ void f3::FaceWidget::createFaceFeatures()
 	// Add the face feature nodes
 	FaceFeatureNode *pPrevFeat = NULL;
 	FaceFeatureNode *pCurFeat = NULL;
+	beginBulkUpdate();
 	for(int i = 0; i < NUM_FACE_FEATURES; i++)
 	{
 		pCurFeat = addFaceFeature(QPoint(aFaceModel[i][0], aFaceModel[i][1]));
@@ -303,6 +412,7 @@ void f3::FaceWidget::createFaceFeatures()
 			pPrevFeat = pCurFeat;
 		}
 	}
+	endBulkUpdate();
 }
 
 // +-----------------------------------------------------------
@@ -349,7 +459,7 @@ QList<f3::FaceFeatureEdge*> f3::FaceWidget::getSelectedConnections() const
 	{
 		for(oSecond = oFirst + 1; oSecond != lFeatures.end(); ++oSecond)
 		{
-			pEdge = (*oFirst)->getEdgeTo(*oSecond);
+			pEdge = getConnection(*oFirst, *oSecond);
 			if(pEdge)
 			{
 				lSelected.append(pEdge);
@@ -361,6 +471,26 @@ QList<f3::FaceFeatureEdge*> f3::FaceWidget::getSelectedConnections() const
 	return lSelected;
 }
 
+// +-----------------------------------------------------------
+f3::FaceFeatureNode* f3::FaceWidget::faceFeatureAt(const QPointF &oPos) const
+{
+	if(!m_bDisplayFaceFeatures)
+		return NULL;
+	return m_oFeatureGrid.nearest(oPos, FaceFeatureNode::RADIUS);
+}
+
+// +-----------------------------------------------------------
+QList<f3::FaceFeatureNode*> f3::FaceWidget::faceFeaturesIn(const QRectF &oRect) const
+{
+	return m_oFeatureGrid.nodesIn(oRect);
+}
+
+// +-----------------------------------------------------------
+f3::FaceFeatureNode* f3::FaceWidget::nearestFaceFeature(const QPointF &oPos, const double dMaxDistance) const
+{
+	return m_oFeatureGrid.nearest(oPos, dMaxDistance);
+}
+
 // +-----------------------------------------------------------
 f3::FaceFeatureNode* f3::FaceWidget::addFaceFeature(const QPoint &oPos, bool bGlobal)
 {
@@ -368,49 +498,117 @@ f3::FaceFeatureNode* f3::FaceWidget::addFaceFeature(const QPoint &oPos, bool bGl
 	FaceFeatureNode *pNode = new FaceFeatureNode(iID, this);
 	m_pScene->addItem(pNode);
 	m_lFaceFeatures.append(pNode);
+
+	// Placing a new node is not a change to an existing one
+	beginBulkUpdate();
 	if(bGlobal)
 		pNode->setPos(mapToScene(mapFromGlobal(oPos)));
 	else
 		pNode->setPos(oPos);
+	endBulkUpdate();
+	m_oFeatureGrid.update(pNode);
+	updateFeaturesItem();
+	return pNode;
+}
+
+// +-----------------------------------------------------------
+f3::FaceFeatureNode* f3::FaceWidget::insertFaceFeature(const int iIndex, const QPointF &oPos)
+{
+	FaceFeatureNode *pNode;
+	if(iIndex < 0 || iIndex >= m_lFaceFeatures.size())
+		pNode = addFaceFeature();
+	else
+	{
+		pNode = new FaceFeatureNode(iIndex, this);
+		m_pScene->addItem(pNode);
+		m_lFaceFeatures.insert(iIndex, pNode);
+	}
+
+	// Placing a new node is not a change to an existing one
+	beginBulkUpdate();
+	pNode->setPos(oPos);
+	endBulkUpdate();
+	m_oFeatureGrid.update(pNode);
+
+	// Adjust the IDs of the features after the new one
+	for(int i = iIndex + 1; i < m_lFaceFeatures.size(); i++)
+		m_lFaceFeatures[i]->setID(i);
+	updateFeaturesItem();
 	return pNode;
 }
 
 // +-----------------------------------------------------------
 void f3::FaceWidget::removeFaceFeature(FaceFeatureNode* pNode)
 {
-	// First, remove all edges connected to the node
-	QList<FaceFeatureEdge*> lEdges = pNode->edges();
-	for(int i = 0; i < lEdges.size(); i++)
-		removeConnection(lEdges[i]);
+	removeFaceFeatures(QList<FaceFeatureNode*>() << pNode);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceWidget::removeFaceFeatures(const QList<FaceFeatureNode*> &lNodes)
+{
+	QSet<FaceFeatureNode*> setNodes = lNodes.toSet();
+
+	// First, remove all edges connected to the nodes
+	QSet<FaceFeatureEdge*> setEdges;
+	foreach(FaceFeatureNode *pNode, setNodes)
+		foreach(FaceFeatureEdge *pEdge, pNode->edges())
+			setEdges.insert(pEdge);
 
-	// Then, remove the node
-	m_lFaceFeatures.removeOne(pNode);
-	m_pScene->removeItem(pNode);
-	delete pNode;
+	beginBulkUpdate();
+	foreach(FaceFeatureEdge *pEdge, setEdges)
+		removeConnection(pEdge);
+	endBulkUpdate();
 
-	// And adjust the IDs of the remaining features
-	int iID = 0;
+	// Then, remove the nodes, adjusting the IDs of the remaining features in the same pass
+	QList<FaceFeatureNode*> lKeptNodes;
+	lKeptNodes.reserve(m_lFaceFeatures.size());
 	foreach(FaceFeatureNode *pNode, m_lFaceFeatures)
-		pNode->setID(iID++);
+	{
+		if(setNodes.contains(pNode))
+		{
+			m_setBulkMoved.remove(pNode);
+			m_setChangedFeatures.remove(pNode);
+			if(m_pStatusNode == pNode)
+				m_pStatusNode = NULL;
+			if(m_pHoveredNode == pNode)
+				m_pHoveredNode = NULL;
+			m_setRubberBandBase.remove(pNode);
+			m_oFeatureGrid.remove(pNode);
+			m_pScene->removeItem(pNode);
+			delete pNode;
+		}
+		else
+		{
+			pNode->setID(lKeptNodes.size());
+			lKeptNodes.append(pNode);
+		}
+	}
+	m_lFaceFeatures = lKeptNodes;
+	updateFeaturesItem();
 }
 
 // +-----------------------------------------------------------
 f3::FaceFeatureEdge* f3::FaceWidget::connectFaceFeatures(FaceFeatureNode* pSource, FaceFeatureNode* pTarget)
 {
-	FaceFeatureEdge* pEdge = pSource->getEdgeTo(pTarget);
+	FaceFeatureEdge* pEdge = getConnection(pSource, pTarget);
 	if(pEdge)
 		return pEdge;
 
 	pEdge = new FaceFeatureEdge(this, pSource, pTarget);
+	pEdge->setVisible(m_bDisplayConnections && !m_bBatchedRendering);
 	m_pScene->addItem(pEdge);
-	m_lConnections.append(pEdge);
+	m_hConnections.insert(connectionKey(pSource, pTarget), pEdge);
+	if(m_iBulkUpdateLevel > 0)
+		m_bBulkConnectionsChanged = true;
+	else
+		updateFeaturesItem();
 	return pEdge;
 }
 
 // +-----------------------------------------------------------
 void f3::FaceWidget::disconnectFaceFeatures(FaceFeatureNode* pSource, FaceFeatureNode* pTarget)
 {
-	FaceFeatureEdge *pEdge = pSource->getEdgeTo(pTarget);
+	FaceFeatureEdge *pEdge = getConnection(pSource, pTarget);
 	if(pEdge)
 		removeConnection(pEdge);
 }
@@ -420,22 +618,135 @@ void f3::FaceWidget::removeConnection(FaceFeatureEdge* pEdge)
 {
 	pEdge->sourceNode()->removeEdge(pEdge);
 	pEdge->targetNode()->removeEdge(pEdge);
-	m_lConnections.removeOne(pEdge);
+	m_hConnections.remove(connectionKey(pEdge->sourceNode(), pEdge->targetNode()));
 	m_pScene->removeItem(pEdge);
 	delete pEdge;
+	if(m_iBulkUpdateLevel > 0)
+		m_bBulkConnectionsChanged = true;
+	else
+		updateFeaturesItem();
+}
+
+// +-----------------------------------------------------------
+f3::FaceWidget::ConnectionKey f3::FaceWidget::connectionKey(const FaceFeatureNode* pSource, const FaceFeatureNode* pTarget)
+{
+	return pSource < pTarget ? qMakePair(pSource, pTarget) : qMakePair(pTarget, pSource);
+}
+
+// +-----------------------------------------------------------
+f3::FaceFeatureEdge* f3::FaceWidget::getConnection(const FaceFeatureNode* pSource, const FaceFeatureNode* pTarget) const
+{
+	return m_hConnections.value(connectionKey(pSource, pTarget), NULL);
+}
+
+// +-----------------------------------------------------------
+void f3::FaceWidget::setConnections(const std::vector<std::pair<int, int> > &vConnections)
+{
+	// The batched rendering is updated only once, after all the edges are replaced
+	beginBulkUpdate();
+	foreach(FaceFeatureEdge *pEdge, m_hConnections.values())
+		removeConnection(pEdge);
+
+	m_hConnections.reserve((int) vConnections.size());
+	for(unsigned int i = 0; i < vConnections.size(); i++)
+	{
+		if(vConnections[i].first < m_lFaceFeatures.size() && vConnections[i].second < m_lFaceFeatures.size())
+			connectFaceFeatures(m_lFaceFeatures[vConnections[i].first], m_lFaceFeatures[vConnections[i].second]);
+	}
+	endBulkUpdate();
 }
 
 // +-----------------------------------------------------------
 void f3::FaceWidget::faceFeatureMoved(FaceFeatureNode *pNode)
 {
-	Q_UNUSED(pNode);
+	m_oFeatureGrid.update(pNode);
+
+	if(m_iBulkUpdateLevel > 0)
+	{
+		m_setBulkMoved.insert(pNode);
+		if(!m_bBulkUserChange)
+			return;
+	}
+	else
+		updateFeaturesItem();
+
+	m_setChangedFeatures.insert(pNode);
 	m_bFeaturesMoved = true;
 }
 
+// +-----------------------------------------------------------
+void f3::FaceWidget::beginBulkUpdate(const bool bUserChange)
+{
+	if(m_iBulkUpdateLevel++ == 0)
+		m_bBulkUserChange = bUserChange;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceWidget::endBulkUpdate()
+{
+	if(m_iBulkUpdateLevel == 0 || --m_iBulkUpdateLevel > 0)
+		return;
+
+	// Adjust each edge affected only once, even if both its nodes were moved (the
+	// edge items are not drawn in the batched rendering, so they are adjusted only
+	// when it is disabled)
+	if(m_bBatchedRendering)
+	{
+		if(!m_setBulkMoved.isEmpty() || m_bBulkConnectionsChanged)
+			updateFeaturesItem();
+	}
+	else
+	{
+		QSet<FaceFeatureEdge*> setEdges;
+		foreach(FaceFeatureNode *pNode, m_setBulkMoved)
+			foreach(FaceFeatureEdge *pEdge, pNode->edges())
+				setEdges.insert(pEdge);
+		foreach(FaceFeatureEdge *pEdge, setEdges)
+			pEdge->adjust();
+	}
+
+	// The position displayed in the status bar is the one of the node grabbed by the mouse (if any)
+	if(m_bBulkUserChange && !m_setBulkMoved.isEmpty())
+	{
+		FaceFeatureNode *pGrabber = (FaceFeatureNode*) m_pScene->mouseGrabberItem();
+		m_pStatusNode = m_setBulkMoved.contains(pGrabber) ? pGrabber : *m_setBulkMoved.begin();
+		if(!m_pStatusTimer->isActive())
+			m_pStatusTimer->start();
+	}
+
+	m_setBulkMoved.clear();
+	m_bBulkUserChange = false;
+	m_bBulkConnectionsChanged = false;
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceWidget::isBulkUpdating() const
+{
+	return m_iBulkUpdateLevel > 0;
+}
+
+// +-----------------------------------------------------------
+QList<f3::FaceFeatureNode*> f3::FaceWidget::takeChangedFeatures()
+{
+	QList<FaceFeatureNode*> lRet = m_setChangedFeatures.toList();
+	m_setChangedFeatures.clear();
+	return lRet;
+}
+
 // +-----------------------------------------------------------
 void f3::FaceWidget::onSelectionChanged()
 {
 	m_bSelectionChanged = true;
+	if(m_bBatchedRendering)
+		m_pFeaturesItem->update();
+}
+
+// +-----------------------------------------------------------
+void f3::FaceWidget::onStatusTimeout()
+{
+	if(m_pStatusNode)
+		m_pStatusNode->showPositionInStatus();
+	m_pStatusNode = NULL;
 }
 
 // +-----------------------------------------------------------
@@ -452,6 +763,7 @@ void f3::FaceWidget::setDisplayFaceFeatures(const bool bValue)
 	m_bDisplayFaceFeatures = bValue;
 	foreach(FaceFeatureNode *pNode, m_lFaceFeatures)
 		pNode->setVisible(bValue);
+	m_pFeaturesItem->setVisible(bValue && m_bBatchedRendering);
 	update();
 }
 
@@ -468,8 +780,9 @@ void f3::FaceWidget::setDisplayConnections(const bool bValue)
 		return;
 
 	m_bDisplayConnections = bValue;
-	foreach(FaceFeatureEdge *pEdge, m_lConnections)
-		pEdge->setVisible(bValue);
+	foreach(FaceFeatureEdge *pEdge, m_hConnections)
+		pEdge->setVisible(bValue && !m_bBatchedRendering);
+	updateFeaturesItem();
 	update();
 }
 
@@ -482,12 +795,111 @@ bool f3::FaceWidget::displayFeatureIDs() const
 // +-----------------------------------------------------------
 void f3::FaceWidget::setDisplayFeatureIDs(const bool bValue)
 {
+	if(bValue == m_bDisplayFeatureIDs)
+		return;
+
 	m_bDisplayFeatureIDs = bValue;
 	foreach(FaceFeatureNode *pNode, m_lFaceFeatures)
+		pNode->updateBoundingRect();
+	updateFeaturesItem();
+	update();
+}
+
+// +-----------------------------------------------------------
+QStaticText f3::FaceWidget::featureLabel(const int iID) const
+{
+	// The zoom step is the number of zoom in (or out, if negative) steps nearest to the scale factor
+	int iZoomStep = qRound(qLn(m_dScaleFactor) / qLn(ZOOM_IN_STEP));
+	quint64 iKey = ((quint64) (quint32) iZoomStep << 32) | (quint64) (quint32) iID;
+
+	QStaticText *pLabel = m_oLabelCache.object(iKey);
+	if(!pLabel)
+	{
+		double dScale = qPow(ZOOM_IN_STEP, iZoomStep);
+		pLabel = new QStaticText(QString::number(iID));
+		pLabel->setTextFormat(Qt::PlainText);
+		pLabel->setPerformanceHint(QStaticText::AggressiveCaching);
+		pLabel->prepare(QTransform::fromScale(dScale, dScale), font());
+		m_oLabelCache.insert(iKey, pLabel);
+	}
+	return *pLabel;
+}
+
+// +-----------------------------------------------------------
+QSizeF f3::FaceWidget::featureLabelSize(const int iID) const
+{
+	if(iID < 0)
+		return QSizeF();
+
+	if(iID >= m_vLabelSizes.size())
+	{
+		int iFirst = m_vLabelSizes.size();
+		m_vLabelSizes.resize(iID + 1);
+		QFontMetrics oMetrics = fontMetrics();
+		for(int i = iFirst; i <= iID; i++)
+			m_vLabelSizes[i] = QSizeF(oMetrics.width(QString::number(i)), oMetrics.height());
+	}
+	return m_vLabelSizes[iID];
+}
+
+// +-----------------------------------------------------------
+void f3::FaceWidget::changeEvent(QEvent *pEvent)
+{
+	if(pEvent->type() == QEvent::FontChange)
+	{
+		m_oLabelCache.clear();
+		m_vLabelSizes.clear();
+		if(m_bDisplayFeatureIDs)
+		{
+			foreach(FaceFeatureNode *pNode, m_lFaceFeatures)
+				pNode->updateBoundingRect();
+			updateFeaturesItem();
+		}
+	}
+	QGraphicsView::changeEvent(pEvent);
+}
+
+// +-----------------------------------------------------------
+bool f3::FaceWidget::batchedRendering() const
+{
+	return m_bBatchedRendering;
+}
+
+// +-----------------------------------------------------------
+void f3::FaceWidget::setBatchedRendering(const bool bValue)
+{
+	if(bValue == m_bBatchedRendering)
+		return;
+
+	m_bBatchedRendering = bValue;
+
+	// The node items only paint (and cache) themselves when not drawn in batch
+	foreach(FaceFeatureNode *pNode, m_lFaceFeatures)
+	{
+		pNode->setCacheMode(bValue ? QGraphicsItem::NoCache : QGraphicsItem::DeviceCoordinateCache);
 		pNode->update();
+	}
+
+	// The edge items were not adjusted while drawn in batch
+	foreach(FaceFeatureEdge *pEdge, m_hConnections)
+	{
+		if(!bValue)
+			pEdge->adjust();
+		pEdge->setVisible(m_bDisplayConnections && !bValue);
+	}
+
+	m_pFeaturesItem->setVisible(m_bDisplayFaceFeatures && bValue);
+	updateFeaturesItem();
 	update();
 }
 
+// +-----------------------------------------------------------
+void f3::FaceWidget::updateFeaturesItem()
+{
+	if(m_bBatchedRendering)
+		m_pFeaturesItem->updateGeometry();
+}
+
 // +-----------------------------------------------------------
 void f3::FaceWidget::contextMenuEvent(QContextMenuEvent *pEvent)
 {
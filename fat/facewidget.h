@@ -21,13 +21,26 @@
 #define FACEWIDGET_H
 
 #include <QGraphicsView>
-#include <QGraphicsPixmapItem>
 #include <QMouseEvent>
 #include <QMenu>
 #include <QAction>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QTimer>
+#include <QRubberBand>
+#include <QStaticText>
+#include <QCache>
+#include <QVector>
 
 #include "facefeaturenode.h"
 #include "facefeatureedge.h"
+#include "facefeaturesitem.h"
+#include "facefeaturegrid.h"
+#include "tiledimageitem.h"
+
+#include <vector>
+#include <utility>
 
 namespace Ui {
     class MainWindow;
@@ -49,6 +62,12 @@ namespace f3
 		/** Scale value for the zoom out step. */
 		static const double ZOOM_OUT_STEP;
 
+		/** Interval (in miliseconds) of the updates of the status bar while nodes are dragged. */
+		static const int STATUS_UPDATE_INTERVAL;
+
+		/** Maximum number of feature labels kept in the cache (see featureLabel()). */
+		static const int LABEL_CACHE_SIZE;
+
 		/**
 		 * Class constructor.
 		 * @param pParent Instance of the parent widget.
@@ -66,6 +85,14 @@ namespace f3
 		 */
 		void setPixmap(const QPixmap &oPixmap);
 
+		/**
+		 * Updates the image displayed at the central area. The image is displayed in tiles, taken
+		 * from the resolution that matches the zoom (see TiledImageItem), so its pixels are never
+		 * uploaded or scaled as a whole.
+		 * @param oImage Reference for a QImage with the new image to display.
+		 */
+		void setImage(const QImage &oImage);
+
 		/**
 		 * Gets the currently applied scale factor on the image displayed.
 		 * @return Double with the currently applied scale factor.
@@ -113,6 +140,31 @@ namespace f3
 		 */
 		QList<FaceFeatureEdge*> getSelectedConnections() const;
 
+		/**
+		 * Queries the face feature node displayed at the given position (see FaceFeatureGrid).
+		 * @param oPos QPointF with the position to query, in scene coordinates.
+		 * @return Pointer to the node at the position (the nearest one, if there are more than one),
+		 * or NULL if there is no node there or if the nodes are not on display.
+		 */
+		FaceFeatureNode* faceFeatureAt(const QPointF &oPos) const;
+
+		/**
+		 * Queries the face feature nodes inside the given rectangle (see FaceFeatureGrid).
+		 * @param oRect QRectF with the rectangle to query, in scene coordinates.
+		 * @return QList with the pointers to the nodes inside the rectangle.
+		 */
+		QList<FaceFeatureNode*> faceFeaturesIn(const QRectF &oRect) const;
+
+		/**
+		 * Queries the face feature node nearest to the given position (useful to snap positions
+		 * to existing nodes).
+		 * @param oPos QPointF with the position to query, in scene coordinates.
+		 * @param dMaxDistance Double with the maximum distance of the node to the position, in scene
+		 * coordinates. The default is -1, indicating that there is no limit.
+		 * @return Pointer to the nearest node, or NULL if there is no node within the maximum distance.
+		 */
+		FaceFeatureNode* nearestFaceFeature(const QPointF &oPos, const double dMaxDistance = -1) const;
+
 		/**
 		 * Adds a new face feature node in the given position.
 		 * @param oPos A QPoint with the coordinates for the new node. If not provided, (0, 0) is assumed.
@@ -123,12 +175,29 @@ namespace f3
 		 */
 		FaceFeatureNode* addFaceFeature(const QPoint &oPos = QPoint(), bool bGlobal = false);
 
+		/**
+		 * Inserts a new face feature node at the given index (the identifiers of the nodes
+		 * after it are shifted).
+		 * @param iIndex Integer with the index of the new node. If it is out of bounds, the node
+		 * is added at the end.
+		 * @param oPos QPointF with the position of the new node in the scene coordinate system.
+		 * @return Pointer to the instance of the newly inserted face feature node.
+		 */
+		FaceFeatureNode* insertFaceFeature(const int iIndex, const QPointF &oPos);
+
 		/**
 		 * Removes an existing face feature node.
 		 * @param pNode Pointer to the instance of the face feature node to remove.
 		 */
 		void removeFaceFeature(FaceFeatureNode* pNode);
 
+		/**
+		 * Removes a set of existing face feature nodes at once, with their edges. The IDs of the
+		 * remaining nodes are adjusted only once, after all nodes are removed.
+		 * @param lNodes QList with the pointers to the instances of the face feature nodes to remove.
+		 */
+		void removeFaceFeatures(const QList<FaceFeatureNode*> &lNodes);
+
 		/**
 		 * Adds a new face feature edge connecting two existing nodes.
 		 * @param pSource Pointer to the instance of the first face feature node.
@@ -151,11 +220,57 @@ namespace f3
 		void removeConnection(FaceFeatureEdge* pEdge);
 
 		/**
-		 * Captures the indication that a face feature node has been moved by the user.
+		 * Queries the face feature edge connecting two nodes, in constant time.
+		 * @param pSource Pointer to the instance of the first face feature node.
+		 * @param pTarget Pointer to the instance of the second face feature node.
+		 * @return Pointer to the instance of the face feature edge connecting the two nodes (in
+		 * any order), or NULL if they are not connected.
+		 */
+		FaceFeatureEdge* getConnection(const FaceFeatureNode* pSource, const FaceFeatureNode* pTarget) const;
+
+		/**
+		 * Replaces all the face feature edges with the given connections.
+		 * @param vConnections Vector with the pairs of indexes of the face feature nodes to connect.
+		 */
+		void setConnections(const std::vector<std::pair<int, int> > &vConnections);
+
+		/**
+		 * Captures the indication that a face feature node has been moved. The node is recorded in
+		 * the set of changed nodes, unless it was moved in a bulk update that is not a change made by
+		 * the user (see beginBulkUpdate()).
 		 * @param pNode Instance of the Face Feature Node that has been moved.
 		 */
 		void faceFeatureMoved(FaceFeatureNode *pNode);
 
+		/**
+		 * Starts a bulk update of the face feature nodes. Until the matching call to endBulkUpdate(),
+		 * the nodes moved do not adjust their edges nor update the status bar, so moving many nodes
+		 * costs a single adjustment of each affected edge at the end. Likewise, the edges added or
+		 * removed only update the batched rendering at the end. Bulk updates can be nested.
+		 * @param bUserChange Boolean indicating if the nodes are moved due to a change made by the user
+		 * (true), so they are recorded as changed, or to display existing data (false, the default).
+		 */
+		void beginBulkUpdate(const bool bUserChange = false);
+
+		/**
+		 * Ends a bulk update of the face feature nodes (see beginBulkUpdate()). When the outermost
+		 * bulk update ends, the edges of the nodes moved during it are adjusted (once each).
+		 */
+		void endBulkUpdate();
+
+		/**
+		 * Indicates if a bulk update of the face feature nodes is in progress.
+		 * @return Boolean indicating if a bulk update is in progress (true) or not (false).
+		 */
+		bool isBulkUpdating() const;
+
+		/**
+		 * Gets the face feature nodes changed by the user since the last call to this method, and
+		 * clears that set of changes.
+		 * @return QList with the pointers to the face feature nodes changed, in no particular order.
+		 */
+		QList<FaceFeatureNode*> takeChangedFeatures();
+
 		/**
 		 * Indicates if the face feature nodes are on display.
 		 * @return Boolean indicating if the face feature nodes are being displayed or not.
@@ -192,6 +307,37 @@ namespace f3
 		 */
 		void setDisplayFeatureIDs(const bool bValue);
 
+		/**
+		 * Gets the label with the identifier of a face feature node, ready to be drawn. The labels
+		 * are laid out only once for each zoom step and kept in a cache, so drawing them repeatedly
+		 * while zooming and panning does not require shaping the text again.
+		 * @param iID Integer with the identifier of the face feature node.
+		 * @return QStaticText with the label of the node.
+		 */
+		QStaticText featureLabel(const int iID) const;
+
+		/**
+		 * Gets the size of the label with the identifier of a face feature node (the sizes
+		 * are measured only once, and kept until the font of the widget changes).
+		 * @param iID Integer with the identifier of the face feature node.
+		 * @return QSizeF with the size of the label, in scene units.
+		 */
+		QSizeF featureLabelSize(const int iID) const;
+
+		/**
+		 * Indicates if the face feature nodes and edges are drawn in batch (see FaceFeaturesItem).
+		 * @return Boolean indicating if the batched rendering is in use or not.
+		 */
+		bool batchedRendering() const;
+
+		/**
+		 * Updates the indication on if the face feature nodes and edges shall be drawn in batch, by a single
+		 * graphics item, or individually by their own items. The individual node items are used for the
+		 * interaction (selection and dragging) in both cases.
+		 * @param bValue Boolean with the new value (true means to draw in batch, false means to draw individually).
+		 */
+		void setBatchedRendering(const bool bValue);
+
 		/**
 		 * Sets the menu to be displayed upon events of context menu on the face features editor.
 		 * The actions used in the menu must be controlled by the caller.
@@ -227,6 +373,17 @@ namespace f3
 
 	protected:
 
+		/** Key of an edge in the hash of connections: the pair of nodes, the lowest address first. */
+		typedef QPair<const FaceFeatureNode*, const FaceFeatureNode*> ConnectionKey;
+
+		/**
+		 * Builds the key of the edge connecting the two given nodes, independent of their order.
+		 * @param pSource Pointer to the instance of the first face feature node.
+		 * @param pTarget Pointer to the instance of the second face feature node.
+		 * @return ConnectionKey with the key of the edge.
+		 */
+		static ConnectionKey connectionKey(const FaceFeatureNode* pSource, const FaceFeatureNode* pTarget);
+
 	#ifndef QT_NO_WHEELEVENT
 		/**
 		 * Captures and handles the mouse wheel events to automate user interactions.
@@ -247,6 +404,15 @@ namespace f3
 		 */
 		void mouseReleaseEvent(QMouseEvent *pEvent);
 
+		/**
+		 * Captures the movement of the mouse. When nodes are being dragged, all the selected nodes
+		 * are moved by the scene in a single bulk update (see beginBulkUpdate()), so each affected
+		 * edge is adjusted once per movement and the status bar is updated at most once per
+		 * STATUS_UPDATE_INTERVAL.
+		 * @param pEvent Instance of the QMouseEvent with the event data.
+		 */
+		void mouseMoveEvent(QMouseEvent *pEvent) Q_DECL_OVERRIDE;
+
 		/**
 		 * Scales the widget view to emulate a zoom behaviour by the given factor.
 		 * @param dFactorBy Double with the scale to be added/removed.
@@ -264,6 +430,33 @@ namespace f3
 		 */
 		void contextMenuEvent(QContextMenuEvent *pEvent) Q_DECL_OVERRIDE;
 
+		/**
+		 * Captures the changes in the widget, to discard the cached feature labels when the font changes.
+		 * @param pEvent Instance of a QEvent with the event data.
+		 */
+		void changeEvent(QEvent *pEvent) Q_DECL_OVERRIDE;
+
+		/**
+		 * Updates the node under the mouse cursor, displaying its position in the status bar.
+		 * It replaces the hover events of the node items, that would require the scene to search
+		 * all items at each movement of the mouse.
+		 * @param oPos QPointF with the position of the mouse, in scene coordinates.
+		 */
+		void updateHoveredFeature(const QPointF &oPos);
+
+		/**
+		 * Updates the rubber band and the selection of the nodes inside it, querying only the
+		 * nodes in its area.
+		 * @param oPos QPoint with the position of the mouse, in viewport coordinates.
+		 */
+		void updateRubberBand(const QPoint &oPos);
+
+		/**
+		 * Updates the geometry of the item used for the batched rendering, if it is in use. It must
+		 * be called after any change in the face feature nodes or edges.
+		 */
+		void updateFeaturesItem();
+
 	protected slots:
 
 		/**
@@ -271,6 +464,11 @@ namespace f3
 		 */
 		void onSelectionChanged();
 
+		/**
+		 * Displays the position of the last node dragged in the status bar (coalesced updates).
+		 */
+		void onStatusTimeout();
+
 	private:
 
 		/** Indication about the feature nodes being moved. */
@@ -282,8 +480,8 @@ namespace f3
 		/** The scene used to render the widget contents. */
 		QGraphicsScene *m_pScene;
 
-		/** Pixmap item used to display the face image. */
-		QGraphicsPixmapItem *m_pPixmapItem;
+		/** Item used to display the face image. */
+		TiledImageItem *m_pImageItem;
 
 		/** The current applied scale factor. */
 		double m_dScaleFactor;
@@ -291,8 +489,44 @@ namespace f3
 		/** List of nodes used to edit the coordinates of facial features. */
 		QList<FaceFeatureNode*> m_lFaceFeatures;
 
-		/** List of edges connecting two feature nodes. */
-		QList<FaceFeatureEdge*> m_lConnections;
+		/** Spatial index of the feature nodes, updated as they are added, moved or removed. */
+		FaceFeatureGrid m_oFeatureGrid;
+
+		/** Node currently under the mouse cursor (or NULL if none). */
+		FaceFeatureNode *m_pHoveredNode;
+
+		/** Rubber band used to select the feature nodes in an area. */
+		QRubberBand *m_pRubberBand;
+
+		/** Position where the rubber band started, in viewport coordinates. */
+		QPoint m_oRubberBandOrigin;
+
+		/** Nodes kept selected during the selection with the rubber band (selected before it started). */
+		QSet<FaceFeatureNode*> m_setRubberBandBase;
+
+		/** Edges connecting two feature nodes, indexed by the nodes they connect (see connectionKey()). */
+		QHash<ConnectionKey, FaceFeatureEdge*> m_hConnections;
+
+		/** Nesting level of the bulk updates in progress (0 if there are none). */
+		int m_iBulkUpdateLevel;
+
+		/** Indication that the bulk update in progress is due to changes made by the user. */
+		bool m_bBulkUserChange;
+
+		/** Indication that edges were added or removed during the current bulk update. */
+		bool m_bBulkConnectionsChanged;
+
+		/** Nodes moved during the bulk update in progress, whose edges are adjusted when it ends. */
+		QSet<FaceFeatureNode*> m_setBulkMoved;
+
+		/** Nodes changed by the user since the changes were last taken (see takeChangedFeatures()). */
+		QSet<FaceFeatureNode*> m_setChangedFeatures;
+
+		/** Timer used to coalesce the updates of the status bar while nodes are dragged. */
+		QTimer *m_pStatusTimer;
+
+		/** Node whose position is displayed when the status timer fires (or NULL if none). */
+		FaceFeatureNode *m_pStatusNode;
 
 		/** Indicates if the face feature nodes should be displayed or not. */
 		bool m_bDisplayFaceFeatures;
@@ -303,6 +537,18 @@ namespace f3
 		/** Indicates if the IDs of the face feature nodes should be displayed or not. */
 		bool m_bDisplayFeatureIDs;
 
+		/** Cache of the feature labels, by identifier and zoom step (see featureLabel()). */
+		mutable QCache<quint64, QStaticText> m_oLabelCache;
+
+		/** Sizes of the feature labels, by identifier (see featureLabelSize()). */
+		mutable QVector<QSizeF> m_vLabelSizes;
+
+		/** Indicates if the face feature nodes and edges are drawn in batch or not. */
+		bool m_bBatchedRendering;
+
+		/** Item that draws all face feature nodes and edges when the batched rendering is in use. */
+		FaceFeaturesItem *m_pFeaturesItem;
+
 		/** Context menu for the face feature editor. */
 		QMenu *m_pContextMenu;
 	};
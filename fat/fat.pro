@@ -37,7 +37,13 @@ SOURCES += main.cpp \
            emotiondelegate.cpp \
            facefeaturenode.cpp \
            facefeatureedge.cpp \
-           facewidgetscene.cpp
+           facefeaturesitem.cpp \
+           facefeaturegrid.cpp \
+           tiledimageitem.cpp \
+           thumbnailatlas.cpp \
+           thumbnaildelegate.cpp \
+           facewidgetscene.cpp \
+           undocommands.cpp
            
 HEADERS += mainwindow.h \
            childwindow.h \
@@ -47,7 +53,13 @@ HEADERS += mainwindow.h \
            emotiondelegate.h \
            facefeaturenode.h \
            facefeatureedge.h \
-           facewidgetscene.h
+           facefeaturesitem.h \
+           facefeaturegrid.h \
+           tiledimageitem.h \
+           thumbnailatlas.h \
+           thumbnaildelegate.h \
+           facewidgetscene.h \
+           undocommands.h
 
 FORMS += mainwindow.ui \
          aboutwindow.ui
@@ -60,8 +72,8 @@ win32 {
 	LIBS += -L/usr/local/lib
 }
 
-DEPENDS += ../core
-INCLUDEPATH += ../core
+DEPENDS += ../core ../gui
+INCLUDEPATH += ../core ../gui
 
 CONFIG(debug, debug|release) {
 
@@ -73,32 +85,13 @@ CONFIG(debug, debug|release) {
 	UI_DIR = ../debug/tmp/fat
 
 	LIBS += -L../debug
+	LIBS += -lf3guid
 	LIBS += -lf3cored
 
 	win32 {
-		LIBS += -lopencv_core2410d \
-				-lopencv_imgproc2410d \
-				-lopencv_highgui2410d \
-				-lopencv_ml2410d \
-				-lopencv_video2410d \
-				-lopencv_features2d2410d \
-				-lopencv_calib3d2410d \
-				-lopencv_objdetect2410d \
-				-lopencv_contrib2410d \
-				-lopencv_legacy2410d \
-				-lopencv_flann2410d
+		LIBS += -lopencv_core2410d
 	} else:unix {
-		LIBS += -lopencv_core \
-				-lopencv_imgproc \
-				-lopencv_highgui \
-				-lopencv_ml \
-				-lopencv_video \
-				-lopencv_features2d \
-				-lopencv_calib3d \
-				-lopencv_objdetect \
-				-lopencv_contrib \
-				-lopencv_legacy \
-				-lopencv_flann
+		LIBS += -lopencv_core
 	}
 
 } else {
@@ -111,35 +104,21 @@ CONFIG(debug, debug|release) {
 	UI_DIR = ../release/tmp/fat
 
 	LIBS += -L../release
+	LIBS += -lf3gui
 	LIBS += -lf3core
 
 	win32 {
-		LIBS += -lopencv_core2410 \
-				-lopencv_imgproc2410 \
-				-lopencv_highgui2410 \
-				-lopencv_ml2410 \
-				-lopencv_video2410 \
-				-lopencv_features2d2410 \
-				-lopencv_calib3d2410 \
-				-lopencv_objdetect2410 \
-				-lopencv_contrib2410 \
-				-lopencv_legacy2410 \
-				-lopencv_flann2410
+		LIBS += -lopencv_core2410
 	} else:unix {
-		LIBS += -lopencv_core \
-				-lopencv_imgproc \
-				-lopencv_highgui \
-				-lopencv_ml \
-				-lopencv_video \
-				-lopencv_features2d \
-				-lopencv_calib3d \
-				-lopencv_objdetect \
-				-lopencv_contrib \
-				-lopencv_legacy \
-				-lopencv_flann
+		LIBS += -lopencv_core
 	}
 }
 
+# Startup benchmark: runs the application until its main window is interactive and prints
+# the time spent up to each startup phase (including the first paint) as tab-separated values
+startupbench.commands = $$DESTDIR/$$TARGET --startup-benchmark
+QMAKE_EXTRA_TARGETS += startupbench
+
 RESOURCES += resources.qrc
 win32:RC_FILE = win_resources.rc
 
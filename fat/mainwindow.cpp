@@ -24,9 +24,6 @@
 #include "application.h"
 #include "emotiondelegate.h"
 
-#include <opencv2/core/core.hpp>
-#include <opencv2/highgui/highgui.hpp>
-
 #include <vector>
 
 #include <QApplication>
@@ -35,8 +32,14 @@
 #include <QDesktopServices>
 #include <QAction>
 #include <QMessageBox>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QtMath>
+
+#include <opencv2/core/core.hpp>
 
-using namespace cv;
 using namespace std;
 
 // +-----------------------------------------------------------
@@ -52,6 +55,7 @@ f3::MainWindow::MainWindow(QWidget *pParent) :
 
     setWindowState(Qt::WindowMaximized);
     m_pAbout = NULL;
+	m_pEmotionDelegate = NULL;
 
     setWindowIcon(QIcon(":/icons/fat"));
 	ui->tabWidget->setAutoFillBackground(true);
@@ -85,9 +89,49 @@ f3::MainWindow::MainWindow(QWidget *pParent) :
 	m_pViewButton->setIcon(QIcon(":/icons/viewicons")); // By default display the image thumbnails
 	ui->treeImages->setVisible(false);
 
+	// All items have the same size, so the views of the image list do not need to query
+	// the data of every row to lay them out (only the data of the visible ones)
+	ui->listImages->setUniformItemSizes(true);
+	ui->treeImages->setUniformRowHeights(true);
+
+	// The thumbnails are painted straight from the atlas of the model
+	m_pThumbnailDelegate = new ThumbnailDelegate(this);
+	ui->listImages->setItemDelegate(m_pThumbnailDelegate);
+	ui->treeImages->setItemDelegateForColumn(0, m_pThumbnailDelegate);
+
 	// Initialize other variables
 	m_sDocumentsPath = QDir::toNativeSeparators(QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation)) + QDir::separator();
 
+	// Create the undo/redo actions (they follow the undo stack of the current child window)
+	m_pUndoGroup = new QUndoGroup(this);
+	QAction *pUndoAction = m_pUndoGroup->createUndoAction(this, tr("&Desfazer"));
+	pUndoAction->setShortcut(QKeySequence::Undo);
+	QAction *pRedoAction = m_pUndoGroup->createRedoAction(this, tr("&Refazer"));
+	pRedoAction->setShortcut(QKeySequence::Redo);
+	QAction *pFirstAction = ui->menuEdit->actions().isEmpty() ? NULL : ui->menuEdit->actions().first();
+	ui->menuEdit->insertAction(pFirstAction, pUndoAction);
+	ui->menuEdit->insertAction(pFirstAction, pRedoAction);
+	ui->menuEdit->insertSeparator(pFirstAction);
+
+	// Create the option of batched rendering of the face features (useful with many features)
+	m_pBatchedRenderingAction = new QAction(tr("Desenho &agrupado das marcas"), this);
+	m_pBatchedRenderingAction->setCheckable(true);
+	m_pBatchedRenderingAction->setStatusTip(tr("Desenha todas as marcas faciais e suas conexões de uma só vez (mais rápido com muitas marcas)"));
+	ui->menu_Marcas_Faciais->addSeparator();
+	ui->menu_Marcas_Faciais->addAction(m_pBatchedRenderingAction);
+	connect(m_pBatchedRenderingAction, SIGNAL(triggered()), this, SLOT(onUpdateUI()));
+
+	// Create the batch editing of the face features of the images selected
+	m_pTransformFeaturesAction = new QAction(tr("&Transformar marcas das imagens selecionadas..."), this);
+	m_pTransformFeaturesAction->setStatusTip(tr("Desloca, escala ou rotaciona as marcas faciais de todas as imagens selecionadas"));
+	m_pCopyFeaturesAction = new QAction(tr("C&opiar marcas da imagem atual para as selecionadas"), this);
+	m_pCopyFeaturesAction->setStatusTip(tr("Copia as posições das marcas faciais da imagem atual para as demais imagens selecionadas"));
+	ui->menu_Marcas_Faciais->insertAction(m_pBatchedRenderingAction, m_pTransformFeaturesAction);
+	ui->menu_Marcas_Faciais->insertAction(m_pBatchedRenderingAction, m_pCopyFeaturesAction);
+	ui->menu_Marcas_Faciais->insertSeparator(m_pBatchedRenderingAction);
+	connect(m_pTransformFeaturesAction, SIGNAL(triggered()), this, SLOT(onTransformFeaturesTriggered()));
+	connect(m_pCopyFeaturesAction, SIGNAL(triggered()), this, SLOT(onCopyFeaturesTriggered()));
+
 	// Add the action shortcuts to the tooltips (in order to make it easier for the user to know they exist)
 	// P.S.: I wonder why doesn't Qt do that automatically... :)
 	QObjectList lsObjects = children();
@@ -121,8 +165,12 @@ f3::MainWindow::MainWindow(QWidget *pParent) :
 	connect(ui->radioSadness, SIGNAL(toggled(bool)), this, SLOT(onEmotionToggled(bool)));
 	connect(ui->radioSurprise, SIGNAL(toggled(bool)), this, SLOT(onEmotionToggled(bool)));
 
-	// Item delegate to allow editing the emotion label directly through the TreeView
-	ui->treeImages->setItemDelegate(new EmotionDelegate());
+	// Progress of the loadings and savings done in background (only visible while they run)
+	m_pProgressBar = new QProgressBar(ui->statusBar);
+	m_pProgressBar->setRange(0, 100);
+	m_pProgressBar->setMaximumWidth(200);
+	m_pProgressBar->setVisible(false);
+	ui->statusBar->addPermanentWidget(m_pProgressBar);
 }
 
 // +-----------------------------------------------------------
@@ -174,7 +222,7 @@ void f3::MainWindow::closeEvent(QCloseEvent *pEvent)
 			{
 				pChild = lModified[i];
 				ui->tabWidget->setCurrentWidget(pChild);
-				if(!saveCurrentFile())
+				if(!saveCurrentFile(false, true))
 				{
 					pEvent->ignore();
 					return;
@@ -183,6 +231,16 @@ void f3::MainWindow::closeEvent(QCloseEvent *pEvent)
 		}
 	}
 
+	// Do not leave any saving in background unfinished
+	QString sMsg;
+	for(int i = 0; i < ui->tabWidget->count(); i++)
+	{
+		pChild = (ChildWindow*) ui->tabWidget->widget(i);
+		pChild->waitForSave(sMsg);
+		if(!pChild->isLoading()) // The recovery of datasets still loading was not yet offered
+			pChild->discardAutosave();
+	}
+
 	pEvent->accept();
 }
 
@@ -206,7 +264,7 @@ void f3::MainWindow::on_actionNew_triggered()
 // +-----------------------------------------------------------
 void f3::MainWindow::on_actionOpen_triggered()
 {
-    QString sFile = QFileDialog::getOpenFileName(this, tr("Abrir banco de faces anotadas..."), m_sDocumentsPath, tr("Arquivos de banco de faces anotadas (*.afd);; Todos os arquivos (*.*)"));
+    QString sFile = QFileDialog::getOpenFileName(this, tr("Abrir banco de faces anotadas..."), m_sDocumentsPath, tr("Arquivos de banco de faces anotadas (*.afd *.afm *.afdb);; Todos os arquivos (*.*)"));
     if(sFile.length())
 	{
 		sFile = QDir::toNativeSeparators(sFile);
@@ -218,18 +276,9 @@ void f3::MainWindow::on_actionOpen_triggered()
 		}
 		else
 		{
+			// The dataset is loaded in background (see onChildLoadFinished)
 			ChildWindow *pChild = createChildWindow(sFile, false);
-
-			QString sMsg;
-			if(!pChild->loadFromFile(sFile, sMsg))
-			{
-				destroyChildWindow(pChild);
-				QMessageBox::warning(this, tr("Erro carregando banco de faces anotadas"), tr("Não foi possível abrir o banco de faces anotadas:\n%1").arg(sMsg), QMessageBox::Ok);
-				return;
-			}
-
-			if(pChild->dataModel()->rowCount() > 0)
-				pChild->selectionModel()->setCurrentIndex(pChild->dataModel()->index(0, 0), QItemSelectionModel::Select);
+			pChild->loadFromFile(sFile);
 			updateUI();
 		}
 	}
@@ -248,46 +297,37 @@ void f3::MainWindow::on_actionSaveAs_triggered()
 }
 
 // +-----------------------------------------------------------
-bool f3::MainWindow::saveCurrentFile(bool bAskForFileName)
+bool f3::MainWindow::saveCurrentFile(bool bAskForFileName, bool bWait)
 {
 	ChildWindow *pChild = (ChildWindow*) ui->tabWidget->currentWidget();
-	if(!pChild || !pChild->isWindowModified())
+	if(!pChild)
 		return false;
 
-	if(bAskForFileName)
-	{
-		QString sFileName = QFileDialog::getSaveFileName(this, tr("Salvar banco de faces anotadas..."), windowFilePath(), tr("Arquivos de banco de faces anotadas (*.afd);; Todos os arquivos (*.*)"));
-		if(sFileName.length())
-		{
-			QString sMsg;
-			if(!pChild->saveToFile(sFileName, sMsg))
-			{
-				QMessageBox::warning(this, tr("Erro gravando banco de faces anotadas"), tr("Não foi possível salvar o banco de faces anotadas:\n%1").arg(sMsg), QMessageBox::Ok);
-				return false;
-			}
+	QString sMsg;
 
-			return true;
-		}
-		else
+	// A saving is already in progress
+	if(pChild->isSaving())
+		return bWait ? pChild->waitForSave(sMsg) : false;
+
+	if(!pChild->isWindowModified())
+		return false;
+
+	// Force the user to chose a file name if the dataset has not yet been saved
+	QString sFileName;
+	if(bAskForFileName || pChild->property("new").toBool())
+	{
+		sFileName = QFileDialog::getSaveFileName(this, tr("Salvar banco de faces anotadas..."), windowFilePath(), tr("Arquivos de banco de faces anotadas (*.afd);; Manifestos de banco de faces anotadas particionado (*.afm);; Bancos de dados SQLite de faces anotadas (*.afdb);; Todos os arquivos (*.*)"));
+		if(!sFileName.length())
 			return false;
 	}
 	else
-	{
-		// Force the user to chose a file name if the dataset has not yet been saved
-		if(pChild->property("new").toBool())
-			return saveCurrentFile(true);
-		else
-		{
-			QString sMsg;
-			if(!pChild->save(sMsg))
-			{
-				QMessageBox::warning(this, tr("Erro gravando banco de faces anotadas"), tr("Não foi possível salvar o banco de faces anotadas:\n%1").arg(sMsg), QMessageBox::Ok);
-				return false;
-			}
+		sFileName = pChild->windowFilePath();
 
-			return true;
-		}
-	}
+	// Errors are reported when the saving is finished (see onChildSaveFinished)
+	pChild->saveToFile(sFileName);
+	updateUI();
+
+	return bWait ? pChild->waitForSave(sMsg) : true;
 }
 
 // +-----------------------------------------------------------
@@ -305,7 +345,10 @@ void f3::MainWindow::on_actionProject_triggered()
 // +-----------------------------------------------------------
 void f3::MainWindow::on_actionAbout_triggered()
 {
-	(new AboutWindow(this))->show();
+	// The about window is only created the first time it is requested
+	if(!m_pAbout)
+		m_pAbout = new AboutWindow(this);
+	m_pAbout->show();
 }
 
 // +-----------------------------------------------------------
@@ -321,10 +364,14 @@ void f3::MainWindow::on_tabCloseRequested(int iTabIndex)
 		// Do not close the tab if the user has chosen "cancel" or if she has chosen "yes" but then
 		// cancelled the file save dialog
 		ui->tabWidget->setCurrentIndex(iTabIndex);
-		if(oResp == QMessageBox::Cancel || (oResp == QMessageBox::Yes && !saveCurrentFile()))
+		if(oResp == QMessageBox::Cancel || (oResp == QMessageBox::Yes && !saveCurrentFile(false, true)))
 			return;
 	}
 
+	// The user decided about the pending changes, so the autosaved copy is no longer needed
+	// (unless the dataset is still loading, and hence its recovery was not yet offered)
+	if(!pChild->isLoading())
+		pChild->discardAutosave();
 	destroyChildWindow(pChild);
 
 	if(ui->tabWidget->count() == 0) // no more tabs
@@ -343,6 +390,8 @@ void f3::MainWindow::on_tabCloseRequested(int iTabIndex)
 void f3::MainWindow::on_tabChanged(int iTabIndex)
 {
 	Q_UNUSED(iTabIndex);
+	ChildWindow *pChild = (ChildWindow*) ui->tabWidget->currentWidget();
+	m_pUndoGroup->setActiveStack(pChild ? pChild->undoStack() : NULL);
 	updateUI();
 }
 
@@ -380,9 +429,21 @@ void f3::MainWindow::on_actionRemoveImage_triggered()
 		if(QMessageBox::question(this, tr("Confirmação da remoção"), sMsg, QMessageBox::Yes|QMessageBox::No) == QMessageBox::Yes)
 		{
 			QList<int> lIndexes;
+			int iFirst = lsSelected[0].row();
 			for(int i = 0; i < lsSelected.size(); i++)
+			{
 				lIndexes.append(lsSelected[i].row());
+				iFirst = qMin(iFirst, lsSelected[i].row());
+			}
 			pChild->dataModel()->removeImages(lIndexes);
+
+			// The model is reset if the rows removed were too scattered, so the image after the
+			// first one removed is selected
+			if(!pChild->selectionModel()->currentIndex().isValid() && pChild->dataModel()->rowCount() > 0)
+			{
+				int iRow = qMin(iFirst, pChild->dataModel()->rowCount() - 1);
+				pChild->selectionModel()->setCurrentIndex(pChild->dataModel()->index(iRow, 0), QItemSelectionModel::Select);
+			}
 		}
 	}
 }
@@ -453,7 +514,7 @@ void f3::MainWindow::on_actionRemoveFeature_triggered()
 	if(!pChild)
 		return;
 
-	QString sMsg = tr("Tem certeza de que deseja remover as marcas faciais selecionadas? Essa ação não pode ser desfeita.");
+	QString sMsg = tr("Tem certeza de que deseja remover as marcas faciais selecionadas?");
 	QMessageBox::StandardButton oResp = QMessageBox::question(this, tr("Confirmação de Remoção"), sMsg, QMessageBox::Yes|QMessageBox::No);
 
 	if(oResp == QMessageBox::Yes)
@@ -508,6 +569,15 @@ void f3::MainWindow::setImageListView(QString sType)
 	if(sType == "details")
 	{
 		m_pViewButton->setIcon(QIcon(":/icons/viewdetails"));
+
+		// Item delegate to allow editing the emotion label directly through the TreeView
+		// (created only when needed, since the details view is not displayed by default)
+		if(!m_pEmotionDelegate)
+		{
+			m_pEmotionDelegate = new EmotionDelegate(this);
+			ui->treeImages->setItemDelegate(m_pEmotionDelegate);
+		}
+
 		ui->listImages->setVisible(false);
 		ui->treeImages->setVisible(true);
 		//disconnect(ui->listImages->selectionModel(), SIGNAL(currentChanged(const QModelIndex &, const QModelIndex &)), this, SLOT(onthumbnailSelected(const QModelIndex &, const QModelIndex &)));
@@ -562,7 +632,8 @@ void f3::MainWindow::updateUI()
 	ChildWindow *pChild = (ChildWindow*) ui->tabWidget->currentWidget();
 
 	bool bFileOpened = pChild != NULL;
-	bool bFileChanged = bFileOpened ? pChild->isWindowModified() : false;
+	bool bFileLoading = bFileOpened && pChild->isLoading();
+	bool bFileChanged = bFileOpened ? pChild->isWindowModified() && !pChild->isSaving() : false;
 	bool bItemsSelected = bFileOpened && (pChild->selectionModel()->currentIndex().isValid() || pChild->selectionModel()->selectedIndexes().size() > 0);
 	bool bFileNotNew = bFileOpened && !pChild->property("new").toBool();
 
@@ -593,16 +664,19 @@ void f3::MainWindow::updateUI()
 	}
 
 	// Update the UI availability
-	ui->actionSave->setEnabled(bFileChanged);
-	ui->actionSaveAs->setEnabled(bFileNotNew);
-	ui->actionAddImage->setEnabled(bFileOpened);
-	ui->actionRemoveImage->setEnabled(bItemsSelected);
-	ui->actionAddFeature->setEnabled(bFileOpened);
-	ui->actionRemoveFeature->setEnabled(bFeaturesSelected);
-	ui->actionConnectFeatures->setEnabled(bFeaturesConnectable);
-	ui->actionDisconnectFeatures->setEnabled(bConnectionsSelected);
+	// (the dataset can not be edited nor saved while it is being loaded)
+	ui->actionSave->setEnabled(bFileChanged && !bFileLoading);
+	ui->actionSaveAs->setEnabled(bFileNotNew && !bFileLoading && !pChild->isSaving());
+	ui->actionAddImage->setEnabled(bFileOpened && !bFileLoading);
+	ui->actionRemoveImage->setEnabled(bItemsSelected && !bFileLoading);
+	ui->actionAddFeature->setEnabled(bFileOpened && !bFileLoading);
+	ui->actionRemoveFeature->setEnabled(bFeaturesSelected && !bFileLoading);
+	ui->actionConnectFeatures->setEnabled(bFeaturesConnectable && !bFileLoading);
+	ui->actionDisconnectFeatures->setEnabled(bConnectionsSelected && !bFileLoading);
 	m_pViewButton->setEnabled(bFileOpened);
-	ui->groupEmotions->setEnabled(bItemsSelected);
+	ui->groupEmotions->setEnabled(bItemsSelected && !bFileLoading);
+	m_pTransformFeaturesAction->setEnabled(bItemsSelected && !bFileLoading);
+	m_pCopyFeaturesAction->setEnabled(bFileOpened && pChild->selectionModel()->selectedRows().size() > 1 && !bFileLoading);
 	ui->zoomSlider->setEnabled(bFileOpened);
 
 	// Update the tab title and tooltip
@@ -626,6 +700,7 @@ void f3::MainWindow::updateUI()
 		pChild->setDisplayFaceFeatures(ui->actionShowFeatures->isChecked());
 		pChild->setDisplayConnections(ui->actionShowFeatures->isChecked() && ui->actionShowConnections->isChecked());
 		pChild->setDisplayFeatureIDs(ui->actionShowFeatures->isChecked() && ui->actionShowFeatureIDs->isChecked());
+		pChild->setBatchedRendering(m_pBatchedRenderingAction->isChecked());
 	}
 
 }
@@ -674,6 +749,17 @@ void f3::MainWindow::keyPressEvent(QKeyEvent *pEvent)
 			pEvent->accept();
 			break;
 
+		case Qt::Key_Escape:
+			if(pChild->isLoading())
+			{
+				pChild->setProperty("cancelled", true);
+				pChild->cancelLoading();
+				pEvent->accept();
+			}
+			else
+				QMainWindow::keyPressEvent(pEvent);
+			break;
+
 		default:
 			QMainWindow::keyPressEvent(pEvent);
     }
@@ -702,6 +788,68 @@ void f3::MainWindow::onEmotionToggled(bool bValue)
 	pChild->updateEmotionLabel(eLabel);
 }
 
+// +-----------------------------------------------------------
+void f3::MainWindow::onTransformFeaturesTriggered()
+{
+	ChildWindow *pChild = (ChildWindow*) ui->tabWidget->currentWidget();
+	if(!pChild)
+		return;
+
+	QDialog oDialog(this);
+	oDialog.setWindowTitle(tr("Transformar marcas de %1 imagens").arg(pChild->getSelectedImages().size()));
+
+	QDoubleSpinBox *pShiftX = new QDoubleSpinBox(&oDialog);
+	pShiftX->setRange(-10000.0, 10000.0);
+	pShiftX->setSuffix(" px");
+	QDoubleSpinBox *pShiftY = new QDoubleSpinBox(&oDialog);
+	pShiftY->setRange(-10000.0, 10000.0);
+	pShiftY->setSuffix(" px");
+	QDoubleSpinBox *pScale = new QDoubleSpinBox(&oDialog);
+	pScale->setRange(1.0, 1000.0);
+	pScale->setValue(100.0);
+	pScale->setSuffix(" %");
+	QDoubleSpinBox *pRotation = new QDoubleSpinBox(&oDialog);
+	pRotation->setRange(-180.0, 180.0);
+	pRotation->setSuffix(tr(" graus"));
+
+	QDialogButtonBox *pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &oDialog);
+	connect(pButtons, SIGNAL(accepted()), &oDialog, SLOT(accept()));
+	connect(pButtons, SIGNAL(rejected()), &oDialog, SLOT(reject()));
+
+	QFormLayout *pLayout = new QFormLayout(&oDialog);
+	pLayout->addRow(tr("Deslocamento &horizontal:"), pShiftX);
+	pLayout->addRow(tr("Deslocamento &vertical:"), pShiftY);
+	pLayout->addRow(tr("&Escala:"), pScale);
+	pLayout->addRow(tr("&Rotação:"), pRotation);
+	pLayout->addRow(pButtons);
+
+	if(oDialog.exec() != QDialog::Accepted)
+		return;
+
+	// The scale and rotation are applied around the centroid of the features of each image
+	// (positive angles rotate the features counter-clockwise in the screen)
+	double dScale = pScale->value() / 100.0;
+	double dAngle = qDegreesToRadians(pRotation->value());
+	double a = dScale * qCos(dAngle);
+	double b = dScale * qSin(dAngle);
+	cv::Mat oTransform = (cv::Mat_<double>(2, 3) << a, b, pShiftX->value(), -b, a, pShiftY->value());
+
+	pChild->transformFeatures(oTransform);
+}
+
+// +-----------------------------------------------------------
+void f3::MainWindow::onCopyFeaturesTriggered()
+{
+	ChildWindow *pChild = (ChildWindow*) ui->tabWidget->currentWidget();
+	if(!pChild)
+		return;
+
+	int iCount = pChild->getSelectedImages().size() - 1;
+	QString sMsg = tr("Você confirma a cópia das marcas da imagem atual para as outras %1 imagens selecionadas?").arg(iCount);
+	if(QMessageBox::question(this, tr("Confirmação da cópia"), sMsg, QMessageBox::Yes|QMessageBox::No) == QMessageBox::Yes)
+		pChild->copyFeatures();
+}
+
 // +-----------------------------------------------------------
 f3::ChildWindow* f3::MainWindow::createChildWindow(QString sFileName, bool bModified)
 {
@@ -722,6 +870,10 @@ f3::ChildWindow* f3::MainWindow::createChildWindow(QString sFileName, bool bModi
 	connect(pChild, SIGNAL(onUIUpdated(const QString, const EmotionLabel, const int)), this, SLOT(onChildUIUpdated(const QString, const EmotionLabel, const int)));
 	connect(pChild, SIGNAL(onDataModified()), this, SLOT(onUpdateUI()));
 	connect(pChild, SIGNAL(onFeaturesSelectionChanged()), this, SLOT(onUpdateUI()));
+	connect(pChild, SIGNAL(onSaveProgress(const int)), this, SLOT(onChildSaveProgress(const int)));
+	connect(pChild, SIGNAL(onSaveFinished(const bool, const QString)), this, SLOT(onChildSaveFinished(const bool, const QString)));
+	connect(pChild, SIGNAL(onLoadProgress(const int)), this, SLOT(onChildLoadProgress(const int)));
+	connect(pChild, SIGNAL(onLoadFinished(const bool, const QString)), this, SLOT(onChildLoadFinished(const bool, const QString)));
 
 	// Create the context menu for the features editor, using the same actions from the main window
 	QMenu *pContextMenu = new QMenu(pChild);
@@ -731,6 +883,9 @@ f3::ChildWindow* f3::MainWindow::createChildWindow(QString sFileName, bool bModi
 	pContextMenu->addAction(ui->actionDisconnectFeatures);
 	pChild->setContextMenu(pContextMenu);
 
+	// Add its undo stack to the group (it is activated when the tab is selected)
+	m_pUndoGroup->addStack(pChild->undoStack());
+
 	// Add the window to the tab widget
 	int iIndex = ui->tabWidget->addTab(pChild, pChild->windowIcon(), "");
 	ui->tabWidget->setCurrentIndex(iIndex);
@@ -741,12 +896,86 @@ f3::ChildWindow* f3::MainWindow::createChildWindow(QString sFileName, bool bModi
 // +-----------------------------------------------------------
 void f3::MainWindow::destroyChildWindow(ChildWindow *pChild)
 {
+	// Do not destroy the window in the middle of a saving
+	QString sMsg;
+	pChild->waitForSave(sMsg);
+	if(pChild->isLoading())
+		m_pProgressBar->setVisible(false);
+
+	m_pUndoGroup->removeStack(pChild->undoStack());
 	int iTabIndex = ui->tabWidget->indexOf(pChild);
 	ui->tabWidget->removeTab(iTabIndex);
 
 	disconnect(pChild, SIGNAL(onUIUpdated(const QString, const EmotionLabel, const int)), this, SLOT(onChildUIUpdated(const QString, const EmotionLabel, const int)));
 	disconnect(pChild, SIGNAL(onDataModified()), this, SLOT(onUpdateUI()));
 	disconnect(pChild, SIGNAL(onFeaturesSelectionChanged()), this, SLOT(onUpdateUI()));
+	disconnect(pChild, SIGNAL(onSaveProgress(const int)), this, SLOT(onChildSaveProgress(const int)));
+	disconnect(pChild, SIGNAL(onSaveFinished(const bool, const QString)), this, SLOT(onChildSaveFinished(const bool, const QString)));
+	disconnect(pChild, SIGNAL(onLoadProgress(const int)), this, SLOT(onChildLoadProgress(const int)));
+	disconnect(pChild, SIGNAL(onLoadFinished(const bool, const QString)), this, SLOT(onChildLoadFinished(const bool, const QString)));
 
 	delete pChild;
+}
+
+// +-----------------------------------------------------------
+void f3::MainWindow::onChildSaveProgress(const int iPercent)
+{
+	m_pProgressBar->setValue(iPercent);
+	m_pProgressBar->setVisible(true);
+}
+
+// +-----------------------------------------------------------
+void f3::MainWindow::onChildSaveFinished(const bool bSuccess, const QString sMsgError)
+{
+	ChildWindow *pChild = (ChildWindow*) sender();
+	m_pProgressBar->setVisible(false);
+	updateUI();
+
+	if(bSuccess)
+		showStatusMessage(tr("O banco de faces anotadas [%1] foi gravado com sucesso").arg(Utils::shortenPath(pChild->windowFilePath())));
+	else
+		QMessageBox::warning(this, tr("Erro gravando banco de faces anotadas"), tr("Não foi possível salvar o banco de faces anotadas:\n%1").arg(sMsgError), QMessageBox::Ok);
+}
+
+// +-----------------------------------------------------------
+void f3::MainWindow::onChildLoadProgress(const int iPercent)
+{
+	m_pProgressBar->setValue(iPercent);
+	m_pProgressBar->setVisible(true);
+	updateUI();
+}
+
+// +-----------------------------------------------------------
+void f3::MainWindow::onChildLoadFinished(const bool bSuccess, const QString sMsgError)
+{
+	ChildWindow *pChild = (ChildWindow*) sender();
+	m_pProgressBar->setVisible(false);
+
+	if(!bSuccess)
+	{
+		QString sFile = pChild->windowFilePath();
+		bool bCancelled = pChild->property("cancelled").toBool();
+		destroyChildWindow(pChild);
+
+		if(bCancelled)
+			showStatusMessage(tr("O carregamento do banco de faces anotadas [%1] foi cancelado").arg(Utils::shortenPath(sFile)));
+		else
+			QMessageBox::warning(this, tr("Erro carregando banco de faces anotadas"), tr("Não foi possível abrir o banco de faces anotadas:\n%1").arg(sMsgError), QMessageBox::Ok);
+		return;
+	}
+
+	// Offer the recovery of the changes autosaved if the application was not properly closed
+	if(pChild->hasAutosave())
+	{
+		QString sMsg = tr("Foi encontrada uma cópia de recuperação com alterações não gravadas no banco de faces anotadas [%1]. Deseja recuperá-la?").arg(QFileInfo(pChild->windowFilePath()).baseName());
+		if(QMessageBox::question(this, tr("Recuperação de alterações"), sMsg, QMessageBox::Yes|QMessageBox::No) == QMessageBox::Yes)
+		{
+			if(!pChild->recoverAutosave(sMsg))
+				QMessageBox::warning(this, tr("Erro recuperando banco de faces anotadas"), tr("Não foi possível recuperar as alterações do banco de faces anotadas:\n%1").arg(sMsg), QMessageBox::Ok);
+		}
+		else
+			pChild->discardAutosave();
+	}
+
+	updateUI();
 }
\ No newline at end of file
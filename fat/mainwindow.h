@@ -21,9 +21,13 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QProgressBar>
+#include <QUndoGroup>
 
 #include "aboutwindow.h"
 #include "childwindow.h"
+#include "emotiondelegate.h"
+#include "thumbnaildelegate.h"
 
 namespace Ui {
     class MainWindow;
@@ -66,15 +70,17 @@ namespace f3
 
 		/**
 		 * Helper method to request the saving of the current face annotation dataset opened
-		 * to the user.
+		 * to the user. The saving is performed in background (see ChildWindow::save()).
 		 * @param bAskForFileName Boolean indicating if the UI should ask the user for a file
 		 * name. If the value is true, the user is requested to choose a file name, otherwise 
 		 * (the default) the current file name is used. If the file has not yet been saved,
 		 * a file name is requested despite the value on this parameter.
-		 * @return Boolean indicating if the save was performed or false if the user cancelled
-		 * the operation.
+		 * @param bWait Boolean indicating if the method shall wait for the conclusion of the
+		 * saving (as required, for instance, before closing the dataset). The default is false.
+		 * @return Boolean indicating if the save was started (or, if bWait is true, performed
+		 * with success) or false if the user cancelled the operation or the save failed.
 		 */
-		bool saveCurrentFile(bool bAskForFileName=false);
+		bool saveCurrentFile(bool bAskForFileName=false, bool bWait=false);
 
 		/**
 		 * Gets the page index of the file if already opened in the editor.
@@ -266,6 +272,45 @@ namespace f3
 		 */
 		void onEmotionToggled(bool bValue);
 
+		/**
+		 * Captures the progress of the saving of a dataset in a child window, to display it in the
+		 * status bar.
+		 * @param iPercent Integer with the percentage of the saving concluded (in range [0, 100]).
+		 */
+		void onChildSaveProgress(const int iPercent);
+
+		/**
+		 * Captures the conclusion of the saving of a dataset in a child window.
+		 * @param bSuccess Boolean indicating if the saving succeeded (true) or failed (false).
+		 * @param sMsgError QString with the error message in case the saving failed.
+		 */
+		void onChildSaveFinished(const bool bSuccess, const QString sMsgError);
+
+		/**
+		 * Captures the progress of the loading of a dataset in a child window, to display it in the
+		 * status bar.
+		 * @param iPercent Integer with the percentage of the file read (in range [0, 100]).
+		 */
+		void onChildLoadProgress(const int iPercent);
+
+		/**
+		 * Captures the conclusion of the loading of a dataset in a child window.
+		 * @param bSuccess Boolean indicating if the loading succeeded (true) or failed (false).
+		 * @param sMsgError QString with the error message in case the loading failed.
+		 */
+		void onChildLoadFinished(const bool bSuccess, const QString sMsgError);
+
+		/**
+		 * Slot for the menu Transform Features of Selected Images trigger event. It asks the user for
+		 * the transform (shift, scale and rotation) to apply to the features of all images selected.
+		 */
+		void onTransformFeaturesTriggered();
+
+		/**
+		 * Slot for the menu Copy Features to Selected Images trigger event.
+		 */
+		void onCopyFeaturesTriggered();
+
     private:
         /** Instance of the ui for GUI element access. */
         Ui::MainWindow *ui;
@@ -278,6 +323,30 @@ namespace f3
 
 		/** Instance of a dropdown button for the view mode of the image list. */
 		QMenu *m_pViewButton;
+
+		/**
+		 * Item delegate used to edit the emotion labels in the details view of the image list.
+		 * It is only created when the details view is displayed for the first time.
+		 */
+		EmotionDelegate *m_pEmotionDelegate;
+
+		/** Item delegate used to paint the thumbnails in both views of the image list. */
+		ThumbnailDelegate *m_pThumbnailDelegate;
+
+		/** Progress bar displayed in the status bar while datasets are loaded or saved in background. */
+		QProgressBar *m_pProgressBar;
+
+		/** Group of the undo stacks of the child windows, so the undo/redo actions act on the current one. */
+		QUndoGroup *m_pUndoGroup;
+
+		/** Action to toggle the batched rendering of the face features (see FaceFeaturesItem). */
+		QAction *m_pBatchedRenderingAction;
+
+		/** Action to transform the face features of all the images selected. */
+		QAction *m_pTransformFeaturesAction;
+
+		/** Action to copy the face features of the current image to the other images selected. */
+		QAction *m_pCopyFeaturesAction;
     };
 };
 
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "thumbnailatlas.h"
+
+#include <QPainter>
+#include <QtMath>
+
+// +-----------------------------------------------------------
+f3::ThumbnailAtlas::ThumbnailAtlas(const int iThumbnailSize, const int iMaxMemory)
+{
+	// Pages of about 1024x1024 pixels (4 MB in 32 bits), or less if the memory allowed is smaller
+	m_iThumbnailSize = iThumbnailSize;
+	m_iPageSide = qMax(1024 / iThumbnailSize, 1);
+	int iSlotMemory = iThumbnailSize * iThumbnailSize * 4 / 1024;
+	m_iMaxSlots = qMax(iMaxMemory / qMax(iSlotMemory, 1), 1);
+	m_iPageSide = qMin(m_iPageSide, qCeil(qSqrt(m_iMaxSlots)));
+	m_iClockHand = 0;
+}
+
+// +-----------------------------------------------------------
+int f3::ThumbnailAtlas::allocate(const int iOwner, int &iEvictedOwner)
+{
+	int iSlot;
+	iEvictedOwner = -1;
+
+	if(!m_vFree.isEmpty())
+	{
+		iSlot = m_vFree.last();
+		m_vFree.removeLast();
+	}
+	else if(m_vOwners.size() < m_iMaxSlots)
+	{
+		iSlot = m_vOwners.size();
+		m_vOwners.append(-1);
+		m_vReferenced.append(false);
+
+		int iSlotsPerPage = m_iPageSide * m_iPageSide;
+		if(iSlot / iSlotsPerPage >= m_vPages.size())
+		{
+			QPixmap oPage(m_iPageSide * m_iThumbnailSize, m_iPageSide * m_iThumbnailSize);
+			oPage.fill(Qt::transparent);
+			m_vPages.append(oPage);
+		}
+	}
+	else
+	{
+		// The clock hand skips (and clears) the slots used since it last passed by them
+		while(m_vReferenced[m_iClockHand])
+		{
+			m_vReferenced[m_iClockHand] = false;
+			m_iClockHand = (m_iClockHand + 1) % m_vOwners.size();
+		}
+		iSlot = m_iClockHand;
+		iEvictedOwner = m_vOwners[iSlot];
+		m_iClockHand = (m_iClockHand + 1) % m_vOwners.size();
+	}
+
+	m_vOwners[iSlot] = iOwner;
+	m_vReferenced[iSlot] = true;
+	return iSlot;
+}
+
+// +-----------------------------------------------------------
+void f3::ThumbnailAtlas::store(const int iSlot, const QImage &oThumbnail)
+{
+	QPixmap &oPage = m_vPages[iSlot / (m_iPageSide * m_iPageSide)];
+	QPainter oPainter(&oPage);
+	oPainter.setCompositionMode(QPainter::CompositionMode_Source);
+	oPainter.drawImage(region(iSlot), oThumbnail);
+}
+
+// +-----------------------------------------------------------
+void f3::ThumbnailAtlas::release(const int iSlot)
+{
+	if(m_vOwners[iSlot] == -1)
+		return;
+	m_vOwners[iSlot] = -1;
+	m_vReferenced[iSlot] = false;
+	m_vFree.append(iSlot);
+}
+
+// +-----------------------------------------------------------
+void f3::ThumbnailAtlas::clear()
+{
+	m_vPages.clear();
+	m_vOwners.clear();
+	m_vReferenced.clear();
+	m_vFree.clear();
+	m_iClockHand = 0;
+}
+
+// +-----------------------------------------------------------
+void f3::ThumbnailAtlas::touch(const int iSlot)
+{
+	m_vReferenced[iSlot] = true;
+}
+
+// +-----------------------------------------------------------
+void f3::ThumbnailAtlas::setOwner(const int iSlot, const int iOwner)
+{
+	m_vOwners[iSlot] = iOwner;
+}
+
+// +-----------------------------------------------------------
+QPixmap f3::ThumbnailAtlas::page(const int iSlot) const
+{
+	return m_vPages[iSlot / (m_iPageSide * m_iPageSide)];
+}
+
+// +-----------------------------------------------------------
+QRect f3::ThumbnailAtlas::region(const int iSlot) const
+{
+	int iInPage = iSlot % (m_iPageSide * m_iPageSide);
+	return QRect((iInPage % m_iPageSide) * m_iThumbnailSize, (iInPage / m_iPageSide) * m_iThumbnailSize, m_iThumbnailSize, m_iThumbnailSize);
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THUMBNAILATLAS_H
+#define THUMBNAILATLAS_H
+
+#include <QPixmap>
+#include <QImage>
+#include <QVector>
+#include <QRect>
+
+namespace f3
+{
+	/**
+	 * Storage of thumbnails packed in slots of a few large pixmaps (the pages of the atlas), instead
+	 * of one pixmap per thumbnail. The number of pages is bounded; when all slots are in use, the slot
+	 * of a thumbnail not drawn recently is reused (with the clock, or second chance, algorithm). Each
+	 * slot records its owner (e.g. the row of the image), so the owner can be told of the eviction.
+	 */
+	class ThumbnailAtlas
+	{
+	public:
+		/**
+		 * Class constructor.
+		 * @param iThumbnailSize Integer with the size of the side of the thumbnails.
+		 * @param iMaxMemory Integer with the maximum memory used by the pages, in KB.
+		 */
+		ThumbnailAtlas(const int iThumbnailSize, const int iMaxMemory);
+
+		/**
+		 * Allocates a slot for a new thumbnail, evicting a thumbnail if all slots are in use.
+		 * @param iOwner Integer with the owner of the new thumbnail.
+		 * @param iEvictedOwner Integer to receive the owner of the thumbnail evicted, or -1 if none was.
+		 * @return Integer with the slot allocated.
+		 */
+		int allocate(const int iOwner, int &iEvictedOwner);
+
+		/**
+		 * Stores the pixels of a thumbnail in its slot.
+		 * @param iSlot Integer with the slot of the thumbnail.
+		 * @param oThumbnail QImage with the thumbnail (scaled to the size of the slots if needed).
+		 */
+		void store(const int iSlot, const QImage &oThumbnail);
+
+		/**
+		 * Releases a slot, so it can be reused.
+		 * @param iSlot Integer with the slot to release.
+		 */
+		void release(const int iSlot);
+
+		/**
+		 * Releases all slots and the pages.
+		 */
+		void clear();
+
+		/**
+		 * Marks a slot as recently used (so it is not the next to be evicted).
+		 * @param iSlot Integer with the slot used.
+		 */
+		void touch(const int iSlot);
+
+		/**
+		 * Updates the owner of a slot (e.g. when the rows of a model shift).
+		 * @param iSlot Integer with the slot.
+		 * @param iOwner Integer with the new owner.
+		 */
+		void setOwner(const int iSlot, const int iOwner);
+
+		/**
+		 * Gets the page where a slot is.
+		 * @param iSlot Integer with the slot.
+		 * @return QPixmap with the page (shared, not copied).
+		 */
+		QPixmap page(const int iSlot) const;
+
+		/**
+		 * Gets the region of a slot in its page.
+		 * @param iSlot Integer with the slot.
+		 * @return QRect with the region of the slot.
+		 */
+		QRect region(const int iSlot) const;
+
+	private:
+		/** Size of the side of the thumbnails. */
+		int m_iThumbnailSize;
+
+		/** Number of slots per row (and column) of a page. */
+		int m_iPageSide;
+
+		/** Maximum number of slots (in all pages). */
+		int m_iMaxSlots;
+
+		/** Pages of the atlas (created only when needed). */
+		QVector<QPixmap> m_vPages;
+
+		/** Owners of the slots created so far (-1 for the slots free). */
+		QVector<int> m_vOwners;
+
+		/** Indications of the slots used since the clock last passed by them. */
+		QVector<bool> m_vReferenced;
+
+		/** Slots free to be reused. */
+		QVector<int> m_vFree;
+
+		/** Position of the clock hand (the next slot considered for eviction). */
+		int m_iClockHand;
+	};
+};
+
+#endif // THUMBNAILATLAS_H
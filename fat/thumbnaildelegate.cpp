@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "thumbnaildelegate.h"
+#include "facedatasetmodel.h"
+
+#include <QApplication>
+#include <QPainter>
+
+// +-----------------------------------------------------------
+f3::ThumbnailDelegate::ThumbnailDelegate(QObject *pParent) : QStyledItemDelegate(pParent)
+{
+}
+
+// +-----------------------------------------------------------
+void f3::ThumbnailDelegate::paint(QPainter *pPainter, const QStyleOptionViewItem &oOption, const QModelIndex &oIndex) const
+{
+	// The model decoration is an empty placeholder, that only reserves the space of the thumbnail
+	QStyledItemDelegate::paint(pPainter, oOption, oIndex);
+
+	const FaceDatasetModel *pModel = qobject_cast<const FaceDatasetModel*>(oIndex.model());
+	if(!pModel || oIndex.column() != 0)
+		return;
+
+	QPixmap oPage;
+	QRect oRegion;
+	if(!pModel->thumbnailRegion(oIndex.row(), oPage, oRegion))
+		return;
+
+	QStyleOptionViewItem oItemOption = oOption;
+	initStyleOption(&oItemOption, oIndex);
+	const QWidget *pWidget = oOption.widget;
+	QStyle *pStyle = pWidget ? pWidget->style() : QApplication::style();
+	QRect oTarget = pStyle->subElementRect(QStyle::SE_ItemViewItemDecoration, &oItemOption, pWidget);
+	pPainter->drawPixmap(oTarget, oPage, oRegion);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THUMBNAILDELEGATE_H
+#define THUMBNAILDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+namespace f3
+{
+	/**
+	 * Item delegate used to paint the thumbnails of the images straight from the atlas of the
+	 * FaceDatasetModel (see ThumbnailAtlas), without creating a pixmap per item.
+	 */
+	class ThumbnailDelegate : public QStyledItemDelegate
+	{
+		Q_OBJECT
+	public:
+		/**
+		 * Class constructor.
+		 * @param pParent Instance of the parent object for the item delegate (default is 0).
+		 */
+		ThumbnailDelegate(QObject *pParent = 0);
+
+		/**
+		 * Paints the item. The background, the selection and the text are painted as usual, and the
+		 * thumbnail is painted from its region in the atlas in the place of the decoration.
+		 * @param pPainter Instance of the QPainter used to paint.
+		 * @param oOption Reference of the QStyleOptionViewItem with the style options of the item.
+		 * @param oIndex Reference of the QModelIndex of the item.
+		 */
+		void paint(QPainter *pPainter, const QStyleOptionViewItem &oOption, const QModelIndex &oIndex) const Q_DECL_OVERRIDE;
+	};
+};
+
+#endif // THUMBNAILDELEGATE_H
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tiledimageitem.h"
+#include "application.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QMutexLocker>
+#include <QtMath>
+
+// Size of the side of the tiles (small enough to be produced quickly, big enough to be drawn in few calls)
+const int f3::TiledImageItem::TILE_SIZE = 256;
+
+// Maximum memory used by the cached tiles (in KB, as the costs in the cache): 96 MB
+const int f3::TiledImageItem::TILE_CACHE_SIZE = 96 * 1024;
+
+// Maximum size of the side of the preview of the image
+const int f3::TiledImageItem::PREVIEW_SIZE = 512;
+
+// +-----------------------------------------------------------
+f3::ImagePyramid::ImagePyramid(const QImage &oImage, const int iTileSize)
+{
+	QSize oSize = oImage.size();
+	m_vSizes.append(oSize);
+	while(oSize.width() > iTileSize || oSize.height() > iTileSize)
+	{
+		oSize = QSize(qMax(oSize.width() / 2, 1), qMax(oSize.height() / 2, 1));
+		m_vSizes.append(oSize);
+	}
+
+	m_vLevels.resize(m_vSizes.size());
+	m_vLevels[0] = oImage;
+}
+
+// +-----------------------------------------------------------
+int f3::ImagePyramid::levels() const
+{
+	return m_vSizes.size();
+}
+
+// +-----------------------------------------------------------
+QSize f3::ImagePyramid::levelSize(const int iLevel) const
+{
+	return m_vSizes[iLevel];
+}
+
+// +-----------------------------------------------------------
+QImage f3::ImagePyramid::tile(const int iLevel, const QRect &oRect)
+{
+	QImage oLevel;
+	{
+		QMutexLocker oLocker(&m_oMutex);
+		oLevel = level(iLevel);
+	}
+	return oLevel.copy(oRect);
+}
+
+// +-----------------------------------------------------------
+QImage f3::ImagePyramid::level(const int iLevel)
+{
+	if(m_vLevels[iLevel].isNull())
+		m_vLevels[iLevel] = level(iLevel - 1).scaled(m_vSizes[iLevel], Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+	return m_vLevels[iLevel];
+}
+
+// +-----------------------------------------------------------
+f3::TiledImageItem::TiledImageItem()
+{
+	setFlag(ItemUsesExtendedStyleOption); // To get the exposed rect in paint
+	setAcceptedMouseButtons(0);
+	m_oTiles.setMaxCost(TILE_CACHE_SIZE);
+	m_iCurrentLevel = -1;
+}
+
+// +-----------------------------------------------------------
+f3::TiledImageItem::~TiledImageItem()
+{
+	m_oToken.cancel();
+}
+
+// +-----------------------------------------------------------
+void f3::TiledImageItem::setImage(const QImage &oImage)
+{
+	// Cancel the production of the tiles of the previous image
+	m_oToken.cancel();
+	m_oToken = CancellationToken();
+	m_hRequests.clear();
+	m_oTiles.clear();
+	m_iCurrentLevel = -1;
+
+	prepareGeometryChange();
+	m_oSize = oImage.size();
+	if(oImage.isNull())
+	{
+		m_pPyramid.clear();
+		m_oPreview = QPixmap();
+	}
+	else
+	{
+		m_pPyramid = QSharedPointer<ImagePyramid>(new ImagePyramid(oImage, TILE_SIZE));
+
+		// The preview samples the image without filtering, so it costs only its own pixels
+		m_oPreview = QPixmap::fromImage(oImage.width() > PREVIEW_SIZE || oImage.height() > PREVIEW_SIZE ?
+			oImage.scaled(PREVIEW_SIZE, PREVIEW_SIZE, Qt::KeepAspectRatio, Qt::FastTransformation) : oImage);
+	}
+	update();
+}
+
+// +-----------------------------------------------------------
+QRectF f3::TiledImageItem::boundingRect() const
+{
+	return QRectF(QPointF(0, 0), m_oSize);
+}
+
+// +-----------------------------------------------------------
+quint64 f3::TiledImageItem::tileKey(const int iLevel, const int iX, const int iY)
+{
+	return ((quint64) iLevel << 48) | ((quint64) iY << 24) | (quint64) iX;
+}
+
+// +-----------------------------------------------------------
+QRect f3::TiledImageItem::tileRect(const int iLevel, const int iX, const int iY) const
+{
+	QRect oLevel(QPoint(0, 0), m_pPyramid->levelSize(iLevel));
+	return QRect(iX * TILE_SIZE, iY * TILE_SIZE, TILE_SIZE, TILE_SIZE).intersected(oLevel);
+}
+
+// +-----------------------------------------------------------
+QRectF f3::TiledImageItem::mapFromLevel(const int iLevel, const QRectF &oRect) const
+{
+	QSize oLevelSize = m_pPyramid->levelSize(iLevel);
+	double dFX = (double) m_oSize.width() / oLevelSize.width();
+	double dFY = (double) m_oSize.height() / oLevelSize.height();
+	return QRectF(oRect.x() * dFX, oRect.y() * dFY, oRect.width() * dFX, oRect.height() * dFY);
+}
+
+// +-----------------------------------------------------------
+void f3::TiledImageItem::paint(QPainter *pPainter, const QStyleOptionGraphicsItem *pOption, QWidget *pWidget)
+{
+	Q_UNUSED(pWidget);
+
+	if(!m_pPyramid)
+		return;
+
+	// The level used is the coarsest one with at least the resolution of the display
+	int iLevel = 0;
+	qreal dDetail = QStyleOptionGraphicsItem::levelOfDetailFromTransform(pPainter->worldTransform());
+	if(dDetail < 1.0)
+		iLevel = qMin(qFloor(qLn(1.0 / dDetail) / qLn(2.0)), m_pPyramid->levels() - 1);
+
+	// The tiles requested for other levels are not needed anymore
+	if(iLevel != m_iCurrentLevel)
+	{
+		cancelRequests(iLevel);
+		m_iCurrentLevel = iLevel;
+	}
+
+	// Range of tiles exposed, in the coordinates of the level
+	QRectF oExposed = pOption->exposedRect.intersected(boundingRect());
+	if(oExposed.isEmpty())
+		return;
+	QSize oLevelSize = m_pPyramid->levelSize(iLevel);
+	double dFX = (double) oLevelSize.width() / m_oSize.width();
+	double dFY = (double) oLevelSize.height() / m_oSize.height();
+	int iLeft = qFloor(oExposed.left() * dFX) / TILE_SIZE;
+	int iTop = qFloor(oExposed.top() * dFY) / TILE_SIZE;
+	int iRight = qMin(qFloor(oExposed.right() * dFX) / TILE_SIZE, (oLevelSize.width() - 1) / TILE_SIZE);
+	int iBottom = qMin(qFloor(oExposed.bottom() * dFY) / TILE_SIZE, (oLevelSize.height() - 1) / TILE_SIZE);
+
+	// The antialiasing would show the seams between the tiles
+	pPainter->save();
+	pPainter->setRenderHint(QPainter::Antialiasing, false);
+	for(int iY = iTop; iY <= iBottom; iY++)
+		for(int iX = iLeft; iX <= iRight; iX++)
+		{
+			QRectF oTarget = mapFromLevel(iLevel, tileRect(iLevel, iX, iY));
+			QPixmap *pTile = m_oTiles.object(tileKey(iLevel, iX, iY));
+			if(pTile)
+				pPainter->drawPixmap(oTarget, *pTile, QRectF(pTile->rect()));
+			else
+			{
+				requestTile(iLevel, iX, iY);
+				drawFallback(pPainter, iLevel, oTarget);
+			}
+		}
+	pPainter->restore();
+}
+
+// +-----------------------------------------------------------
+void f3::TiledImageItem::drawFallback(QPainter *pPainter, const int iLevel, const QRectF &oTarget)
+{
+	for(int iCoarser = iLevel + 1; iCoarser < m_pPyramid->levels(); iCoarser++)
+	{
+		// Region in the coordinates of the coarser level, and the tile that contains it
+		QSize oLevelSize = m_pPyramid->levelSize(iCoarser);
+		double dFX = (double) oLevelSize.width() / m_oSize.width();
+		double dFY = (double) oLevelSize.height() / m_oSize.height();
+		QRectF oSource(oTarget.x() * dFX, oTarget.y() * dFY, oTarget.width() * dFX, oTarget.height() * dFY);
+		int iX = qFloor(oSource.center().x()) / TILE_SIZE;
+		int iY = qFloor(oSource.center().y()) / TILE_SIZE;
+
+		QPixmap *pTile = m_oTiles.object(tileKey(iCoarser, iX, iY));
+		if(pTile)
+		{
+			pPainter->drawPixmap(oTarget, *pTile, oSource.translated(-iX * TILE_SIZE, -iY * TILE_SIZE));
+			return;
+		}
+	}
+
+	// No tile is available, so the region is taken from the preview
+	double dFX = (double) m_oPreview.width() / m_oSize.width();
+	double dFY = (double) m_oPreview.height() / m_oSize.height();
+	pPainter->drawPixmap(oTarget, m_oPreview, QRectF(oTarget.x() * dFX, oTarget.y() * dFY, oTarget.width() * dFX, oTarget.height() * dFY));
+}
+
+// +-----------------------------------------------------------
+void f3::TiledImageItem::requestTile(const int iLevel, const int iX, const int iY)
+{
+	quint64 iKey = tileKey(iLevel, iX, iY);
+	if(m_hRequests.contains(iKey))
+		return;
+
+	QSharedPointer<ImagePyramid> pPyramid = m_pPyramid;
+	QRect oRect = tileRect(iLevel, iX, iY);
+
+	TaskScheduler::Task fTask = [pPyramid, iLevel, oRect](TaskContext &oContext) -> QVariant
+	{
+		if(oContext.isCancelled())
+			return QVariant();
+		return QVariant::fromValue(pPyramid->tile(iLevel, oRect));
+	};
+
+	TaskScheduler::CompletionHandler fDone = [this, iKey, iLevel, oRect](const QVariant &oResult)
+	{
+		m_hRequests.remove(iKey);
+		QImage oTile = oResult.value<QImage>();
+		if(oTile.isNull())
+			return;
+
+		// The conversion to a pixmap (i.e. the upload to the display) happens in the GUI thread
+		m_oTiles.insert(iKey, new QPixmap(QPixmap::fromImage(oTile)), qMax(oTile.byteCount() / 1024, 1));
+		update(mapFromLevel(iLevel, oRect));
+	};
+
+	QString sKey = QString("tile-%1-%2-%3").arg(iLevel).arg(iX).arg(iY);
+	m_hRequests.insert(iKey, F3Application::scheduler()->schedule(TaskScheduler::VisibleNow, fTask, fDone, m_oToken, sKey));
+}
+
+// +-----------------------------------------------------------
+void f3::TiledImageItem::cancelRequests(const int iLevel)
+{
+	QHash<quint64, CancellationToken>::iterator it = m_hRequests.begin();
+	while(it != m_hRequests.end())
+	{
+		if((int) (it.key() >> 48) != iLevel)
+		{
+			it.value().cancel();
+			it = m_hRequests.erase(it);
+		}
+		else
+			++it;
+	}
+}
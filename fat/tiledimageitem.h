@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILEDIMAGEITEM_H
+#define TILEDIMAGEITEM_H
+
+#include "taskscheduler.h"
+
+#include <QGraphicsItem>
+#include <QImage>
+#include <QPixmap>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
+
+namespace f3
+{
+	/**
+	 * Pyramid of resolutions of an image, where each level has half the width and height of the
+	 * previous one (the level 0 is the original image). The levels are only built when tiles from
+	 * them are first requested, from the level immediately before. All methods are thread safe, so
+	 * the tiles can be produced in background.
+	 */
+	class ImagePyramid
+	{
+	public:
+		/**
+		 * Class constructor.
+		 * @param oImage QImage with the original image (level 0). It is shared, not copied.
+		 * @param iTileSize Integer with the size of the tiles. The last level is the first one
+		 * to fit in a single tile.
+		 */
+		ImagePyramid(const QImage &oImage, const int iTileSize);
+
+		/**
+		 * Queries the number of levels of the pyramid.
+		 * @return Integer with the number of levels (at least 1).
+		 */
+		int levels() const;
+
+		/**
+		 * Queries the size of the image in a level of the pyramid.
+		 * @param iLevel Integer with the level (in range [0, levels() - 1]).
+		 * @return QSize with the size of the image in the level.
+		 */
+		QSize levelSize(const int iLevel) const;
+
+		/**
+		 * Gets a region of the image in a level of the pyramid, building the level if needed.
+		 * @param iLevel Integer with the level (in range [0, levels() - 1]).
+		 * @param oRect QRect with the region to get, in the coordinates of the level.
+		 * @return QImage with the copy of the region.
+		 */
+		QImage tile(const int iLevel, const QRect &oRect);
+
+	protected:
+		/**
+		 * Gets the image of a level, building it (and the ones before) if needed. The mutex
+		 * must be locked by the caller.
+		 * @param iLevel Integer with the level (in range [0, levels() - 1]).
+		 * @return QImage with the image of the level.
+		 */
+		QImage level(const int iLevel);
+
+	private:
+		/** Mutex to protect the lazy building of the levels. */
+		QMutex m_oMutex;
+
+		/** Images of the levels (null for the levels not built yet). */
+		QVector<QImage> m_vLevels;
+
+		/** Sizes of the levels. */
+		QVector<QSize> m_vSizes;
+	};
+
+	/**
+	 * Graphics item that displays an image in tiles, taken from the level of an image pyramid that
+	 * matches the current zoom. Only the tiles exposed in the viewport are produced, in background by
+	 * the task scheduler, and converted to pixmaps kept in a cache bounded by their size in memory.
+	 * While a tile is not available, the region is drawn from a coarser tile (or from a quick preview
+	 * of the whole image), so the display never blocks.
+	 */
+	class TiledImageItem: public QGraphicsItem
+	{
+	public:
+		/**
+		 * Class constructor.
+		 */
+		TiledImageItem();
+
+		/**
+		 * Class destructor. Cancels the tiles still being produced.
+		 */
+		virtual ~TiledImageItem();
+
+		/**
+		 * Updates the image displayed. The previous tiles are discarded.
+		 * @param oImage QImage with the image to display (its pixels are shared, not copied).
+		 */
+		void setImage(const QImage &oImage);
+
+		/**
+		 * Queries the bounding rectangle of the item (the size of the image).
+		 * @return A QRectF with the coordinates and size of the bounding rect of the item.
+		 */
+		QRectF boundingRect() const Q_DECL_OVERRIDE;
+
+	protected:
+
+		/**
+		 * Paint method for the image. Draws the tiles exposed from the level that matches the
+		 * zoom of the painter, requesting the ones not available yet.
+		 * @param pPainter Instance of a QPainter to allow drawing the item.
+		 * @param pOption Instance of a QStyleOptionGraphicsItem with information on the style and state of the item.
+		 * @param pWidget Instance of a QWidget with the widget that the item is being painted on. Optional, and might be 0.
+		 */
+		void paint(QPainter *pPainter, const QStyleOptionGraphicsItem *pOption, QWidget *pWidget) Q_DECL_OVERRIDE;
+
+		/**
+		 * Gets the key of a tile in the cache.
+		 * @param iLevel Integer with the level of the tile.
+		 * @param iX Integer with the column of the tile.
+		 * @param iY Integer with the row of the tile.
+		 * @return Unsigned 64-bit integer with the key of the tile.
+		 */
+		static quint64 tileKey(const int iLevel, const int iX, const int iY);
+
+		/**
+		 * Gets the region of a tile in the coordinates of its level.
+		 * @param iLevel Integer with the level of the tile.
+		 * @param iX Integer with the column of the tile.
+		 * @param iY Integer with the row of the tile.
+		 * @return QRect with the region of the tile (clipped to the size of the level).
+		 */
+		QRect tileRect(const int iLevel, const int iX, const int iY) const;
+
+		/**
+		 * Maps a region in the coordinates of a level to the coordinates of the item.
+		 * @param iLevel Integer with the level.
+		 * @param oRect QRectF with the region in the coordinates of the level.
+		 * @return QRectF with the region in the coordinates of the item.
+		 */
+		QRectF mapFromLevel(const int iLevel, const QRectF &oRect) const;
+
+		/**
+		 * Requests a tile to be produced in background, if it was not requested yet. When the tile is
+		 * ready, it is added to the cache and the region of the item it covers is updated.
+		 * @param iLevel Integer with the level of the tile.
+		 * @param iX Integer with the column of the tile.
+		 * @param iY Integer with the row of the tile.
+		 */
+		void requestTile(const int iLevel, const int iX, const int iY);
+
+		/**
+		 * Cancels the requested tiles of all levels but the given one.
+		 * @param iLevel Integer with the level whose requests are kept.
+		 */
+		void cancelRequests(const int iLevel);
+
+		/**
+		 * Draws a region of the item from the tiles available of a coarser level than the given one,
+		 * or from the preview of the image if there are none.
+		 * @param pPainter Instance of the QPainter used to draw.
+		 * @param iLevel Integer with the level of the tile missing.
+		 * @param oTarget QRectF with the region to draw, in the coordinates of the item.
+		 */
+		void drawFallback(QPainter *pPainter, const int iLevel, const QRectF &oTarget);
+
+	public:
+
+		/** Size of the side of the tiles, in pixels. */
+		static const int TILE_SIZE;
+
+		/** Maximum memory used by the cached tiles, in KB. */
+		static const int TILE_CACHE_SIZE;
+
+		/** Maximum size of the side of the preview of the image. */
+		static const int PREVIEW_SIZE;
+
+	private:
+
+		/** Size of the image displayed. */
+		QSize m_oSize;
+
+		/** Pyramid of the image displayed (shared with the tasks producing its tiles). */
+		QSharedPointer<ImagePyramid> m_pPyramid;
+
+		/** Quick (low quality) preview of the whole image, drawn while no tile covers a region. */
+		QPixmap m_oPreview;
+
+		/** Cache of the tiles already produced, by their keys (see tileKey()). */
+		QCache<quint64, QPixmap> m_oTiles;
+
+		/** Cancellation tokens of the tiles requested but not produced yet, by their keys. */
+		QHash<quint64, CancellationToken> m_hRequests;
+
+		/** Token that owns the tile requests of the image displayed. */
+		CancellationToken m_oToken;
+
+		/** Level of the pyramid used in the last paint (or -1 if none). */
+		int m_iCurrentLevel;
+	};
+};
+
+#endif // TILEDIMAGEITEM_H
@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "undocommands.h"
+#include "childwindow.h"
+
+#include <QApplication>
+
+using namespace std;
+
+// Identifier of the command of movement of features
+const int f3::MoveFeaturesCommand::ID = 1;
+
+// Maximum interval between merged moves (one second)
+const int f3::MoveFeaturesCommand::MERGE_INTERVAL = 1000;
+
+// +-----------------------------------------------------------
+f3::MoveFeaturesCommand::MoveFeaturesCommand(ChildWindow *pWindow, const int iImage, const QList<int> &lIndexes, const QList<QPointF> &lOldPositions, const QList<QPointF> &lNewPositions)
+{
+	m_pWindow = pWindow;
+	m_iImage = iImage;
+	m_lIndexes = lIndexes;
+	m_lOldPositions = lOldPositions;
+	m_lNewPositions = lNewPositions;
+	m_bDone = true;
+	m_oTimer.start();
+
+	if(lIndexes.size() == 1)
+		setText(QApplication::translate("UndoCommands", "mover marca facial %1").arg(lIndexes.first()));
+	else
+		setText(QApplication::translate("UndoCommands", "mover %1 marcas faciais").arg(lIndexes.size()));
+}
+
+// +-----------------------------------------------------------
+void f3::MoveFeaturesCommand::undo()
+{
+	m_pWindow->setFeaturePositions(m_iImage, m_lIndexes, m_lOldPositions);
+}
+
+// +-----------------------------------------------------------
+void f3::MoveFeaturesCommand::redo()
+{
+	if(m_bDone)
+	{
+		m_bDone = false;
+		return;
+	}
+	m_pWindow->setFeaturePositions(m_iImage, m_lIndexes, m_lNewPositions);
+}
+
+// +-----------------------------------------------------------
+int f3::MoveFeaturesCommand::id() const
+{
+	return ID;
+}
+
+// +-----------------------------------------------------------
+bool f3::MoveFeaturesCommand::mergeWith(const QUndoCommand *pOther)
+{
+	const MoveFeaturesCommand *pMove = static_cast<const MoveFeaturesCommand*>(pOther);
+	if(pMove->m_pWindow != m_pWindow || pMove->m_iImage != m_iImage || pMove->m_lIndexes != m_lIndexes || m_oTimer.elapsed() > MERGE_INTERVAL)
+		return false;
+
+	// The old positions are kept, so the merged moves are undone at once
+	m_lNewPositions = pMove->m_lNewPositions;
+	m_oTimer.restart();
+	return true;
+}
+
+// +-----------------------------------------------------------
+qint64 f3::MoveFeaturesCommand::cost() const
+{
+	return sizeof(*this) + m_lIndexes.size() * (sizeof(int) + 2 * sizeof(QPointF));
+}
+
+// +-----------------------------------------------------------
+f3::AddFeatureCommand::AddFeatureCommand(ChildWindow *pWindow, const int iIndex, const QPointF &oPos)
+{
+	m_pWindow = pWindow;
+	m_iIndex = iIndex;
+	m_oPos = oPos;
+	setText(QApplication::translate("UndoCommands", "adicionar marca facial %1").arg(iIndex));
+}
+
+// +-----------------------------------------------------------
+void f3::AddFeatureCommand::undo()
+{
+	m_pWindow->removeFeatures(QList<int>() << m_iIndex);
+}
+
+// +-----------------------------------------------------------
+void f3::AddFeatureCommand::redo()
+{
+	m_pWindow->appendFeature(m_oPos);
+}
+
+// +-----------------------------------------------------------
+qint64 f3::AddFeatureCommand::cost() const
+{
+	return sizeof(*this);
+}
+
+// +-----------------------------------------------------------
+f3::RemoveFeaturesCommand::RemoveFeaturesCommand(ChildWindow *pWindow, const QList<int> &lIndexes, const QList<vector<cv::Point2f> > &lPositions, const QList<QPair<int, int> > &lConnections)
+{
+	m_pWindow = pWindow;
+	m_lIndexes = lIndexes;
+	m_lPositions = lPositions;
+	m_lConnections = lConnections;
+
+	if(lIndexes.size() == 1)
+		setText(QApplication::translate("UndoCommands", "remover marca facial %1").arg(lIndexes.first()));
+	else
+		setText(QApplication::translate("UndoCommands", "remover %1 marcas faciais").arg(lIndexes.size()));
+}
+
+// +-----------------------------------------------------------
+void f3::RemoveFeaturesCommand::undo()
+{
+	m_pWindow->insertFeatures(m_lIndexes, m_lPositions, m_lConnections);
+}
+
+// +-----------------------------------------------------------
+void f3::RemoveFeaturesCommand::redo()
+{
+	m_pWindow->removeFeatures(m_lIndexes);
+}
+
+// +-----------------------------------------------------------
+qint64 f3::RemoveFeaturesCommand::cost() const
+{
+	qint64 iRet = sizeof(*this) + m_lIndexes.size() * sizeof(int) + m_lConnections.size() * sizeof(QPair<int, int>);
+	foreach(const vector<cv::Point2f> &vPositions, m_lPositions)
+		iRet += sizeof(vPositions) + vPositions.size() * sizeof(cv::Point2f);
+	return iRet;
+}
+
+// +-----------------------------------------------------------
+f3::ConnectFeaturesCommand::ConnectFeaturesCommand(ChildWindow *pWindow, const QList<QPair<int, int> > &lConnections, const bool bConnect)
+{
+	m_pWindow = pWindow;
+	m_lConnections = lConnections;
+	m_bConnect = bConnect;
+
+	if(bConnect)
+		setText(QApplication::translate("UndoCommands", "conectar marcas faciais"));
+	else
+		setText(QApplication::translate("UndoCommands", "desconectar marcas faciais"));
+}
+
+// +-----------------------------------------------------------
+void f3::ConnectFeaturesCommand::undo()
+{
+	m_pWindow->setConnections(m_lConnections, !m_bConnect);
+}
+
+// +-----------------------------------------------------------
+void f3::ConnectFeaturesCommand::redo()
+{
+	m_pWindow->setConnections(m_lConnections, m_bConnect);
+}
+
+// +-----------------------------------------------------------
+qint64 f3::ConnectFeaturesCommand::cost() const
+{
+	return sizeof(*this) + m_lConnections.size() * sizeof(QPair<int, int>);
+}
+
+// +-----------------------------------------------------------
+f3::SetEmotionLabelCommand::SetEmotionLabelCommand(ChildWindow *pWindow, const int iImage, const EmotionLabel eOldLabel, const EmotionLabel eNewLabel)
+{
+	m_pWindow = pWindow;
+	m_iImage = iImage;
+	m_eOldLabel = eOldLabel;
+	m_eNewLabel = eNewLabel;
+	m_bDone = true;
+	setText(QApplication::translate("UndoCommands", "alterar emoção para %1").arg(eNewLabel.getName()));
+}
+
+// +-----------------------------------------------------------
+void f3::SetEmotionLabelCommand::undo()
+{
+	m_pWindow->setEmotionLabel(m_iImage, m_eOldLabel);
+}
+
+// +-----------------------------------------------------------
+void f3::SetEmotionLabelCommand::redo()
+{
+	if(m_bDone)
+	{
+		m_bDone = false;
+		return;
+	}
+	m_pWindow->setEmotionLabel(m_iImage, m_eNewLabel);
+}
+
+// +-----------------------------------------------------------
+qint64 f3::SetEmotionLabelCommand::cost() const
+{
+	return sizeof(*this);
+}
+
+// +-----------------------------------------------------------
+f3::SetEmotionLabelsCommand::SetEmotionLabelsCommand(ChildWindow *pWindow, const QList<int> &lImages, const QList<EmotionLabel> &lOldLabels, const EmotionLabel eNewLabel)
+{
+	m_pWindow = pWindow;
+	m_lImages = lImages;
+	m_lOldLabels = lOldLabels;
+	m_eNewLabel = eNewLabel;
+	m_bDone = true;
+	setText(QApplication::translate("UndoCommands", "alterar emoção de %1 imagens para %2").arg(lImages.size()).arg(eNewLabel.getName()));
+}
+
+// +-----------------------------------------------------------
+void f3::SetEmotionLabelsCommand::undo()
+{
+	m_pWindow->setEmotionLabels(m_lImages, m_lOldLabels);
+}
+
+// +-----------------------------------------------------------
+void f3::SetEmotionLabelsCommand::redo()
+{
+	if(m_bDone)
+	{
+		m_bDone = false;
+		return;
+	}
+
+	QList<EmotionLabel> lNewLabels;
+	for(int i = 0; i < m_lImages.size(); i++)
+		lNewLabels.append(m_eNewLabel);
+	m_pWindow->setEmotionLabels(m_lImages, lNewLabels);
+}
+
+// +-----------------------------------------------------------
+qint64 f3::SetEmotionLabelsCommand::cost() const
+{
+	return sizeof(*this) + m_lImages.size() * (sizeof(int) + sizeof(EmotionLabel));
+}
+
+// +-----------------------------------------------------------
+f3::SetShapesCommand::SetShapesCommand(ChildWindow *pWindow, const QString &sText, const QList<int> &lImages, const std::vector<std::vector<cv::Point2f> > &vOldShapes, const std::vector<std::vector<cv::Point2f> > &vNewShapes)
+{
+	m_pWindow = pWindow;
+	m_lImages = lImages;
+	m_vOldShapes = vOldShapes;
+	m_vNewShapes = vNewShapes;
+	m_bDone = true;
+	setText(sText);
+}
+
+// +-----------------------------------------------------------
+void f3::SetShapesCommand::undo()
+{
+	m_pWindow->setShapes(m_lImages, m_vOldShapes);
+}
+
+// +-----------------------------------------------------------
+void f3::SetShapesCommand::redo()
+{
+	if(m_bDone)
+	{
+		m_bDone = false;
+		return;
+	}
+	m_pWindow->setShapes(m_lImages, m_vNewShapes);
+}
+
+// +-----------------------------------------------------------
+qint64 f3::SetShapesCommand::cost() const
+{
+	qint64 iRet = sizeof(*this) + m_lImages.size() * sizeof(int);
+	for(unsigned int i = 0; i < m_vOldShapes.size(); i++)
+		iRet += sizeof(m_vOldShapes[i]) + m_vOldShapes[i].size() * sizeof(cv::Point2f);
+	for(unsigned int i = 0; i < m_vNewShapes.size(); i++)
+		iRet += sizeof(m_vNewShapes[i]) + m_vNewShapes[i].size() * sizeof(cv::Point2f);
+	return iRet;
+}
+
+// +-----------------------------------------------------------
+f3::UndoStackEntry::UndoStackEntry(const shared_ptr<UndoCommand> &pCommand, const bool bRestored)
+{
+	m_pCommand = pCommand;
+	m_bRestored = bRestored;
+	setText(pCommand->text());
+}
+
+// +-----------------------------------------------------------
+void f3::UndoStackEntry::undo()
+{
+	m_pCommand->undo();
+}
+
+// +-----------------------------------------------------------
+void f3::UndoStackEntry::redo()
+{
+	if(m_bRestored)
+		return;
+	m_pCommand->redo();
+}
+
+// +-----------------------------------------------------------
+int f3::UndoStackEntry::id() const
+{
+	return m_bRestored ? -1 : m_pCommand->id();
+}
+
+// +-----------------------------------------------------------
+bool f3::UndoStackEntry::mergeWith(const QUndoCommand *pOther)
+{
+	const UndoStackEntry *pEntry = static_cast<const UndoStackEntry*>(pOther);
+	if(!m_pCommand->mergeWith(pEntry->m_pCommand.get()))
+		return false;
+
+	setText(m_pCommand->text());
+	return true;
+}
+
+// +-----------------------------------------------------------
+shared_ptr<f3::UndoCommand> f3::UndoStackEntry::command() const
+{
+	return m_pCommand;
+}
+
+// +-----------------------------------------------------------
+void f3::UndoStackEntry::setPushed()
+{
+	m_bRestored = false;
+}
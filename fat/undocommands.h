@@ -0,0 +1,473 @@
+/*
+ * Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+ *
+ * This file is part of Fun from Faces (f3).
+ *
+ * f3 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * f3 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNDOCOMMANDS_H
+#define UNDOCOMMANDS_H
+
+#include "emotionlabel.h"
+
+#include <QUndoCommand>
+#include <QList>
+#include <QPair>
+#include <QPointF>
+#include <QElapsedTimer>
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+#include <memory>
+
+namespace f3
+{
+	class ChildWindow;
+
+	/**
+	 * Base class of the undoable commands of the child windows, that informs the memory used by
+	 * each command so the undo stack can be limited in size (see UndoStackEntry).
+	 */
+	class UndoCommand : public QUndoCommand
+	{
+	public:
+		/**
+		 * Gets the memory used by the data stored in the command.
+		 * @return Integer with the approximate number of bytes used by the command.
+		 */
+		virtual qint64 cost() const = 0;
+	};
+
+	/**
+	 * Undoable command for the movement of face features in one face image. Only the indexes
+	 * of the features moved and their old and new positions are stored. Consecutive moves of the
+	 * same features in the same image (i.e. repeated drags to adjust them) are merged into a
+	 * single command.
+	 */
+	class MoveFeaturesCommand : public UndoCommand
+	{
+	public:
+		/** Identifier of the command, used to merge consecutive moves. */
+		static const int ID;
+
+		/** Maximum interval (in miliseconds) between consecutive moves for them to be merged. */
+		static const int MERGE_INTERVAL;
+
+		/**
+		 * Class constructor. The movement is considered already done in the window, so the first
+		 * call to redo() (done when the command is pushed to the undo stack) does nothing.
+		 * @param pWindow Instance of the ChildWindow where the features were moved.
+		 * @param iImage Integer with the index of the face image where the features were moved.
+		 * @param lIndexes QList with the indexes of the features moved.
+		 * @param lOldPositions QList with the positions of the features before the movement.
+		 * @param lNewPositions QList with the positions of the features after the movement.
+		 */
+		MoveFeaturesCommand(ChildWindow *pWindow, const int iImage, const QList<int> &lIndexes, const QList<QPointF> &lOldPositions, const QList<QPointF> &lNewPositions);
+
+		/**
+		 * Undoes the movement, restoring the old positions.
+		 */
+		void undo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Redoes the movement, restoring the new positions.
+		 */
+		void redo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Gets the identifier of the command (used to merge consecutive moves).
+		 * @return Integer with the identifier of the command.
+		 */
+		int id() const Q_DECL_OVERRIDE;
+
+		/**
+		 * Merges the given command into this one, if both moved the same features in the same image
+		 * within the merge interval.
+		 * @param pOther Instance of the command pushed after this one.
+		 * @return Boolean indicating if the command was merged (true) or not (false).
+		 */
+		bool mergeWith(const QUndoCommand *pOther) Q_DECL_OVERRIDE;
+
+		/**
+		 * Gets the memory used by the data stored in the command.
+		 * @return Integer with the approximate number of bytes used by the command.
+		 */
+		qint64 cost() const Q_DECL_OVERRIDE;
+
+	private:
+		/** Window where the features were moved. */
+		ChildWindow *m_pWindow;
+
+		/** Index of the face image where the features were moved. */
+		int m_iImage;
+
+		/** Indexes of the features moved. */
+		QList<int> m_lIndexes;
+
+		/** Positions of the features before the movement. */
+		QList<QPointF> m_lOldPositions;
+
+		/** Positions of the features after the movement. */
+		QList<QPointF> m_lNewPositions;
+
+		/** Timer started with the last movement merged into the command. */
+		QElapsedTimer m_oTimer;
+
+		/** Indication that the movement is already done in the window. */
+		bool m_bDone;
+	};
+
+	/**
+	 * Undoable command for the addition of a face feature to all face images.
+	 */
+	class AddFeatureCommand : public UndoCommand
+	{
+	public:
+		/**
+		 * Class constructor.
+		 * @param pWindow Instance of the ChildWindow where the feature is added.
+		 * @param iIndex Integer with the index of the new feature (i.e. the current number of features).
+		 * @param oPos QPointF with the position of the new feature (the same in all face images).
+		 */
+		AddFeatureCommand(ChildWindow *pWindow, const int iIndex, const QPointF &oPos);
+
+		/**
+		 * Undoes the addition, removing the feature.
+		 */
+		void undo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Adds the feature.
+		 */
+		void redo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Gets the memory used by the data stored in the command.
+		 * @return Integer with the approximate number of bytes used by the command.
+		 */
+		qint64 cost() const Q_DECL_OVERRIDE;
+
+	private:
+		/** Window where the feature is added. */
+		ChildWindow *m_pWindow;
+
+		/** Index of the new feature. */
+		int m_iIndex;
+
+		/** Position of the new feature. */
+		QPointF m_oPos;
+	};
+
+	/**
+	 * Undoable command for the removal of face features from all face images. The positions of
+	 * the removed features in each face image (i.e. the removed columns of the dataset) and their
+	 * connections are stored, so the features can be restored.
+	 */
+	class RemoveFeaturesCommand : public UndoCommand
+	{
+	public:
+		/**
+		 * Class constructor.
+		 * @param pWindow Instance of the ChildWindow where the features are removed.
+		 * @param lIndexes QList with the indexes of the features to remove, in ascending order.
+		 * @param lPositions QList with the positions of each feature to remove in all face images.
+		 * @param lConnections QList with the connections of the features to remove (as pairs of
+		 * feature indexes).
+		 */
+		RemoveFeaturesCommand(ChildWindow *pWindow, const QList<int> &lIndexes, const QList<std::vector<cv::Point2f> > &lPositions, const QList<QPair<int, int> > &lConnections);
+
+		/**
+		 * Undoes the removal, restoring the features and their connections.
+		 */
+		void undo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Removes the features.
+		 */
+		void redo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Gets the memory used by the data stored in the command.
+		 * @return Integer with the approximate number of bytes used by the command.
+		 */
+		qint64 cost() const Q_DECL_OVERRIDE;
+
+	private:
+		/** Window where the features are removed. */
+		ChildWindow *m_pWindow;
+
+		/** Indexes of the features removed, in ascending order. */
+		QList<int> m_lIndexes;
+
+		/** Positions of each feature removed in all face images. */
+		QList<std::vector<cv::Point2f> > m_lPositions;
+
+		/** Connections of the features removed. */
+		QList<QPair<int, int> > m_lConnections;
+	};
+
+	/**
+	 * Undoable command for the connection or disconnection of face features.
+	 */
+	class ConnectFeaturesCommand : public UndoCommand
+	{
+	public:
+		/**
+		 * Class constructor.
+		 * @param pWindow Instance of the ChildWindow where the features are connected.
+		 * @param lConnections QList with the connections changed (as pairs of feature indexes).
+		 * @param bConnect Boolean indicating if the features are connected (true) or disconnected (false).
+		 */
+		ConnectFeaturesCommand(ChildWindow *pWindow, const QList<QPair<int, int> > &lConnections, const bool bConnect);
+
+		/**
+		 * Undoes the change in the connections.
+		 */
+		void undo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Changes the connections.
+		 */
+		void redo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Gets the memory used by the data stored in the command.
+		 * @return Integer with the approximate number of bytes used by the command.
+		 */
+		qint64 cost() const Q_DECL_OVERRIDE;
+
+	private:
+		/** Window where the features are connected. */
+		ChildWindow *m_pWindow;
+
+		/** Connections changed. */
+		QList<QPair<int, int> > m_lConnections;
+
+		/** Indication if the features are connected or disconnected. */
+		bool m_bConnect;
+	};
+
+	/**
+	 * Undoable command for the change of the emotion label of a face image.
+	 */
+	class SetEmotionLabelCommand : public UndoCommand
+	{
+	public:
+		/**
+		 * Class constructor. The change is considered already done in the window (it is done
+		 * directly in the data model by the views), so the first call to redo() does nothing.
+		 * @param pWindow Instance of the ChildWindow where the label was changed.
+		 * @param iImage Integer with the index of the face image.
+		 * @param eOldLabel EmotionLabel with the label before the change.
+		 * @param eNewLabel EmotionLabel with the label after the change.
+		 */
+		SetEmotionLabelCommand(ChildWindow *pWindow, const int iImage, const EmotionLabel eOldLabel, const EmotionLabel eNewLabel);
+
+		/**
+		 * Undoes the change, restoring the old label.
+		 */
+		void undo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Redoes the change, restoring the new label.
+		 */
+		void redo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Gets the memory used by the data stored in the command.
+		 * @return Integer with the approximate number of bytes used by the command.
+		 */
+		qint64 cost() const Q_DECL_OVERRIDE;
+
+	private:
+		/** Window where the label was changed. */
+		ChildWindow *m_pWindow;
+
+		/** Index of the face image. */
+		int m_iImage;
+
+		/** Label before the change. */
+		EmotionLabel m_eOldLabel;
+
+		/** Label after the change. */
+		EmotionLabel m_eNewLabel;
+
+		/** Indication that the change is already done in the window. */
+		bool m_bDone;
+	};
+
+	/**
+	 * Undoable command for the change of the emotion labels of several face images at once.
+	 */
+	class SetEmotionLabelsCommand : public UndoCommand
+	{
+	public:
+		/**
+		 * Class constructor. The change is considered already done in the window, so the first
+		 * call to redo() (done when the command is pushed to the undo stack) does nothing.
+		 * @param pWindow Instance of the ChildWindow where the labels were changed.
+		 * @param lImages QList with the indexes of the face images.
+		 * @param lOldLabels QList with the label of each face image before the change.
+		 * @param eNewLabel EmotionLabel with the label of all face images after the change.
+		 */
+		SetEmotionLabelsCommand(ChildWindow *pWindow, const QList<int> &lImages, const QList<EmotionLabel> &lOldLabels, const EmotionLabel eNewLabel);
+
+		/**
+		 * Undoes the change, restoring the old labels.
+		 */
+		void undo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Redoes the change, restoring the new label.
+		 */
+		void redo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Gets the memory used by the data stored in the command.
+		 * @return Integer with the approximate number of bytes used by the command.
+		 */
+		qint64 cost() const Q_DECL_OVERRIDE;
+
+	private:
+		/** Window where the labels were changed. */
+		ChildWindow *m_pWindow;
+
+		/** Indexes of the face images. */
+		QList<int> m_lImages;
+
+		/** Labels of the face images before the change. */
+		QList<EmotionLabel> m_lOldLabels;
+
+		/** Label of the face images after the change. */
+		EmotionLabel m_eNewLabel;
+
+		/** Indication that the change is already done in the window. */
+		bool m_bDone;
+	};
+
+	/**
+	 * Undoable command for the change of the shapes (the positions of all features) of several
+	 * face images at once, as when the features are transformed or copied in batch.
+	 */
+	class SetShapesCommand : public UndoCommand
+	{
+	public:
+		/**
+		 * Class constructor. The change is considered already done in the window, so the first
+		 * call to redo() (done when the command is pushed to the undo stack) does nothing.
+		 * @param pWindow Instance of the ChildWindow where the shapes were changed.
+		 * @param sText QString with the text of the command (displayed in the undo/redo actions).
+		 * @param lImages QList with the indexes of the face images.
+		 * @param vOldShapes Vector with the shape of each face image before the change.
+		 * @param vNewShapes Vector with the shape of each face image after the change.
+		 */
+		SetShapesCommand(ChildWindow *pWindow, const QString &sText, const QList<int> &lImages, const std::vector<std::vector<cv::Point2f> > &vOldShapes, const std::vector<std::vector<cv::Point2f> > &vNewShapes);
+
+		/**
+		 * Undoes the change, restoring the old shapes.
+		 */
+		void undo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Redoes the change, restoring the new shapes.
+		 */
+		void redo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Gets the memory used by the data stored in the command.
+		 * @return Integer with the approximate number of bytes used by the command.
+		 */
+		qint64 cost() const Q_DECL_OVERRIDE;
+
+	private:
+		/** Window where the shapes were changed. */
+		ChildWindow *m_pWindow;
+
+		/** Indexes of the face images. */
+		QList<int> m_lImages;
+
+		/** Shapes of the face images before the change. */
+		std::vector<std::vector<cv::Point2f> > m_vOldShapes;
+
+		/** Shapes of the face images after the change. */
+		std::vector<std::vector<cv::Point2f> > m_vNewShapes;
+
+		/** Indication that the change is already done in the window. */
+		bool m_bDone;
+	};
+
+	/**
+	 * Entry of the undo stack of a child window, that forwards to a shared UndoCommand. Since
+	 * QUndoStack can only limit the number of commands, the child windows limit the memory used
+	 * by rebuilding the stack with only its newest commands: the entries are deleted when the stack
+	 * is cleared, but not the commands, which are pushed again in new entries.
+	 */
+	class UndoStackEntry : public QUndoCommand
+	{
+	public:
+		/**
+		 * Class constructor.
+		 * @param pCommand Shared pointer to the command.
+		 * @param bRestored Boolean indicating if the command is already done in the window (i.e. it
+		 * is pushed again while the stack is rebuilt), so the first call to redo() does nothing.
+		 * The default is false.
+		 */
+		UndoStackEntry(const std::shared_ptr<UndoCommand> &pCommand, const bool bRestored = false);
+
+		/**
+		 * Undoes the command.
+		 */
+		void undo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Redoes the command (except in the first call if the command was restored).
+		 */
+		void redo() Q_DECL_OVERRIDE;
+
+		/**
+		 * Gets the identifier of the command. A restored command is never merged while pushed.
+		 * @return Integer with the identifier of the command.
+		 */
+		int id() const Q_DECL_OVERRIDE;
+
+		/**
+		 * Merges the command of the given entry into the command of this one.
+		 * @param pOther Instance of the entry pushed after this one.
+		 * @return Boolean indicating if the command was merged (true) or not (false).
+		 */
+		bool mergeWith(const QUndoCommand *pOther) Q_DECL_OVERRIDE;
+
+		/**
+		 * Gets the command of the entry.
+		 * @return Shared pointer to the command.
+		 */
+		std::shared_ptr<UndoCommand> command() const;
+
+		/**
+		 * Indicates that the restored command was pushed, so it can be merged again.
+		 */
+		void setPushed();
+
+	private:
+		/** Command of the entry. */
+		std::shared_ptr<UndoCommand> m_pCommand;
+
+		/** Indication that the command was restored and not yet pushed. */
+		bool m_bRestored;
+	};
+}
+
+#endif // UNDOCOMMANDS_H
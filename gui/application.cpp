@@ -27,6 +27,7 @@
 #include <QDir>
 #include <QStandardPaths>
 #include <QFileInfo>
+#include <QTimer>
 
 #include <iostream>
 #include <stdexcept>
@@ -36,13 +37,19 @@ using namespace std;
 // Initiate the singleton instance with null
 f3::F3Application* f3::F3Application::m_spInstance = NULL;
 
+// Timer used to measure the startup phases
+QElapsedTimer f3::F3Application::m_soStartupTimer;
+
 // +-----------------------------------------------------------
 void f3::F3Application::initiate(int argc, char* argv[], const QString &sAppName, const bool bCreateLog)
 {
 	if(!m_spInstance)
 	{
+		m_soStartupTimer.start();
 		m_spInstance = new F3Application(argc, argv);
+		markStartupPhase("application created");
 		m_spInstance->setup(sAppName, bCreateLog);
+		markStartupPhase("application configured");
 	}
 }
 
@@ -54,6 +61,7 @@ void f3::F3Application::loadAndShowMainWindow(const QMainWindow *pMainWindow)
 	m_pMainWindow->restoreGeometry(oSettings.value("geometry").toByteArray());
     m_pMainWindow->restoreState(oSettings.value("windowState").toByteArray());
 	m_pMainWindow->show();
+	markStartupPhase("main window restored");
 }
 
 // +-----------------------------------------------------------
@@ -77,6 +85,11 @@ void f3::F3Application::setup(const QString &sAppName, const bool bCreateLog)
 	m_sAppName = sAppName;
 	m_bCreateLog = bCreateLog;
 	m_pMainWindow = NULL;
+	m_bStartupBenchmark = arguments().contains("--startup-benchmark");
+	m_pScheduler = new TaskScheduler();
+
+	// The application-wide filter detects the first paint of the main window (see eventFilter())
+	installEventFilter(this);
 
 	// Only install the message handler and initialize the log control if required
 	if(m_bCreateLog)
@@ -101,12 +114,17 @@ void f3::F3Application::setup(const QString &sAppName, const bool bCreateLog)
 		// Default to only log fatal messages
 		m_eLogLevel = QtFatalMsg;
 		m_oLogControl.setLogLevel(m_sAppName, m_eLogLevel);
+		markStartupPhase("log control connected");
 	}
 }
 
 // +-----------------------------------------------------------
 void f3::F3Application::clean()
 {
+	// Cancel the background tasks and wait for the ones in execution
+	delete m_pScheduler;
+	m_pScheduler = NULL;
+
 	if(m_bCreateLog)
 	{
 		m_oLogFile.flush();
@@ -151,6 +169,7 @@ f3::F3Application* f3::F3Application::instance()
 f3::F3Application::F3Application(int argc, char* argv[]):
     QApplication(argc, argv)
 {
+	m_pScheduler = NULL;
 }
 
 // +-----------------------------------------------------------
@@ -188,6 +207,52 @@ bool f3::F3Application::notify(QObject* pReceiver, QEvent* pEvent)
     return false;
 }
 
+// +-----------------------------------------------------------
+bool f3::F3Application::eventFilter(QObject *pObject, QEvent *pEvent)
+{
+	if(pEvent->type() == QEvent::Paint && m_pMainWindow && pObject->isWidgetType() && ((QWidget*) pObject)->window() == m_pMainWindow)
+	{
+		removeEventFilter(this);
+		markStartupPhase("first paint");
+
+		// The window is interactive once the events queued up to its first paint are processed
+		QTimer::singleShot(0, this, SLOT(onStartupFinished()));
+	}
+
+	return QApplication::eventFilter(pObject, pEvent);
+}
+
+// +-----------------------------------------------------------
+void f3::F3Application::markStartupPhase(const QString &sPhase)
+{
+	if(m_spInstance)
+		m_spInstance->m_lStartupPhases.append(qMakePair(sPhase, m_soStartupTimer.elapsed()));
+}
+
+// +-----------------------------------------------------------
+f3::TaskScheduler* f3::F3Application::scheduler()
+{
+	return m_spInstance ? m_spInstance->m_pScheduler : NULL;
+}
+
+// +-----------------------------------------------------------
+void f3::F3Application::onStartupFinished()
+{
+	markStartupPhase("interactive");
+
+	QPair<QString, qint64> oPhase;
+	foreach(oPhase, m_lStartupPhases)
+		qDebug() << "Startup phase" << qPrintable(oPhase.first) << "concluded in" << oPhase.second << "ms";
+
+	if(m_bStartupBenchmark)
+	{
+		// Print the measurements as tab-separated values, so they can be easily compared by scripts
+		foreach(oPhase, m_lStartupPhases)
+			cout << qPrintable(m_sAppName) << "\t" << qPrintable(oPhase.first) << "\t" << oPhase.second << endl;
+		quit();
+	}
+}
+
 // +-----------------------------------------------------------
 void f3::F3Application::handleLogOutput(QtMsgType eType, const QMessageLogContext &oContext, const QString &sMsg) {
 	// Do not log the message if its type is bigger then the maximum configured log level
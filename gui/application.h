@@ -22,11 +22,15 @@
 #include <QApplication>
 #include <QMainWindow>
 #include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
 
 #include <fstream>
 
-#include "core_global.h"
+#include "gui_global.h"
 #include "logcontrol.h"
+#include "taskscheduler.h"
 
 namespace f3
 {
@@ -34,7 +38,7 @@ namespace f3
 	 * Custom Qt application class, mainly used to intercept message notifications in the fff project applications.
 	 * Made into a singleton in version 2.0.
 	 */
-	class CORE_EXPORT F3Application: public QApplication
+	class GUI_EXPORT F3Application: public QApplication
 	{
 		Q_OBJECT
 	private:
@@ -87,6 +91,23 @@ namespace f3
 		 */
 		static void showStatusMessage(const QString &sMsg, const int iTimeout = 5000);
 
+		/**
+		 * Records the conclusion of a startup phase. The time elapsed since the application was
+		 * initiated is stored with the phase name and logged (together with the time to the first
+		 * paint and the time to interactive of the main window) once the startup is completed.
+		 * @param sPhase QString with the name of the phase just concluded.
+		 */
+		static void markStartupPhase(const QString &sPhase);
+
+		/**
+		 * Gets the scheduler used to execute the background tasks of the application. All
+		 * background work shall be scheduled through it, so the tasks do not compete for the
+		 * cores among themselves nor with the GUI thread.
+		 * @return Instance of the TaskScheduler of the application, or NULL if the application
+		 * was not yet initiated.
+		 */
+		static TaskScheduler* scheduler();
+
 		/**
 		 * Sets the main window to be used with this application, load its properties and
 		 * display it. The application handles the saving of the window properties such as geometry
@@ -102,6 +123,15 @@ namespace f3
 		 */
         bool notify(QObject* pReceiver, QEvent* pEvent);
 
+		/**
+		 * Filters the application events while the startup is in progress, in order to detect
+		 * the first paint of the main window.
+		 * @param pObject Pointer to the QObject receiving the event.
+		 * @param pEvent Pointer to the QEvent with the event information.
+		 * @return Boolean indicating if the event was filtered out (always false).
+		 */
+		bool eventFilter(QObject *pObject, QEvent *pEvent);
+
 	signals:
 
 		/**
@@ -146,6 +176,16 @@ namespace f3
 		 */
 		static void handleLogOutput(QtMsgType eType, const QMessageLogContext& oContext, const QString& sMsg);
 
+	private slots:
+
+		/**
+		 * Concludes the startup measurements once the main window is interactive (i.e. after its first
+		 * paint has been done and the pending events have been processed). If the application was
+		 * started with the argument --startup-benchmark, the measurements are also printed to the
+		 * standard output and the application quits.
+		 */
+		void onStartupFinished();
+
 	private:
 
 		/** Object used to allow the external update of the log level. */
@@ -159,6 +199,18 @@ namespace f3
 
 		/** Indication about creating a log file. */
 		bool m_bCreateLog;
+
+		/** Timer started when the application is initiated, used to measure the startup phases. */
+		static QElapsedTimer m_soStartupTimer;
+
+		/** List of the startup phases concluded so far, with their elapsed times in miliseconds. */
+		QList<QPair<QString, qint64> > m_lStartupPhases;
+
+		/** Indication that the application was started only to benchmark its startup. */
+		bool m_bStartupBenchmark;
+
+		/** Scheduler of the background tasks of the application. */
+		TaskScheduler *m_pScheduler;
 	};
 }
 
@@ -0,0 +1,71 @@
+#
+# Copyright (C) 2015 Luiz Carlos Vieira (http://www.luiz.vieira.nom.br)
+#
+# This file is part of Fun from Faces (f3).
+#
+# f3 is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# f3 is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+QT += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+DEFINES += GUI_LIBRARY
+
+win32 {
+	TEMPLATE = vclib
+	QMAKE_LFLAGS += /INCREMENTAL:NO
+} else {
+	TEMPLATE = lib
+}
+
+CONFIG += lib
+
+SOURCES += application.cpp
+
+HEADERS += gui_global.h \
+           application.h
+
+DEPENDS += ../core
+INCLUDEPATH += ../core
+
+CONFIG(debug, debug|release) {
+
+	TARGET = f3guid
+    DESTDIR = ../debug
+	OBJECTS_DIR = ../debug/tmp/gui
+	MOC_DIR = ../debug/tmp/gui
+	RCC_DIR = ../debug/tmp/gui
+	UI_DIR = ../debug/tmp/gui
+
+	LIBS += -L../debug
+	LIBS += -lf3cored
+
+} else {
+
+	TARGET = f3gui
+    DESTDIR = ../release
+	OBJECTS_DIR = ../release/tmp/gui
+	MOC_DIR = ../release/tmp/gui
+	RCC_DIR = ../release/tmp/gui
+	UI_DIR = ../release/tmp/gui
+
+	LIBS += -L../release
+	LIBS += -lf3core
+}
+
+unix {
+    target.path = /usr/local/lib
+    INSTALLS += target
+}
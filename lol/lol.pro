@@ -50,8 +50,8 @@ win32 {
 	LIBS += -L/usr/local/lib
 }
 
-DEPENDS += ../core
-INCLUDEPATH += ../core
+DEPENDS += ../core ../gui
+INCLUDEPATH += ../core ../gui
 
 CONFIG(debug, debug|release) {
 
@@ -63,6 +63,7 @@ CONFIG(debug, debug|release) {
 	UI_DIR = ../debug/tmp/lol
 
 	LIBS += -L../debug
+	LIBS += -lf3guid
 	LIBS += -lf3cored
 
 } else {
@@ -75,10 +76,16 @@ CONFIG(debug, debug|release) {
 	UI_DIR = ../release/tmp/lol
 
 	LIBS += -L../release
+	LIBS += -lf3gui
 	LIBS += -lf3core
     
 }
 
+# Startup benchmark: runs the application until its main window is interactive and prints
+# the time spent up to each startup phase (including the first paint) as tab-separated values
+startupbench.commands = $$DESTDIR/$$TARGET --startup-benchmark
+QMAKE_EXTRA_TARGETS += startupbench
+
 RESOURCES += resources.qrc
 win32:RC_FILE = win_resources.rc
 
@@ -40,6 +40,7 @@ int main(int argc, char *argv[])
 	
 	// Create the main window (as a pointer because it must be deleted before the application to avoid double deletion)
 	MainWindow *pMainWindow = new MainWindow();
+	F3Application::markStartupPhase("main window created");
 	QObject::connect(F3Application::instance(), SIGNAL(statusMessageShown(const QString &, const int)), pMainWindow, SLOT(showStatusMessage(const QString &, const int)));
 
 	// Load main window geometry and widgets states and show it
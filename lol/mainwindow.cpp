@@ -30,6 +30,7 @@
 #include <QUrl>
 #include <QComboBox>
 #include <QDateTime>
+#include <QTimer>
 
 using namespace std;
 
@@ -41,6 +42,7 @@ f3::MainWindow::MainWindow(QWidget *pParent) :
 	// Setup the UI
     ui->setupUi(this);
     m_pAbout = NULL;
+	m_pLevelDelegate = NULL;
 
     setWindowIcon(QIcon(":/icons/lol"));
 
@@ -56,7 +58,6 @@ f3::MainWindow::MainWindow(QWidget *pParent) :
 	}
 
 	ui->treeData->setModel(&m_oDataModel);
-	ui->treeData->setItemDelegate(new LevelDelegate());
 }
 
 // +-----------------------------------------------------------
@@ -88,7 +89,10 @@ void f3::MainWindow::on_actionProject_triggered()
 // +-----------------------------------------------------------
 void f3::MainWindow::on_actionAbout_triggered()
 {
-	(new AboutWindow(this))->show();
+	// The about window is only created the first time it is requested
+	if(!m_pAbout)
+		m_pAbout = new AboutWindow(this);
+	m_pAbout->show();
 }
 
 // +-----------------------------------------------------------
@@ -100,6 +104,17 @@ void f3::MainWindow::showStatusMessage(const QString &sMsg, const int iTimeout)
 // +-----------------------------------------------------------
 void f3::MainWindow::showEvent(QShowEvent *)
 {
+	QTimer::singleShot(0, this, SLOT(onShown()));
+}
+
+// +-----------------------------------------------------------
+void f3::MainWindow::onShown()
+{
+	if(!m_pLevelDelegate)
+	{
+		m_pLevelDelegate = new LevelDelegate(this);
+		ui->treeData->setItemDelegate(m_pLevelDelegate);
+	}
 	updateUI();
 }
 
@@ -22,6 +22,7 @@
 
 #include "aboutwindow.h"
 #include "datamodel.h"
+#include "leveldelegate.h"
 
 #include <QMainWindow>
 #include <QTreeWidget>
@@ -95,6 +96,12 @@ namespace f3
          */
         void on_actionAbout_triggered();
 
+		/**
+		 * Completes the setup of the window after it has been displayed, so the work not required
+		 * for the first paint (like querying the running applications) does not delay it.
+		 */
+		void onShown();
+
     private:
         /** Instance of the ui for GUI element access. */
         Ui::MainWindow *ui;
@@ -104,6 +111,9 @@ namespace f3
 
 		/** Object used to access the log data via inter-process communication. */
 		DataModel m_oDataModel;
+
+		/** Item delegate used to edit the log levels (created only after the window is displayed). */
+		LevelDelegate *m_pLevelDelegate;
     };
 
 }